@@ -303,16 +303,18 @@ void AddonsManager::checkInstalledAddons()
     // -----------
     for(unsigned int i=0; i<kart_properties_manager->getNumberOfKarts(); i++)
     {
-        const KartProperties *kp = kart_properties_manager->getKartById(i);
-        const std::string &dir=kp->getKartDir();
+        const std::string &dir =
+            (*kart_properties_manager->getAllKartDirs())[i];
         if(dir.find(file_manager->getAddonsDir())==std::string::npos)
             continue;
-        int n = getAddonIndex(kp->getIdent());
+        const std::string &ident =
+            kart_properties_manager->getKartInfo(i).m_ident;
+        int n = getAddonIndex(ident);
         if(n<0) continue;
         if(!m_addons_list.getData()[n].isInstalled())
         {
             Log::info("[AddonsManager] Marking '%s' as being installed.",
-                   kp->getIdent().c_str());
+                   ident.c_str());
             m_addons_list.getData()[n].setInstalled(true);
             something_was_changed = true;
         }
@@ -320,18 +322,20 @@ void AddonsManager::checkInstalledAddons()
 
     // Then tracks
     // -----------
+    const std::vector<std::string> track_idents =
+        track_manager->getAllTrackIdentifiers();
     for(unsigned int i=0; i<track_manager->getNumberOfTracks(); i++)
     {
-        const Track *track = track_manager->getTrack(i);
-        const std::string &dir=track->getFilename();
+        const std::string &dir = (*track_manager->getAllTrackDirs())[i];
         if(dir.find(file_manager->getAddonsDir())==std::string::npos)
             continue;
-        int n = getAddonIndex(track->getIdent());
+        const std::string &ident = track_idents[i];
+        int n = getAddonIndex(ident);
         if(n<0) continue;
         if(!m_addons_list.getData()[n].isInstalled())
         {
             Log::info("[AddonsManager] Marking '%s' as being installed.",
-                   track->getIdent().c_str());
+                   ident.c_str());
             m_addons_list.getData()[n].setInstalled(true);
             something_was_changed = true;
         }
@@ -475,6 +479,8 @@ bool AddonsManager::install(const Addon &addon)
     std::string to        = addon.getDataDir();
 
     success = extract_zip(from, to);
+    // The extracted files must be visible to the file manager
+    file_manager->invalidateDirectoryIndex();
     if (!success)
     {
         // TODO: show a message in the interface
@@ -501,17 +507,14 @@ bool AddonsManager::install(const Addon &addon)
         // when reloading the karts. This is important on one hand since we
         // reload all karts (this function is easily available) and existing
         // karts will not reload their meshes.
-        const KartProperties *prop =
-            kart_properties_manager->getKart(addon.getId());
         // If the model already exist, first remove the old kart
-        if(prop)
+        if(kart_properties_manager->hasKart(addon.getId()))
             kart_properties_manager->removeKart(addon.getId());
         kart_properties_manager->loadKart(addon.getDataDir());
     }
     else if (addon.getType()=="track" || addon.getType()=="arena")
     {
-        Track *track = track_manager->getTrack(addon.getId());
-        if(track)
+        if(track_manager->hasTrack(addon.getId()))
             track_manager->removeTrack(addon.getId());
 
         try
@@ -563,12 +566,12 @@ bool AddonsManager::uninstall(const Addon &addon)
         // check first if the track is still known.
         if(addon.getType()=="kart")
         {
-            if(kart_properties_manager->getKart(addon.getId()))
+            if(kart_properties_manager->hasKart(addon.getId()))
                kart_properties_manager->removeKart(addon.getId());
         }
         else if(addon.getType()=="track" || addon.getType()=="arena")
         {
-            if(track_manager->getTrack(addon.getId()))
+            if(track_manager->hasTrack(addon.getId()))
                track_manager->removeTrack(addon.getId());
         }
     }
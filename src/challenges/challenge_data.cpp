@@ -127,7 +127,7 @@ ChallengeData::ChallengeData(const std::string& filename)
         {
             error("track");
         }
-        if (track_manager->getTrack(m_track_id) == NULL)
+        if (!track_manager->hasTrack(m_track_id))
         {
             error("track");
         }
@@ -329,16 +329,16 @@ void ChallengeData::setUnlocks(const std::string &id, RewardType reward)
                             break;
                             }
     case UNLOCK_KART:       {
-                            const KartProperties* prop =
-                                kart_properties_manager->getKart(id);
-                            if (prop == NULL)
+                            if (!kart_properties_manager->hasKart(id))
                             {
                                 Log::warn("ChallengeData", "Challenge refers to kart %s, "
                                           "which is unknown. Ignoring reward.",
                                           id.c_str());
                                 break;
                             }
-                            irr::core::stringw user_name = prop->getName();
+                            irr::core::stringw user_name =
+                                kart_properties_manager->getKartName(
+                                      kart_properties_manager->getKartId(id));
                             addUnlockKartReward(id, user_name);
                             break;
                             }
@@ -507,14 +507,13 @@ const irr::core::stringw
         }
         case UNLOCK_KART:
         {
-            const KartProperties* kp =
-            kart_properties_manager->getKart(m_name);
-
             // shouldn't happen but let's avoid crashes as much as possible...
-            if (kp == NULL) return irr::core::stringw( L"????" );
+            if (!kart_properties_manager->hasKart(m_name))
+                return irr::core::stringw( L"????" );
 
             return _("New kart '%s' now available",
-                      core::stringw(kp->getName()));
+                     kart_properties_manager->getKartName(
+                                   kart_properties_manager->getKartId(m_name)));
         }
         default:
             assert(false);
@@ -530,7 +529,7 @@ const irr::core::stringw
 void ChallengeData::addUnlockTrackReward(const std::string &track_name)
 {
 
-    if (track_manager->getTrack(track_name) == NULL)
+    if (!track_manager->hasTrack(track_name))
     {
         throw std::runtime_error(
             StringUtils::insertValues("Challenge refers to unknown track <%s>",
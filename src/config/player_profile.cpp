@@ -153,8 +153,8 @@ void PlayerProfile::addIcon()
         return;
 
     int n = m_unique_id % kart_properties_manager->getNumberOfKarts();
-    std::string source = kart_properties_manager->getKartById(n)
-                                                ->getAbsoluteIconFile();
+    std::string source = kart_properties_manager->getKartInfo(n)
+                                                .m_icon_file;
     // Create the filename for the icon of this player: the unique id
     // followed by .png or .jpg.
     std::ostringstream out;
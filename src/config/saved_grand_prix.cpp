@@ -146,12 +146,12 @@ void SavedGrandPrix::loadKarts(std::vector<RaceManager::KartStatus> & kart_list)
     int aikarts = 0;
     for(unsigned int i = 0; i < m_karts.size(); i++)
     {
-        const KartProperties *kp = kart_properties_manager->getKart(m_karts[i].m_ident);
+        bool has_kart = kart_properties_manager->hasKart(m_karts[i].m_ident);
 
         if(m_karts[i].m_local_player_id == -1)
         {
             //AI kart found
-            if(kp) kart_list[aikarts].m_ident = m_karts[i].m_ident;
+            if(has_kart) kart_list[aikarts].m_ident = m_karts[i].m_ident;
             kart_list[aikarts].m_score = m_karts[i].m_score;
             kart_list[aikarts].m_overall_time = m_karts[i].m_overall_time;
             aikarts++;
@@ -482,6 +482,10 @@ namespace UserConfigParams
     /** If track debugging is enabled. */
     PARAM_PREFIX int m_track_debug PARAM_DEFAULT( false );
 
+    /** True if the sector lookup in the quad graph should be compared
+     *  with the (slow) test of all quads. */
+    PARAM_PREFIX bool m_sector_debug PARAM_DEFAULT( false );
+
     /** True if check structures should be debugged. */
     PARAM_PREFIX bool m_check_debug PARAM_DEFAULT( false );
 
@@ -556,9 +560,41 @@ namespace UserConfigParams
                             "stun.voxgratia.org",
                             "stun.xten.com") );
 
+    PARAM_PREFIX IntUserConfigParam         m_network_state_frequency
+            PARAM_DEFAULT(  IntUserConfigParam(20, "network_state_frequency",
+                                       "How many times per second the kart states are sent.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_server_tick_rate
+            PARAM_DEFAULT(  IntUserConfigParam(60, "server_tick_rate",
+                                       "How many times per second a dedicated (no graphics) server, and the world of an online race, is updated.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_network_rewind_ticks
+            PARAM_DEFAULT(  IntUserConfigParam(30, "network_rewind_ticks",
+                                       "How many ticks the world of an online race can be rewound to apply late inputs.") );
+
+    /** True to rewind and re-simulate the karts when inputs arrive late
+     *  (server) or the server state differs from the prediction (client).
+     *  Set with --network-rollback. */
+    PARAM_PREFIX bool m_network_rollback PARAM_DEFAULT( false );
+
+    /** Artificial latency in ms added to all received packets, to test
+     *  online races on one machine (set with --network-latency). */
+    PARAM_PREFIX int  m_network_latency PARAM_DEFAULT( 0 );
+
+    PARAM_PREFIX IntUserConfigParam         m_ai_threads
+            PARAM_DEFAULT(  IntUserConfigParam(1, "ai_threads",
+                                       "Number of threads used to compute the AI decisions (0: one per core, 1: no additional threads, the AI is updated with each kart).") );
+
     PARAM_PREFIX StringUserConfigParam m_packets_log_filename
-            PARAM_DEFAULT( StringUserConfigParam("packets_log.txt", "packets_log_filename",
-                                                 "Where to log received and sent packets.") );
+            PARAM_DEFAULT( StringUserConfigParam("packets.cap", "packets_log_filename",
+                                                 "Where to capture received and sent packets (empty: no capture).") );
+
+    /** Packet capture to replay instead of starting the network (set
+     *  with --replay-packets). */
+    PARAM_PREFIX std::string m_packets_replay_filename PARAM_DEFAULT( "" );
+
+    /** True to replay the packets with the captured timing. */
+    PARAM_PREFIX bool m_packets_replay_real_time PARAM_DEFAULT( false );
 
     // ---- Graphic Quality
     PARAM_PREFIX GroupUserConfigParam        m_graphics_quality
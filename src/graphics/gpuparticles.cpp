@@ -1,6 +1,7 @@
 #include "graphics/irr_driver.hpp"
 #include "gpuparticles.hpp"
 #include "io/file_manager.hpp"
+#include "tracks/height_map.hpp"
 #include "config/user_config.hpp"
 #include <ICameraSceneNode.h>
 #include <IParticleSystemSceneNode.h>
@@ -86,31 +87,20 @@ void ParticleSystemProxy::setFlip()
     flip = true;
 }
 
-void ParticleSystemProxy::setHeightmap(const std::vector<std::vector<float> > &hm,
+void ParticleSystemProxy::setHeightmap(const HeightMap &hm,
     float f1, float f2, float f3, float f4)
 {
     track_x = f1, track_z = f2, track_x_len = f3, track_z_len = f4;
 
-    unsigned width = hm.size();
-    unsigned height = hm[0].size();
-    float *hm_array = new float[width * height];
-    for (unsigned i = 0; i < width; i++)
-    {
-        for (unsigned j = 0; j < height; j++)
-        {
-            hm_array[i * height + j] = hm[i][j];
-        }
-    }
+    unsigned size = hm.getResolution() * hm.getResolution();
     has_height_map = true;
     glGenBuffers(1, &heighmapbuffer);
     glBindBuffer(GL_TEXTURE_BUFFER, heighmapbuffer);
-    glBufferData(GL_TEXTURE_BUFFER, width * height * sizeof(float), hm_array, GL_STATIC_DRAW);
+    glBufferData(GL_TEXTURE_BUFFER, size * sizeof(float), hm.getData(), GL_STATIC_DRAW);
     glGenTextures(1, &heightmaptexture);
     glBindTexture(GL_TEXTURE_BUFFER, heightmaptexture);
     glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, heighmapbuffer);
     glBindBuffer(GL_TEXTURE_BUFFER, 0);
-
-    delete[] hm_array;
 }
 
 static
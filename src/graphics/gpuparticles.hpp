@@ -8,6 +8,7 @@
 #include <IParticleSystemSceneNode.h>
 
 namespace irr { namespace video{ class ITexture; } }
+class HeightMap;
 
 class ParticleSystemProxy : public scene::CParticleSystemSceneNode
 {
@@ -63,7 +64,7 @@ public:
     void setColorTo(float r, float g, float b) { m_color_to[0] = r; m_color_to[1] = g; m_color_to[2] = b; }
     const float* getColorFrom() const { return m_color_from; }
     const float* getColorTo() const { return m_color_to; }
-    void setHeightmap(const std::vector<std::vector<float> >&, float, float, float, float);
+    void setHeightmap(const HeightMap &, float, float, float, float);
     void setFlip();
 };
 
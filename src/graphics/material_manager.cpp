@@ -58,25 +58,66 @@ MaterialManager::~MaterialManager()
         delete m_materials[i];
     }
     m_materials.clear();
+    m_material_index.clear();
+    m_texture_materials.clear();
 }   // ~MaterialManager
 
+//-----------------------------------------------------------------------------
+/** Adds a material and makes it the one found for its texture name.
+ *  \param m The material to add.
+ */
+void MaterialManager::addMaterial(Material *m)
+{
+    m_materials.push_back(m);
+    m_material_index[m->getTexFname()].push_back(m);
+    m_texture_materials.clear();
+}   // addMaterial
+
+//-----------------------------------------------------------------------------
+/** Deletes the last added material, which makes a previously added material
+ *  with the same texture name (if any) visible again.
+ */
+void MaterialManager::removeLastMaterial()
+{
+    Material *m = m_materials.back();
+    MaterialIndex::iterator i = m_material_index.find(m->getTexFname());
+    assert(i != m_material_index.end() && i->second.back() == m);
+    i->second.pop_back();
+    if (i->second.empty())
+        m_material_index.erase(i);
+    m_texture_materials.clear();
+    delete m;
+    m_materials.pop_back();
+}   // removeLastMaterial
+
+//-----------------------------------------------------------------------------
+/** Returns the material for a texture name (without path), or NULL if no
+ *  material with this name exists. If there is more than one, the last
+ *  added one is returned, so temporary (track) textures are found first.
+ *  \param basename Name of the texture.
+ */
+Material* MaterialManager::findMaterial(const std::string &basename) const
+{
+    MaterialIndex::const_iterator i = m_material_index.find(basename);
+    return i == m_material_index.end() ? NULL : i->second.back();
+}   // findMaterial
+
 //-----------------------------------------------------------------------------
 
 Material* MaterialManager::getMaterialFor(video::ITexture* t,
                                           scene::IMeshBuffer *mb)
 {
     assert(t != NULL);
-    const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname()==image)
-        {
-            return m_materials[i];
-        }
-    }   // for i
+    TextureMaterials::iterator i = m_texture_materials.find(t);
+    if (i != m_texture_materials.end() &&
+        i->second.m_name == t->getName().getPath())
+        return i->second.m_material;
 
-    return NULL;
+    const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
+    TextureMaterial &tm = m_texture_materials[t];
+    tm.m_material = findMaterial(image);
+    tm.m_name     = t->getName().getPath();
+    return tm.m_material;
 }
 
 //-----------------------------------------------------------------------------
@@ -143,15 +184,9 @@ void MaterialManager::adjustForFog(video::ITexture* t,
                                    bool use_fog) const
 {
     const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname()==image)
-        {
-            m_materials[i]->adjustForFog(parent, &(mb->getMaterial()), use_fog);
-            return;
-        }
-    }   // for i
+    Material *m = findMaterial(image);
+    if (m)
+        m->adjustForFog(parent, &(mb->getMaterial()), use_fog);
 }   // adjustForFog
 
 //-----------------------------------------------------------------------------
@@ -173,7 +208,7 @@ void MaterialManager::setAllUntexturedMaterialFlags(scene::IMeshBuffer *mb) cons
 //-----------------------------------------------------------------------------
 int MaterialManager::addEntity(Material *m)
 {
-    m_materials.push_back(m);
+    addMaterial(m);
     return (int)m_materials.size()-1;
 }
 
@@ -244,7 +279,7 @@ bool MaterialManager::pushTempMaterial(const XMLNode *root,
         }
         try
         {
-            m_materials.push_back(new Material(node, m_materials.size(), deprecated));
+            addMaterial(new Material(node, m_materials.size(), deprecated));
         }
         catch(std::exception& e)
         {
@@ -261,8 +296,7 @@ void MaterialManager::popTempMaterial()
 {
     for(int i=(int)m_materials.size()-1; i>=this->m_shared_material_index; i--)
     {
-        delete m_materials[i];
-        m_materials.pop_back();
+        removeLastMaterial();
     }   // for i6
 }   // popTempMaterial
 
@@ -304,15 +338,12 @@ Material *MaterialManager::getMaterial(const std::string& fname,
     else
         basename = fname;
         
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return m_materials[i];
-    }
+    Material *existing = findMaterial(basename);
+    if(existing) return existing;
 
     // Add the new material
     Material* m=new Material(fname, m_materials.size(), is_full_path, complain_if_not_found);
-    m_materials.push_back(m);
+    addMaterial(m);
     if(make_permanent)
     {
         assert(m_shared_material_index==(int)m_materials.size()-1);
@@ -334,11 +365,5 @@ void MaterialManager::makeMaterialsPermanent()
 bool MaterialManager::hasMaterial(const std::string& fname)
 {
     std::string basename=StringUtils::getBasename(fname);
-
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return true;
-    }
-    return false;
+    return findMaterial(basename) != NULL;
 }
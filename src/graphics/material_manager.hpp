@@ -20,6 +20,7 @@
 #ifndef HEADER_MATERIAL_MANAGER_HPP
 #define HEADER_MATERIAL_MANAGER_HPP
 
+#include "utils/cpp2011.hpp"
 #include "utils/no_copy.hpp"
 
 namespace irr
@@ -29,9 +30,17 @@ namespace irr
 }
 using namespace irr;
 
+#include <path.h>
+
 #include <string>
 #include <vector>
 
+#ifdef STDCPP2011
+#  include <unordered_map>
+#else
+#  include <map>
+#endif
+
 class Material;
 class XMLReader;
 class XMLNode;
@@ -42,11 +51,42 @@ class XMLNode;
 class MaterialManager : public NoCopy
 {
 private:
+    /** The material found for a texture, see m_texture_materials. */
+    struct TextureMaterial
+    {
+        Material *m_material;
+        /** Name of the texture, to detect if the texture was freed and
+         *  another texture was allocated at the same address. */
+        io::path  m_name;
+    };   // TextureMaterial
 
-    void    parseMaterialFile(const std::string& filename);
+    // Hash maps are only available with C++11.
+#ifdef STDCPP2011
+    typedef std::unordered_map<std::string, std::vector<Material*> >
+                                                          MaterialIndex;
+    typedef std::unordered_map<video::ITexture*, TextureMaterial>
+                                                          TextureMaterials;
+#else
+    typedef std::map<std::string, std::vector<Material*> > MaterialIndex;
+    typedef std::map<video::ITexture*, TextureMaterial>    TextureMaterials;
+#endif
+
+    void      parseMaterialFile(const std::string& filename);
+    void      addMaterial(Material *m);
+    void      removeLastMaterial();
+    Material* findMaterial(const std::string &basename) const;
     int     m_shared_material_index;
 
     std::vector<Material*> m_materials;
+
+    /** For each texture name the stack of all materials with this name.
+     *  The last one is used, so temporary (track) materials shadow the
+     *  shared ones. */
+    MaterialIndex          m_material_index;
+
+    /** Caches the result of getMaterialFor for each texture. It is cleared
+     *  whenever materials are added or removed. */
+    TextureMaterials       m_texture_materials;
 public:
               MaterialManager();
              ~MaterialManager();
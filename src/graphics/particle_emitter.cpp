@@ -25,6 +25,7 @@
 #include "graphics/shaders.hpp"
 #include "graphics/wind.hpp"
 #include "io/file_manager.hpp"
+#include "tracks/height_map.hpp"
 #include "tracks/track.hpp"
 #include "utils/constants.hpp"
 #include "utils/helpers.hpp"
@@ -104,12 +105,12 @@ public:
 
 class HeightMapCollisionAffector : public scene::IParticleAffector
 {
-    std::vector< std::vector<float> > m_height_map;
+    const HeightMap* m_height_map;
     Track* m_track;
     bool m_first_time;
 
 public:
-    HeightMapCollisionAffector(Track* t) : m_height_map(t->buildHeightMap())
+    HeightMapCollisionAffector(Track* t) : m_height_map(t->getHeightMap())
     {
         m_track = t;
         m_first_time = true;
@@ -120,26 +121,21 @@ public:
         const Vec3* aabb_min;
         const Vec3* aabb_max;
         m_track->getAABB(&aabb_min, &aabb_max);
-        float track_x = aabb_min->getX();
-        float track_z = aabb_min->getZ();
-        const float track_x_len = aabb_max->getX() - aabb_min->getX();
-        const float track_z_len = aabb_max->getZ() - aabb_min->getZ();
 
         for (unsigned int n=0; n<count; n++)
         {
             scene::SParticle& curr = particlearray[n];
-            const int i = (int)( (curr.pos.X - track_x)
-                                 /track_x_len*(HEIGHT_MAP_RESOLUTION) );
-            const int j = (int)( (curr.pos.Z - track_z)
-                                 /track_z_len*(HEIGHT_MAP_RESOLUTION) );
-            if (i >= HEIGHT_MAP_RESOLUTION || j >= HEIGHT_MAP_RESOLUTION) continue;
-            if (i < 0 || j < 0) continue;
+            if (curr.pos.X < aabb_min->getX() || curr.pos.X >= aabb_max->getX() ||
+                curr.pos.Z < aabb_min->getZ() || curr.pos.Z >= aabb_max->getZ())
+                continue;
+            const float height = m_height_map->getHeightAt(curr.pos.X,
+                                                           curr.pos.Z);
 
             /*
             // debug draw
             core::vector3df lp = curr.pos;
             core::vector3df lp2 = curr.pos;
-            lp2.Y = m_height_map[i][j] + 0.02f;
+            lp2.Y = height + 0.02f;
 
             irr_driver->getVideoDriver()->draw3DLine(lp, lp2, video::SColor(255,255,0,0));
             core::vector3df lp3 = lp2;
@@ -154,13 +150,13 @@ public:
 
             if (m_first_time)
             {
-                curr.pos.Y = m_height_map[i][j]
-                           + (curr.pos.Y - m_height_map[i][j])
+                curr.pos.Y = height
+                           + (curr.pos.Y - height)
                                 *((rand()%500)/500.0f);
             }
             else
             {
-                if (curr.pos.Y < m_height_map[i][j])
+                if (curr.pos.Y < height)
                 {
                     //curr.color = video::SColor(255,255,0,0);
                     curr.endTime = curr.startTime; // destroy particle
@@ -705,7 +701,7 @@ void ParticleEmitter::addHeightMapAffector(Track* t)
         float track_z = aabb_min->getZ();
         const float track_x_len = aabb_max->getX() - aabb_min->getX();
         const float track_z_len = aabb_max->getZ() - aabb_min->getZ();
-        static_cast<ParticleSystemProxy *>(m_node)->setHeightmap(t->buildHeightMap(),
+        static_cast<ParticleSystemProxy *>(m_node)->setHeightmap(*t->getHeightMap(),
             track_x, track_z, track_x_len, track_z_len);
     }
     else
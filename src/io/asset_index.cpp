@@ -0,0 +1,347 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "io/asset_index.hpp"
+
+#include "io/file_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/types.hpp"
+
+#include <irrXML.h>
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+/** Identifies a manifest file. */
+static const uint32_t MANIFEST_MAGIC   = 0x58444e49;
+/** Must be increased when the format of the manifest changes. */
+static const uint32_t MANIFEST_VERSION = 1;
+
+// ----------------------------------------------------------------------------
+/** Returns the value of an attribute.
+ *  \param name Name of the attribute.
+ *  \param value On return the value, unchanged if the attribute does not
+ *         exist.
+ *  \return True if the attribute exists.
+ */
+bool AssetIndex::Entry::get(const std::string &name, std::string *value) const
+{
+    std::map<std::string, std::string>::const_iterator i =
+                                                      m_attributes.find(name);
+    if(i==m_attributes.end())
+        return false;
+    *value = i->second;
+    return true;
+}   // get(std::string)
+
+// ----------------------------------------------------------------------------
+bool AssetIndex::Entry::get(const std::string &name, int *value) const
+{
+    std::string s;
+    if(!get(name, &s)) return false;
+    return StringUtils::parseString<int>(s, value);
+}   // get(int)
+
+// ----------------------------------------------------------------------------
+/** Returns a boolean attribute, using the same interpretation as
+ *  XMLNode::get. */
+bool AssetIndex::Entry::get(const std::string &name, bool *value) const
+{
+    std::string s;
+    if(!get(name, &s) || s.empty()) return false;
+    *value = s[0]=='T' || s[0]=='t' || s[0]=='Y' || s[0]=='y' ||
+             s=="#t"   || s   =="#T" || s=="1";
+    return true;
+}   // get(bool)
+
+// ----------------------------------------------------------------------------
+/** Returns an attribute split by spaces. */
+bool AssetIndex::Entry::get(const std::string &name,
+                            std::vector<std::string> *value) const
+{
+    std::string s;
+    if(!get(name, &s)) return false;
+    *value = StringUtils::split(s, ' ');
+    return true;
+}   // get(std::vector<std::string>)
+
+// ============================================================================
+/** Creates an empty index.
+ *  \param root_name Name of the root node of the files to index.
+ *  \param manifest_name Name of the manifest file in the cached data
+ *         directory.
+ *  \param attribute_names NULL terminated list of the attributes of the
+ *         root node to index.
+ */
+AssetIndex::AssetIndex(const std::string &root_name,
+                       const std::string &manifest_name,
+                       const char **attribute_names)
+{
+    m_root_name     = root_name;
+    m_manifest_file = file_manager->getCachedDataDir() + manifest_name;
+    for(unsigned int i=0; attribute_names[i]; i++)
+        m_attribute_names.push_back(attribute_names[i]);
+}   // AssetIndex
+
+// ----------------------------------------------------------------------------
+/** Removes all entries. */
+void AssetIndex::clear()
+{
+    m_entries.clear();
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Adds a directory to the index if it contains the given config file. The
+ *  file is only read by the next call to update().
+ *  \param dir The directory.
+ *  \param config_file Full name of the config file in this directory.
+ *  \return False if the config file does not exist.
+ */
+bool AssetIndex::addDirectory(const std::string &dir,
+                              const std::string &config_file)
+{
+    struct stat file_stat;
+    if(stat(config_file.c_str(), &file_stat)!=0)
+        return false;
+    struct stat dir_stat;
+    if(stat(dir.c_str(), &dir_stat)!=0)
+        dir_stat.st_mtime = 0;
+
+    Entry entry;
+    entry.m_dir         = dir;
+    entry.m_config_file = config_file;
+    entry.m_file_time   = file_stat.st_mtime;
+    entry.m_dir_time    = dir_stat.st_mtime;
+    entry.m_valid       = false;
+    m_entries.push_back(entry);
+    return true;
+}   // addDirectory
+
+// ----------------------------------------------------------------------------
+/** Reads the root node of the config file of an entry. This is executed
+ *  by the worker threads, so it must not use any non thread-safe objects
+ *  (esp. irrlicht's file system).
+ *  \param entry The entry to read.
+ */
+void AssetIndex::parseEntry(Entry *entry) const
+{
+    entry->m_valid = false;
+    entry->m_attributes.clear();
+
+    irr::io::IrrXMLReader *xml =
+                       irr::io::createIrrXMLReader(entry->m_config_file.c_str());
+    if(!xml)
+        return;
+
+    while(xml->read())
+    {
+        if(xml->getNodeType()!=irr::io::EXN_ELEMENT)
+            continue;
+        if(m_root_name==xml->getNodeName())
+        {
+            entry->m_valid = true;
+            for(unsigned int i=0; i<m_attribute_names.size(); i++)
+            {
+                const char *value =
+                    xml->getAttributeValue(m_attribute_names[i].c_str());
+                if(value)
+                    entry->m_attributes[m_attribute_names[i]] = value;
+            }
+        }
+        break;
+    }
+    delete xml;
+}   // parseEntry
+
+// ----------------------------------------------------------------------------
+namespace
+{
+    /** The data for one job of AssetIndex::update. */
+    struct ParseJob
+    {
+        const AssetIndex   *m_index;
+        AssetIndex::Entry  *m_entry;
+    };   // ParseJob
+}
+
+// ----------------------------------------------------------------------------
+/** Job function to parse one entry.
+ *  \param data Pointer to a ParseJob.
+ */
+void AssetIndex::parseEntryJob(void *data)
+{
+    ParseJob *job = (ParseJob*)data;
+    job->m_index->parseEntry(job->m_entry);
+}   // parseEntryJob
+
+// ----------------------------------------------------------------------------
+/** Reads all entries, using the manifest for all files that were not
+ *  modified, and parsing the other files in parallel. The manifest is then
+ *  updated.
+ */
+void AssetIndex::update()
+{
+    std::map<std::string, Entry> manifest;
+    loadManifest(&manifest);
+
+    std::vector<ParseJob> jobs;
+    bool manifest_changed = manifest.size() != m_entries.size();
+    for(unsigned int i=0; i<m_entries.size(); i++)
+    {
+        Entry &entry = m_entries[i];
+        std::map<std::string, Entry>::const_iterator cached =
+                                         manifest.find(entry.m_config_file);
+        if(cached!=manifest.end()                          &&
+           cached->second.m_file_time == entry.m_file_time &&
+           cached->second.m_dir_time  == entry.m_dir_time     )
+        {
+            entry.m_valid      = cached->second.m_valid;
+            entry.m_attributes = cached->second.m_attributes;
+            continue;
+        }
+        ParseJob job;
+        job.m_index = this;
+        job.m_entry = &entry;
+        jobs.push_back(job);
+    }
+
+    if(jobs.size()>0)
+    {
+        manifest_changed = true;
+        ThreadPool pool;
+        for(unsigned int i=0; i<jobs.size(); i++)
+            pool.addJob(&AssetIndex::parseEntryJob, &jobs[i]);
+        pool.waitForAll();
+        Log::info("AssetIndex", "Indexed %d of %d '%s' files.",
+                  (int)jobs.size(), (int)m_entries.size(),
+                  m_root_name.c_str());
+    }
+
+    if(manifest_changed)
+        saveManifest();
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Reads a string from a manifest file. */
+static bool readString(FILE *fd, std::string *s)
+{
+    uint32_t len;
+    if(fread(&len, sizeof(len), 1, fd)!=1 || len>0xffff)
+        return false;
+    s->resize(len);
+    return len==0 || fread(&(*s)[0], 1, len, fd)==len;
+}   // readString
+
+// ----------------------------------------------------------------------------
+/** Writes a string to a manifest file. */
+static void writeString(FILE *fd, const std::string &s)
+{
+    uint32_t len = s.size();
+    fwrite(&len, sizeof(len), 1, fd);
+    fwrite(s.c_str(), 1, len, fd);
+}   // writeString
+
+// ----------------------------------------------------------------------------
+/** Loads the manifest file.
+ *  \param manifest On return the entries of the manifest, indexed by the
+ *         name of the config file.
+ */
+void AssetIndex::loadManifest(std::map<std::string, Entry> *manifest) const
+{
+    FILE *fd = fopen(m_manifest_file.c_str(), "rb");
+    if(!fd)
+        return;
+
+    uint32_t header[3];
+    if(fread(header, sizeof(uint32_t), 3, fd)!=3 ||
+       header[0]!=MANIFEST_MAGIC || header[1]!=MANIFEST_VERSION)
+    {
+        fclose(fd);
+        return;
+    }
+
+    for(unsigned int i=0; i<header[2]; i++)
+    {
+        Entry entry;
+        int64_t times[2];
+        uint8_t valid;
+        uint32_t num_attributes;
+        if(!readString(fd, &entry.m_dir)                            ||
+           !readString(fd, &entry.m_config_file)                    ||
+           fread(times, sizeof(int64_t), 2, fd)!=2                  ||
+           fread(&valid, 1, 1, fd)!=1                               ||
+           fread(&num_attributes, sizeof(uint32_t), 1, fd)!=1          )
+            break;
+        entry.m_file_time = (StkTime::TimeType)times[0];
+        entry.m_dir_time  = (StkTime::TimeType)times[1];
+        entry.m_valid     = valid!=0;
+        bool ok = true;
+        for(unsigned int j=0; ok && j<num_attributes; j++)
+        {
+            std::string name, value;
+            ok = readString(fd, &name) && readString(fd, &value);
+            entry.m_attributes[name] = value;
+        }
+        if(!ok)
+            break;
+        (*manifest)[entry.m_config_file] = entry;
+    }
+    fclose(fd);
+}   // loadManifest
+
+// ----------------------------------------------------------------------------
+/** Saves all entries in the manifest file. */
+void AssetIndex::saveManifest() const
+{
+    FILE *fd = fopen(m_manifest_file.c_str(), "wb");
+    if(!fd)
+    {
+        Log::warn("AssetIndex", "Can not write manifest '%s'.",
+                  m_manifest_file.c_str());
+        return;
+    }
+
+    uint32_t header[3] = { MANIFEST_MAGIC, MANIFEST_VERSION,
+                           (uint32_t)m_entries.size() };
+    fwrite(header, sizeof(uint32_t), 3, fd);
+    for(unsigned int i=0; i<m_entries.size(); i++)
+    {
+        const Entry &entry = m_entries[i];
+        writeString(fd, entry.m_dir);
+        writeString(fd, entry.m_config_file);
+        int64_t times[2] = { (int64_t)entry.m_file_time,
+                             (int64_t)entry.m_dir_time };
+        fwrite(times, sizeof(int64_t), 2, fd);
+        uint8_t valid = entry.m_valid ? 1 : 0;
+        fwrite(&valid, 1, 1, fd);
+        uint32_t num_attributes = entry.m_attributes.size();
+        fwrite(&num_attributes, sizeof(uint32_t), 1, fd);
+        std::map<std::string, std::string>::const_iterator a;
+        for(a=entry.m_attributes.begin(); a!=entry.m_attributes.end(); a++)
+        {
+            writeString(fd, a->first);
+            writeString(fd, a->second);
+        }
+    }
+    fclose(fd);
+}   // saveManifest
+
+/* EOF */
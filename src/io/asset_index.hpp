@@ -0,0 +1,116 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_ASSET_INDEX_HPP
+#define HEADER_ASSET_INDEX_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/time.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * \brief An index of all karts or tracks, which only contains the few
+ *  attributes of the root node of each kart.xml or track.xml file that are
+ *  needed to list them (e.g. identity, groups and icon).
+ *  The files are parsed in parallel, and the result is cached in a manifest
+ *  file in the cached data directory, so a file is only parsed again if it
+ *  (or its directory) was modified. This allows the kart and track managers
+ *  to only load a kart or track completely when it is actually used.
+ * \ingroup io
+ */
+class AssetIndex : public NoCopy
+{
+public:
+    /** The indexed data of one kart or track. */
+    class Entry
+    {
+    private:
+        friend class AssetIndex;
+
+        /** The directory of the kart or track. */
+        std::string m_dir;
+        /** The kart.xml or track.xml file. */
+        std::string m_config_file;
+        /** Modification time of the config file. */
+        StkTime::TimeType m_file_time;
+        /** Modification time of the directory. */
+        StkTime::TimeType m_dir_time;
+        /** False if the file could not be read or has the wrong root node. */
+        bool m_valid;
+        /** The indexed attributes of the root node. */
+        std::map<std::string, std::string> m_attributes;
+
+    public:
+        bool get(const std::string &name, std::string *value) const;
+        bool get(const std::string &name, int *value) const;
+        bool get(const std::string &name, bool *value) const;
+        bool get(const std::string &name,
+                 std::vector<std::string> *value) const;
+        // --------------------------------------------------------------------
+        /** Returns the directory of the kart or track. */
+        const std::string &getDir() const { return m_dir; }
+        // --------------------------------------------------------------------
+        /** Returns the name of the kart.xml or track.xml file. */
+        const std::string &getConfigFile() const { return m_config_file; }
+        // --------------------------------------------------------------------
+        /** Returns false if the file could not be read or does not contain
+         *  the expected root node. */
+        bool isValid() const { return m_valid; }
+    };   // Entry
+
+private:
+    /** Name of the expected root node, e.g. "kart". */
+    std::string              m_root_name;
+
+    /** Names of the attributes to index. */
+    std::vector<std::string> m_attribute_names;
+
+    /** Name of the manifest file. */
+    std::string              m_manifest_file;
+
+    /** All entries in the order they were added. */
+    std::vector<Entry>       m_entries;
+
+    static void parseEntryJob(void *data);
+    void        parseEntry(Entry *entry) const;
+    void        loadManifest(std::map<std::string, Entry> *manifest) const;
+    void        saveManifest() const;
+
+public:
+                 AssetIndex(const std::string &root_name,
+                            const std::string &manifest_name,
+                            const char **attribute_names);
+    bool         addDirectory(const std::string &dir,
+                              const std::string &config_file);
+    void         update();
+    void         clear();
+    // ------------------------------------------------------------------------
+    /** Returns the number of entries. */
+    unsigned int getNumEntries() const { return m_entries.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns the i-th entry. */
+    const Entry &getEntry(unsigned int i) const { return m_entries[i]; }
+};   // AssetIndex
+
+#endif
+
+/* EOF */
@@ -193,6 +193,7 @@ FileManager::FileManager()
     checkAndCreateAddonsDir();
     checkAndCreateScreenshotDir();
     checkAndCreateCachedTexturesDir();
+    checkAndCreateCachedDataDir();
     checkAndCreateGPDir();
 
     redirectOutput();
@@ -537,12 +538,124 @@ bool FileManager::findFile(std::string& full_path,
         i != search_path.rend(); ++i)
     {
         full_path = *i + file_name;
-        if(m_file_system->existFile(full_path.c_str())) return true;
+        if(fileExists(full_path)) return true;
     }
     full_path="";
     return false;
 }   // findFile
 
+//-----------------------------------------------------------------------------
+/** Returns true if the specified file (or directory) exists. Files in the
+ *  data directories and in the installed kart and track addons are looked
+ *  up in the directory index, everything else is checked on disk.
+ *  \param path Path of the file to check.
+ */
+bool FileManager::fileExists(const std::string& path) const
+{
+    bool exists;
+    if(findInDirectoryIndex(path, &exists))
+        return exists;
+    return m_file_system->existFile(path.c_str());
+}   // fileExists
+
+//-----------------------------------------------------------------------------
+/** Returns true if the given directory can be stored in the directory index.
+ *  Only directories that STK itself never writes to while running are
+ *  indexed (the data directories and the addon karts and tracks, which are
+ *  only changed when an addon is installed or removed). Config, cache and
+ *  screenshot directories are always checked on disk.
+ *  \param dir The directory to test (ending with a '/').
+ */
+bool FileManager::isIndexedDirectory(const std::string &dir) const
+{
+    for(unsigned int i=0; i<m_root_dirs.size(); i++)
+    {
+        if(StringUtils::startsWith(dir, m_root_dirs[i]))
+            return true;
+    }
+    return StringUtils::startsWith(dir, m_addons_dir+"karts/" ) ||
+           StringUtils::startsWith(dir, m_addons_dir+"tracks/");
+}   // isIndexedDirectory
+
+//-----------------------------------------------------------------------------
+/** Checks if a file exists using the directory index. The directory
+ *  containing the file is read the first time it is needed, afterwards
+ *  all tests for files in it are answered from memory.
+ *  \param path The file to check.
+ *  \param exists On return true if the file exists.
+ *  \return False if the index can not answer this query (the directory
+ *          is not indexed, or could not be read).
+ */
+bool FileManager::findInDirectoryIndex(const std::string &path,
+                                       bool *exists) const
+{
+    std::string name = path;
+    // A directory name, test for its entry in the parent directory
+    while(name.size()>1 && name[name.size()-1]=='/')
+        name.erase(name.size()-1);
+    std::size_t slash = name.find_last_of('/');
+    if(slash==std::string::npos || slash+1==name.size())
+        return false;
+    std::string dir = name.substr(0, slash+1);
+    name = name.substr(slash+1);
+    if(!isIndexedDirectory(dir))
+        return false;
+#ifdef WIN32
+    name = StringUtils::toLowerCase(name);
+#endif
+
+    m_directory_index.lock();
+    std::map<std::string, DirectoryListing> &index =
+                                                m_directory_index.getData();
+    std::map<std::string, DirectoryListing>::iterator i = index.find(dir);
+    if(i==index.end())
+    {
+        DirectoryListing &listing = index[dir];
+        listing.m_valid = false;
+#ifdef WIN32
+        WIN32_FIND_DATAA data;
+        HANDLE handle = FindFirstFileA((dir+"*").c_str(), &data);
+        if(handle!=INVALID_HANDLE_VALUE)
+        {
+            listing.m_valid = true;
+            do
+            {
+                listing.m_entries.insert(
+                                 StringUtils::toLowerCase(data.cFileName));
+            } while(FindNextFileA(handle, &data));
+            FindClose(handle);
+        }
+#else
+        DIR *d = opendir(dir.c_str());
+        if(d)
+        {
+            listing.m_valid = true;
+            while(struct dirent *entry = readdir(d))
+                listing.m_entries.insert(entry->d_name);
+            closedir(d);
+        }
+#endif
+        i = index.find(dir);
+    }
+    bool valid = i->second.m_valid;
+    if(valid)
+        *exists = i->second.m_entries.count(name)>0;
+    m_directory_index.unlock();
+    return valid;
+}   // findInDirectoryIndex
+
+//-----------------------------------------------------------------------------
+/** Discards all cached directory listings. This must be called when files
+ *  in an indexed directory are added or removed (e.g. when an addon is
+ *  installed or removed), the listings are read again when needed.
+ */
+void FileManager::invalidateDirectoryIndex() const
+{
+    m_directory_index.lock();
+    m_directory_index.getData().clear();
+    m_directory_index.unlock();
+}   // invalidateDirectoryIndex
+
 //-----------------------------------------------------------------------------
 std::string FileManager::getAssetChecked(FileManager::AssetType type,
                                          const std::string& name,
@@ -602,6 +715,15 @@ std::string FileManager::getCachedTexturesDir() const
     return m_cached_textures_dir;
 }   // getCachedTexturesDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which data computed from the assets (e.g. the
+ *  collision data of tracks) should be cached.
+ */
+std::string FileManager::getCachedDataDir() const
+{
+    return m_cached_data_dir;
+}   // getCachedDataDir
+
 //-----------------------------------------------------------------------------
 /** Returns the directory in which user-defined grand prix should be stored.
  */
@@ -883,6 +1005,31 @@ void FileManager::checkAndCreateCachedTexturesDir()
 
 }   // checkAndCreateCachedTexturesDir
 
+// ----------------------------------------------------------------------------
+/** Creates the directory for cached data. This will set m_cached_data_dir
+ *  with the appropriate path.
+ */
+void FileManager::checkAndCreateCachedDataDir()
+{
+#if defined(WIN32) || defined(__CYGWIN__)
+    m_cached_data_dir = m_user_config_dir + "cached-data/";
+#elif defined(__APPLE__)
+    m_cached_data_dir = getenv("HOME");
+    m_cached_data_dir += "/Library/Application Support/SuperTuxKart/CachedData/";
+#else
+    m_cached_data_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    m_cached_data_dir += "cached-data/";
+#endif
+
+    if (!checkAndCreateDirectory(m_cached_data_dir))
+    {
+        Log::error("FileManager", "Can not create cached data directory '%s', "
+            "falling back to '.'.", m_cached_data_dir.c_str());
+        m_cached_data_dir = "./";
+    }
+
+}   // checkAndCreateCachedDataDir
+
 // ----------------------------------------------------------------------------
 /** Creates the directories for user-defined grand prix. This will set m_gp_dir
  *  with the appropriate path.
@@ -1173,6 +1320,7 @@ void FileManager::checkAndCreateDirForAddons(const std::string &dir)
 {
     // Tries to create directory recursively
     bool success = checkAndCreateDirectoryP(dir);
+    invalidateDirectoryIndex();
     if(!success)
     {
         Log::warn("FileManager", "There is a problem with the addons dir.");
@@ -1228,10 +1376,12 @@ bool FileManager::removeDirectory(const std::string &name) const
         }
     }
 #if defined(WIN32)
-        return RemoveDirectory(name.c_str())==TRUE;
+    bool success = RemoveDirectory(name.c_str())==TRUE;
 #else
-    return remove(name.c_str())==0;
+    bool success = remove(name.c_str())==0;
 #endif
+    invalidateDirectoryIndex();
+    return success;
 }   // remove directory
 
 // ----------------------------------------------------------------------------
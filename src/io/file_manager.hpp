@@ -25,6 +25,7 @@
  * Contains generic utility classes for file I/O (especially XML handling).
  */
 
+#include <map>
 #include <string>
 #include <vector>
 #include <set>
@@ -36,6 +37,7 @@ using namespace irr;
 
 #include "io/xml_node.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/synchronised.hpp"
 
 /**
   * \brief class handling files and paths
@@ -75,6 +77,9 @@ private:
     /** Directory where resized textures are cached. */
     std::string       m_cached_textures_dir;
 
+    /** Directory where other data computed from the assets is cached. */
+    std::string       m_cached_data_dir;
+
     /** Directory where user-defined grand prix are stored. */
     std::string       m_gp_dir;
 
@@ -82,6 +87,25 @@ private:
                       m_texture_search_path,
                       m_model_search_path,
                       m_music_search_path;
+
+    /** The cached listing of one directory. */
+    struct DirectoryListing
+    {
+        /** False if the directory could not be read (e.g. it does not
+         *  exist, or it is stored in an archive). */
+        bool                  m_valid;
+        std::set<std::string> m_entries;
+    };
+
+    /** Listings of the read-only asset directories, so that checking
+     *  whether a file exists does not need a syscall each time. A
+     *  directory is read the first time a file in it is checked. */
+    mutable Synchronised<std::map<std::string, DirectoryListing> >
+                      m_directory_index;
+
+    bool              isIndexedDirectory(const std::string &dir) const;
+    bool              findInDirectoryIndex(const std::string &path,
+                                           bool *exists) const;
     bool              findFile(std::string& full_path,
                                const std::string& fname,
                                const std::vector<std::string>& search_path)
@@ -91,10 +115,10 @@ private:
     bool              checkAndCreateDirectory(const std::string &path);
     io::path          createAbsoluteFilename(const std::string &f);
     void              checkAndCreateConfigDir();
-    bool              isDirectory(const std::string &path) const;
     void              checkAndCreateAddonsDir();
     void              checkAndCreateScreenshotDir();
     void              checkAndCreateCachedTexturesDir();
+    void              checkAndCreateCachedDataDir();
     void              checkAndCreateGPDir();
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
     std::string       checkAndCreateLinuxDir(const char *env_name,
@@ -115,12 +139,14 @@ public:
 
     std::string       getScreenshotDir() const;
     std::string       getCachedTexturesDir() const;
+    std::string       getCachedDataDir() const;
     std::string       getGPDir() const;
     std::string       getTextureCacheLocation(const std::string& filename);
     bool              checkAndCreateDirectoryP(const std::string &path);
     const std::string &getAddonsDir() const;
     std::string        getAddonsFile(const std::string &name);
     void checkAndCreateDirForAddons(const std::string &dir);
+    bool isDirectory(const std::string &path) const;
     bool removeFile(const std::string &name) const;
     bool removeDirectory(const std::string &name) const;
     bool copyFile(const std::string &source, const std::string &dest);
@@ -146,6 +172,8 @@ public:
     void       redirectOutput();
 
     bool       fileIsNewer(const std::string& f1, const std::string& f2) const;
+    bool       fileExists(const std::string& path) const;
+    void       invalidateDirectoryIndex() const;
 
     // ------------------------------------------------------------------------
     /** Adds a directory to the music search path (or stack).
@@ -155,14 +183,6 @@ public:
         m_music_search_path.push_back(path);
     }   // pushMusicSearchPath
 
-    // ------------------------------------------------------------------------
-    /** Returns true if the specified file exists.
-     */
-    bool fileExists(const std::string& path) const
-    {
-        return m_file_system->existFile(path.c_str());
-    }   // fileExists
-
 };   // FileManager
 
 extern FileManager* file_manager;
@@ -0,0 +1,150 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/mapped_file.hpp"
+
+#include <stdio.h>
+
+#ifdef WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    m_data = NULL;
+    m_size = 0;
+#ifdef WIN32
+    m_file_handle    = INVALID_HANDLE_VALUE;
+    m_mapping_handle = NULL;
+#else
+    m_is_mapped      = false;
+#endif
+}   // MappedFile
+
+// ----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}   // ~MappedFile
+
+// ----------------------------------------------------------------------------
+/** Opens a file. A previously opened file is closed first.
+ *  \param filename Name of the file.
+ *  \return False if the file could not be opened.
+ */
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+
+#ifdef WIN32
+    m_file_handle = CreateFileA(filename.c_str(), GENERIC_READ,
+                                FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file_handle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(m_file_handle, &size) && size.QuadPart > 0)
+        {
+            m_mapping_handle = CreateFileMappingA(m_file_handle, NULL,
+                                                  PAGE_READONLY, 0, 0, NULL);
+            if (m_mapping_handle)
+            {
+                m_data = (const uint8_t*)MapViewOfFile(m_mapping_handle,
+                                                       FILE_MAP_READ, 0, 0, 0);
+                if (m_data)
+                {
+                    m_size = (size_t)size.QuadPart;
+                    return true;
+                }
+            }
+        }
+        close();
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                ::close(fd);
+                m_data      = (const uint8_t*)p;
+                m_size      = st.st_size;
+                m_is_mapped = true;
+                return true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    // Mapping failed (or the file is empty), read the file into memory
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size > 0)
+    {
+        m_buffer.resize(size);
+        if (fread(&m_buffer[0], 1, size, file) != (size_t)size)
+        {
+            fclose(file);
+            m_buffer.clear();
+            return false;
+        }
+        m_data = &m_buffer[0];
+        m_size = size;
+    }
+    fclose(file);
+    return m_data != NULL;
+}   // open
+
+// ----------------------------------------------------------------------------
+/** Closes the file. All pointers returned by getData() become invalid.
+ */
+void MappedFile::close()
+{
+#ifdef WIN32
+    if (m_data && m_mapping_handle)
+        UnmapViewOfFile(m_data);
+    if (m_mapping_handle)
+        CloseHandle(m_mapping_handle);
+    if (m_file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file_handle);
+    m_mapping_handle = NULL;
+    m_file_handle    = INVALID_HANDLE_VALUE;
+#else
+    if (m_is_mapped)
+        munmap((void*)m_data, m_size);
+    m_is_mapped = false;
+#endif
+    m_buffer.clear();
+    m_data = NULL;
+    m_size = 0;
+}   // close
@@ -0,0 +1,66 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MAPPED_FILE_HPP
+#define HEADER_MAPPED_FILE_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Gives read-only access to the content of a file by mapping it
+ *  into memory. Pages are only loaded by the OS when they are accessed, so
+ *  opening even a large file is cheap. If the file can not be mapped, it is
+ *  read into memory instead.
+ * \ingroup io
+ */
+class MappedFile : public NoCopy
+{
+private:
+    /** Pointer to the content of the file. */
+    const uint8_t       *m_data;
+    /** Size of the file. */
+    size_t               m_size;
+    /** Used if the file could not be mapped. */
+    std::vector<uint8_t> m_buffer;
+#ifdef WIN32
+    void                *m_file_handle;
+    void                *m_mapping_handle;
+#else
+    bool                 m_is_mapped;
+#endif
+
+public:
+              MappedFile();
+             ~MappedFile();
+    bool      open(const std::string &filename);
+    void      close();
+
+    // ------------------------------------------------------------------------
+    /** Returns the content of the file, or NULL if no file is open. */
+    const uint8_t *getData() const { return m_data; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of the file. */
+    size_t    getSize() const { return m_size; }
+};   // MappedFile
+
+#endif
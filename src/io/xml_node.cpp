@@ -22,28 +22,454 @@
 #include "utils/interpolation_array.hpp"
 #include "utils/vec3.hpp"
 
+#include <limits.h>
+#include <map>
 #include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+/** Identifies a binary XML cache file. */
+static const uint32_t XML_CACHE_MAGIC   = 0x4c4d5842;
+/** Must be increased when the format of the cache files changes. */
+static const uint32_t XML_CACHE_VERSION = 1;
+/** Number of nodes allocated at once by a document. */
+static const uint32_t NODES_PER_BLOCK   = 256;
+
+bool XMLNode::m_use_binary_cache = true;
+
+// ============================================================================
+/** The data shared by all nodes of one XML file. It is owned by the root
+ *  node.
+ */
+class XMLNode::Document : public NoCopy
+{
+public:
+    /** An attribute of a node. */
+    struct Attribute
+    {
+        /** Index of the name in m_names. */
+        uint16_t m_name;
+        /** True if the value is stored in m_wide_values. */
+        bool     m_is_wide;
+        /** Offset of the 0-terminated value in m_values or m_wide_values. */
+        uint32_t m_value;
+    };   // Attribute
+
+    /** Name of the file, used in error messages. */
+    std::string                     m_file_name;
+    /** All names of elements and attributes. */
+    std::vector<std::string>        m_names;
+    /** Maps names to their index in m_names, only used while parsing. */
+    std::map<std::string, uint16_t> m_name_ids;
+    /** All attribute values that only contain ASCII characters. */
+    std::vector<char>               m_values;
+    /** All other attribute values. */
+    std::vector<wchar_t>            m_wide_values;
+    /** The attributes of all nodes, the attributes of a node are stored
+     *  one after the other. */
+    std::vector<Attribute>          m_attributes;
+    /** The node indices of the children of all nodes, the children of a
+     *  node are stored one after the other. */
+    std::vector<uint32_t>           m_children;
+    /** All nodes except the root node. */
+    std::vector<XMLNode*>           m_blocks;
+    /** Number of nodes in m_blocks. */
+    uint32_t                        m_num_nodes;
+
+    // ------------------------------------------------------------------------
+    Document(const std::string &file_name)
+    {
+        m_file_name = file_name;
+        m_num_nodes = 0;
+    }   // Document
+    // ------------------------------------------------------------------------
+    ~Document()
+    {
+        for(unsigned int i=0; i<m_blocks.size(); i++)
+            delete [] m_blocks[i];
+    }   // ~Document
+    // ------------------------------------------------------------------------
+    /** Returns the node with the given index. */
+    XMLNode *getNode(uint32_t index) const
+    {
+        return &m_blocks[index/NODES_PER_BLOCK][index%NODES_PER_BLOCK];
+    }   // getNode
+    // ------------------------------------------------------------------------
+    /** Allocates a new node.
+     *  \param index On return the index of the new node. */
+    XMLNode *createNode(uint32_t *index)
+    {
+        if(m_num_nodes == m_blocks.size()*NODES_PER_BLOCK)
+            m_blocks.push_back(new XMLNode[NODES_PER_BLOCK]);
+        *index = m_num_nodes++;
+        XMLNode *node = getNode(*index);
+        node->m_document = this;
+        return node;
+    }   // createNode
+    // ------------------------------------------------------------------------
+    /** Returns the index of a name, adding the name if necessary. */
+    uint16_t intern(const std::string &name)
+    {
+        std::map<std::string, uint16_t>::iterator i = m_name_ids.find(name);
+        if(i!=m_name_ids.end())
+            return i->second;
+        if(m_names.size() >= 0xffff)
+            throw std::runtime_error("Too many different names in "
+                                     +m_file_name);
+        uint16_t id = (uint16_t)m_names.size();
+        m_names.push_back(name);
+        m_name_ids[name] = id;
+        return id;
+    }   // intern
+    // ------------------------------------------------------------------------
+    /** Adds an attribute value. */
+    void addAttribute(const std::string &name, const wchar_t *value)
+    {
+        Attribute a;
+        a.m_name    = intern(name);
+        a.m_is_wide = false;
+        for(const wchar_t *c=value; *c; c++)
+        {
+            if((uint32_t)*c > 127)
+            {
+                a.m_is_wide = true;
+                break;
+            }
+        }
+        if(a.m_is_wide)
+        {
+            a.m_value = m_wide_values.size();
+            for(const wchar_t *c=value; *c; c++)
+                m_wide_values.push_back(*c);
+            m_wide_values.push_back(0);
+        }
+        else
+        {
+            a.m_value = m_values.size();
+            for(const wchar_t *c=value; *c; c++)
+                m_values.push_back((char)*c);
+            m_values.push_back(0);
+        }
+        m_attributes.push_back(a);
+    }   // addAttribute
+
+    bool loadBinary(const std::string &cache_file, int64_t file_time,
+                    int64_t file_size, XMLNode *root);
+    void saveBinary(const std::string &cache_file, int64_t file_time,
+                    int64_t file_size, const XMLNode *root) const;
+};   // XMLNode::Document
+
+// ----------------------------------------------------------------------------
+/** Computes a hash of a string (FNV-1a), used to name the cache files. */
+static uint32_t hashData(const std::string &s)
+{
+    uint32_t hash = 2166136261u;
+    for(unsigned int i=0; i<s.size(); i++)
+    {
+        hash ^= (uint8_t)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}   // hashData
+
+// ----------------------------------------------------------------------------
+/** Converts a string to a float. Unlike StringUtils::parseString this does
+ *  not need a stream, which makes a difference for files with many values.
+ *  \return False if the string is not a (complete) floating point number.
+ */
+static bool parseFloat(const char *s, float *value)
+{
+    char *end;
+    double d = strtod(s, &end);
+    if(end==s || *end!=0)
+        return false;
+    *value = (float)d;
+    return true;
+}   // parseFloat
+
+// ----------------------------------------------------------------------------
+/** Converts a string to an int, see parseFloat. */
+static bool parseInt(const char *s, int32_t *value)
+{
+    char *end;
+    long long l = strtoll(s, &end, 10);
+    if(end==s || *end!=0 || l<INT_MIN || l>INT_MAX)
+        return false;
+    *value = (int32_t)l;
+    return true;
+}   // parseInt
+
+// ----------------------------------------------------------------------------
+/** Reads an array of 32 bit values from a cache file. */
+static bool readArray(FILE *fd, std::vector<uint32_t> *data)
+{
+    uint32_t size;
+    if(fread(&size, sizeof(size), 1, fd)!=1 || size > 0x10000000)
+        return false;
+    data->resize(size);
+    return size==0 || fread(&(*data)[0], sizeof(uint32_t), size, fd)==size;
+}   // readArray
+
+// ----------------------------------------------------------------------------
+/** Writes an array of 32 bit values to a cache file. */
+static void writeArray(FILE *fd, const std::vector<uint32_t> &data)
+{
+    uint32_t size = data.size();
+    fwrite(&size, sizeof(size), 1, fd);
+    if(size>0)
+        fwrite(&data[0], sizeof(uint32_t), size, fd);
+}   // writeArray
+
+// ----------------------------------------------------------------------------
+/** Loads a document from its binary cache file.
+ *  \param cache_file Name of the cache file.
+ *  \param file_time Modification time of the XML file.
+ *  \param file_size Size of the XML file.
+ *  \param root The root node.
+ *  \return False if the cache file does not exist, is outdated or corrupt.
+ */
+bool XMLNode::Document::loadBinary(const std::string &cache_file,
+                                   int64_t file_time, int64_t file_size,
+                                   XMLNode *root)
+{
+    FILE *fd = fopen(cache_file.c_str(), "rb");
+    if(!fd)
+        return false;
+
+    uint32_t header[2];
+    int64_t  stamp[2];
+    std::string file_name;
+    if(fread(header, sizeof(uint32_t), 2, fd)!=2 ||
+       header[0]!=XML_CACHE_MAGIC || header[1]!=XML_CACHE_VERSION ||
+       fread(stamp, sizeof(int64_t), 2, fd)!=2 ||
+       stamp[0]!=file_time || stamp[1]!=file_size)
+    {
+        fclose(fd);
+        return false;
+    }
+
+    // The names, and the name of the file to detect hash collisions
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> chars;
+    bool ok = readArray(fd, &lengths) && readArray(fd, &chars);
+    std::vector<uint32_t> values, wide_values, attributes, nodes;
+    ok = ok && readArray(fd, &values)     && readArray(fd, &wide_values) &&
+               readArray(fd, &attributes) && readArray(fd, &m_children)  &&
+               readArray(fd, &nodes);
+    fclose(fd);
+    if(!ok || lengths.size()==0 || nodes.size()%5!=0 || nodes.size()==0 ||
+       attributes.size()%2!=0)
+        return false;
+
+    unsigned int offset = 0;
+    for(unsigned int i=0; i<lengths.size(); i++)
+    {
+        if(offset+lengths[i] > chars.size())
+            return false;
+        std::string name(lengths[i], ' ');
+        for(unsigned int j=0; j<lengths[i]; j++)
+            name[j] = (char)chars[offset+j];
+        offset += lengths[i];
+        if(i==0)
+            file_name = name;
+        else
+            m_names.push_back(name);
+    }
+    if(file_name!=m_file_name)
+        return false;
+
+    // Values are stored 4 characters per 32 bit value
+    m_values.resize(values.size()*4);
+    for(unsigned int i=0; i<values.size(); i++)
+    {
+        for(unsigned int j=0; j<4; j++)
+            m_values[i*4+j] = (char)(values[i] >> (8*j));
+    }
+    m_wide_values.resize(wide_values.size());
+    for(unsigned int i=0; i<wide_values.size(); i++)
+        m_wide_values[i] = (wchar_t)wide_values[i];
+
+    m_attributes.resize(attributes.size()/2);
+    for(unsigned int i=0; i<m_attributes.size(); i++)
+    {
+        Attribute &a = m_attributes[i];
+        a.m_name    = attributes[2*i] & 0xffff;
+        a.m_is_wide = (attributes[2*i] >> 16)!=0;
+        a.m_value   = attributes[2*i+1];
+        if(a.m_name >= m_names.size() ||
+           a.m_value >= (a.m_is_wide ? m_wide_values.size()
+                                     : m_values.size()))
+            return false;
+    }
+
+    // The first node is the root node
+    uint32_t num_nodes = nodes.size()/5 - 1;
+    for(unsigned int i=0; i<m_children.size(); i++)
+    {
+        if(m_children[i] >= num_nodes)
+            return false;
+    }
+    for(unsigned int i=0; i<=num_nodes; i++)
+    {
+        uint32_t index;
+        XMLNode *node = i==0 ? root : createNode(&index);
+        const uint32_t *n = &nodes[5*i];
+        node->m_name            = n[0] & 0xffff;
+        node->m_num_attributes  = n[0] >> 16;
+        node->m_first_attribute = n[1];
+        node->m_first_child     = n[2];
+        node->m_num_children    = n[3];
+        if(node->m_name >= m_names.size() ||
+           (uint64_t)n[1]+node->m_num_attributes > m_attributes.size() ||
+           (uint64_t)n[2]+n[3] > m_children.size())
+            return false;
+    }
+    return true;
+}   // loadBinary
+
+// ----------------------------------------------------------------------------
+/** Saves a document in a binary cache file.
+ *  \param cache_file Name of the cache file.
+ *  \param file_time Modification time of the XML file.
+ *  \param file_size Size of the XML file.
+ *  \param root The root node.
+ */
+void XMLNode::Document::saveBinary(const std::string &cache_file,
+                                   int64_t file_time, int64_t file_size,
+                                   const XMLNode *root) const
+{
+    std::vector<uint32_t> lengths, chars;
+    lengths.push_back(m_file_name.size());
+    for(unsigned int i=0; i<m_file_name.size(); i++)
+        chars.push_back((uint8_t)m_file_name[i]);
+    for(unsigned int i=0; i<m_names.size(); i++)
+    {
+        lengths.push_back(m_names[i].size());
+        for(unsigned int j=0; j<m_names[i].size(); j++)
+            chars.push_back((uint8_t)m_names[i][j]);
+    }
+
+    std::vector<uint32_t> values((m_values.size()+3)/4, 0);
+    for(unsigned int i=0; i<m_values.size(); i++)
+        values[i/4] |= (uint32_t)(uint8_t)m_values[i] << (8*(i%4));
+    std::vector<uint32_t> wide_values(m_wide_values.begin(),
+                                      m_wide_values.end());
+
+    std::vector<uint32_t> attributes;
+    for(unsigned int i=0; i<m_attributes.size(); i++)
+    {
+        attributes.push_back(m_attributes[i].m_name |
+                             (m_attributes[i].m_is_wide ? 0x10000 : 0));
+        attributes.push_back(m_attributes[i].m_value);
+    }
 
+    std::vector<uint32_t> nodes;
+    for(unsigned int i=0; i<=m_num_nodes; i++)
+    {
+        const XMLNode *node = i==0 ? root : getNode(i-1);
+        nodes.push_back(node->m_name | (node->m_num_attributes << 16));
+        nodes.push_back(node->m_first_attribute);
+        nodes.push_back(node->m_first_child);
+        nodes.push_back(node->m_num_children);
+        nodes.push_back(0);
+    }
+
+    // Write to a temporary file first, so that a concurrently running
+    // instance never reads an incomplete file.
+    std::string tmp_file = cache_file+".tmp";
+    FILE *fd = fopen(tmp_file.c_str(), "wb");
+    if(!fd)
+        return;
+    uint32_t header[2] = { XML_CACHE_MAGIC, XML_CACHE_VERSION };
+    int64_t  stamp[2]  = { file_time, file_size };
+    fwrite(header, sizeof(uint32_t), 2, fd);
+    fwrite(stamp, sizeof(int64_t), 2, fd);
+    writeArray(fd, lengths);
+    writeArray(fd, chars);
+    writeArray(fd, values);
+    writeArray(fd, wide_values);
+    writeArray(fd, attributes);
+    writeArray(fd, m_children);
+    writeArray(fd, nodes);
+    bool ok = ferror(fd)==0;
+    fclose(fd);
+    remove(cache_file.c_str());
+    if(!ok || rename(tmp_file.c_str(), cache_file.c_str())!=0)
+    {
+        remove(tmp_file.c_str());
+        Log::warn("[XMLNode]", "Can not write cache file '%s'.",
+                  cache_file.c_str());
+    }
+}   // saveBinary
+
+// ============================================================================
+/** Constructor for nodes allocated by a document. */
+XMLNode::XMLNode()
+{
+    m_document        = NULL;
+    m_name            = 0;
+    m_num_attributes  = 0;
+    m_first_attribute = 0;
+    m_first_child     = 0;
+    m_num_children    = 0;
+    m_is_root         = false;
+}   // XMLNode
+
+// ----------------------------------------------------------------------------
 XMLNode::XMLNode(io::IXMLReader *xml)
 {
-    m_file_name = "[unknown]";
+    m_document        = new Document("[unknown]");
+    m_name            = 0;
+    m_num_attributes  = 0;
+    m_first_attribute = 0;
+    m_first_child     = 0;
+    m_num_children    = 0;
+    m_is_root         = true;
 
     while(xml->getNodeType()!=io::EXN_ELEMENT && xml->read());
     readXML(xml);
+    m_document->m_name_ids.clear();
 }   // XMLNode
 
 // ----------------------------------------------------------------------------
-/** Reads a XML file and convert it into a XMLNode tree.
+/** Reads a XML file and convert it into a XMLNode tree. If the file is
+ *  large, the binary cache is used if it is up to date, otherwise it is
+ *  updated.
  *  \param filename Name of the XML file to read.
  */
 XMLNode::XMLNode(const std::string &filename)
 {
-    m_file_name = filename;
+    m_document        = new Document(filename);
+    m_name            = 0;
+    m_num_attributes  = 0;
+    m_first_attribute = 0;
+    m_first_child     = 0;
+    m_num_children    = 0;
+    m_is_root         = true;
+
+    std::string cache_file;
+    struct stat file_stat;
+    if(m_use_binary_cache && stat(filename.c_str(), &file_stat)==0 &&
+       file_stat.st_size >= BINARY_CACHE_MIN_SIZE)
+    {
+        char name[32];
+        sprintf(name, "xml-%08x.bin", hashData(filename));
+        cache_file = file_manager->getCachedDataDir()+name;
+        if(m_document->loadBinary(cache_file, file_stat.st_mtime,
+                                  file_stat.st_size, this))
+            return;
+
+        // The cache file was not usable, start from scratch
+        delete m_document;
+        m_document = new Document(filename);
+    }
 
     io::IXMLReader *xml = file_manager->createXMLReader(filename);
     
     if (xml == NULL)
     {
+        delete m_document;
         throw std::runtime_error("Cannot find file "+filename);
     }
 
@@ -72,17 +498,20 @@ XMLNode::XMLNode(const std::string &filename)
         }   // switch
     }   // while
     xml->drop();
+    m_document->m_name_ids.clear();
+
+    if(!cache_file.empty() && !is_first_element)
+        m_document->saveBinary(cache_file, file_stat.st_mtime,
+                               file_stat.st_size, this);
 }   // XMLNode
 
 // ----------------------------------------------------------------------------
-/** Destructor. */
+/** Destructor. The root node deletes the document, which deletes all other
+ *  nodes. */
 XMLNode::~XMLNode()
 {
-    for(unsigned int i=0; i<m_nodes.size(); i++)
-    {
-        delete m_nodes[i];
-    }
-    m_nodes.clear();
+    if(m_is_root)
+        delete m_document;
 }   // ~XMLNode
 
 // ----------------------------------------------------------------------------
@@ -91,34 +520,42 @@ XMLNode::~XMLNode()
  */
 void XMLNode::readXML(io::IXMLReader *xml)
 {
-    m_name = std::string(core::stringc(xml->getNodeName()).c_str());
+    m_name = m_document->intern(core::stringc(xml->getNodeName()).c_str());
 
-    for(unsigned int i=0; i<xml->getAttributeCount(); i++)
+    m_first_attribute = m_document->m_attributes.size();
+    m_num_attributes  = xml->getAttributeCount();
+    for(unsigned int i=0; i<m_num_attributes; i++)
     {
-        std::string   name  = core::stringc(xml->getAttributeName(i)).c_str();
-        core::stringw value = xml->getAttributeValue(i);
-        m_attributes[name] = value;
+        std::string name = core::stringc(xml->getAttributeName(i)).c_str();
+        m_document->addAttribute(name, xml->getAttributeValue(i));
     }   // for i
 
     // If no children, we are done
+    m_first_child  = 0;
+    m_num_children = 0;
     if(xml->isEmptyElement())
         return;
 
-    /** Read all children elements. */
-    while(xml->read())
+    /** Read all children elements. The children are added to the document
+     *  once the end of this element is found, so that the children of this
+     *  node are stored one after the other. */
+    std::vector<uint32_t> children;
+    bool end_found = false;
+    while(!end_found && xml->read())
     {
         switch (xml->getNodeType())
         {
         case io::EXN_ELEMENT:
             {
-                XMLNode* n = new XMLNode(xml);
-                n->m_file_name = m_file_name;
-                m_nodes.push_back(n);
+                uint32_t index;
+                XMLNode* n = m_document->createNode(&index);
+                n->readXML(xml);
+                children.push_back(index);
                 break;
             }
         case io::EXN_ELEMENT_END:
             // End of this element found.
-            return;
+            end_found = true;
             break;
         case io::EXN_UNKNOWN:            break;
         case io::EXN_COMMENT:            break;
@@ -126,15 +563,26 @@ void XMLNode::readXML(io::IXMLReader *xml)
         default:                         break;
         }   // switch
     }   // while
+    m_first_child  = m_document->m_children.size();
+    m_num_children = children.size();
+    m_document->m_children.insert(m_document->m_children.end(),
+                                  children.begin(), children.end());
 }   // readXML
 
+// ----------------------------------------------------------------------------
+/** Returns the name of this element. */
+const std::string &XMLNode::getName() const
+{
+    return m_document->m_names[m_name];
+}   // getName
+
 // ----------------------------------------------------------------------------
 /** Returns the i.th node.
  *  \param i Number of node to return.
  */
 const XMLNode *XMLNode::getNode(unsigned int i) const
 {
-    return m_nodes[i];
+    return m_document->getNode(m_document->m_children[m_first_child+i]);
 }   // getNode
 
 // ----------------------------------------------------------------------------
@@ -143,9 +591,10 @@ const XMLNode *XMLNode::getNode(unsigned int i) const
  */
 const XMLNode *XMLNode::getNode(const std::string &s) const
 {
-    for(unsigned int i=0; i<m_nodes.size(); i++)
+    for(unsigned int i=0; i<m_num_children; i++)
     {
-        if(m_nodes[i]->getName()==s) return m_nodes[i];
+        const XMLNode *node = getNode(i);
+        if(node->getName()==s) return node;
     }
     return NULL;
 }   // getNode
@@ -157,15 +606,47 @@ const XMLNode *XMLNode::getNode(const std::string &s) const
  */
 const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) const
 {
-    for(unsigned int i=0; i<m_nodes.size(); i++)
+    for(unsigned int i=0; i<m_num_children; i++)
     {
-        if(m_nodes[i]->getName()==s)
+        XMLNode *node =
+            m_document->getNode(m_document->m_children[m_first_child+i]);
+        if(node->getName()==s)
         {
-            out.push_back(m_nodes[i]);
+            out.push_back(node);
         }
     }
 }   // getNode
 
+// ----------------------------------------------------------------------------
+/** Finds the value of an attribute as 8 bit string. If an attribute is
+ *  defined more than once, the last value is used.
+ *  \param attribute Name of the attribute.
+ *  \param value On return the value.
+ *  \param buffer Used to store the converted value if the value is stored
+ *         as wide string.
+ *  \return 1 if the attribute was found, 0 otherwise.
+ */
+int XMLNode::getValue(const std::string &attribute, const char **value,
+                      std::string *buffer) const
+{
+    for(unsigned int i=m_num_attributes; i>0; i--)
+    {
+        const Document::Attribute &a =
+            m_document->m_attributes[m_first_attribute+i-1];
+        if(m_document->m_names[a.m_name]!=attribute) continue;
+        if(a.m_is_wide)
+        {
+            *buffer = core::stringc(&m_document->m_wide_values[a.m_value])
+                      .c_str();
+            *value = buffer->c_str();
+        }
+        else
+            *value = &m_document->m_values[a.m_value];
+        return 1;
+    }
+    return 0;
+}   // getValue
+
 // ----------------------------------------------------------------------------
 /** If 'attribute' was defined, set 'value' to the value of the
 *   attribute and return 1, otherwise return 0 and do not change value.
@@ -174,22 +655,27 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
 */
 int XMLNode::get(const std::string &attribute, std::string *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value=core::stringc(o->second).c_str();
+    const char *s;
+    std::string buffer;
+    if(!getValue(attribute, &s, &buffer)) return 0;
+    *value = s;
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::stringw *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value = o->second;
-    return 1;
+    for(unsigned int i=m_num_attributes; i>0; i--)
+    {
+        const Document::Attribute &a =
+            m_document->m_attributes[m_first_attribute+i-1];
+        if(m_document->m_names[a.m_name]!=attribute) continue;
+        if(a.m_is_wide)
+            *value = &m_document->m_wide_values[a.m_value];
+        else
+            *value = &m_document->m_values[a.m_value];
+        return 1;
+    }
+    return 0;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::vector2df *value) const
@@ -224,15 +710,15 @@ int XMLNode::get(const std::string &attribute, Vec3 *value) const
     if (v.size() != 3)
     {
         Log::warn("[XMLNode]", "WARNING: Expected 3 floating-point values, but found '%s' in file %s",
-                    s.c_str(), m_file_name.c_str());
+                    s.c_str(), m_document->m_file_name.c_str());
         return 0;
     }
 
     float x, y, z;
 
-    if (StringUtils::parseString<float>(v[0], &x) &&
-        StringUtils::parseString<float>(v[1], &y) &&
-        StringUtils::parseString<float>(v[2], &z) )
+    if (parseFloat(v[0].c_str(), &x) &&
+        parseFloat(v[1].c_str(), &y) &&
+        parseFloat(v[2].c_str(), &z) )
     {
         value->setX(x);
         value->setY(y);
@@ -241,7 +727,7 @@ int XMLNode::get(const std::string &attribute, Vec3 *value) const
     else
     {
         Log::warn("[XMLNode]", "WARNING: Expected 3 floating-point values, but found '%s' in file %s",
-                    s.c_str(), m_file_name.c_str());
+                    s.c_str(), m_document->m_file_name.c_str());
         return 0;
     }
 
@@ -300,13 +786,14 @@ int XMLNode::get(const std::string &attribute, video::SColorf *color) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, int32_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const char *s;
+    std::string buffer;
+    if(!getValue(attribute, &s, &buffer)) return 0;
 
-    if (!StringUtils::parseString<int>(s, value))
+    if (!parseInt(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s, attribute.c_str(), getName().c_str(), m_document->m_file_name.c_str());
         return 0;
     }
 
@@ -322,7 +809,7 @@ int XMLNode::get(const std::string &attribute, int64_t *value) const
     if (!StringUtils::parseString<int64_t>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), getName().c_str(), m_document->m_file_name.c_str());
         return 0;
     }
 
@@ -339,7 +826,7 @@ int XMLNode::get(const std::string &attribute, uint16_t *value) const
     if (!StringUtils::parseString<uint16_t>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), getName().c_str(), m_document->m_file_name.c_str());
         return 0;
     }
 
@@ -355,7 +842,7 @@ int XMLNode::get(const std::string &attribute, uint32_t *value) const
     if (!StringUtils::parseString<unsigned int>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), getName().c_str(), m_document->m_file_name.c_str());
         return 0;
     }
 
@@ -365,13 +852,14 @@ int XMLNode::get(const std::string &attribute, uint32_t *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, float *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const char *s;
+    std::string buffer;
+    if(!getValue(attribute, &s, &buffer)) return 0;
 
-    if (!StringUtils::parseString<float>(s, value))
+    if (!parseFloat(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s, attribute.c_str(), getName().c_str(), m_document->m_file_name.c_str());
         return 0;
     }
 
@@ -427,10 +915,10 @@ int XMLNode::get(const std::string &attribute,
     for (unsigned int i=0; i<count; i++)
     {
         float curr;
-        if (!StringUtils::parseString<float>(v[i], &curr))
+        if (!parseFloat(v[i].c_str(), &curr))
         {
             Log::warn("[XMLNode]", "WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s",
-                        v[i].c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                        v[i].c_str(), attribute.c_str(), getName().c_str(), m_document->m_file_name.c_str());
             return 0;
         }
 
@@ -461,7 +949,7 @@ int XMLNode::get(const std::string &attribute, std::vector<int> *value) const
         if (!StringUtils::parseString<int>(v[i], &val))
         {
             Log::warn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s'",
-                        v[i].c_str(), attribute.c_str(), m_name.c_str());
+                        v[i].c_str(), attribute.c_str(), getName().c_str());
             return 0;
         }
 
@@ -619,9 +1107,9 @@ int XMLNode::getHPR(Vec3 *value) const
 
 bool XMLNode::hasChildNamed(const char* name) const
 {
-    for (unsigned int i = 0; i < m_nodes.size(); i++)
+    for (unsigned int i = 0; i < m_num_children; i++)
     {
-        if (m_nodes[i]->getName() == name) return true;
+        if (getNode(i)->getName() == name) return true;
     }
     return false;
 }
@@ -40,22 +40,46 @@ class InterpolationArray;
 class Vec3;
 
 /**
-  * \brief utility class used to parse XML files
+  * \brief utility class used to parse XML files.
+  *  All nodes of a file share one document, which stores the (interned)
+  *  names of all elements and attributes, all attribute values as plain
+  *  8 bit strings (only values with non-ASCII characters are stored as wide
+  *  strings), and allocates the child nodes in blocks. Values are only
+  *  converted to the requested type in get(). The document of a large file
+  *  is cached in binary form in the cached data directory, so it does not
+  *  need to be parsed again as long as the file does not change.
   * \ingroup io
   */
 class XMLNode : public NoCopy
 {
 private:
-    /** Name of this element. */
-    std::string                          m_name;
-    /** List of all attributes. */
-    std::map<std::string, core::stringw> m_attributes;
-    /** List of all sub nodes. */
-    std::vector<XMLNode *>               m_nodes;
+    class Document;
 
-    void readXML(io::IXMLReader *xml);
+    /** The document this node belongs to. */
+    Document    *m_document;
+    /** Index of the name of this element in the interned names. */
+    uint16_t     m_name;
+    /** Number of attributes of this node. */
+    uint16_t     m_num_attributes;
+    /** Index of the first attribute of this node in the document. */
+    uint32_t     m_first_attribute;
+    /** Index of the first child of this node in the document. */
+    uint32_t     m_first_child;
+    /** Number of children of this node. */
+    uint32_t     m_num_children;
+    /** True for the root node, which owns the document. */
+    bool         m_is_root;
 
-    std::string                          m_file_name;
+    /** Files that are at least this size are cached in binary form. */
+    static const long BINARY_CACHE_MIN_SIZE = 32*1024;
+
+    /** If the binary cache of XML files is used. */
+    static bool  m_use_binary_cache;
+
+                 XMLNode();
+    void         readXML(io::IXMLReader *xml);
+    int          getValue(const std::string &attribute, const char **value,
+                          std::string *buffer) const;
 
 public:
          LEAK_CHECK();
@@ -66,11 +90,11 @@ public:
 
         ~XMLNode();
 
-    const std::string &getName() const {return m_name; }
+    const std::string &getName() const;
     const XMLNode     *getNode(const std::string &name) const;
     const void         getNodes(const std::string &s, std::vector<XMLNode*>& out) const;
     const XMLNode     *getNode(unsigned int i) const;
-    unsigned int       getNumNodes() const {return m_nodes.size(); }
+    unsigned int       getNumNodes() const {return m_num_children; }
     int get(const std::string &attribute, std::string *value) const;
     int get(const std::string &attribute, core::stringw *value) const;
     int get(const std::string &attribute, int32_t  *value) const;
@@ -103,6 +127,11 @@ public:
     static bool hasH(int b) { return (b&1)==1; }
     static bool hasP(int b) { return (b&2)==2; }
     static bool hasR(int b) { return (b&4)==4; }
+
+    // ------------------------------------------------------------------------
+    /** Enables or disables the binary cache of large XML files (e.g. to
+     *  compare the loading times). */
+    static void setUseBinaryCache(bool b) { m_use_binary_cache = b; }
 };   // XMLNode
 
 #endif
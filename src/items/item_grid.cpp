@@ -0,0 +1,106 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "items/item_grid.hpp"
+
+#include "items/item.hpp"
+#include "utils/vec3.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+/** Creates an empty grid.
+ *  \param cell_size Side length of a cell. It should be about the size of
+ *         the collection distance of the typical item.
+ */
+ItemGrid::ItemGrid(float cell_size)
+{
+    assert(cell_size>0);
+    m_cell_size = cell_size;
+    m_buckets.resize(NUM_BUCKETS);
+}   // ItemGrid
+
+// ----------------------------------------------------------------------------
+/** Computes the range of cells which are overlapped by the collection
+ *  sphere of an item.
+ */
+void ItemGrid::getCellRange(const Item *item, int *min_x, int *max_x,
+                            int *min_z, int *max_z) const
+{
+    const Vec3 &xyz = item->getXYZ();
+    float r = sqrtf(item->getDistance2());
+    *min_x = getCell(xyz.getX()-r);
+    *max_x = getCell(xyz.getX()+r);
+    *min_z = getCell(xyz.getZ()-r);
+    *max_z = getCell(xyz.getZ()+r);
+}   // getCellRange
+
+// ----------------------------------------------------------------------------
+/** Adds an item to all cells its collection sphere overlaps. An item is
+ *  stored at most once in each bucket.
+ *  \param item The item to add.
+ */
+void ItemGrid::addItem(Item *item)
+{
+    int min_x, max_x, min_z, max_z;
+    getCellRange(item, &min_x, &max_x, &min_z, &max_z);
+    for(int x=min_x; x<=max_x; x++)
+    {
+        for(int z=min_z; z<=max_z; z++)
+        {
+            ItemList &items = m_buckets[getBucket(x, z)];
+            if(std::find(items.begin(), items.end(), item)==items.end())
+                items.push_back(item);
+        }   // for z
+    }   // for x
+}   // addItem
+
+// ----------------------------------------------------------------------------
+/** Removes an item from all cells it was added to.
+ *  \param item The item to remove.
+ */
+void ItemGrid::removeItem(Item *item)
+{
+    int min_x, max_x, min_z, max_z;
+    getCellRange(item, &min_x, &max_x, &min_z, &max_z);
+    for(int x=min_x; x<=max_x; x++)
+    {
+        for(int z=min_z; z<=max_z; z++)
+        {
+            ItemList &items = m_buckets[getBucket(x, z)];
+            ItemList::iterator it = std::find(items.begin(), items.end(),
+                                              item);
+            if(it==items.end()) continue;
+            // The order of items in a bucket doesn't matter
+            *it = items.back();
+            items.pop_back();
+        }   // for z
+    }   // for x
+}   // removeItem
+
+// ----------------------------------------------------------------------------
+/** Returns all items which could be hit at the specified position. The
+ *  list can contain items that are further away, so the caller still has
+ *  to test each item.
+ *  \param xyz The position to test.
+ */
+const ItemGrid::ItemList& ItemGrid::getItemsNear(const Vec3 &xyz) const
+{
+    return m_buckets[getBucket(getCell(xyz.getX()), getCell(xyz.getZ()))];
+}   // getItemsNear
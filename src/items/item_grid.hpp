@@ -0,0 +1,83 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_ITEM_GRID_HPP
+#define HEADER_ITEM_GRID_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <math.h>
+#include <vector>
+
+class Item;
+class Vec3;
+
+/**
+  * \brief A spatial index of all items, used to quickly find the items a
+  *  kart can hit.
+  *  The ground plane (x/z) is divided into square cells, and each item is
+  *  stored in every cell that its collection sphere overlaps. A kart then
+  *  only has to test the items in the cell it is in. The cells are hashed
+  *  into a fixed number of buckets, so the grid needs no bounds and uses
+  *  the same amount of memory for every track. Different cells can end up
+  *  in the same bucket, which only results in a few more (cheap) tests.
+  *  Items don't move, so they are only added when created and removed
+  *  when deleted. Collected items remain in the grid (they are skipped
+  *  using Item::wasCollected()).
+  * \ingroup items
+  */
+class ItemGrid : public NoCopy
+{
+public:
+    typedef std::vector<Item*> ItemList;
+
+private:
+    /** Number of buckets, must be a power of 2. */
+    static const unsigned int NUM_BUCKETS = 1024;
+
+    /** Side length of a cell. */
+    float m_cell_size;
+
+    /** All buckets. */
+    std::vector<ItemList> m_buckets;
+
+    void          getCellRange(const Item *item, int *min_x, int *max_x,
+                               int *min_z, int *max_z) const;
+    // ------------------------------------------------------------------------
+    /** Returns the cell coordinate of a world coordinate. */
+    int           getCell(float f) const
+    {
+        return (int)floorf(f/m_cell_size);
+    }   // getCell
+    // ------------------------------------------------------------------------
+    /** Returns the index of the bucket a cell is stored in. */
+    unsigned int  getBucket(int x, int z) const
+    {
+        return ((unsigned int)x*73856093u ^ (unsigned int)z*19349663u)
+               & (NUM_BUCKETS-1);
+    }   // getBucket
+
+public:
+                  ItemGrid(float cell_size=8.0f);
+    void          addItem(Item *item);
+    void          removeItem(Item *item);
+    const ItemList& getItemsNear(const Vec3 &xyz) const;
+};   // ItemGrid
+
+#endif
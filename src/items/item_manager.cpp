@@ -29,11 +29,13 @@
 #include "io/file_manager.hpp"
 #include "karts/abstract_kart.hpp"
 #include "modes/linear_world.hpp"
+#include "modes/profile_world.hpp"
 #include "network/network_manager.hpp"
 #include "network/network_world.hpp"
 #include "tracks/quad_graph.hpp"
 #include "tracks/track.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 
 #include <IMesh.h>
 #include <IAnimatedMesh.h>
@@ -144,7 +146,10 @@ void ItemManager::removeTextures()
  *  of each race. */
 ItemManager::ItemManager()
 {
-    m_switch_time = -1.0f;
+    m_switch_time    = -1.0f;
+    m_num_hit_checks = 0;
+    m_num_hit_tests  = 0;
+    m_hit_check_time = 0;
     // The actual loading is done in loadDefaultItems
 
     // Prepare the switch to array, which stores which item should be
@@ -216,6 +221,7 @@ void ItemManager::insertItem(Item *item)
     else
         m_all_items.push_back(item);
     item->setItemId(index);
+    m_item_grid.addItem(item);
 
     // Now insert into the appropriate quad list, if there is a quad list
     // (i.e. race mode has a quad graph).
@@ -300,35 +306,60 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
-
-    for(AllItemTypes::iterator i =m_all_items.begin();
-        i!=m_all_items.end();  i++)
+    const bool profile = ProfileWorld::isProfileMode();
+    double start = profile ? StkTime::getMonoTime() : 0;
+
+    // Only the items in the grid cell of the kart can be hit. Note that
+    // collecting an item can add new items (which might invalidate
+    // iterators), so use an index to access the list.
+    const Vec3 &xyz = kart->getXYZ();
+    const ItemGrid::ItemList &items = m_item_grid.getItemsNear(xyz);
+    for(unsigned int i=0; i<items.size(); i++)
     {
-        if((!*i) || (*i)->wasCollected()) continue;
+        Item *item = items[i];
+        if(item->wasCollected()) continue;
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
-        if((*i)->hitKart(kart->getXYZ(), kart))
+        if(item->hitKart(xyz, kart))
         {
             // if we're not playing online, pick the item.
             if (!NetworkWorld::getInstance()->isRunning())
-                collectedItem(*i, kart);
+                collectedItem(item, kart);
             else if (NetworkManager::getInstance()->isServer())
             {
-                collectedItem(*i, kart);
-                NetworkWorld::getInstance()->collectedItem(*i, kart);
+                collectedItem(item, kart);
+                NetworkWorld::getInstance()->collectedItem(item, kart);
             }
         }   // if hit
-    }   // for m_all_items
+    }   // for i<items.size()
+
+    if(profile)
+    {
+        m_num_hit_checks++;
+        m_num_hit_tests  += items.size();
+        m_hit_check_time += StkTime::getMonoTime() - start;
+    }
 }   // checkItemHit
 
+//-----------------------------------------------------------------------------
+/** Prints statistics about the item hit detection, used in profile mode to
+ *  compare the cost for different numbers of karts and items.
+ */
+void ItemManager::printHitStatistics() const
+{
+    unsigned int num_items = 0;
+    for(unsigned int i=0; i<m_all_items.size(); i++)
+        if(m_all_items[i]) num_items++;
+    if(m_num_hit_checks==0)
+        return;
+    Log::verbose("profile", "Item hit detection: %d items, %d checks, "
+                 "%f items tested per check, %f us per check, %f us total",
+                 num_items, m_num_hit_checks,
+                 (float)m_num_hit_tests/m_num_hit_checks,
+                 m_hit_check_time*1000000.0/m_num_hit_checks,
+                 m_hit_check_time*1000000.0);
+}   // printHitStatistics
+
 //-----------------------------------------------------------------------------
 /** Resets all items and removes bubble gum that is stuck on the track.
  *  This is done when a race is (re)started.
@@ -430,6 +461,8 @@ void ItemManager::deleteItem(Item *item)
         items.erase(it);
     }   // if m_items_in_quads
 
+    m_item_grid.removeItem(item);
+
     int index = item->getItemId();
     m_all_items[index] = NULL;
     delete item;
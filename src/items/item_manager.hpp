@@ -20,6 +20,7 @@
 #define HEADER_ITEMMANAGER_HPP
 
 #include "items/item.hpp"
+#include "items/item_grid.hpp"
 #include "utils/no_copy.hpp"
 
 #include <SColor.h>
@@ -82,6 +83,15 @@ private:
      *  field is undefined if no QuadGraph exist, e.g. in battle mode. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** Spatial index of all items, used for the item hit detection. */
+    ItemGrid m_item_grid;
+
+    /** Number of calls to checkItemHit, item tests done and time spent in
+     *  checkItemHit. Only updated in profile mode. */
+    unsigned int m_num_hit_checks;
+    unsigned int m_num_hit_tests;
+    double       m_hit_check_time;
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
@@ -109,6 +119,7 @@ public:
     void           collectedItem   (Item *item, AbstractKart *kart,
                                     int add_info=-1);
     void           switchItems     ();
+    void           printHitStatistics() const;
     // ------------------------------------------------------------------------
     /** Returns the number of items. */
     unsigned int   getNumberOfItems() const { return m_all_items.size(); }
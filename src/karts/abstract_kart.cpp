@@ -19,6 +19,7 @@
 
 #include "karts/abstract_kart.hpp"
 
+#include "config/user_config.hpp"
 #include "items/powerup.hpp"
 #include "karts/abstract_kart_animation.hpp"
 #include "karts/kart_model.hpp"
@@ -40,7 +41,19 @@ AbstractKart::AbstractKart(const std::string& ident,
     m_world_kart_id   = world_kart_id;
     m_kart_properties = kart_properties_manager->getKart(ident);
     m_kart_animation  = NULL;
-    assert(m_kart_properties != NULL);
+    // Karts are only loaded when they are used for the first time, so a
+    // listed kart can still fail to load (e.g. because of a broken
+    // kart.xml file). Use the default kart in this case.
+    if(!m_kart_properties)
+    {
+        std::string default_kart = UserConfigParams::m_default_kart;
+        Log::error("AbstractKart", "Can not load kart '%s', using '%s'.",
+                   ident.c_str(), default_kart.c_str());
+        m_kart_properties = kart_properties_manager->getKart(default_kart);
+        if(!m_kart_properties)
+            Log::fatal("AbstractKart", "Can not load kart '%s'.",
+                       default_kart.c_str());
+    }
 
     // We have to take a copy of the kart model, since otherwise
     // the animations will be mixed up (i.e. different instances of
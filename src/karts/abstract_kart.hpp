@@ -358,6 +358,11 @@ public:
      *  which includes attaching an anvil to the kart (and detaching). */
     virtual void updateWeight() = 0;
     // ------------------------------------------------------------------------
+    /** Applies the controls of the kart to its physics vehicle (engine
+     *  force, brakes, steering). Called by update(), and on its own when
+     *  the physics of the karts is re-simulated after a rewind. */
+    virtual void updatePhysics(float dt) = 0;
+    // ------------------------------------------------------------------------
     /** Multiplies the velocity of the kart by a factor f (both linear
      *  and angular). This is used by anvils, which suddenly slow down the kart
      *  when they are attached. */
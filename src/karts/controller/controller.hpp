@@ -104,6 +104,15 @@ public:
     /** Get a pointer on the kart controls. */
     virtual KartControl* getControls() { return m_controls; }
     // ------------------------------------------------------------------------
+    /** Called for all karts before any kart is updated if the AI decisions
+     *  are computed by several threads (see World::computeAIDecisions).
+     *  Otherwise it is not called at all. A controller can
+     *  do expensive computations here that are then used in update().
+     *  This function is called for several karts in parallel, so it must
+     *  only modify data of this controller, and must not use random
+     *  numbers. */
+    virtual void  computeDecisions(float dt) {};
+    // ------------------------------------------------------------------------
 };   // Controller
 
 #endif
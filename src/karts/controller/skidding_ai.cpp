@@ -190,6 +190,9 @@ void SkiddingAI::reset()
     m_avoid_item_close           = false;
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
+    m_decisions_computed         = false;
+    m_aim_point                  = Vec3(0,0,0);
+    m_aim_last_node              = QuadGraph::UNKNOWN_SECTOR;
 
     AIBaseController::reset();
     m_track_node               = QuadGraph::UNKNOWN_SECTOR;
@@ -228,6 +231,55 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
     return m_successor_index[index];
 }   // getNextSector
 
+//-----------------------------------------------------------------------------
+/** Computes the expensive, read-only part of the AI decisions: the nearest
+ *  karts, possible crashes, the direction of the track ahead and the point
+ *  to aim for. This is called for all karts in parallel before any kart
+ *  is updated (only if --ai-threads is not 1), the result is then used in
+ *  update().
+ *  The graphical AI debugging is not thread safe, so if it is compiled in
+ *  this information is computed in update().
+ *  \param dt Time step size.
+ */
+void SkiddingAI::computeDecisions(float dt)
+{
+    m_decisions_computed = false;
+#if defined(AI_DEBUG) || defined(AI_DEBUG_NEW_FIND_NON_CRASHING) || \
+    defined(AI_DEBUG_CIRCLES) || defined(AI_DEBUG_KART_HEADING)     || \
+    defined(AI_DEBUG_KART_AIM)
+    return;
+#endif
+    // Nothing to precompute if update() will not need this information.
+    if(m_kart->getKartAnimation() || isStuck() || m_world->isStartPhase())
+        return;
+
+    computeNearestKarts();
+    checkCrashes(m_kart->getXYZ());
+    determineTrackDirection();
+    findAimPoint(&m_aim_point, &m_aim_last_node);
+    m_decisions_computed = true;
+}   // computeDecisions
+
+//-----------------------------------------------------------------------------
+/** Finds the point to aim for (if no crash needs to be avoided) using the
+ *  selected point selection algorithm.
+ *  \param aim_point On return contains the point to aim for.
+ *  \param last_node On return contains the graph node of the aim point.
+ */
+void SkiddingAI::findAimPoint(Vec3 *aim_point, int *last_node)
+{
+    *last_node = QuadGraph::UNKNOWN_SECTOR;
+    switch(m_point_selection_algorithm)
+    {
+    case PSA_FIXED : findNonCrashingPointFixed(aim_point, last_node);
+                     break;
+    case PSA_NEW:    findNonCrashingPointNew(aim_point, last_node);
+                     break;
+    case PSA_DEFAULT:findNonCrashingPoint(aim_point, last_node);
+                     break;
+    }
+}   // findAimPoint
+
 //-----------------------------------------------------------------------------
 /** This is the main entry point for the AI.
  *  It is called once per frame for each AI and determines the behaviour of
@@ -311,15 +363,21 @@ void SkiddingAI::update(float dt)
         return;
     }
 
-    // Get information that is needed by more than 1 of the handling funcs
-    computeNearestKarts();
+    // Get information that is needed by more than 1 of the handling funcs,
+    // unless it was already computed in computeDecisions(). Otherwise the
+    // order of the original serial update is kept.
+    if(!m_decisions_computed)
+        computeNearestKarts();
 
     m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
                         m_ai_properties->getSpeedCap(m_distance_to_player),
                         /*fade_in_time*/0.0f);
-    //Detect if we are going to crash with the track and/or kart
-    checkCrashes(m_kart->getXYZ());
-    determineTrackDirection();
+    if(!m_decisions_computed)
+    {
+        //Detect if we are going to crash with the track and/or kart
+        checkCrashes(m_kart->getXYZ());
+        determineTrackDirection();
+    }
 
     // Special behaviour if we have a bomb attach: try to hit the kart ahead
     // of us.
@@ -533,17 +591,15 @@ void SkiddingAI::handleSteering(float dt)
     {
         m_start_kart_crash_direction = 0;
         Vec3 aim_point;
-        int last_node = QuadGraph::UNKNOWN_SECTOR;
-
-        switch(m_point_selection_algorithm)
+        int last_node;
+        if(m_decisions_computed)
         {
-        case PSA_FIXED : findNonCrashingPointFixed(&aim_point, &last_node);
-                         break;
-        case PSA_NEW:    findNonCrashingPointNew(&aim_point, &last_node);
-                         break;
-        case PSA_DEFAULT:findNonCrashingPoint(&aim_point, &last_node);
-                         break;
+            // The point to aim for was determined in computeDecisions()
+            aim_point = m_aim_point;
+            last_node = m_aim_last_node;
         }
+        else
+            findAimPoint(&aim_point, &last_node);
 #ifdef AI_DEBUG
         m_debug_sphere[m_point_selection_algorithm]->setPosition(aim_point.toIrrVector());
 #endif
@@ -1469,27 +1525,14 @@ void SkiddingAI::handleItems(const float dt)
  */
 void SkiddingAI::computeNearestKarts()
 {
-    int my_position    = m_kart->getPosition();
-
-    // If we are not the first, there must be another kart ahead of this kart
-    if( my_position>1 )
-    {
-        m_kart_ahead = m_world->getKartAtPosition(my_position-1);
-        if(m_kart_ahead &&
-              ( m_kart_ahead->isEliminated() || m_kart_ahead->hasFinishedRace()))
-              m_kart_ahead = NULL;
-    }
-    else
-        m_kart_ahead = NULL;
-
-    if( my_position<(int)m_world->getCurrentNumKarts())
-    {
-        m_kart_behind = m_world->getKartAtPosition(my_position+1);
-        if(m_kart_behind &&
-            (m_kart_behind->isEliminated() || m_kart_behind->hasFinishedRace()))
-            m_kart_behind = NULL;
-    }
-    else
+    m_kart_ahead = m_world->getKartAhead(m_kart);
+    if(m_kart_ahead &&
+          ( m_kart_ahead->isEliminated() || m_kart_ahead->hasFinishedRace()))
+          m_kart_ahead = NULL;
+
+    m_kart_behind = m_world->getKartBehind(m_kart);
+    if(m_kart_behind &&
+        (m_kart_behind->isEliminated() || m_kart_behind->hasFinishedRace()))
         m_kart_behind = NULL;
 
     m_distance_ahead = m_distance_behind = 9999999.9f;
@@ -2076,6 +2119,16 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
         current = m_next_node_index[current];
     }
 
+    // Use the precomputed data of the track if it covers the path the AI
+    // is going to drive.
+    if(QuadGraph::get()->getNavigationCache()
+                        .findNonCrashingPoint(m_track_node,
+                                              future_successor_idx,
+                                              m_kart->getXYZ(), m_kart_width,
+                                              m_next_node_index,
+                                              aim_position, last_node))
+        return;
+
     // This for loop runs till it runs out of unrolled quads or breaks when the
     // aim point is outside one of the unrolled quads.
     for(unsigned int j=0; j<QuadGraph::get()->getNumberOfUnrolledQuads(); j++)
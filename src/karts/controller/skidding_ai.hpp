@@ -199,6 +199,19 @@ private:
     enum {PSA_DEFAULT, PSA_FIXED, PSA_NEW}
           m_point_selection_algorithm;
 
+    /** True if computeDecisions() has computed the information about the
+     *  track and the other karts for this frame. It is only called if the
+     *  AI decisions are computed in parallel, otherwise update() computes
+     *  this information itself. */
+    bool m_decisions_computed;
+
+    /** The point to aim for (if no crash needs to be avoided), computed
+     *  by the selected point selection algorithm. */
+    Vec3 m_aim_point;
+
+    /** The graph node on which m_aim_point is. */
+    int  m_aim_last_node;
+
 #ifdef DEBUG
     /** For skidding debugging: shows the estimated turn shape. */
     ShowCurve **m_curve;
@@ -226,6 +239,7 @@ private:
     void  handleBraking();
     void  handleNitroAndZipper();
     void  computeNearestKarts();
+    void  findAimPoint(Vec3 *aim_point, int *last_node);
     void  handleItemCollectionAndAvoidance(Vec3 *aim_point,
                                            int last_node);
     bool  handleSelectedItem(Vec3 kart_aim_direction, Vec3 *aim_point);
@@ -260,6 +274,7 @@ public:
                  SkiddingAI(AbstractKart *kart);
                 ~SkiddingAI();
     virtual void update      (float delta) ;
+    virtual void computeDecisions(float dt);
     virtual void reset       ();
     virtual const irr::core::stringw& getNamePostfix() const;
 };
@@ -26,8 +26,9 @@ GhostKart::GhostKart(const std::string& ident)
              : Kart(ident, /*world kart id*/99999,
                     /*position*/-1, btTransform())
 {
-    m_current_transform = 0;
     m_next_event        = 0;
+    m_has_next          = false;
+    m_times[0] = m_times[1] = 0;
 }   // GhostKart
 
 // ----------------------------------------------------------------------------
@@ -35,27 +36,40 @@ void GhostKart::reset()
 {
     m_node->setVisible(true);
     Kart::reset();
-    m_current_transform = 0;
     m_next_event        = 0;
+    m_decoder.rewind();
+    m_has_next = true;
+    decodeNext();
+    decodeNext();
     // This will set the correct start position
     update(0);
 }   // reset
 
 // ----------------------------------------------------------------------------
-/** Sets the next time and transform. The current time and transform becomes
- *  the previous time and transform.
- *  \param
+/** Sets the encoded transforms of this kart (see TransformEncoder). The
+ *  data is not copied, it must stay valid as long as this kart exists.
+ *  \param data Pointer to the encoded transforms.
+ *  \param size Size of the encoded data.
  */
-void GhostKart::addTransform(float time, const btTransform &trans)
+void GhostKart::setTransformData(const uint8_t *data, size_t size)
 {
-    // FIXME: for now avoid that transforms for the same time are set
-    // twice (to avoid division by zero in update). This should be
-    // done when saving in replay
-    if(m_all_times.size()>0 && m_all_times.back()==time)
-        return;
-    m_all_times.push_back(time);
-    m_all_transform.push_back(trans);
-}   // addTransform
+    m_decoder.setData(data, size);
+    m_has_next = true;
+    decodeNext();
+    decodeNext();
+}   // setTransformData
+
+// ----------------------------------------------------------------------------
+/** The next transform becomes the previous transform, and the next
+ *  transform is decoded.
+ */
+void GhostKart::decodeNext()
+{
+    m_times[0]      = m_times[1];
+    m_transforms[0] = m_transforms[1];
+    if(m_has_next)
+        m_has_next = m_decoder.next(&m_times[1], &m_transforms[1]);
+}   // decodeNext
 
 // ----------------------------------------------------------------------------
 /** Adds a replay event for this kart.
@@ -92,27 +106,21 @@ void GhostKart::update(float dt)
 void GhostKart::updateTransform(float t, float dt)
 {
 
-    // Find (if necessary) the next index to use
-    while(m_current_transform+1 < m_all_times.size() &&
-          t>=m_all_times[m_current_transform+1])
-    {
-          m_current_transform ++;
-    }
-    if(m_current_transform+1>=m_all_times.size())
+    // Find (if necessary) the next transforms to use
+    while(m_has_next && t>=m_times[1])
+        decodeNext();
+
+    if(!m_has_next)
     {
         m_node->setVisible(false);
         return;
     }
 
-    float f =(t - m_all_times[m_current_transform])
-           / (  m_all_times[m_current_transform+1]
-              - m_all_times[m_current_transform]  );
-    setXYZ((1-f)*m_all_transform[m_current_transform  ].getOrigin()
-           + f  *m_all_transform[m_current_transform+1].getOrigin() );
-    const btQuaternion q = m_all_transform[m_current_transform].getRotation()
-                          .slerp(m_all_transform[m_current_transform+1]
-                                 .getRotation(),
-                                 f);
+    float f =(t - m_times[0]) / (m_times[1] - m_times[0]);
+    setXYZ((1-f)*m_transforms[0].getOrigin()
+           + f  *m_transforms[1].getOrigin() );
+    const btQuaternion q = m_transforms[0].getRotation()
+                          .slerp(m_transforms[1].getRotation(), f);
     setRotation(q);
     Moveable::updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
 }   // update
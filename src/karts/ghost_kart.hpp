@@ -21,6 +21,7 @@
 
 #include "karts/kart.hpp"
 #include "replay/replay_base.hpp"
+#include "replay/transform_codec.hpp"
 
 #include "LinearMath/btTransform.h"
 
@@ -31,31 +32,37 @@
 /** A ghost kart. It does not have a phsyics representation. It gets two
  *  transforms from the replay objects at two consecutive time steps,
  *  and will interpolate between those positions depending on the current
- *  time
+ *  time. The transforms are decoded one at a time from the encoded replay
+ *  data (which is usually memory mapped), so only the two transforms
+ *  currently used are kept in memory.
  */
 class GhostKart : public Kart
 {
 private:
-    /** The list of the times at which the transform were reached. */
-    std::vector<float>       m_all_times;
+    /** Decodes the transforms of this kart. */
+    TransformDecoder         m_decoder;
 
-    /** The transforms to assume at the corresponding time in m_all_times. */
-    std::vector<btTransform> m_all_transform;
+    /** The times of the previous and next transform. */
+    float                    m_times[2];
 
-    std::vector<ReplayBase::KartReplayEvent> m_replay_events;
+    /** The previous and next transform, the kart is interpolated between
+     *  those two. */
+    btTransform              m_transforms[2];
+
+    /** False once all transforms have been used. */
+    bool                     m_has_next;
 
-    /** Pointer to the last index in m_all_times that is smaller than
-     *  the current world time. */
-    unsigned int m_current_transform;
+    std::vector<ReplayBase::KartReplayEvent> m_replay_events;
 
     /** Index of the next kart replay event. */
     unsigned int m_next_event;
 
     void         updateTransform(float t, float dt);
+    void         decodeNext();
 public:
                  GhostKart(const std::string& ident);
     virtual void update (float dt);
-    virtual void addTransform(float time, const btTransform &trans);
+    virtual void setTransformData(const uint8_t *data, size_t size);
     virtual void addReplayEvent(const ReplayBase::KartReplayEvent &kre);
     virtual void reset();
     // ------------------------------------------------------------------------
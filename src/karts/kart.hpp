@@ -35,6 +35,7 @@
 #include "utils/no_copy.hpp"
 
 class btKart;
+class btKartRaycaster;
 
 class Attachment;
 class Controller;
@@ -147,7 +148,7 @@ private:
     // Bullet physics parameters
     // -------------------------
     btCompoundShape          m_kart_chassis;
-    btVehicleRaycaster      *m_vehicle_raycaster;
+    btKartRaycaster         *m_vehicle_raycaster;
     btKart                  *m_vehicle;
 
      /** The amount of energy collected by hitting coins. Note that it
@@ -213,7 +214,6 @@ private:
     /** To prevent using nitro in too short bursts */
     float         m_min_nitro_time;
 
-    void          updatePhysics(float dt);
     void          handleMaterialSFX(const Material *material);
     void          handleMaterialGFX();
     void          updateFlying();
@@ -232,6 +232,7 @@ public:
     virtual void   init(RaceManager::KartType type);
     virtual void   updateGraphics(float dt, const Vec3& off_xyz,
                                   const btQuaternion& off_rotation);
+    virtual void   updatePhysics(float dt);
     virtual void   createPhysics    ();
     virtual void   updateWeight     ();
     virtual bool   isInRest         () const;
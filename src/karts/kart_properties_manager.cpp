@@ -19,6 +19,7 @@
 
 #include "karts/kart_properties_manager.hpp"
 
+#include "addons/addon.hpp"
 #include "challenges/unlock_manager.hpp"
 #include "config/player_manager.hpp"
 #include "config/player_profile.hpp"
@@ -26,10 +27,13 @@
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "guiengine/engine.hpp"
+#include "io/asset_index.hpp"
 #include "io/file_manager.hpp"
 #include "karts/kart_properties.hpp"
+#include "utils/constants.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/translation.hpp"
 
 #include <algorithm>
 #include <ctime>
@@ -52,6 +56,8 @@ KartPropertiesManager::KartPropertiesManager()
  */
 KartPropertiesManager::~KartPropertiesManager()
 {
+    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+        delete m_karts_properties[i];
 }   // ~KartPropertiesManager
 
 //-----------------------------------------------------------------------------
@@ -71,9 +77,14 @@ void KartPropertiesManager::addKartSearchDir(const std::string &s)
  */
 void KartPropertiesManager::unloadAllKarts()
 {
-    m_karts_properties.clearAndDeleteAll();
+    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+        delete m_karts_properties[i];
+    m_karts_properties.clear();
+    m_kart_info.clear();
+    m_all_kart_dirs.clear();
     m_selected_karts.clear();
     m_kart_available.clear();
+    m_kart_load_failed.clear();
     m_groups_2_indices.clear();
     m_all_groups.clear();
 }   // unloadAllKarts
@@ -86,15 +97,18 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 {
     // Remove the kart properties from the vector of all kart properties
     int index = getKartId(ident);
-    const KartProperties *kp = getKart(ident);  // must be done before remove
-    m_karts_properties.remove(index);
+    // The kart might not have been loaded yet, so kp can be NULL.
+    KartProperties *kp = m_karts_properties[index];
+    const std::vector<std::string> groups = m_kart_info[index].m_groups;
+    m_karts_properties.erase(m_karts_properties.begin()+index);
+    m_kart_info.erase(m_kart_info.begin()+index);
     m_all_kart_dirs.erase(m_all_kart_dirs.begin()+index);
     m_kart_available.erase(m_kart_available.begin()+index);
+    m_kart_load_failed.erase(m_kart_load_failed.begin()+index);
 
     // Remove the just removed kart from the 'group-name to kart property
     // index' mapping. If a group is now empty (i.e. the removed kart was
     // the only member of this group), remove the group
-    const std::vector<std::string> &groups = kp->getGroups();
 
     for (unsigned int i=0; i<groups.size(); i++)
     {
@@ -142,17 +156,24 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 }   // removeKart
 
 //-----------------------------------------------------------------------------
-/** Loads all kart properties and models.
+/** Indexes all karts. Only the data needed to list the karts (see KartInfo)
+ *  is read, using an AssetIndex so that only new or modified kart.xml files
+ *  are parsed (in parallel). The kart properties and models are loaded the
+ *  first time a kart is used, see getKartById().
  */
 void KartPropertiesManager::loadAllKarts(bool loading_icon)
 {
+    static const char *attributes[] = { "version", "name", "icon-file",
+                                        "groups", NULL };
+    AssetIndex index("kart", "karts.index", attributes);
+
     m_all_kart_dirs.clear();
     std::vector<std::string>::const_iterator dir;
     for(dir = m_kart_search_path.begin(); dir!=m_kart_search_path.end(); dir++)
     {
         // First check if there is a kart in the current directory
         // -------------------------------------------------------
-        if(loadKart(*dir)) continue;
+        if(index.addDirectory(*dir, *dir+"/kart.xml")) continue;
 
         // If not, check each subdir of this directory.
         // --------------------------------------------
@@ -161,22 +182,71 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
         for(std::set<std::string>::const_iterator subdir=result.begin();
             subdir!=result.end(); subdir++)
         {
-            const bool loaded = loadKart(*dir+*subdir);
-
-            if (loaded && loading_icon)
-            {
-                GUIEngine::addLoadingIcon(irr_driver->getTexture(
-                    m_karts_properties[m_karts_properties.size()-1]
-                            .getAbsoluteIconFile()              )
-                                          );
-            }
+            if(*subdir=="." || *subdir=="..") continue;
+            index.addDirectory(*dir+*subdir, *dir+*subdir+"/kart.xml");
         }   // for all files in the currently handled directory
     }   // for i
+
+    index.update();
+
+    for(unsigned int i=0; i<index.getNumEntries(); i++)
+    {
+        const AssetIndex::Entry &entry = index.getEntry(i);
+        if(!entry.isValid())
+        {
+            Log::error("[Kart_Properties_Manager]", "Giving up loading '%s'.",
+                       entry.getConfigFile().c_str());
+            continue;
+        }
+
+        KartInfo info;
+        info.m_ident = StringUtils::getBasename(
+                             StringUtils::getPath(entry.getConfigFile()));
+        // If this is an addon kart, add "addon_" to the identifier - just in
+        // case that an addon kart has the same directory name (and therefore
+        // identifier) as an included kart.
+        if(Addon::isAddon(entry.getConfigFile()))
+            info.m_ident = Addon::createAddonId(info.m_ident);
+
+        // If the version of the kart file is not supported,
+        // ignore this .kart file
+        int version = 0;
+        entry.get("version", &version);
+        if (version < stk_config->m_min_kart_version ||
+            version > stk_config->m_max_kart_version)
+        {
+            Log::warn("[Kart_Properties_Manager]", "Warning: kart '%s' is not "
+                      "supported by this binary, ignored.",
+                      info.m_ident.c_str());
+            continue;
+        }
+
+        info.m_name = "NONAME";
+        entry.get("name", &info.m_name);
+        std::string icon_file;
+        entry.get("icon-file", &icon_file);
+        info.m_icon_file = entry.getDir()+"/"+icon_file;
+        entry.get("groups", &info.m_groups);
+        if(info.m_groups.size()==0)
+            info.m_groups.push_back(DEFAULT_GROUP_NAME);
+
+        if(!addKart(entry.getDir(), info, NULL))
+            continue;
+
+        if (loading_icon && !icon_file.empty() &&
+            std::find(m_kart_search_path.begin(), m_kart_search_path.end(),
+                      entry.getDir()) == m_kart_search_path.end())
+        {
+            GUIEngine::addLoadingIcon(irr_driver->getTexture(info.m_icon_file));
+        }
+    }   // for i < index.getNumEntries()
 }   // loadAllKarts
 
 //-----------------------------------------------------------------------------
 /** Loads a single kart and (if not disabled) the oorresponding 3d model.
- *  \param filename Full path to the kart config file.
+ *  This is used for karts that are installed while the game is running,
+ *  e.g. by the addons manager.
+ *  \param dir Directory of the kart.
  */
 bool KartPropertiesManager::loadKart(const std::string &dir)
 {
@@ -208,20 +278,55 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
         return false;
     }
 
-    m_karts_properties.push_back(kart_properties);
+    KartInfo info;
+    info.m_ident     = kart_properties->getIdent();
+    info.m_name      = kart_properties->getNonTranslatedName();
+    info.m_icon_file = kart_properties->getAbsoluteIconFile();
+    info.m_groups    = kart_properties->getGroups();
+    if(!addKart(dir, info, kart_properties))
+    {
+        delete kart_properties;
+        return false;
+    }
+    if(m_hat_mesh_name.size()>0)
+        kart_properties->setHatMeshName(m_hat_mesh_name);
+    return true;
+}   // loadKart
+
+//-----------------------------------------------------------------------------
+/** Adds a kart to the list of all karts and to its groups.
+ *  \param dir Directory of the kart.
+ *  \param info The data of the kart needed to list it.
+ *  \param kp The kart properties if the kart was already loaded, or NULL.
+ *  \return False if a kart with the same identifier already exists.
+ */
+bool KartPropertiesManager::addKart(const std::string &dir,
+                                    const KartInfo &info, KartProperties *kp)
+{
+    if(hasKart(info.m_ident))
+    {
+        Log::warn("[Kart_Properties_Manager]",
+                  "Kart '%s' in '%s' already exists, ignored.",
+                  info.m_ident.c_str(), dir.c_str());
+        return false;
+    }
+
+    m_karts_properties.push_back(kp);
+    m_kart_info.push_back(info);
     m_kart_available.push_back(true);
-    const std::vector<std::string>& groups=kart_properties->getGroups();
+    m_kart_load_failed.push_back(false);
+    const std::vector<std::string>& groups=info.m_groups;
     for(unsigned int g=0; g<groups.size(); g++)
     {
         if(m_groups_2_indices.find(groups[g])==m_groups_2_indices.end())
         {
             m_all_groups.push_back(groups[g]);
         }
-        m_groups_2_indices[groups[g]].push_back(m_karts_properties.size()-1);
+        m_groups_2_indices[groups[g]].push_back(m_kart_info.size()-1);
     }
     m_all_kart_dirs.push_back(dir);
     return true;
-}   // loadKartData
+}   // addKart
 
 //-----------------------------------------------------------------------------
 /** Sets the name of a mesh to use as a hat for all karts.
@@ -229,9 +334,11 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
   */
 void KartPropertiesManager::setHatMeshName(const std::string &hat_name)
 {
+    m_hat_mesh_name = hat_name;
     for (unsigned int i=0; i<m_karts_properties.size(); i++)
     {
-        m_karts_properties[i].setHatMeshName(hat_name);
+        if(m_karts_properties[i])
+            m_karts_properties[i]->setHatMeshName(hat_name);
     }
 }   // setHatMeshName
 
@@ -241,9 +348,9 @@ void KartPropertiesManager::setHatMeshName(const std::string &hat_name)
  */
 const int KartPropertiesManager::getKartId(const std::string &ident) const
 {
-    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+    for (unsigned int i=0; i<m_kart_info.size(); i++)
     {
-        if (m_karts_properties[i].getIdent() == ident)
+        if (m_kart_info[i].m_ident == ident)
             return i;
     }
 
@@ -253,26 +360,83 @@ const int KartPropertiesManager::getKartId(const std::string &ident) const
 }   // getKartId
 
 //-----------------------------------------------------------------------------
+/** Returns true if a kart with the given identifier exists. Unlike getKart
+ *  this does not load the kart.
+ *  \param ident Identifier of the kart.
+ */
+bool KartPropertiesManager::hasKart(const std::string &ident) const
+{
+    for (unsigned int i=0; i<m_kart_info.size(); i++)
+    {
+        if (m_kart_info[i].m_ident == ident)
+            return true;
+    }
+    return false;
+}   // hasKart
+
+//-----------------------------------------------------------------------------
+/** Returns the (translated) name of a kart without loading the kart.
+ *  \param i Index of the kart.
+ */
+core::stringw KartPropertiesManager::getKartName(int i) const
+{
+    return core::stringw(translations->w_gettext(m_kart_info[i].m_name.c_str()));
+}   // getKartName
+
+//-----------------------------------------------------------------------------
+/** Returns the kart properties of a kart, and loads the kart if necessary.
+ *  \param ident Identifier of the kart.
+ *  \return The kart properties, or NULL if the kart does not exist or can
+ *          not be loaded.
+ */
 const KartProperties* KartPropertiesManager::getKart(
                                                 const std::string &ident) const
 {
-    const KartProperties* kp;
-    for_in (kp, m_karts_properties)
+    for (unsigned int i=0; i<m_kart_info.size(); i++)
     {
-        if (kp->getIdent() == ident)
-            return kp;
+        if (m_kart_info[i].m_ident == ident)
+            return getKartById(i);
     }
 
     return NULL;
 }   // getKart
 
 //-----------------------------------------------------------------------------
+/** Returns the kart properties of a kart. If the kart was not used before,
+ *  its properties and model are loaded now.
+ *  \param i Index of the kart.
+ *  \return The kart properties, or NULL if the index is invalid or the kart
+ *          can not be loaded.
+ */
 const KartProperties* KartPropertiesManager::getKartById(int i) const
 {
     if (i < 0 || i >= int(m_karts_properties.size()))
         return NULL;
 
-    return m_karts_properties.get(i);
+    if (!m_karts_properties[i])
+    {
+        if (m_kart_load_failed[i])
+            return NULL;
+        std::string config_filename = m_all_kart_dirs[i]+"/kart.xml";
+        KartProperties *kp;
+        try
+        {
+            kp = new KartProperties(config_filename);
+        }
+        catch (std::runtime_error& err)
+        {
+            Log::error("[Kart_Properties_Manager]",
+                       "Giving up loading '%s': %s",
+                       config_filename.c_str(), err.what());
+            m_kart_load_failed[i] = true;
+            m_kart_available[i]   = false;
+            return NULL;
+        }
+        if(m_hat_mesh_name.size()>0)
+            kp->setHatMeshName(m_hat_mesh_name);
+        m_karts_properties[i] = kp;
+    }
+    return m_karts_properties[i];
 }   // getKartById
 
 //-----------------------------------------------------------------------------
@@ -280,10 +444,10 @@ const KartProperties* KartPropertiesManager::getKartById(int i) const
 std::vector<std::string> KartPropertiesManager::getAllAvailableKarts() const
 {
     std::vector<std::string> all;
-    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+    for (unsigned int i=0; i<m_kart_info.size(); i++)
     {
         if (m_kart_available[i])
-            all.push_back(m_karts_properties[i].getIdent());
+            all.push_back(m_kart_info[i].m_ident);
     }
     return all;
 }   // getAllAvailableKarts
@@ -296,19 +460,19 @@ std::vector<std::string> KartPropertiesManager::getAllAvailableKarts() const
  */
 void KartPropertiesManager::setUnavailableKarts(std::vector<std::string> karts)
 {
-    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+    for (unsigned int i=0; i<m_kart_info.size(); i++)
     {
         if (!m_kart_available[i]) continue;
 
         if (std::find(karts.begin(), karts.end(),
-                      m_karts_properties[i].getIdent())
+                      m_kart_info[i].m_ident)
             == karts.end())
         {
             m_kart_available[i] = false;
 
             Log::error("[Kart_Properties_Manager]",
                        "Kart '%s' not available on all clients, disabled.",
-                       m_karts_properties[i].getIdent().c_str());
+                       m_kart_info[i].m_ident.c_str());
         }   // kart not in list
     }   // for i in m_kart_properties
 
@@ -321,9 +485,9 @@ int KartPropertiesManager::getKartByGroup(const std::string& group,
                                           int n) const
 {
     int count=0;
-    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+    for (unsigned int i=0; i<m_kart_info.size(); i++)
     {
-        std::vector<std::string> groups = m_karts_properties[i].getGroups();
+        const std::vector<std::string> &groups = m_kart_info[i].m_groups;
         if (std::find(groups.begin(), groups.end(), group) == groups.end())
             continue;
         if (count == n) return i;
@@ -354,8 +518,8 @@ bool KartPropertiesManager::kartAvailable(int kartid)
     {
         if ( kartid == *it) return false;
     }
-    const KartProperties *kartprop = getKartById(kartid);
-    if( PlayerManager::getCurrentPlayer()->isLocked(kartprop->getIdent()) )
+    if( PlayerManager::getCurrentPlayer()->isLocked(
+                                                m_kart_info[kartid].m_ident) )
         return false;
     return true;
 }   // kartAvailable
@@ -382,7 +546,7 @@ const std::vector<int> KartPropertiesManager::getKartsInGroup(
     if (g == ALL_KART_GROUPS_ID)
     {
         std::vector<int> out;
-        for (unsigned int n=0; n<m_karts_properties.size(); n++)
+        for (unsigned int n=0; n<m_kart_info.size(); n++)
         {
             out.push_back(n);
         }
@@ -461,12 +625,12 @@ void KartPropertiesManager::getRandomKartList(int count,
             // first try not to use a kart already used by a player
             for (unsigned int i=0; i<karts_in_group.size(); i++)
             {
-                const KartProperties &kp=m_karts_properties[karts_in_group[i]];
+                const KartInfo &info = m_kart_info[karts_in_group[i]];
                 if (!used[karts_in_group[i]]                 &&
                     m_kart_available[karts_in_group[i]]      &&
-                    !PlayerManager::getCurrentPlayer()->isLocked(kp.getIdent())   )
+                    !PlayerManager::getCurrentPlayer()->isLocked(info.m_ident) )
                 {
-                    random_kart_queue.push_back(kp.getIdent());
+                    random_kart_queue.push_back(info.m_ident);
                 }
             }
 
@@ -475,9 +639,8 @@ void KartPropertiesManager::getRandomKartList(int count,
             {
                 for (unsigned int i=0; i<karts_in_group.size(); i++)
                 {
-                    const KartProperties &kp =
-                        m_karts_properties[karts_in_group[i]];
-                    random_kart_queue.push_back(kp.getIdent());
+                    random_kart_queue.push_back(
+                                          m_kart_info[karts_in_group[i]].m_ident);
                 }
             }
 
@@ -20,8 +20,11 @@
 #ifndef HEADER_KART_PROPERTIES_MANAGER_HPP
 #define HEADER_KART_PROPERTIES_MANAGER_HPP
 
-#include "utils/ptr_vector.hpp"
 #include <map>
+#include <string>
+#include <vector>
+
+#include <irrString.h>
 
 #include "network/remote_kart_info.hpp"
 #include "utils/no_copy.hpp"
@@ -31,10 +34,28 @@
 class KartProperties;
 
 /**
+  * \brief Manages all karts. At startup only the data needed to list the
+  *  karts (see KartInfo) is read from an AssetIndex. The kart properties
+  *  (including the model) of a kart are only loaded the first time they
+  *  are requested.
   * \ingroup karts
   */
 class KartPropertiesManager: public NoCopy
 {
+public:
+    /** The data of a kart that is available without loading the kart. */
+    struct KartInfo
+    {
+        /** Identifier of the kart. */
+        std::string              m_ident;
+        /** The (untranslated) name of the kart. */
+        std::string              m_name;
+        /** Full path of the icon file. */
+        std::string              m_icon_file;
+        /** The groups the kart belongs to. */
+        std::vector<std::string> m_groups;
+    };   // KartInfo
+
 private:
     /** The list of all directories in which to search for karts. */
     static std::vector<std::string>          m_kart_search_path;
@@ -55,14 +76,27 @@ private:
     std::vector<int>         m_selected_karts;
 
     /** Contains a flag for each kart indicating wether it is available on
-     *  all clients or not. */
-    std::vector<bool>        m_kart_available;
+     *  all clients or not. A kart whose data can not be loaded is marked
+     *  unavailable as well (see getKartById). */
+    mutable std::vector<bool> m_kart_available;
+
+    /** True for each kart whose kart.xml failed to load, so that it is not
+     *  parsed (and the error logged) again on every request. */
+    mutable std::vector<bool> m_kart_load_failed;
 
-protected:
+    /** The data of all karts that is available without loading them. */
+    std::vector<KartInfo>    m_kart_info;
 
-    typedef PtrVector<KartProperties> KartPropertiesVector;
-    /** All available kart configurations */
-    KartPropertiesVector m_karts_properties;
+    /** Name of the hat mesh used for all karts, or "". */
+    std::string              m_hat_mesh_name;
+
+    /** All available kart configurations, NULL if a kart was not used yet
+     *  (see getKartById). */
+    mutable std::vector<KartProperties*> m_karts_properties;
+
+    bool                     addKart(const std::string &dir,
+                                     const KartInfo &info,
+                                     KartProperties *kp);
 
 public:
                              KartPropertiesManager();
@@ -73,6 +107,8 @@ public:
     const int                getKartId(const std::string &ident) const;
     int                      getKartByGroup(const std::string& group,
                                            int i) const;
+    bool                     hasKart(const std::string &ident) const;
+    irr::core::stringw       getKartName(int i) const;
 
     bool                     loadKart               (const std::string &dir);
     void                     loadAllKarts           (bool loading_icon = true);
@@ -104,6 +140,10 @@ public:
     /** Sets a kartid to be selected (used in networking only). */
     void selectKart(int kartid) { m_selected_karts.push_back(kartid); }
     // ------------------------------------------------------------------------
+    /** Returns the data of a kart that is available without loading it.
+     *  \param i Index of the kart. */
+    const KartInfo& getKartInfo(int i) const { return m_kart_info[i]; }
+    // ------------------------------------------------------------------------
     /** Returns all directories from which karts were loaded. */
     const std::vector<std::string>* getAllKartDirs() const
                                     { return &m_all_kart_dirs; }
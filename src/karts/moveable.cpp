@@ -125,6 +125,18 @@ void Moveable::stopFlying()
  *  \param float dt Time step size.
  */
 void Moveable::update(float dt)
+{
+    updatePosition();
+    updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Takes the position and orientation of this object from the physics, and
+ *  updates all values derived from it (velocity in local coordinates,
+ *  heading, pitch, roll). This is called from update(), but can be called
+ *  before that if the up-to-date position is needed earlier.
+ */
+void Moveable::updatePosition()
 {
     if(m_body->getInvMass()!=0)
         m_motion_state->getWorldTransform(m_transform);
@@ -138,9 +150,7 @@ void Moveable::update(float dt)
     Vec3 up       = getTrans().getBasis().getColumn(1);
     m_pitch       = atan2(up.getZ(), fabsf(up.getY()));
     m_roll        = atan2(up.getX(), up.getY());
-
-    updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
-}   // update
+}   // updatePosition
 
 //-----------------------------------------------------------------------------
 /** Creates the bullet rigid body for this moveable.
@@ -163,6 +163,7 @@
 #include "input/input_manager.hpp"
 #include "input/wiimote_manager.hpp"
 #include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
 #include "items/attachment_manager.hpp"
 #include "items/item_manager.hpp"
 #include "items/projectile_manager.hpp"
@@ -173,6 +174,7 @@
 #include "modes/profile_world.hpp"
 #include "network/client_network_manager.hpp"
 #include "network/network_manager.hpp"
+#include "network/packet_replay.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/protocols/server_lobby_room_protocol.hpp"
 #include "network/client_network_manager.hpp"
@@ -200,6 +202,8 @@
 #include "utils/crash_reporting.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 
 static void cleanSuperTuxKart();
@@ -405,7 +409,7 @@ void setupRaceStart()
     StateManager::get()->createActivePlayer(
         PlayerManager::get()->getPlayer(0), device);
 
-    if (!kart_properties_manager->getKart(UserConfigParams::m_default_kart))
+    if (!kart_properties_manager->hasKart(UserConfigParams::m_default_kart))
     {
         Log::warn("main", "Kart '%s' is unknown so will use the "
             "default kart.",
@@ -481,9 +485,22 @@ void cmdLineHelp()
     "       --password=s       Automatically sign in (set the password).\n"
     "       --port=n           Port number to use.\n"
     "       --max-players=n    Maximum number of clients (server only).\n"
+    "       --server-tick-rate=n Number of world updates per second of a\n"
+    "                          server without graphics, and of online races.\n"
+    "       --network-rollback Rewind and re-simulate the karts in online races\n"
+    "                          when inputs arrive late.\n"
+    "       --network-latency=n Add n ms latency to all received packets.\n"
+    "       --ai-threads=n     Number of threads to compute the AI decisions\n"
+    "                          (0: one per core, 1: no additional threads,\n"
+    "                          default).\n"
     "       --no-console       Does not write messages in the console but to\n"
     "                          stdout.log.\n"
     "       --console          Write messages in the console and files\n"
+    "       --replay-packets=file  Replay the packets received in a packet\n"
+    "                          capture (see --server for server mode).\n"
+    "       --replay-real-time Replay the packets with the captured timing.\n"
+    "       --benchmark-xml    Measure the time to load all XML files in the\n"
+    "                          data directory, with and without binary cache.\n"
     "  -h,  --help             Show this help.\n"
     "\n"
     "You can visit SuperTuxKart's homepage at "
@@ -492,6 +509,63 @@ void cmdLineHelp()
     );
 }   // cmdLineHelp
 
+//=============================================================================
+/** Adds all XML files in a directory and its subdirectories to a list.
+ *  \param dir The directory to search.
+ *  \param files The list of files.
+ */
+static void findXMLFiles(const std::string &dir,
+                         std::vector<std::string> *files)
+{
+    std::set<std::string> result;
+    file_manager->listFiles(result, dir);
+    for(std::set<std::string>::iterator i=result.begin(); i!=result.end(); i++)
+    {
+        if(*i=="." || *i=="..") continue;
+        std::string path = dir+"/"+*i;
+        if(file_manager->isDirectory(path))
+            findXMLFiles(path, files);
+        else if(StringUtils::getExtension(*i)=="xml")
+            files->push_back(path);
+    }
+}   // findXMLFiles
+
+//=============================================================================
+/** Loads all XML files in the data directory three times: without the
+ *  binary cache, while creating the cache, and using the cache. The time
+ *  needed is printed.
+ */
+static void benchmarkXMLLoading()
+{
+    std::string data_dir =
+        StringUtils::getPath(file_manager->getAsset("stk_config.xml"));
+    std::vector<std::string> files;
+    findXMLFiles(data_dir, &files);
+
+    const char *passes[] = { "text only", "creating cache", "using cache" };
+    for(unsigned int pass=0; pass<3; pass++)
+    {
+        XMLNode::setUseBinaryCache(pass>0);
+        unsigned int errors = 0;
+        double start = StkTime::getMonoTime();
+        for(unsigned int i=0; i<files.size(); i++)
+        {
+            try
+            {
+                delete new XMLNode(files[i]);
+            }
+            catch(std::exception&)
+            {
+                errors++;
+            }
+        }
+        Log::info("main", "Loaded %d XML files in %f seconds (%s, %d errors).",
+                  (int)files.size(), StkTime::getMonoTime()-start,
+                  passes[pass], errors);
+    }
+    XMLNode::setUseBinaryCache(true);
+}   // benchmarkXMLLoading
+
 //=============================================================================
 /** For base options that don't need much to be inited (and, in some cases,
  *  that need to be read before initing stuff) - it only assumes that
@@ -510,6 +584,13 @@ int handleCmdLinePreliminary()
         exit(0);
     }
 
+    if(CommandLine::has("--benchmark-xml"))
+    {
+        benchmarkXMLLoading();
+        cleanUserConfig();
+        exit(0);
+    }
+
     if(CommandLine::has("--version") || CommandLine::has("-v"))
     {
         Log::info("main", "==============================");
@@ -667,6 +748,8 @@ int handleCmdLine()
         UserConfigParams::m_track_debug=1;
     if(CommandLine::has("--material-debug"))
         UserConfigParams::m_material_debug = true;
+    if(CommandLine::has("--sector-debug"))
+        UserConfigParams::m_sector_debug = true;
     if(CommandLine::has("--ftl-debug"))
         UserConfigParams::m_ftl_debug = true;
     if(CommandLine::has("--slipstream-debug"))
@@ -695,9 +778,26 @@ int handleCmdLine()
         Log::info("main", "Creating a server network manager.");
     }   // -server
 
+    if(CommandLine::has("--network-rollback"))
+        UserConfigParams::m_network_rollback = true;
+
+    if(CommandLine::has("--network-latency", &n) && n>=0)
+        UserConfigParams::m_network_latency = n;
+
+    if(CommandLine::has("--replay-packets", &s))
+        UserConfigParams::m_packets_replay_filename = s;
+    if(CommandLine::has("--replay-real-time"))
+        UserConfigParams::m_packets_replay_real_time = true;
+
     if(CommandLine::has("--max-players", &n))
         UserConfigParams::m_server_max_players=n;
 
+    if(CommandLine::has("--server-tick-rate", &n) && n>0)
+        UserConfigParams::m_server_tick_rate=n;
+
+    if(CommandLine::has("--ai-threads", &n) && n>=0)
+        UserConfigParams::m_ai_threads=n;
+
     if(CommandLine::has("--login", &s) )
     {
         login = s.c_str();
@@ -715,6 +815,8 @@ int handleCmdLine()
         {
             const KartProperties *km =
                 kart_properties_manager->getKartById(i);
+            // The kart could not be loaded, an error was already printed
+            if(!km) continue;
             Log::info("main", "%s:\t%swidth: %f length: %f height: %f "
                       "mesh-buffer count %d",
                       km->getIdent().c_str(),
@@ -906,6 +1008,8 @@ int handleCmdLine()
         {
             Log::verbose("main", "Profiling %d laps.",n);
             UserConfigParams::m_no_start_screen = true;
+            // Use a fixed seed, so that profile runs can be compared
+            srand(0);
             ProfileWorld::setProfileModeLaps(n);
             race_manager->setNumLaps(n);
         }
@@ -915,6 +1019,7 @@ int handleCmdLine()
     {
         Log::verbose("main", "Profiling: %d seconds.", n);
         UserConfigParams::m_no_start_screen = true;
+        srand(0);
         ProfileWorld::setProfileModeTime((float)n);
         race_manager->setNumLaps(999999); // profile end depends on time
     }   // --profile-time
@@ -1111,7 +1216,7 @@ void initRest()
     race_manager->setMinorMode (RaceManager::MINOR_MODE_NORMAL_RACE);
     race_manager->setDifficulty(
                  (RaceManager::Difficulty)(int)UserConfigParams::m_difficulty);
-    if(track_manager->getTrack(UserConfigParams::m_last_track))
+    if(track_manager->hasTrack(UserConfigParams::m_last_track))
         race_manager->setTrack(UserConfigParams::m_last_track);
 
 }   // initRest
@@ -1255,6 +1360,21 @@ int main(int argc, char *argv[] )
             ServerNetworkManager::getInstance()->setMaxPlayers(
                     UserConfigParams::m_server_max_players);
         }
+        if (UserConfigParams::m_packets_replay_filename.size() > 0)
+        {
+            // Only the protocols are started, no sockets are opened
+            ProtocolManager::getInstance<ProtocolManager>();
+            if (NetworkManager::getInstance()->isServer())
+                ProtocolManager::getInstance()->requestStart(
+                                              new ServerLobbyRoomProtocol());
+            {
+                PacketReplay replay;
+                replay.run(UserConfigParams::m_packets_replay_filename,
+                           UserConfigParams::m_packets_replay_real_time);
+            }
+            ProtocolManager::getInstance()->abort();
+            exit(0);
+        }
         NetworkManager::getInstance()->run();
         if (NetworkManager::getInstance()->isServer())
         {
@@ -1366,7 +1486,14 @@ int main(int argc, char *argv[] )
             race_manager->setupPlayerKartInfo();
             race_manager->startNew(false);
         }
-        main_loop->run();
+
+        // A dedicated server without graphics runs at a fixed tick rate,
+        // independent of any frame rate throttling.
+        if(ProfileWorld::isNoGraphics() &&
+           NetworkManager::getInstance()->isServer())
+            main_loop->runServer(UserConfigParams::m_server_tick_rate);
+        else
+            main_loop->run();
 
     }  // try
     catch (std::exception &e)
@@ -1394,6 +1521,9 @@ int main(int argc, char *argv[] )
     MemoryLeaks::checkForLeaks();
 #endif
 
+    // Write all queued log messages
+    Log::stopWriterThread();
+
 #ifndef WIN32
     if (user_config) //close logfiles
     {
@@ -35,7 +35,9 @@
 #include "online/request_manager.hpp"
 #include "race/race_manager.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/log.hpp"
 #include "utils/profiler.hpp"
+#include "utils/time.hpp"
 
 MainLoop* main_loop = 0;
 
@@ -46,6 +48,9 @@ m_frame_count(0)
     m_curr_time = 0;
     m_prev_time = 0;
     m_throttle_fps = true;
+    m_num_ticks = 0;
+    m_num_tick_overruns = 0;
+    m_max_tick_time = 0;
 }  // MainLoop
 
 //-----------------------------------------------------------------------------
@@ -180,6 +185,91 @@ void MainLoop::run()
 
 }   // run
 
+//-----------------------------------------------------------------------------
+/** The main loop of a dedicated server without graphics. Unlike run() the
+ *  world is updated with a fixed time step at a fixed rate, independent of
+ *  the irrlicht device timer and of any frame rate throttling. After each
+ *  tick the loop sleeps until the start of the next tick. If a tick takes
+ *  longer than the tick interval, it is counted as overrun; if the server
+ *  falls too far behind, the missed ticks are dropped instead of running
+ *  them back to back.
+ *  \param ticks_per_second Number of ticks per second.
+ */
+void MainLoop::runServer(int ticks_per_second)
+{
+    if(ticks_per_second < 1) ticks_per_second = 1;
+    const float  dt       = 1.0f/ticks_per_second;
+    // Maximum number of ticks the server can be behind before ticks are
+    // dropped.
+    const double max_lag  = 5*(double)dt;
+
+    Log::info("MainLoop", "Running server at %d ticks per second.",
+              ticks_per_second);
+
+    double next_tick   = StkTime::getMonoTime();
+    double last_report = next_tick;
+    unsigned int reported_overruns = 0;
+    while(!m_abort)
+    {
+        PROFILER_PUSH_CPU_MARKER("Server tick", 0xFF, 0x00, 0xF7);
+        const double tick_start = StkTime::getMonoTime();
+
+        if (World::getWorld())  // race is active if world exists
+        {
+            PROFILER_PUSH_CPU_MARKER("Update race", 0, 255, 255);
+            updateRace(dt);
+            PROFILER_POP_CPU_MARKER();
+        }
+
+        if (!m_abort)
+        {
+            PROFILER_PUSH_CPU_MARKER("Protocol manager update", 0x7F, 0x00, 0x7F);
+            ProtocolManager::getInstance()->update();
+            PROFILER_POP_CPU_MARKER();
+
+            PROFILER_PUSH_CPU_MARKER("Database polling update", 0x00, 0x7F, 0x7F);
+            Online::RequestManager::get()->update(dt);
+            PROFILER_POP_CPU_MARKER();
+        }
+        PROFILER_SYNC_FRAME();
+        PROFILER_POP_CPU_MARKER();
+
+        m_num_ticks++;
+        const double now       = StkTime::getMonoTime();
+        const double tick_time = now - tick_start;
+        if (tick_time > m_max_tick_time)
+            m_max_tick_time = tick_time;
+
+        next_tick += dt;
+        if (now > next_tick)
+        {
+            m_num_tick_overruns++;
+            if (now - next_tick > max_lag)
+            {
+                // Too far behind, skip the missed ticks.
+                next_tick = now;
+            }
+        }
+        else
+            StkTime::sleepUntil(next_tick);
+
+        // Report overruns at most every 10 seconds to avoid flooding the log
+        if (m_num_tick_overruns != reported_overruns && now - last_report > 10)
+        {
+            Log::warn("MainLoop", "%u ticks overran the tick interval of "
+                      "%.2f ms (%u ticks total), longest tick %.2f ms.",
+                      m_num_tick_overruns - reported_overruns,
+                      dt*1000.0f, m_num_ticks, m_max_tick_time*1000.0);
+            reported_overruns = m_num_tick_overruns;
+            last_report       = now;
+        }
+    }  // while !m_abort
+
+    Log::info("MainLoop", "Server stopped after %u ticks, %u overruns, "
+              "longest tick %.2f ms.", m_num_ticks, m_num_tick_overruns,
+              m_max_tick_time*1000.0);
+}   // runServer
+
 //-----------------------------------------------------------------------------
 /** Set the abort flag, causing the mainloop to be left.
  */
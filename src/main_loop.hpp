@@ -34,17 +34,32 @@ private:
     int      m_frame_count;
     Uint32   m_curr_time;
     Uint32   m_prev_time;
+
+    /** Number of ticks done by runServer(). */
+    unsigned int m_num_ticks;
+    /** Number of ticks that took longer than the tick interval. */
+    unsigned int m_num_tick_overruns;
+    /** The longest tick duration in seconds. */
+    double       m_max_tick_time;
+
     float    getLimitedDt();
     void     updateRace(float dt);
 public:
          MainLoop();
         ~MainLoop();
     void run();
+    void runServer(int ticks_per_second);
     void abort();
     void setThrottleFPS(bool throttle) { m_throttle_fps = throttle; }
     // ------------------------------------------------------------------------
     /** Returns true if STK is to be stoppe. */
     bool isAborted() const { return m_abort; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of ticks done by runServer(). */
+    unsigned int getNumTicks() const { return m_num_ticks; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of server ticks that were not finished in time. */
+    unsigned int getNumTickOverruns() const { return m_num_tick_overruns; }
 };   // MainLoop
 
 extern MainLoop* main_loop;
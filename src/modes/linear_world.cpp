@@ -94,6 +94,12 @@ void LinearWorld::reset()
         m_kart_info[i].getTrackSector()->update(m_karts[i]->getXYZ());
     }   // next kart
 
+    // Start with all karts in the order in which they were created,
+    // updateRacePosition() will sort them.
+    m_race_order.resize(kart_amount);
+    for(unsigned int i=0; i<kart_amount; i++)
+        m_race_order[i] = i;
+
     // At the moment the last kart would be the one that is furthest away
     // from the start line, i.e. it would determine the amount by which
     // the track length must be extended (to avoid negative numbers in
@@ -677,57 +683,64 @@ void LinearWorld::updateRacePosition()
     bool rank_changed = false;
 #endif
 
-    // NOTE: if you do any changes to this loop, the next loop (see
-    // DEBUG_KART_RANK below) needs to have the same changes applied
-    // so that debug output is still correct!!!!!!!!!!!
+    // Karts that are either eliminated or have finished the race already
+    // have their (final) position assigned. If these karts would get their
+    // rank updated, it could happen that a kart that finished first will be
+    // overtaken after crossing the finishing line and become second! All
+    // karts still racing are ranked behind the karts that have finished.
+    unsigned int num_finished = 0;
     for (unsigned int i=0; i<kart_amount; i++)
     {
         AbstractKart* kart = m_karts[i];
-        // Karts that are either eliminated or have finished the
-        // race already have their (final) position assigned. If
-        // these karts would get their rank updated, it could happen
-        // that a kart that finished first will be overtaken after
-        // crossing the finishing line and become second!
         if(kart->isEliminated() || kart->hasFinishedRace())
         {
             // This is only necessary to support debugging inconsistencies
             // in kart position parameters.
             setKartPosition(i, kart->getPosition());
-            continue;
+            if(!kart->isEliminated())
+                num_finished++;
         }
-        KartInfo& kart_info = m_kart_info[i];
-
-        int p = 1 ;
+    }
 
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
+    // Remove the karts that are not racing anymore from the race order,
+    // keeping the order of the remaining karts.
+    unsigned int num_racing = 0;
+    for (unsigned int i=0; i<m_race_order.size(); i++)
+    {
+        AbstractKart* kart = m_karts[m_race_order[i]];
+        if(!kart->isEliminated() && !kart->hasFinishedRace())
+            m_race_order[num_racing++] = m_race_order[i];
+    }
+    m_race_order.resize(num_racing);
 
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
+    // The order from the previous frame is nearly sorted, since only a few
+    // karts overtake each other in one frame. So the insertion sort only
+    // swaps the karts that changed places, and is linear otherwise.
+    for (unsigned int i=1; i<m_race_order.size(); i++)
+    {
+        const unsigned int kart_id = m_race_order[i];
+        unsigned int j = i;
+        while(j>0 && isKartAhead(kart_id, m_race_order[j-1]))
         {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
-
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
+            m_race_order[j] = m_race_order[j-1];
+            j--;
+        }
+        m_race_order[j] = kart_id;
+    }
 
-        } //next kart
+    // NOTE: if you do any changes to the ranking, the next loop (see
+    // DEBUG_KART_RANK below) needs to have the same changes applied
+    // so that debug output is still correct!!!!!!!!!!!
+    for (unsigned int n=0; n<m_race_order.size(); n++)
+    {
+        const unsigned int i = m_race_order[n];
+        KartInfo& kart_info = m_kart_info[i];
+        const int p = num_finished + n + 1;
 
 #ifndef DEBUG
         setKartPosition(i, p);
 #else
+        AbstractKart* kart = m_karts[i];
         rank_changed |= kart->getPosition()!=p;
         if (!setKartPosition(i,p))
         {
@@ -746,10 +759,11 @@ void LinearWorld::updateRacePosition()
             }
 
             Log::debug("[LinearWorld]", "Who has each ranking so far :");
-            for (unsigned int d=0; d<i; d++)
+            for (unsigned int d=0; d<n; d++)
             {
-                Log::debug("[LinearWorld]", "%s has rank %d", m_karts[d]->getIdent().c_str(),
-                            m_karts[d]->getPosition());
+                Log::debug("[LinearWorld]", "%s has rank %d",
+                           m_karts[m_race_order[d]]->getIdent().c_str(),
+                           m_karts[m_race_order[d]]->getPosition());
             }
 
             Log::debug("[LinearWorld]", "    --> And %s is being set at rank %d",
@@ -772,7 +786,7 @@ void LinearWorld::updateRacePosition()
             music_manager->switchToFastMusic();
             m_faster_music_active=true;
         }
-    }   // for i<kart_amount
+    }   // for n<m_race_order.size()
 
     // Define this to get a detailled analyses each time a race position
     // changes.
@@ -846,6 +860,21 @@ void LinearWorld::updateRacePosition()
     endSetKartPositions();
 }   // updateRacePosition
 
+//-----------------------------------------------------------------------------
+/** Returns true if kart a is ahead of kart b, i.e. it has covered a larger
+ *  overall distance, or it has the same distance (very unlikely) but
+ *  started ahead of kart b.
+ *  \param a World kart id of the first kart.
+ *  \param b World kart id of the second kart.
+ */
+bool LinearWorld::isKartAhead(unsigned int a, unsigned int b) const
+{
+    if(m_kart_info[a].m_overall_distance != m_kart_info[b].m_overall_distance)
+        return m_kart_info[a].m_overall_distance >
+               m_kart_info[b].m_overall_distance;
+    return m_karts[a]->getInitialPosition() < m_karts[b]->getInitialPosition();
+}   // isKartAhead
+
 //-----------------------------------------------------------------------------
 /** Checks if a kart is going in the wrong direction. This is done only for
  *  player karts to display a message to the player.
@@ -55,6 +55,12 @@ private:
      *  get valid finish times estimates. */
     float       m_distance_increase;
 
+    /** The world kart ids of all karts that are still racing, sorted by
+     *  their race position. The order is kept between frames, so that
+     *  updateRacePosition() only needs to swap karts that overtook each
+     *  other instead of comparing all karts with each other. */
+    std::vector<unsigned int> m_race_order;
+
     // ------------------------------------------------------------------------
     /** Some additional info that needs to be kept for each kart
      * in this kind of race.
@@ -103,6 +109,8 @@ private:
     };
     // ------------------------------------------------------------------------
 
+    bool         isKartAhead(unsigned int a, unsigned int b) const;
+
 protected:
 
     /** This vector contains an 'KartInfo' struct for every kart in the race.
@@ -69,7 +69,7 @@ void OverWorld::enterOverWorld()
     StateManager::get()->createActivePlayer(PlayerManager::getCurrentPlayer(),
                                             device);
 
-    if (!kart_properties_manager->getKart(UserConfigParams::m_default_kart))
+    if (!kart_properties_manager->hasKart(UserConfigParams::m_default_kart))
     {
         Log::warn("[overworld]", "cannot find kart '%s', "
                   "will revert to default",
@@ -21,8 +21,10 @@
 #include "main_loop.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/irr_driver.hpp"
+#include "items/item_manager.hpp"
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
+#include "race/history.hpp"
 #include "tracks/track.hpp"
 
 #include <ISceneManager.h>
@@ -198,6 +200,10 @@ void ProfileWorld::enterRaceOverState()
         m_karts[i]->finishedRace(estimateFinishTimeForKart(m_karts[i]));
     }
 
+    // Save the history, so that the kart controls (and positions) of runs
+    // with different settings (e.g. number of AI threads) can be compared.
+    history->Save();
+
     // Print framerate statistics
     float runtime = (irr_driver->getRealTime()-m_start_time)*0.001f;
     Log::verbose("profile", "Number of frames: %d time %f, Average FPS: %f",
@@ -218,6 +224,12 @@ void ProfileWorld::enterRaceOverState()
                      (float)m_num_trans_effect/m_frame_count);
     }
 
+    // Print the cost of the item hit detection, which depends on the
+    // number of karts and items
+    Log::verbose("profile", "Number of karts: %d",
+                 race_manager->getNumberOfKarts());
+    ItemManager::get()->printHitStatistics();
+
     // Print race statistics for each individual kart
     float min_t=999999.9f, max_t=0.0, av_t=0.0;
     Log::verbose("profile", "name start_position end_position time average_speed top_speed "
@@ -59,6 +59,7 @@
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/thread_pool.hpp"
 
 #include <algorithm>
 #include <assert.h>
@@ -111,6 +112,7 @@ World::World() : WorldStatus(), m_clear_color(255,100,101,140)
 #endif
 
     m_physics            = NULL;
+    m_ai_thread_pool     = NULL;
     m_race_gui           = NULL;
     m_saved_race_gui     = NULL;
     m_use_highscores     = true;
@@ -163,9 +165,36 @@ void World::init()
     // Create the physics
     m_physics = new Physics();
 
+    // The AI decisions of several karts can be computed in parallel. With
+    // only one thread the AI is updated as before, interleaved with the
+    // update of the karts.
+    if(UserConfigParams::m_ai_threads!=1 &&
+       race_manager->getNumberOfKarts() > race_manager->getNumPlayers()+1)
+    {
+        m_ai_thread_pool = new ThreadPool(UserConfigParams::m_ai_threads);
+        if(m_ai_thread_pool->getNumThreads()<=1)
+        {
+            delete m_ai_thread_pool;
+            m_ai_thread_pool = NULL;
+        }
+    }
+
     unsigned int num_karts = race_manager->getNumberOfKarts();
     //assert(num_karts > 0);
 
+    // Karts are only loaded when they are used for the first time. Make sure
+    // this happens before the track is loaded, since the (shared) materials
+    // of a kart must not be mixed with the temporary materials of the track.
+    // If a kart can not be loaded, the default kart is used instead (see
+    // AbstractKart), so load that one now, too.
+    for(unsigned int i=0; i<num_karts; i++)
+    {
+        if(!kart_properties_manager->getKart(history->replayHistory()
+                                             ? history->getKartIdent(i)
+                                             : race_manager->getKartIdent(i)))
+            kart_properties_manager->getKart(UserConfigParams::m_default_kart);
+    }
+
     // Load the track models - this must be done before the karts so that the
     // karts can be positioned properly on (and not in) the tracks.
     m_track->loadTrackModel(race_manager->getReverseTrack());
@@ -388,6 +417,8 @@ World::~World()
     if(m_physics)
         delete m_physics;
 
+    delete m_ai_thread_pool;
+
     music_manager->stopMusic();
     m_world = NULL;
 
@@ -839,7 +870,7 @@ void World::updateWorld(float dt)
                 StateManager::get()->createActivePlayer(PlayerManager::getCurrentPlayer(),
                                                         device);
 
-                if (!kart_properties_manager->getKart(UserConfigParams::m_default_kart))
+                if (!kart_properties_manager->hasKart(UserConfigParams::m_default_kart))
                 {
                     Log::warn("[World]",
                               "Cannot find kart '%s', will revert to default.",
@@ -914,6 +945,9 @@ void World::update(float dt)
         m_physics->update(dt);
     }
 
+    if(m_ai_thread_pool && !history->replayHistory())
+        computeAIDecisions(dt);
+
     const int kart_amount = m_karts.size();
     for (int i = 0 ; i < kart_amount; ++i)
     {
@@ -935,6 +969,82 @@ void World::update(float dt)
 #endif
 }   // update
 
+// ----------------------------------------------------------------------------
+namespace
+{
+    /** The data for one job computing the AI decisions of some karts. */
+    struct AIDecisionsJob
+    {
+        World::KartList    *m_karts;
+        unsigned int        m_first;
+        unsigned int        m_last;
+        float               m_dt;
+    };   // AIDecisionsJob
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Lets the controllers of all karts compute their decisions (see
+ *  Controller::computeDecisions) before any kart is updated. Since the
+ *  controllers only read the state of the world at this stage, the karts
+ *  are distributed over the AI thread pool. All karts see the same state
+ *  of the world, so the result does not depend on the number of threads
+ *  (or the order in which the karts are processed). Note that this is
+ *  different from the serial update (without a thread pool), in which
+ *  each AI sees the karts that were updated before it in this frame.
+ *  \param dt Time step size.
+ */
+void World::computeAIDecisions(float dt)
+{
+    PROFILER_PUSH_CPU_MARKER("AI decisions", 0x7F, 0x7F, 0x00);
+
+    // Make sure all karts use the positions from the last physics step
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if(!m_karts[i]->isEliminated())
+            m_karts[i]->updatePosition();
+    }
+
+    unsigned int num_jobs = m_ai_thread_pool->getNumThreads();
+    if(num_jobs > m_karts.size())
+        num_jobs = m_karts.size();
+    if(num_jobs <= 1)
+    {
+        AIDecisionsJob job = { &m_karts, 0, (unsigned int)m_karts.size(),
+                               dt };
+        computeAIDecisionsJob(&job);
+        PROFILER_POP_CPU_MARKER();
+        return;
+    }
+
+    std::vector<AIDecisionsJob> jobs(num_jobs);
+    for (unsigned int i = 0; i < num_jobs; i++)
+    {
+        jobs[i].m_karts   = &m_karts;
+        jobs[i].m_first   = (unsigned int)( i   *m_karts.size()/num_jobs);
+        jobs[i].m_last    = (unsigned int)((i+1)*m_karts.size()/num_jobs);
+        jobs[i].m_dt      = dt;
+        m_ai_thread_pool->addJob(&World::computeAIDecisionsJob, &jobs[i]);
+    }
+    m_ai_thread_pool->waitForAll();
+    PROFILER_POP_CPU_MARKER();
+}   // computeAIDecisions
+
+// ----------------------------------------------------------------------------
+/** Computes the AI decisions for a range of karts, executed as a job in the
+ *  AI thread pool.
+ *  \param data Pointer to the AIDecisionsJob data.
+ */
+void World::computeAIDecisionsJob(void *data)
+{
+    const AIDecisionsJob *job = (const AIDecisionsJob*)data;
+    for (unsigned int i = job->m_first; i < job->m_last; i++)
+    {
+        AbstractKart *kart = (*job->m_karts)[i];
+        if(!kart->isEliminated())
+            kart->getController()->computeDecisions(job->m_dt);
+    }
+}   // computeAIDecisionsJob
+
 // ----------------------------------------------------------------------------
 /** Only updates the track. The order in which the various parts of STK are
  *  updated is quite important (i.e. the track can't be updated as part of
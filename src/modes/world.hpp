@@ -41,6 +41,7 @@ class btRigidBody;
 class Controller;
 class PhysicalObject;
 class Physics;
+class ThreadPool;
 class Track;
 
 namespace irr
@@ -91,6 +92,11 @@ protected:
     RandomGenerator           m_random;
 
     Physics*      m_physics;
+
+    /** The threads used to compute the AI decisions, or NULL if they are
+     *  computed in the main thread. */
+    ThreadPool*   m_ai_thread_pool;
+
     AbstractKart* m_fastest_kart;
     /** Number of eliminated karts. */
     int         m_eliminated_karts;
@@ -166,6 +172,8 @@ protected:
     /** Returns true if the race is over. Must be defined by all modes. */
     virtual bool  isRaceOver() = 0;
     virtual void  update(float dt);
+            void  computeAIDecisions(float dt);
+    static  void  computeAIDecisionsJob(void *data);
     virtual void  createRaceGUI();
             void  updateTrack(float dt);
     void moveKartTo(AbstractKart* kart, const btTransform &t);
@@ -51,6 +51,26 @@ AbstractKart* WorldWithRank::getKartAtPosition(unsigned int p) const
     return m_karts[m_position_index[p-1]];
 }   // getKartAtPosition
 
+//-----------------------------------------------------------------------------
+/** Returns the kart directly ahead of the given kart, or NULL if the kart
+ *  is first.
+ *  \param kart The kart for which to find the kart ahead.
+ */
+AbstractKart* WorldWithRank::getKartAhead(const AbstractKart *kart) const
+{
+    return getKartAtPosition(kart->getPosition()-1);
+}   // getKartAhead
+
+//-----------------------------------------------------------------------------
+/** Returns the kart directly behind the given kart, or NULL if the kart
+ *  is last.
+ *  \param kart The kart for which to find the kart behind.
+ */
+AbstractKart* WorldWithRank::getKartBehind(const AbstractKart *kart) const
+{
+    return getKartAtPosition(kart->getPosition()+1);
+}   // getKartBehind
+
 //-----------------------------------------------------------------------------
 /** This function must be called before starting to set all kart positions
  *  again. It's mainly used to add some debug support, i.e. detect if the
@@ -70,6 +70,8 @@ public:
                                  unsigned int position);
     void          endSetKartPositions();
     AbstractKart* getKartAtPosition(unsigned int p) const;
+    AbstractKart* getKartAhead(const AbstractKart *kart) const;
+    AbstractKart* getKartBehind(const AbstractKart *kart) const;
 
     virtual unsigned int getNumberOfRescuePositions() const OVERRIDE;
     virtual unsigned int getRescuePositionIndex(AbstractKart *kart) OVERRIDE;
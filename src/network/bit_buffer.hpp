@@ -0,0 +1,163 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file bit_buffer.hpp
+ *  \brief Defines classes to write and read values with an arbitrary number
+ *  of bits into and from a NetworkString.
+ */
+
+#ifndef BIT_BUFFER_HPP
+#define BIT_BUFFER_HPP
+
+#include "network/network_string.hpp"
+#include "utils/types.hpp"
+
+#include <assert.h>
+
+/** \class BitWriter
+ *  \brief Packs values with an arbitrary number of bits (at most 32) into a
+ *  NetworkString. Bits are written MSB first. The last partial byte is
+ *  only appended to the string when flush() is called.
+ */
+class BitWriter
+{
+private:
+    /** The string the full bytes are appended to. */
+    NetworkString *m_string;
+    /** Bits not yet written to the string, right aligned. */
+    uint32_t       m_pending;
+    /** Number of valid bits in m_pending (always < 8 between calls). */
+    int            m_pending_bits;
+    /** Total number of bits written. */
+    int            m_total_bits;
+
+public:
+    BitWriter(NetworkString *ns)
+        : m_string(ns), m_pending(0), m_pending_bits(0), m_total_bits(0) { }
+    // ------------------------------------------------------------------------
+    ~BitWriter() { assert(m_pending_bits == 0); }
+    // ------------------------------------------------------------------------
+    /** Writes the lowest 'bits' bits of value. */
+    void write(uint32_t value, int bits)
+    {
+        assert(bits > 0 && bits <= 32);
+        m_total_bits += bits;
+        while (bits > 0)
+        {
+            // Write at most 8 bits at a time so m_pending can not overflow
+            int n = bits > 8 ? 8 : bits;
+            bits -= n;
+            m_pending = (m_pending << n) | ((value >> bits) & ((1u << n) - 1));
+            m_pending_bits += n;
+            if (m_pending_bits >= 8)
+            {
+                m_pending_bits -= 8;
+                m_string->addUInt8((m_pending >> m_pending_bits) & 0xff);
+            }
+        }
+    }   // write
+    // ------------------------------------------------------------------------
+    void writeBool(bool b) { write(b ? 1 : 0, 1); }
+    // ------------------------------------------------------------------------
+    /** Writes a signed value in two's complement with 'bits' bits. */
+    void writeSigned(int32_t value, int bits)
+    {
+        write((uint32_t)value & (bits==32 ? 0xffffffffu : (1u << bits) - 1),
+              bits);
+    }   // writeSigned
+    // ------------------------------------------------------------------------
+    /** Pads the last byte with zeros and appends it to the string. */
+    void flush()
+    {
+        if (m_pending_bits > 0)
+        {
+            m_string->addUInt8((m_pending << (8 - m_pending_bits)) & 0xff);
+            m_total_bits += 8 - m_pending_bits;
+        }
+        m_pending      = 0;
+        m_pending_bits = 0;
+    }   // flush
+    // ------------------------------------------------------------------------
+    /** Returns the number of bits written so far. */
+    int getNumBits() const { return m_total_bits; }
+};   // BitWriter
+
+// ============================================================================
+/** \class BitReader
+ *  \brief Reads values written by a BitWriter from a NetworkString. Reading
+ *  past the end of the string returns zeros and sets an error flag, so that
+ *  a truncated or corrupted packet can be detected after parsing.
+ */
+class BitReader
+{
+private:
+    const NetworkString &m_string;
+    /** Index of the next bit to read. */
+    int                  m_bit_offset;
+    /** Set if it was tried to read more bits than available. */
+    bool                 m_overflow;
+
+public:
+    BitReader(const NetworkString &ns)
+        : m_string(ns), m_bit_offset(0), m_overflow(false) { }
+    // ------------------------------------------------------------------------
+    /** Reads 'bits' bits (at most 32) as an unsigned value. */
+    uint32_t read(int bits)
+    {
+        assert(bits > 0 && bits <= 32);
+        if (m_bit_offset + bits > m_string.size()*8)
+        {
+            m_overflow = true;
+            m_bit_offset = m_string.size()*8;
+            return 0;
+        }
+        const uint8_t *bytes = m_string.getBytes();
+        uint32_t result = 0;
+        while (bits > 0)
+        {
+            int byte       = m_bit_offset >> 3;
+            int bit_in     = m_bit_offset & 7;
+            int available  = 8 - bit_in;
+            int n          = bits < available ? bits : available;
+            uint32_t v     = (bytes[byte] >> (available - n)) & ((1u << n) - 1);
+            result         = (result << n) | v;
+            bits          -= n;
+            m_bit_offset  += n;
+        }
+        return result;
+    }   // read
+    // ------------------------------------------------------------------------
+    bool readBool() { return read(1) != 0; }
+    // ------------------------------------------------------------------------
+    /** Reads a two's complement signed value with 'bits' bits. */
+    int32_t readSigned(int bits)
+    {
+        uint32_t v = read(bits);
+        if (bits < 32 && (v & (1u << (bits - 1))))
+            v |= ~((1u << bits) - 1);
+        return (int32_t)v;
+    }   // readSigned
+    // ------------------------------------------------------------------------
+    /** Returns the number of (full or partial) bytes read so far. */
+    int getNumBytesRead() const { return (m_bit_offset + 7) >> 3; }
+    // ------------------------------------------------------------------------
+    /** True if data was read past the end of the string. */
+    bool hasOverflow() const { return m_overflow; }
+};   // BitReader
+
+#endif // BIT_BUFFER_HPP
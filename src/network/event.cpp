@@ -17,14 +17,21 @@
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "network/event.hpp"
-#include "network/network_manager.hpp"
 
 #include "utils/log.hpp"
 
 #include <string.h>
 
-Event::Event(ENetEvent* event)
+Event::Event()
 {
+    m_packet = NULL;
+    peer     = NULL;
+    type     = EVENT_TYPE_MESSAGE;
+}
+
+void Event::set(ENetEvent* event)
+{
+    reset();
     switch (event->type)
     {
     case ENET_EVENT_TYPE_CONNECT:
@@ -40,58 +47,53 @@ Event::Event(ENetEvent* event)
         return;
         break;
     }
-    if (type == EVENT_TYPE_MESSAGE)
+    if (type == EVENT_TYPE_MESSAGE && event->packet)
     {
-        m_data = NetworkString(std::string((char*)(event->packet->data), event->packet->dataLength-1));
-    }
-
-    m_packet = NULL;
-    if (event->packet)
+        // Keep the packet alive and only reference its data. The last byte
+        // is the 0 appended by STKPeer::sendPacket.
         m_packet = event->packet;
-
-    if (m_packet)
-        enet_packet_destroy(m_packet); // we got all we need, just remove the data.
-    m_packet = NULL;
-
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
-    peer = new STKPeer*;
-    *peer = NULL;
-    for (unsigned int i = 0; i < peers.size(); i++)
+        m_data = NetworkString::wrap(m_packet->data, m_packet->dataLength-1);
+    }
+    else if (event->packet)
     {
-        if (peers[i]->m_peer == event->peer)
-        {
-            *peer = peers[i];
-            Log::verbose("Event", "The peer you sought has been found on %lx", (long int)(peer));
-            return;
-        }
+        enet_packet_destroy(event->packet);
     }
-    if (*peer == NULL) // peer does not exist, create him
+
+    // The STKPeer of an ENet peer is stored in its user data, so it is
+    // found without searching all peers.
+    peer = (STKPeer*)(event->peer->data);
+    if (peer == NULL) // peer does not exist, create him
     {
-        STKPeer* new_peer = new STKPeer();
-        new_peer->m_peer = event->peer;
-        *peer = new_peer;
-        Log::debug("Event", "Creating a new peer, address are STKPeer:%lx, Peer:%lx", (long int)(new_peer), (long int)(event->peer));
+        peer = new STKPeer();
+        peer->m_peer = event->peer;
+        event->peer->data = peer;
+        Log::debug("Event", "Creating a new peer, address are STKPeer:%lx, Peer:%lx", (long int)(peer), (long int)(event->peer));
     }
 }
 
 Event::Event(const Event& event)
 {
     m_packet = NULL;
-    m_data = event.m_data;
-    // copy the peer
+    m_data = NetworkString(event.m_data.getBytes(), event.m_data.size());
     peer = event.peer;
     type = event.type;
 }
 
 Event::~Event()
 {
-    delete peer;
+    reset();
+}
+
+void Event::reset()
+{
     peer = NULL;
+    if (m_packet)
+        enet_packet_destroy(m_packet);
     m_packet = NULL;
+    m_data = NetworkString();
 }
 
 void Event::removeFront(int size)
 {
     m_data.removeFront(size);
 }
-
@@ -53,10 +53,12 @@ class Event
 {
     public:
         /*! \brief Constructor
-         *  \param event : The event that needs to be translated.
+         *  Creates an empty event, use set() to fill it.
          */
-        Event(ENetEvent* event);
+        Event();
         /*! \brief Constructor
+         *  The data is copied, so the copy does not depend on the lifetime
+         *  of the original event.
          *  \param event : The event to copy.
          */
         Event(const Event& event);
@@ -65,23 +67,34 @@ class Event
          */
         ~Event();
 
+        /*! \brief Translates an ENet event into this event.
+         *  Events are recycled by the protocol manager, so this must leave
+         *  the event in the same state as a newly constructed one would be.
+         *  \param event : The event that needs to be translated.
+         */
+        void set(ENetEvent* event);
+        /*! \brief Frees the packet of this event, so it can be reused.
+         */
+        void reset();
+
         /*! \brief Remove bytes at the beginning of data.
          *  \param size : The number of bytes to remove.
          */
         void removeFront(int size);
 
-        /*! \brief Get a copy of the data.
-         *  \return A copy of the message data. This is empty for events like
-         *  connection or disconnections.
+        /*! \brief Get the data.
+         *  \return The message data, which is a view on the ENet packet (so
+         *  copying it is cheap). This is empty for events like connection or
+         *  disconnections.
          */
-        NetworkString data() const { return m_data; }
+        const NetworkString& data() const { return m_data; }
 
         EVENT_TYPE type;    //!< Type of the event.
-        STKPeer** peer;     //!< Pointer to the peer that triggered that event.
+        STKPeer* peer;      //!< The peer that triggered that event.
 
     private:
-        NetworkString m_data; //!< Copy of the data passed by the event.
-        ENetPacket* m_packet; //!< A pointer on the ENetPacket to be deleted.
+        NetworkString m_data; //!< View on the data passed by the event.
+        ENetPacket* m_packet; //!< The ENetPacket m_data points to, owned.
 };
 
 #endif // EVENT_HPP
@@ -0,0 +1,230 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/kart_snapshot.hpp"
+
+#include "network/bit_buffer.hpp"
+
+#include <assert.h>
+#include <math.h>
+
+const uint16_t KartSnapshot::NO_SEQUENCE;
+
+Vec3 KartSnapshot::m_min  = Vec3(-1000.0f, -1000.0f, -1000.0f);
+Vec3 KartSnapshot::m_step = Vec3(2000.0f/((1<<POSITION_BITS)-1),
+                                 2000.0f/((1<<POSITION_BITS)-1),
+                                 2000.0f/((1<<POSITION_BITS)-1));
+
+/** The largest possible value of the three smallest components of a unit
+ *  quaternion is 1/sqrt(2). */
+static const float QUATERNION_RANGE = 0.70710678f;
+
+// ----------------------------------------------------------------------------
+KartSnapshot::KartSnapshot(uint16_t sequence, int num_karts)
+{
+    m_sequence = sequence;
+    m_karts.resize(num_karts);
+}   // KartSnapshot
+
+// ----------------------------------------------------------------------------
+/** Sets the box that positions are quantized to. This must be identical on
+ *  server and clients, so it should be based on the track's bounding box.
+ *  A small margin is added since karts can be above the track (e.g. when
+ *  jumping or being rescued).
+ *  \param min Minimum corner of the box.
+ *  \param max Maximum corner of the box.
+ */
+void KartSnapshot::setBounds(const Vec3 &min, const Vec3 &max)
+{
+    const float margin = 10.0f;
+    m_min = min - Vec3(margin, margin, margin);
+    Vec3 size = max - min + Vec3(2*margin, 2*margin, 2*margin);
+    const float steps = (float)((1<<POSITION_BITS)-1);
+    m_step = Vec3(size.getX()/steps, size.getY()/steps, size.getZ()/steps);
+}   // setBounds
+
+// ----------------------------------------------------------------------------
+/** Quantizes and stores the state of one kart.
+ *  \param index World kart id of the kart.
+ *  \param xyz Position of the kart.
+ *  \param q Rotation of the kart.
+ */
+void KartSnapshot::setKart(int index, const Vec3 &xyz, const btQuaternion &q)
+{
+    KartState &state = m_karts[index];
+    const unsigned int max_pos = (1<<POSITION_BITS)-1;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        float f = (xyz[i] - m_min[i]) / m_step[i] + 0.5f;
+        if (f < 0)                f = 0;
+        if (f > (float)max_pos)   f = (float)max_pos;
+        state.m_position[i] = (uint32_t)f;
+    }
+
+    // Smallest three: find the largest component, make it positive (q and
+    // -q are the same rotation) and only store the other three.
+    btQuaternion n = q.normalized();
+    float c[4] = { n.x(), n.y(), n.z(), n.w() };
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; i++)
+        if (fabsf(c[i]) > fabsf(c[largest]))
+            largest = i;
+    float sign = c[largest] < 0 ? -1.0f : 1.0f;
+    state.m_largest = largest;
+    const float max_rot = (float)((1<<QUATERNION_BITS)-1);
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        float f = (c[i]*sign + QUATERNION_RANGE) / (2*QUATERNION_RANGE);
+        f = f*max_rot + 0.5f;
+        if (f < 0)       f = 0;
+        if (f > max_rot) f = max_rot;
+        state.m_rotation[j++] = (uint32_t)f;
+    }
+}   // setKart
+
+// ----------------------------------------------------------------------------
+/** Reconstructs the position and rotation of one kart.
+ *  \param index World kart id of the kart.
+ *  \param xyz On return the position of the kart.
+ *  \param q On return the rotation of the kart.
+ */
+void KartSnapshot::getKart(int index, Vec3 *xyz, btQuaternion *q) const
+{
+    const KartState &state = m_karts[index];
+    for (unsigned int i = 0; i < 3; i++)
+        (*xyz)[i] = m_min[i] + state.m_position[i]*m_step[i];
+
+    const float max_rot = (float)((1<<QUATERNION_BITS)-1);
+    float c[4];
+    float sum = 0;
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == state.m_largest) continue;
+        c[i] = (state.m_rotation[j++]/max_rot)*2*QUATERNION_RANGE
+             - QUATERNION_RANGE;
+        sum += c[i]*c[i];
+    }
+    c[state.m_largest] = sum < 1.0f ? sqrtf(1.0f - sum) : 0.0f;
+    *q = btQuaternion(c[0], c[1], c[2], c[3]).normalized();
+}   // getKart
+
+// ----------------------------------------------------------------------------
+/** Writes this snapshot. If a baseline is given, only karts that changed
+ *  compared with the baseline are sent, and position changes that fit into
+ *  DELTA_BITS are sent as delta. The baseline must have the same number of
+ *  karts.
+ *  \param writer The bit writer to use.
+ *  \param baseline The snapshot the receiver already has, or NULL.
+ */
+void KartSnapshot::encode(BitWriter *writer,
+                          const KartSnapshot *baseline) const
+{
+    assert(!baseline || baseline->m_karts.size() == m_karts.size());
+    const int32_t max_delta = (1 << (DELTA_BITS-1)) - 1;
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        const KartState &state = m_karts[i];
+        const KartState *base  = baseline ? &baseline->m_karts[i] : NULL;
+
+        bool position_changed = !base ||
+                                state.m_position[0] != base->m_position[0] ||
+                                state.m_position[1] != base->m_position[1] ||
+                                state.m_position[2] != base->m_position[2];
+        writer->writeBool(position_changed);
+        if (position_changed)
+        {
+            bool use_delta = base != NULL;
+            int32_t delta[3];
+            for (unsigned int k = 0; k < 3 && use_delta; k++)
+            {
+                delta[k] = (int32_t)state.m_position[k]
+                         - (int32_t)base->m_position[k];
+                if (delta[k] > max_delta || delta[k] < -max_delta)
+                    use_delta = false;
+            }
+            writer->writeBool(use_delta);
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                if (use_delta)
+                    writer->writeSigned(delta[k], DELTA_BITS);
+                else
+                    writer->write(state.m_position[k], POSITION_BITS);
+            }
+        }
+
+        bool rotation_changed = !base || !state.sameRotation(*base);
+        writer->writeBool(rotation_changed);
+        if (rotation_changed)
+        {
+            writer->write(state.m_largest, 2);
+            for (unsigned int k = 0; k < 3; k++)
+                writer->write(state.m_rotation[k], QUATERNION_BITS);
+        }
+    }
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Reads a snapshot written by encode(). The number of karts must have been
+ *  set in the constructor.
+ *  \param reader The bit reader to use.
+ *  \param baseline The baseline the sender used, or NULL.
+ *  \return False if the data was incomplete.
+ */
+bool KartSnapshot::decode(BitReader *reader, const KartSnapshot *baseline)
+{
+    if (baseline && baseline->m_karts.size() != m_karts.size())
+        return false;
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        KartState &state = m_karts[i];
+        const KartState *base = baseline ? &baseline->m_karts[i] : NULL;
+        if (base)
+            state = *base;
+
+        // Without baseline everything must have been sent in full
+        if (reader->readBool())
+        {
+            bool use_delta = reader->readBool();
+            if (use_delta && !base)
+                return false;
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                if (use_delta)
+                    state.m_position[k] = base->m_position[k]
+                                        + reader->readSigned(DELTA_BITS);
+                else
+                    state.m_position[k] = reader->read(POSITION_BITS);
+            }
+        }
+        else if (!base)
+            return false;
+
+        if (reader->readBool())
+        {
+            state.m_largest = reader->read(2);
+            for (unsigned int k = 0; k < 3; k++)
+                state.m_rotation[k] = reader->read(QUATERNION_BITS);
+        }
+        else if (!base)
+            return false;
+    }
+    return !reader->hasOverflow();
+}   // decode
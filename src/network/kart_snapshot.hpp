@@ -0,0 +1,148 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file kart_snapshot.hpp
+ *  \brief Quantized, delta-compressed kart state snapshots.
+ */
+
+#ifndef KART_SNAPSHOT_HPP
+#define KART_SNAPSHOT_HPP
+
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <vector>
+
+class BitReader;
+class BitWriter;
+
+/** \class KartSnapshot
+ *  \brief The quantized position and rotation of all karts at one point in
+ *  time. Positions are quantized relative to the track bounding box,
+ *  rotations use the 'smallest three' encoding (the largest component of
+ *  the unit quaternion is dropped and recomputed on decoding).
+ *  A snapshot can be encoded relative to a baseline snapshot the receiver
+ *  already has, in which case only karts that changed are sent, and small
+ *  position changes are sent as short deltas.
+ */
+class KartSnapshot
+{
+public:
+    /** Number of bits per position component. */
+    static const int POSITION_BITS = 18;
+    /** Number of bits per position component when sent as delta. */
+    static const int DELTA_BITS    = 8;
+    /** Number of bits for each of the three smallest quaternion values. */
+    static const int QUATERNION_BITS = 11;
+    /** Sequence number used to indicate 'no baseline'. */
+    static const uint16_t NO_SEQUENCE = 0xffff;
+
+    /** The quantized state of a single kart. */
+    struct KartState
+    {
+        uint32_t m_position[3];
+        /** Index of the dropped (largest) quaternion component. */
+        uint8_t  m_largest;
+        uint32_t m_rotation[3];
+
+        bool operator==(const KartState &other) const
+        {
+            return m_position[0] == other.m_position[0] &&
+                   m_position[1] == other.m_position[1] &&
+                   m_position[2] == other.m_position[2] &&
+                   sameRotation(other);
+        }
+        bool sameRotation(const KartState &other) const
+        {
+            return m_largest     == other.m_largest     &&
+                   m_rotation[0] == other.m_rotation[0] &&
+                   m_rotation[1] == other.m_rotation[1] &&
+                   m_rotation[2] == other.m_rotation[2];
+        }
+    };   // KartState
+
+private:
+    /** Sequence number of this snapshot. */
+    uint16_t               m_sequence;
+    /** The state of each kart, indexed by world kart id. */
+    std::vector<KartState> m_karts;
+
+    /** Minimum corner of the quantisation box. */
+    static Vec3            m_min;
+    /** Size of one quantisation step along each axis. */
+    static Vec3            m_step;
+
+public:
+                KartSnapshot(uint16_t sequence=NO_SEQUENCE, int num_karts=0);
+    static void setBounds(const Vec3 &min, const Vec3 &max);
+    void        setKart(int index, const Vec3 &xyz, const btQuaternion &q);
+    void        getKart(int index, Vec3 *xyz, btQuaternion *q) const;
+    void        encode(BitWriter *writer, const KartSnapshot *baseline) const;
+    bool        decode(BitReader *reader, const KartSnapshot *baseline);
+
+    // ------------------------------------------------------------------------
+    uint16_t getSequence() const { return m_sequence; }
+    // ------------------------------------------------------------------------
+    void     setSequence(uint16_t sequence) { m_sequence = sequence; }
+    // ------------------------------------------------------------------------
+    unsigned int getNumKarts() const { return m_karts.size(); }
+    // ------------------------------------------------------------------------
+    const KartState &getKartState(int index) const { return m_karts[index]; }
+    // ------------------------------------------------------------------------
+    /** Returns true if sequence a is more recent than b, taking wrap
+     *  around into account. */
+    static bool isNewer(uint16_t a, uint16_t b)
+    {
+        return a != b && (uint16_t)(a - b) < 0x8000;
+    }   // isNewer
+};   // KartSnapshot
+
+// ============================================================================
+/** \class KartSnapshotHistory
+ *  \brief A fixed size ring buffer of the most recent snapshots, indexed by
+ *  sequence number. It is used as baseline store on both ends.
+ */
+class KartSnapshotHistory
+{
+public:
+    static const int HISTORY_SIZE = 64;
+
+private:
+    KartSnapshot m_snapshots[HISTORY_SIZE];
+
+public:
+    // ------------------------------------------------------------------------
+    void add(const KartSnapshot &snapshot)
+    {
+        m_snapshots[snapshot.getSequence() % HISTORY_SIZE] = snapshot;
+    }   // add
+    // ------------------------------------------------------------------------
+    /** Returns the snapshot with the given sequence number, or NULL if it
+     *  is not (or not anymore) stored. */
+    const KartSnapshot *get(uint16_t sequence) const
+    {
+        if (sequence == KartSnapshot::NO_SEQUENCE)
+            return NULL;
+        const KartSnapshot &s = m_snapshots[sequence % HISTORY_SIZE];
+        return s.getSequence() == sequence ? &s : NULL;
+    }   // get
+};   // KartSnapshotHistory
+
+#endif // KART_SNAPSHOT_HPP
@@ -108,11 +108,11 @@ void NetworkManager::setManualSocketsMode(bool manual)
 void NetworkManager::notifyEvent(Event* event)
 {
     Log::verbose("NetworkManager", "EVENT received of type %d", (int)(event->type));
-    STKPeer* peer = *event->peer;
+    STKPeer* peer = event->peer;
     if (event->type == EVENT_TYPE_CONNECTED)
     {
         Log::info("NetworkManager", "A client has just connected. There are now %lu peers.", m_peers.size() + 1);
-        Log::debug("NetworkManager", "Addresses are : %lx, %lx, %lx", event->peer, *event->peer, peer);
+        Log::debug("NetworkManager", "Address is : %lx", peer);
         // create the new peer:
         m_peers.push_back(peer);
     }
@@ -143,14 +143,25 @@ void NetworkManager::sendPacket(STKPeer* peer, const NetworkString& data, bool r
 
 void NetworkManager::sendPacketExcept(STKPeer* peer, const NetworkString& data, bool reliable)
 {
+    // All peers share one packet, so the data is only copied once. A
+    // reference is held while queueing it, otherwise the listening thread
+    // could send it to the first peer and destroy it before it is queued
+    // to the others.
+    ENetPacket* packet = STKPeer::createPacket(data, reliable);
+    packet->referenceCount++;
     for (unsigned int i = 0; i < m_peers.size(); i++)
     {
         STKPeer* p = m_peers[i];
         if (!p->isSamePeer(peer))
         {
-            p->sendPacket(data, reliable);
+            p->sendPacket(packet);
         }
     }
+    STKHost::lockENet();
+    packet->referenceCount--;
+    if (packet->referenceCount == 0)
+        enet_packet_destroy(packet);
+    STKHost::unlockENet();
 }
 
 //-----------------------------------------------------------------------------
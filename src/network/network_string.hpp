@@ -26,6 +26,7 @@
 #include "utils/types.hpp"
 
 #include <string>
+#include <string.h>
 #include <vector>
 #include <stdarg.h>
 #include <assert.h>
@@ -35,31 +36,101 @@ typedef unsigned char uchar;
 /** \class NetworkString
  *  \brief Describes a chain of 8-bit unsigned integers.
  *  This class allows you to easily create and parse 8-bit strings.
+ *  Data is appended at the end of the buffer (write cursor) and read from
+ *  a read cursor, so that removing bytes at the front (which is what all
+ *  parsers do) is O(1) instead of moving all remaining data.
+ *  A NetworkString can also be a read-only view on memory owned by
+ *  somebody else (typically an ENet packet, see wrap()). Copying a view is
+ *  cheap, and the data is only copied if the view is modified. The user
+ *  must make sure that the wrapped memory outlives the view.
  */
 class NetworkString
 {
-    union {
-    float f;
-    uint8_t i[4];
-    } f_as_i; // float as integer
-    union {
-    double d;
-    uint8_t i[8];
-    } d_as_i; // double as integer
     public:
-        NetworkString() { }
-        NetworkString(const uint8_t& value) { m_string.push_back(value); }
-        NetworkString(NetworkString const& copy) { m_string = copy.m_string; }
-        NetworkString(const std::string & value) { m_string = std::vector<uint8_t>(value.begin(), value.end()); }
+        NetworkString() : m_view(NULL), m_view_size(0), m_current_offset(0) { }
+        NetworkString(const uint8_t& value)
+            : m_view(NULL), m_view_size(0), m_current_offset(0)
+        {
+            m_string.push_back(value);
+        }
+        NetworkString(NetworkString const& copy)
+            : m_view(NULL), m_view_size(0), m_current_offset(0)
+        {
+            *this = copy;
+        }
+        NetworkString(const std::string & value)
+            : m_string(value.begin(), value.end()), m_view(NULL),
+              m_view_size(0), m_current_offset(0)
+        {
+        }
+        /** Creates a network string containing a copy of the given data. */
+        NetworkString(const uint8_t* data, int len)
+            : m_string(data, data+len), m_view(NULL), m_view_size(0),
+              m_current_offset(0)
+        {
+        }
+
+        // --------------------------------------------------------------------
+        /** Creates a read-only view on len bytes at data, without copying.
+         *  The memory must stay valid as long as the view (or any copy of it)
+         *  is used. */
+        static NetworkString wrap(const uint8_t* data, int len)
+        {
+            NetworkString ns;
+            ns.m_view      = data;
+            ns.m_view_size = len;
+            return ns;
+        }
+
+        // --------------------------------------------------------------------
+        NetworkString& operator=(NetworkString const& copy)
+        {
+            if (this == &copy)
+                return *this;
+            if (copy.m_view)
+            {
+                // Views are shared, only the pointer is copied
+                m_string.clear();
+                m_view           = copy.m_view;
+                m_view_size      = copy.m_view_size;
+                m_current_offset = copy.m_current_offset;
+            }
+            else
+            {
+                // Only copy the data that has not been read yet
+                m_string.assign(copy.getBytes(), copy.getBytes()+copy.size());
+                m_view           = NULL;
+                m_view_size      = 0;
+                m_current_offset = 0;
+            }
+            return *this;
+        }
+
+        // --------------------------------------------------------------------
+        /** Makes sure that the buffer can store at least size bytes (in
+         *  addition to the ones not yet read) without reallocating. */
+        NetworkString& reserve(int size)
+        {
+            makeOwned();
+            m_string.reserve(m_string.size() + size);
+            return *this;
+        }
 
+        // --------------------------------------------------------------------
+        /** Skips size bytes at the front. This only moves the read cursor. */
         NetworkString& removeFront(int size)
         {
-            m_string.erase(m_string.begin(), m_string.begin()+size);
+            assert(size <= this->size());
+            m_current_offset += size;
             return *this;
         }
         NetworkString& remove(int pos, int size)
         {
-            m_string.erase(m_string.begin()+pos, m_string.begin()+pos+size);
+            if (pos == 0)
+                return removeFront(size);
+            makeOwned();
+            m_string.erase(m_string.begin()+m_current_offset+pos,
+                           m_string.begin()+m_current_offset+pos+size);
             return *this;
         }
 
@@ -70,105 +141,117 @@ class NetworkString
 
         NetworkString& addUInt8(const uint8_t& value)
         {
-            m_string.push_back(value);
+            *grow(1) = value;
             return *this;
         }
         inline NetworkString& ai8(const uint8_t& value) { return addUInt8(value); }
         NetworkString& addUInt16(const uint16_t& value)
         {
-            m_string.push_back((value>>8)&0xff);
-            m_string.push_back(value&0xff);
+            uint8_t *p = grow(2);
+            p[0] = (value>>8)&0xff;
+            p[1] = value&0xff;
             return *this;
         }
         inline NetworkString& ai16(const uint16_t& value) { return addUInt16(value); }
         NetworkString& addUInt32(const uint32_t& value)
         {
-            m_string.push_back((value>>24)&0xff);
-            m_string.push_back((value>>16)&0xff);
-            m_string.push_back((value>>8)&0xff);
-            m_string.push_back(value&0xff);
+            uint8_t *p = grow(4);
+            p[0] = (value>>24)&0xff;
+            p[1] = (value>>16)&0xff;
+            p[2] = (value>>8)&0xff;
+            p[3] = value&0xff;
             return *this;
         }
         inline NetworkString& ai32(const uint32_t& value) { return addUInt32(value); }
         NetworkString& addInt(const int& value)
         {
-            m_string.push_back((value>>24)&0xff);
-            m_string.push_back((value>>16)&0xff);
-            m_string.push_back((value>>8)&0xff);
-            m_string.push_back(value&0xff);
-            return *this;
+            return addUInt32((uint32_t)value);
         }
         inline NetworkString& ai(const int& value) { return addInt(value); }
         NetworkString& addFloat(const float& value) //!< BEWARE OF PRECISION
         {
             assert(sizeof(float)==4);
-            f_as_i.f = value;
-            m_string.push_back(f_as_i.i[0]);
-            m_string.push_back(f_as_i.i[1]);
-            m_string.push_back(f_as_i.i[2]);
-            m_string.push_back(f_as_i.i[3]);
+            memcpy(grow(4), &value, 4);
             return *this;
         }
         inline NetworkString& af(const float& value) { return addFloat(value); }
         NetworkString& addDouble(const double& value) //!< BEWARE OF PRECISION
         {
             assert(sizeof(double)==8);
-            d_as_i.d = value;
-            m_string.push_back(d_as_i.i[0]);
-            m_string.push_back(d_as_i.i[1]);
-            m_string.push_back(d_as_i.i[2]);
-            m_string.push_back(d_as_i.i[3]);
-            m_string.push_back(d_as_i.i[4]);
-            m_string.push_back(d_as_i.i[5]);
-            m_string.push_back(d_as_i.i[6]);
-            m_string.push_back(d_as_i.i[7]);
+            memcpy(grow(8), &value, 8);
             return *this;
         }
         inline NetworkString& ad(const double& value) { return addDouble(value); }
         NetworkString& addChar(const char& value)
         {
-            m_string.push_back((uint8_t)(value));
+            *grow(1) = (uint8_t)(value);
             return *this;
         }
         inline NetworkString& ac(const char& value) { return addChar(value); }
 
         NetworkString& addString(const std::string& value)
         {
-            for (unsigned int i = 0; i < value.size(); i++)
-                m_string.push_back((uint8_t)(value[i]));
+            if (value.size() > 0)
+                memcpy(grow(value.size()), value.c_str(), value.size());
             return *this;
         }
         inline NetworkString& as(const std::string& value) { return addString(value); }
 
         NetworkString& operator+=(NetworkString const& value)
         {
-            m_string.insert( m_string.end(), value.m_string.begin(), value.m_string.end() );
+            if (value.size() > 0)
+            {
+                // Copy first in case that value is *this
+                int n = value.size();
+                const uint8_t *src = value.getBytes();
+                if (&value == this)
+                {
+                    std::vector<uint8_t> tmp(src, src+n);
+                    memcpy(grow(n), &tmp[0], n);
+                }
+                else
+                    memcpy(grow(n), src, n);
+            }
             return *this;
         }
 
         const std::string std_string() const
         {
-            std::string str(m_string.begin(), m_string.end());
+            std::string str((const char*)getBytes(), size());
             return str;
         }
 
+        /** Returns the number of bytes that have not been read yet. */
         int size() const
         {
-            return m_string.size();
+            return getTotalSize() - m_current_offset;
+        }
+
+        /** Returns a pointer to the first byte that has not been read yet. */
+        uint8_t* getBytes()
+        {
+            makeOwned();
+            return m_string.empty() ? NULL : &m_string[m_current_offset];
+        }
+        const uint8_t* getBytes() const
+        {
+            const uint8_t *data = getRawData();
+            return data ? data + m_current_offset : NULL;
         }
 
-        uint8_t* getBytes() { return &m_string[0]; };
-        const uint8_t* getBytes() const { return &m_string[0]; };
+        /** True if this string is a view on memory it does not own. */
+        bool isView() const { return m_view != NULL; }
 
         template<typename T, size_t n>
         T get(int pos) const
         {
-            int a = n;
+            assert(pos + (int)n <= size());
+            const uint8_t *p = getBytes() + pos;
             T result = 0;
-            while(a--)
+            for (size_t a = 0; a < n; a++)
             {
                 result <<= 8; // offset one byte
-                result += ((uint8_t)(m_string[pos+n-1-a]) & 0xff); // add the data to result
+                result += (p[a] & 0xff); // add the data to result
             }
             return result;
         }
@@ -180,7 +263,7 @@ class NetworkString
         inline uint8_t      getUInt8(int pos = 0)  const { return get<uint8_t,1>(pos);         }
         inline char         getChar(int pos = 0)   const { return get<char,1>(pos);            }
         inline unsigned char getUChar(int pos = 0) const { return get<unsigned char,1>(pos);   }
-        std::string         getString(int pos, int len) const { return std::string(m_string.begin()+pos, m_string.begin()+pos+len); }
+        std::string         getString(int pos, int len) const { return std::string((const char*)getBytes()+pos, len); }
 
         inline int          gi(int pos = 0)        const { return get<int,4>(pos);             }
         inline uint32_t     gui(int pos = 0)       const { return get<uint32_t,4>(pos);        }
@@ -189,33 +272,29 @@ class NetworkString
         inline uint8_t      gui8(int pos = 0)      const { return get<uint8_t,1>(pos);         }
         inline char         gc(int pos = 0)        const { return get<char,1>(pos);            }
         inline unsigned char guc(int pos = 0)      const { return get<unsigned char,1>(pos);   }
-        std::string         gs(int pos, int len)   const { return std::string(m_string.begin()+pos, m_string.begin()+pos+len); }
+        std::string         gs(int pos, int len)   const { return getString(pos, len);         }
 
-        double getDouble(int pos = 0) //!< BEWARE OF PRECISION
+        double getDouble(int pos = 0) const //!< BEWARE OF PRECISION
         {
-            for (int i = 0; i < 8; i++)
-                d_as_i.i[i] = m_string[pos+i];
-            return d_as_i.d;
+            assert(pos + 8 <= size());
+            double d;
+            memcpy(&d, getBytes()+pos, 8);
+            return d;
         }
-        float getFloat(int pos = 0) //!< BEWARE OF PRECISION
+        float getFloat(int pos = 0) const //!< BEWARE OF PRECISION
         {
-            for (int i = 0; i < 4; i++)
-                f_as_i.i[i] = m_string[pos+i];
-            return f_as_i.f;
+            assert(pos + 4 <= size());
+            float f;
+            memcpy(&f, getBytes()+pos, 4);
+            return f;
         }
 
         //! Functions to get while removing
         template<typename T, size_t n>
         T getAndRemove(int pos)
         {
-            int a = n;
-            T result = 0;
-            while(a--)
-            {
-                result <<= 8; // offset one byte
-                result += ((uint8_t)(m_string[pos+n-1-a]) & 0xff); // add the data
-            }
-            remove(pos,n);
+            T result = get<T, n>(pos);
+            remove(pos, n);
             return result;
         }
 
@@ -228,17 +307,15 @@ class NetworkString
         inline unsigned char getAndRemoveUChar(int pos = 0)  { return getAndRemove<unsigned char,1>(pos);   }
         double getAndRemoveDouble(int pos = 0) //!< BEWARE OF PRECISION
         {
-            for (int i = 0; i < 8; i++)
-                d_as_i.i[i] = m_string[pos+i];
-            return d_as_i.d;
+            double d = getDouble(pos);
             remove(pos, 8);
+            return d;
         }
         float getAndRemoveFloat(int pos = 0) //!< BEWARE OF PRECISION
         {
-            for (int i = 0; i < 4; i++)
-                f_as_i.i[i] = m_string[pos+i];
-            return f_as_i.f;
+            float f = getFloat(pos);
             remove(pos, 4);
+            return f;
         }
 
         inline NetworkString& gui8(uint8_t* dst)   { *dst = getAndRemoveUInt8(0);  return *this; }
@@ -252,7 +329,50 @@ class NetworkString
         inline NetworkString& gf(float* dst)       { *dst = getAndRemoveFloat(0);  return *this; }
 
     protected:
+        // --------------------------------------------------------------------
+        /** Returns the start of the buffer, including already read bytes. */
+        const uint8_t* getRawData() const
+        {
+            if (m_view)
+                return m_view;
+            return m_string.empty() ? NULL : &m_string[0];
+        }
+        // --------------------------------------------------------------------
+        /** Returns the size of the buffer, including already read bytes. */
+        int getTotalSize() const
+        {
+            return m_view ? m_view_size : (int)m_string.size();
+        }
+        // --------------------------------------------------------------------
+        /** If this string is a view, copies the unread data into its own
+         *  buffer so that it can be modified. */
+        void makeOwned()
+        {
+            if (!m_view)
+                return;
+            m_string.assign(m_view + m_current_offset, m_view + m_view_size);
+            m_view           = NULL;
+            m_view_size      = 0;
+            m_current_offset = 0;
+        }
+        // --------------------------------------------------------------------
+        /** Appends n uninitialised bytes and returns a pointer to them. */
+        uint8_t* grow(int n)
+        {
+            makeOwned();
+            size_t old_size = m_string.size();
+            m_string.resize(old_size + n);
+            return &m_string[old_size];
+        }
+
+        /** The data owned by this string (unused if this is a view). */
         std::vector<uint8_t> m_string;
+        /** If not NULL, the (not owned) memory this string is a view on. */
+        const uint8_t*       m_view;
+        /** Size of the memory pointed to by m_view. */
+        int                  m_view_size;
+        /** Read cursor: index of the first byte not yet read. */
+        int                  m_current_offset;
 };
 
 NetworkString operator+(NetworkString const& a, NetworkString const& b);
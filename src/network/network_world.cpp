@@ -1,5 +1,6 @@
 #include "network/network_world.hpp"
 
+#include "config/user_config.hpp"
 #include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/protocols/synchronization_protocol.hpp"
@@ -13,6 +14,8 @@ NetworkWorld::NetworkWorld()
 {
     m_running = false;
     m_has_run = false;
+    m_tick = 0;
+    m_tick_time = 0;
 }
 
 NetworkWorld::~NetworkWorld()
@@ -34,18 +37,39 @@ void NetworkWorld::update(float dt)
         }
         World::getWorld()->setNetworkWorld(true);
     }
-    World::getWorld()->updateWorld(dt);
-    if (World::getWorld()->getPhase() >= WorldStatus::RESULT_DISPLAY_PHASE) // means it's the end
+    int tick_rate = UserConfigParams::m_server_tick_rate;
+    if (tick_rate < 1) tick_rate = 1;
+    const float tick_dt = 1.0f/tick_rate;
+    // Don't try to catch up more than a few ticks after a slow frame
+    m_tick_time += dt;
+    if (m_tick_time > 5*tick_dt)
+        m_tick_time = 5*tick_dt;
+    while (m_tick_time >= tick_dt)
     {
-        // consider the world finished.
-        stop();
-        Log::info("NetworkWorld", "The game is considered finish.");
+        m_tick_time -= tick_dt;
+        m_rewind_manager.update(m_tick, tick_dt);
+        World::getWorld()->updateWorld(tick_dt);
+        m_rewind_manager.saveState(m_tick);
+        m_tick++;
+        if (World::getWorld()->getPhase() >= WorldStatus::RESULT_DISPLAY_PHASE) // means it's the end
+        {
+            // consider the world finished.
+            stop();
+            Log::info("NetworkWorld", "The game is considered finish.");
+            Log::info("NetworkWorld", "%d ticks, %d rewinds, %d ticks re-simulated.",
+                      m_tick, m_rewind_manager.getNumRewinds(),
+                      m_rewind_manager.getNumResimulatedTicks());
+            break;
+        }
     }
 }
 
 void NetworkWorld::start()
 {
     m_running = true;
+    m_tick = 0;
+    m_tick_time = 0;
+    m_rewind_manager.reset();
 }
 
 void NetworkWorld::stop()
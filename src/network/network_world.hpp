@@ -23,7 +23,9 @@
 #define NETWORK_WORLD_HPP
 
 #include "input/input.hpp"
+#include "network/rewind_manager.hpp"
 #include "utils/singleton.hpp"
+#include "utils/types.hpp"
 #include <map>
 
 class Controller;
@@ -33,6 +35,9 @@ class Item;
 
 /*! \brief Manages the world updates during an online game
  *  This function's update is to be called instead of the normal World update
+ *  The world is updated in fixed ticks (see UserConfigParams::
+ *  m_server_tick_rate), so that the inputs of the karts can be stamped with
+ *  the tick in which they take effect (see RewindManager).
 */
 class NetworkWorld : public AbstractSingleton<NetworkWorld>
 {
@@ -48,11 +53,22 @@ class NetworkWorld : public AbstractSingleton<NetworkWorld>
         void collectedItem(Item *item, AbstractKart *kart);
         void controllerAction(Controller* controller, PlayerAction action, int value);
 
+        /*! \brief Returns the number of ticks simulated so far, which is
+         *  also the tick that is simulated next. */
+        uint32_t getTick() const { return m_tick; }
+        /*! \brief Returns the manager of the tick stamped inputs. */
+        RewindManager* getRewindManager() { return &m_rewind_manager; }
+
         std::string m_self_kart;
     protected:
         bool m_running;
         float m_race_time;
         bool m_has_run;
+        /*! \brief Number of ticks simulated since the start of the race. */
+        uint32_t m_tick;
+        /*! \brief Time not yet simulated, less than one tick. */
+        float m_tick_time;
+        RewindManager m_rewind_manager;
 
     private:
         NetworkWorld();
@@ -0,0 +1,234 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "network/packet_capture.hpp"
+
+#include "utils/log.hpp"
+#include "utils/synchronised.hpp"
+#include "utils/time.hpp"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/** Records that are not yet written by the writer thread. */
+static Synchronised<std::vector<uint8_t> > g_pending;
+/** If the writer can not keep up, packets are dropped once this many bytes
+ *  are pending, so that capturing never takes all the memory. */
+static const size_t           MAX_PENDING_BYTES = 64*1024*1024;
+static FILE                  *g_capture_file = NULL;
+static Synchronised<bool>     g_capture_running(false);
+/** Number of packets dropped because too much data was pending, protected
+ *  by the mutex of g_pending. */
+static int                    g_num_dropped = 0;
+static pthread_t              g_capture_thread;
+
+// ----------------------------------------------------------------------------
+/** Opens the capture file and starts the writer thread.
+ *  \param filename Name of the capture file, which is overwritten.
+ *  \return False if the file can not be written.
+ */
+bool PacketCapture::start(const std::string &filename)
+{
+    if (g_capture_running.getAtomic())
+        return true;
+    g_capture_file = fopen(filename.c_str(), "wb");
+    if (!g_capture_file)
+        return false;
+    uint32_t header[3] = { CAPTURE_MAGIC, CAPTURE_VERSION, sizeof(Record) };
+    fwrite(header, sizeof(uint32_t), 3, g_capture_file);
+
+    g_pending.lock();
+    g_num_dropped = 0;
+    g_pending.unlock();
+    g_capture_running.setAtomic(true);
+    if (pthread_create(&g_capture_thread, NULL, &PacketCapture::writerThread,
+                       NULL) != 0)
+    {
+        g_capture_running.setAtomic(false);
+        fclose(g_capture_file);
+        g_capture_file = NULL;
+        Log::warn("PacketCapture", "Could not create the writer thread.");
+        return false;
+    }
+    Log::info("PacketCapture", "Capturing network packets in '%s'.",
+              filename.c_str());
+    return true;
+}   // start
+
+// ----------------------------------------------------------------------------
+/** Stops the writer thread after all pending packets are written, and
+ *  closes the capture file. It is safe to call this more than once.
+ */
+void PacketCapture::stop()
+{
+    g_capture_running.lock();
+    bool running = g_capture_running.getData();
+    g_capture_running.getData() = false;
+    g_capture_running.unlock();
+    if (!running)
+        return;
+    pthread_join(g_capture_thread, NULL);
+    writePending();
+    fclose(g_capture_file);
+    g_capture_file = NULL;
+    g_pending.lock();
+    int num_dropped = g_num_dropped;
+    g_pending.unlock();
+    if (num_dropped > 0)
+        Log::warn("PacketCapture", "%d packets were not captured.",
+                  num_dropped);
+}   // stop
+
+// ----------------------------------------------------------------------------
+/** Returns true if packets are captured. */
+bool PacketCapture::isRunning()
+{
+    return g_capture_running.getAtomic();
+}   // isRunning
+
+// ----------------------------------------------------------------------------
+/** Adds a packet to the capture. This only copies the packet into the
+ *  pending buffer, so it can be called from the network threads.
+ *  \param direction Whether the packet was received or sent.
+ *  \param type The type of the record.
+ *  \param address IPv4 address of the peer (in host byte order).
+ *  \param port Port of the peer.
+ *  \param channel The ENet channel of the packet.
+ *  \param reliable True if the packet is sent reliably.
+ *  \param data The bytes of the packet (can be NULL if size is 0).
+ *  \param size Number of bytes.
+ */
+void PacketCapture::capture(Direction direction, RecordType type,
+                            uint32_t address, uint16_t port,
+                            uint8_t channel, bool reliable,
+                            const uint8_t *data, uint32_t size)
+{
+    if (!isRunning())
+        return;
+
+    Record record;
+    memset(&record, 0, sizeof(record));
+    record.m_time      = StkTime::getRealTime();
+    record.m_address   = address;
+    record.m_port      = port;
+    record.m_direction = direction;
+    record.m_type      = type;
+    record.m_channel   = channel;
+    record.m_reliable  = reliable ? 1 : 0;
+    record.m_size      = size;
+
+    g_pending.lock();
+    std::vector<uint8_t> &pending = g_pending.getData();
+    if (pending.size() + sizeof(record) + size > MAX_PENDING_BYTES)
+    {
+        g_num_dropped++;
+        g_pending.unlock();
+        return;
+    }
+    const uint8_t *r = (const uint8_t*)&record;
+    pending.insert(pending.end(), r, r+sizeof(record));
+    if (size > 0)
+        pending.insert(pending.end(), data, data+size);
+    g_pending.unlock();
+}   // capture
+
+// ----------------------------------------------------------------------------
+/** Writes all pending records to the file.
+ *  \return False if nothing was pending.
+ */
+bool PacketCapture::writePending()
+{
+    // Swap the buffers, so that the network threads are not blocked
+    // while the data is written. The capacity of both buffers is kept.
+    static std::vector<uint8_t> buffer;
+    g_pending.lock();
+    buffer.swap(g_pending.getData());
+    g_pending.unlock();
+    if (buffer.empty())
+        return false;
+    fwrite(&buffer[0], 1, buffer.size(), g_capture_file);
+    fflush(g_capture_file);
+    buffer.clear();
+    return true;
+}   // writePending
+
+// ----------------------------------------------------------------------------
+/** The writer thread: writes pending records until stop() is called. */
+void* PacketCapture::writerThread(void *data)
+{
+    while (g_capture_running.getAtomic())
+    {
+        if (!writePending())
+            StkTime::sleep(5);
+    }
+    return NULL;
+}   // writerThread
+
+// ============================================================================
+PacketCaptureReader::PacketCaptureReader()
+{
+    m_offset = 0;
+}   // PacketCaptureReader
+
+// ----------------------------------------------------------------------------
+/** Opens a capture file and checks its header.
+ *  \param filename Name of the capture file.
+ *  \return False if the file can not be read or is not a capture file.
+ */
+bool PacketCaptureReader::open(const std::string &filename)
+{
+    m_offset = 0;
+    if (!m_file.open(filename))
+        return false;
+    uint32_t header[3];
+    if (m_file.getSize() < sizeof(header))
+        return false;
+    memcpy(header, m_file.getData(), sizeof(header));
+    if (header[0] != PacketCapture::CAPTURE_MAGIC   ||
+        header[1] != PacketCapture::CAPTURE_VERSION ||
+        header[2] != sizeof(PacketCapture::Record)     )
+        return false;
+    m_offset = sizeof(header);
+    return true;
+}   // open
+
+// ----------------------------------------------------------------------------
+/** Reads the next record.
+ *  \param record On return the header of the record.
+ *  \param data On return points to the bytes of the packet, which are
+ *         not copied.
+ *  \return False at the end of the file (a truncated last record, e.g.
+ *          after a crash, is ignored).
+ */
+bool PacketCaptureReader::next(PacketCapture::Record *record,
+                               const uint8_t **data)
+{
+    const size_t size = m_file.getSize();
+    if (m_offset + sizeof(PacketCapture::Record) > size)
+        return false;
+    // Records are not aligned in the file, so the header is copied
+    memcpy(record, m_file.getData()+m_offset, sizeof(PacketCapture::Record));
+    if (m_offset + sizeof(PacketCapture::Record) + record->m_size > size)
+        return false;
+    *data = m_file.getData() + m_offset + sizeof(PacketCapture::Record);
+    m_offset += sizeof(PacketCapture::Record) + record->m_size;
+    return true;
+}   // next
@@ -0,0 +1,114 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/*! \file packet_capture.hpp
+ *  \brief Records all network packets in a binary file, which can be
+ *  replayed with PacketReplay.
+ */
+
+#ifndef PACKET_CAPTURE_HPP
+#define PACKET_CAPTURE_HPP
+
+#include "io/mapped_file.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <string>
+
+/*! \class PacketCapture
+ *  \brief Writes network packets to a capture file.
+ *  The calling thread only appends the packet to a buffer, the file is
+ *  written by a background thread. The file starts with a header (magic
+ *  number, version and record size), followed by one Record per packet
+ *  and the raw bytes of the packet. All values are stored in the native
+ *  byte order, a capture is only meant to be replayed on the same kind of
+ *  machine.
+ */
+class PacketCapture : public NoCopy
+{
+    public:
+        /*! \brief Whether a packet was received or sent. */
+        enum Direction
+        {
+            PACKET_INCOMING = 0,
+            PACKET_OUTGOING = 1
+        };
+
+        /*! \brief What a record contains. */
+        enum RecordType
+        {
+            RECORD_CONNECT    = 0, //!< A peer connected (no data)
+            RECORD_DISCONNECT = 1, //!< A peer disconnected (no data)
+            RECORD_MESSAGE    = 2, //!< The data of an ENet packet
+            RECORD_RAW        = 3  //!< A packet sent without ENet (STUN)
+        };
+
+        /*! \brief The header of each packet in the capture file. */
+        struct Record
+        {
+            double   m_time;      //!< Real time at which the packet was seen
+            uint32_t m_address;   //!< IPv4 address of the peer (host order)
+            uint16_t m_port;      //!< Port of the peer
+            uint8_t  m_direction; //!< See Direction
+            uint8_t  m_type;      //!< See RecordType
+            uint8_t  m_channel;   //!< ENet channel
+            uint8_t  m_reliable;  //!< 1 if the packet was sent reliably
+            uint16_t m_padding;
+            uint32_t m_size;      //!< Number of bytes following the record
+        };
+
+        /*! \brief Identifies a capture file. Since it is written as a
+         *  native integer, a file with a different byte order is rejected.
+         */
+        static const uint32_t CAPTURE_MAGIC   = 0x53544b43;
+        /*! \brief Must be increased when the format changes. */
+        static const uint32_t CAPTURE_VERSION = 1;
+
+        static bool start(const std::string &filename);
+        static void stop();
+        static bool isRunning();
+        static void capture(Direction direction, RecordType type,
+                            uint32_t address, uint16_t port,
+                            uint8_t channel, bool reliable,
+                            const uint8_t *data, uint32_t size);
+
+    private:
+        static void* writerThread(void *data);
+        static bool  writePending();
+};   // PacketCapture
+
+// ============================================================================
+/*! \class PacketCaptureReader
+ *  \brief Reads the records of a capture file one after the other. The
+ *  file is mapped into memory, so the data returned by next() stays valid
+ *  until the reader is closed.
+ */
+class PacketCaptureReader : public NoCopy
+{
+    public:
+                 PacketCaptureReader();
+        bool     open(const std::string &filename);
+        bool     next(PacketCapture::Record *record, const uint8_t **data);
+
+    private:
+        MappedFile m_file;   //!< The capture file
+        size_t     m_offset; //!< Offset of the next record
+};   // PacketCaptureReader
+
+#endif // PACKET_CAPTURE_HPP
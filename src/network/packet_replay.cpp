@@ -0,0 +1,168 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "network/packet_replay.hpp"
+
+#include "network/event.hpp"
+#include "network/network_manager.hpp"
+#include "network/packet_capture.hpp"
+#include "network/protocol_manager.hpp"
+#include "network/stk_peer.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#  include <winsock2.h>
+#else
+#  include <arpa/inet.h>
+#endif
+
+/** Number of replayed events after which the protocols are updated when
+ *  replaying as fast as possible (similar to a few events per frame). */
+static const unsigned int EVENTS_PER_UPDATE = 64;
+
+PacketReplay::PacketReplay()
+{
+}   // PacketReplay
+
+// ----------------------------------------------------------------------------
+PacketReplay::~PacketReplay()
+{
+    // The STKPeers reference the ENet peers, so remove them first
+    std::map<std::pair<uint32_t, uint16_t>, ENetPeer*>::iterator i;
+    for (i = m_peers.begin(); i != m_peers.end(); i++)
+    {
+        if (i->second->data)
+            NetworkManager::getInstance()->removePeer(
+                                                (STKPeer*)i->second->data);
+        free(i->second);
+    }
+    m_peers.clear();
+}   // ~PacketReplay
+
+// ----------------------------------------------------------------------------
+/** Returns the fake ENet peer for an address, creating it if necessary. The
+ *  peer is in disconnected state, so ENet drops all packets sent to it.
+ */
+ENetPeer* PacketReplay::getPeer(uint32_t address, uint16_t port)
+{
+    std::pair<uint32_t, uint16_t> key(address, port);
+    std::map<std::pair<uint32_t, uint16_t>, ENetPeer*>::iterator i =
+                                                           m_peers.find(key);
+    if (i != m_peers.end())
+        return i->second;
+
+    ENetPeer *peer = (ENetPeer*)calloc(1, sizeof(ENetPeer));
+    peer->address.host = htonl(address);
+    peer->address.port = port;
+    peer->state        = ENET_PEER_STATE_DISCONNECTED;
+    m_peers[key] = peer;
+    return peer;
+}   // getPeer
+
+// ----------------------------------------------------------------------------
+/** Updates the protocols until all replayed events were handled. */
+void PacketReplay::waitForProtocols()
+{
+    ProtocolManager *manager = ProtocolManager::getInstance();
+    do
+    {
+        manager->update();
+        StkTime::sleep(1);
+    } while (manager->getNumQueuedEvents() > 0);
+}   // waitForProtocols
+
+// ----------------------------------------------------------------------------
+/** Replays all packets that were received in a capture file.
+ *  \param filename Name of the capture file.
+ *  \param real_time If true, the packets are replayed with the timing in
+ *         which they were captured, otherwise as fast as possible.
+ *  \return False if the file could not be read.
+ */
+bool PacketReplay::run(const std::string &filename, bool real_time)
+{
+    PacketCaptureReader reader;
+    if (!reader.open(filename))
+    {
+        Log::error("PacketReplay", "Can't read packet capture '%s'.",
+                   filename.c_str());
+        return false;
+    }
+
+    ProtocolManager *manager = ProtocolManager::getInstance();
+    PacketCapture::Record record;
+    const uint8_t *data;
+    unsigned int num_events = 0;
+    double first_time = -1;
+    double start = StkTime::getMonoTime();
+    while (reader.next(&record, &data))
+    {
+        if (record.m_direction != PacketCapture::PACKET_INCOMING ||
+            record.m_type == PacketCapture::RECORD_RAW)
+            continue;
+
+        if (real_time)
+        {
+            if (first_time < 0)
+                first_time = record.m_time;
+            double due = start + (record.m_time - first_time);
+            while (StkTime::getMonoTime() < due)
+            {
+                manager->update();
+                StkTime::sleep(1);
+            }
+        }
+
+        ENetEvent event;
+        event.peer      = getPeer(record.m_address, record.m_port);
+        event.channelID = record.m_channel;
+        event.data      = 0;
+        event.packet    = NULL;
+        switch (record.m_type)
+        {
+        case PacketCapture::RECORD_CONNECT:
+            event.type = ENET_EVENT_TYPE_CONNECT;
+            break;
+        case PacketCapture::RECORD_DISCONNECT:
+            event.type = ENET_EVENT_TYPE_DISCONNECT;
+            break;
+        default:
+            // The packet references the mapped file, nothing is copied
+            event.type   = ENET_EVENT_TYPE_RECEIVE;
+            event.packet = enet_packet_create(data, record.m_size,
+                                              ENET_PACKET_FLAG_NO_ALLOCATE);
+            break;
+        }
+        NetworkManager::getInstance()->notifyEvent(
+                                                manager->createEvent(&event));
+        num_events++;
+
+        if (!real_time && num_events % EVENTS_PER_UPDATE == 0)
+            manager->update();
+    }
+    waitForProtocols();
+
+    double duration = StkTime::getMonoTime() - start;
+    Log::info("PacketReplay", "Replayed %d events from %d peers in %f s.",
+              num_events, (int)m_peers.size(), duration);
+    return true;
+}   // run
@@ -0,0 +1,60 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/*! \file packet_replay.hpp
+ *  \brief Feeds a packet capture back into the protocol manager.
+ */
+
+#ifndef PACKET_REPLAY_HPP
+#define PACKET_REPLAY_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <map>
+#include <string>
+#include <utility>
+
+typedef struct _ENetPeer ENetPeer;
+
+/*! \class PacketReplay
+ *  \brief Replays the packets received in a capture (see PacketCapture)
+ *  without any sockets. Each incoming record is turned into an ENet event
+ *  and passed through the same path as a packet received by STKHost, so
+ *  the running protocols handle it as if it came from the network. The
+ *  peers are ENet peers that are not connected to a host, so everything
+ *  the protocols send is dropped. This allows to reproduce the load of a
+ *  real match and to measure the protocol handling offline.
+ */
+class PacketReplay : public NoCopy
+{
+    public:
+                 PacketReplay();
+                ~PacketReplay();
+        bool     run(const std::string &filename, bool real_time);
+
+    private:
+        ENetPeer* getPeer(uint32_t address, uint16_t port);
+        void      waitForProtocols();
+
+        /*! \brief The fake ENet peers, indexed by address and port. */
+        std::map<std::pair<uint32_t, uint16_t>, ENetPeer*> m_peers;
+};   // PacketReplay
+
+#endif // PACKET_REPLAY_HPP
@@ -56,7 +56,7 @@ PROTOCOL_TYPE Protocol::getProtocolType()
 
 bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
 {
-    NetworkString data = event->data();
+    const NetworkString &data = event->data();
     if (data.size() < minimum_size || data[0] != 4)
     {
         Log::warn("Protocol", "Receiving a badly "
@@ -64,7 +64,7 @@ bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
                   data.size(), data[0]);
         return false;
     }
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     uint32_t token = data.gui32(1);
     if (token != peer->getClientServerToken())
     {
@@ -77,7 +77,7 @@ bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
 
 bool Protocol::isByteCorrect(Event* event, int byte_nb, int value)
 {
-    NetworkString data = event->data();
+    const NetworkString &data = event->data();
     if (data[byte_nb] != value)
     {
         Log::info("Protocol", "Bad byte at pos %d. %d "
@@ -21,19 +21,24 @@
 #include "network/protocol.hpp"
 #include "network/network_manager.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/time.hpp"
 
 #include <assert.h>
 #include <cstdlib>
 #include <errno.h>
+#include <string.h>
 #include <typeinfo>
 
 void* protocolManagerUpdate(void* data)
 {
     ProtocolManager* manager = static_cast<ProtocolManager*>(data);
+    profiler.setThreadName("Protocol manager");
     while(manager && !manager->exit())
     {
+        PROFILER_PUSH_CPU_MARKER("Protocol manager update", 0x7F, 0x00, 0x7F);
         manager->update();
+        PROFILER_POP_CPU_MARKER();
         StkTime::sleep(2);
     }
     return NULL;
@@ -42,9 +47,12 @@ void* protocolManagerAsynchronousUpdate(void* data)
 {
     ProtocolManager* manager = static_cast<ProtocolManager*>(data);
     manager->m_asynchronous_thread_running = true;
+    profiler.setThreadName("Protocol manager async");
     while(manager && !manager->exit())
     {
+        PROFILER_PUSH_CPU_MARKER("Protocol manager async update", 0x7F, 0x3F, 0x7F);
         manager->asynchronousUpdate();
+        PROFILER_POP_CPU_MARKER();
         StkTime::sleep(2);
     }
     manager->m_asynchronous_thread_running = false;
@@ -52,14 +60,17 @@ void* protocolManagerAsynchronousUpdate(void* data)
 }
 
 ProtocolManager::ProtocolManager()
+               : m_incoming_events(4096), m_event_info_pool(1024),
+                 m_event_pool(1024), m_synchronous_events_queue(4096),
+                 m_requests(1024)
 {
-    pthread_mutex_init(&m_events_mutex, NULL);
     pthread_mutex_init(&m_protocols_mutex, NULL);
     pthread_mutex_init(&m_asynchronous_protocols_mutex, NULL);
-    pthread_mutex_init(&m_requests_mutex, NULL);
     pthread_mutex_init(&m_id_mutex, NULL);
     pthread_mutex_init(&m_exit_mutex, NULL);
     m_next_protocol_id = 0;
+    memset(&m_event_queue_stats,   0, sizeof(QueueStats));
+    memset(&m_request_queue_stats, 0, sizeof(QueueStats));
 
 
     pthread_mutex_lock(&m_exit_mutex); // will let the update function run
@@ -83,86 +94,75 @@ void ProtocolManager::abort()
 {
     pthread_mutex_unlock(&m_exit_mutex); // will stop the update function
     pthread_join(*m_asynchronous_update_thread, NULL); // wait the thread to finish
-    pthread_mutex_lock(&m_events_mutex);
     pthread_mutex_lock(&m_protocols_mutex);
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
-    pthread_mutex_lock(&m_requests_mutex);
     pthread_mutex_lock(&m_id_mutex);
     for (unsigned int i = 0; i < m_protocols.size() ; i++)
         delete m_protocols[i].protocol;
-    for (unsigned int i = 0; i < m_events_to_process.size() ; i++)
-        delete m_events_to_process[i].event;
     m_protocols.clear();
-    m_requests.clear();
-    m_events_to_process.clear();
-    pthread_mutex_unlock(&m_events_mutex);
+    m_pending_starts.clear();
+
+    EventProcessingInfo* event;
+    while (m_incoming_events.pop(&event))
+        deleteEvent(event);
+    while (m_synchronous_events_queue.pop(&event))
+        deleteEvent(event);
+    for (unsigned int i = 0; i < m_synchronous_events.size(); i++)
+        deleteEvent(m_synchronous_events[i]);
+    m_synchronous_events.clear();
+    for (unsigned int i = 0; i < m_synchronous_events_overflow.size(); i++)
+        deleteEvent(m_synchronous_events_overflow[i]);
+    m_synchronous_events_overflow.clear();
+    ProtocolRequest request;
+    while (m_requests.pop(&request)) {}
+    while (m_event_info_pool.pop(&event))
+        delete event;
+    Event* unused_event;
+    while (m_event_pool.pop(&unused_event))
+        delete unused_event;
+    rebuildRoutingTable();
+
     pthread_mutex_unlock(&m_protocols_mutex);
     pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
-    pthread_mutex_unlock(&m_requests_mutex);
     pthread_mutex_unlock(&m_id_mutex);
 
-    pthread_mutex_destroy(&m_events_mutex);
+    if (m_event_queue_stats.count > 0)
+    {
+        Log::info("ProtocolManager", "Events: %u processed, max queue depth "
+                  "%u, average wait %f ms, max wait %f ms.",
+                  m_event_queue_stats.count, m_event_queue_stats.max_depth,
+                  m_event_queue_stats.total_wait*1000.0/m_event_queue_stats.count,
+                  m_event_queue_stats.max_wait*1000.0);
+    }
+
     pthread_mutex_destroy(&m_protocols_mutex);
     pthread_mutex_destroy(&m_asynchronous_protocols_mutex);
-    pthread_mutex_destroy(&m_requests_mutex);
     pthread_mutex_destroy(&m_id_mutex);
     pthread_mutex_destroy(&m_exit_mutex);
 }
 
 void ProtocolManager::notifyEvent(Event* event)
 {
-    pthread_mutex_lock(&m_events_mutex);
-    Event* event2 = new Event(*event);
-    // register protocols that will receive this event
-    std::vector<unsigned int> protocols_ids;
-    PROTOCOL_TYPE searchedProtocol = PROTOCOL_NONE;
-    if (event2->type == EVENT_TYPE_MESSAGE)
+    EventProcessingInfo* epi = acquireEventInfo();
+    epi->event = event;
+    epi->arrival_time = StkTime::getRealTime();
+    // The queue is only full if the protocol manager thread is stuck, so
+    // apply back-pressure on the network thread.
+    while (!m_incoming_events.push(epi))
     {
-        if (event2->data().size() > 0)
+        if (exit())
         {
-            searchedProtocol = (PROTOCOL_TYPE)(event2->data()[0]);
-            event2->removeFront(1);
-        }
-        else
-        {
-            Log::warn("ProtocolManager", "Not enough data.");
-        }
-    }
-    if (event2->type == EVENT_TYPE_CONNECTED)
-    {
-        searchedProtocol = PROTOCOL_CONNECTION;
-    }
-    Log::verbose("ProtocolManager", "Received event for protocols of type %d", searchedProtocol);
-    pthread_mutex_lock(&m_protocols_mutex);
-    for (unsigned int i = 0; i < m_protocols.size() ; i++)
-    {
-        if (m_protocols[i].protocol->getProtocolType() == searchedProtocol || event2->type == EVENT_TYPE_DISCONNECTED) // pass data to protocols even when paused
-        {
-            protocols_ids.push_back(m_protocols[i].id);
+            deleteEvent(epi);
+            return;
         }
+        StkTime::sleep(1);
     }
-    pthread_mutex_unlock(&m_protocols_mutex);
-    if (searchedProtocol == PROTOCOL_NONE) // no protocol was aimed, show the msg to debug
-    {
-        Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event2->data().std_string().c_str());
-    }
-
-    if (protocols_ids.size() != 0)
-    {
-        EventProcessingInfo epi;
-        epi.arrival_time = (double)StkTime::getTimeSinceEpoch();
-        epi.event = event2;
-        epi.protocols_ids = protocols_ids;
-        m_events_to_process.push_back(epi); // add the event to the queue
-    }
-    else
-        Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
-    pthread_mutex_unlock(&m_events_mutex);
 }
 
 void ProtocolManager::sendMessage(Protocol* sender, const NetworkString& message, bool reliable)
 {
     NetworkString newMessage;
+    newMessage.reserve(message.size()+1);
     newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
     newMessage += message;
     NetworkManager::getInstance()->sendPacket(newMessage, reliable);
@@ -171,6 +171,7 @@ void ProtocolManager::sendMessage(Protocol* sender, const NetworkString& message
 void ProtocolManager::sendMessage(Protocol* sender, STKPeer* peer, const NetworkString& message, bool reliable)
 {
     NetworkString newMessage;
+    newMessage.reserve(message.size()+1);
     newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
     newMessage += message;
     NetworkManager::getInstance()->sendPacket(peer, newMessage, reliable);
@@ -178,11 +179,23 @@ void ProtocolManager::sendMessage(Protocol* sender, STKPeer* peer, const Network
 void ProtocolManager::sendMessageExcept(Protocol* sender, STKPeer* peer, const NetworkString& message, bool reliable)
 {
     NetworkString newMessage;
+    newMessage.reserve(message.size()+1);
     newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
     newMessage += message;
     NetworkManager::getInstance()->sendPacketExcept(peer, newMessage, reliable);
 }
 
+void ProtocolManager::addRequest(const ProtocolRequest& request)
+{
+    // Requests are rare, so the queue can only be full if the protocol
+    // manager thread is stuck.
+    while (!m_requests.push(request))
+    {
+        Log::warn("ProtocolManager", "Request queue is full.");
+        StkTime::sleep(1);
+    }
+}
+
 uint32_t ProtocolManager::requestStart(Protocol* protocol)
 {
     // create the request
@@ -193,10 +206,13 @@ uint32_t ProtocolManager::requestStart(Protocol* protocol)
     assignProtocolId(&info); // assign a unique id to the protocol.
     req.protocol_info = info;
     req.type = PROTOCOL_REQUEST_START;
-    // add it to the request stack
-    pthread_mutex_lock(&m_requests_mutex);
-    m_requests.push_back(req);
-    pthread_mutex_unlock(&m_requests_mutex);
+    req.time = StkTime::getRealTime();
+    // remember it until it is started, so that it is reported as running
+    pthread_mutex_lock(&m_id_mutex);
+    m_pending_starts.push_back(info);
+    pthread_mutex_unlock(&m_id_mutex);
+    // add it to the request queue
+    addRequest(req);
 
     return info.id;
 }
@@ -209,10 +225,9 @@ void ProtocolManager::requestStop(Protocol* protocol)
     ProtocolRequest req;
     req.protocol_info.protocol = protocol;
     req.type = PROTOCOL_REQUEST_STOP;
-    // add it to the request stack
-    pthread_mutex_lock(&m_requests_mutex);
-    m_requests.push_back(req);
-    pthread_mutex_unlock(&m_requests_mutex);
+    req.time = StkTime::getRealTime();
+    // add it to the request queue
+    addRequest(req);
 }
 
 void ProtocolManager::requestPause(Protocol* protocol)
@@ -223,10 +238,9 @@ void ProtocolManager::requestPause(Protocol* protocol)
     ProtocolRequest req;
     req.protocol_info.protocol = protocol;
     req.type = PROTOCOL_REQUEST_PAUSE;
-    // add it to the request stack
-    pthread_mutex_lock(&m_requests_mutex);
-    m_requests.push_back(req);
-    pthread_mutex_unlock(&m_requests_mutex);
+    req.time = StkTime::getRealTime();
+    // add it to the request queue
+    addRequest(req);
 }
 
 void ProtocolManager::requestUnpause(Protocol* protocol)
@@ -237,10 +251,9 @@ void ProtocolManager::requestUnpause(Protocol* protocol)
     ProtocolRequest req;
     req.protocol_info.protocol = protocol;
     req.type = PROTOCOL_REQUEST_UNPAUSE;
-    // add it to the request stack
-    pthread_mutex_lock(&m_requests_mutex);
-    m_requests.push_back(req);
-    pthread_mutex_unlock(&m_requests_mutex);
+    req.time = StkTime::getRealTime();
+    // add it to the request queue
+    addRequest(req);
 }
 
 void ProtocolManager::requestTerminate(Protocol* protocol)
@@ -251,19 +264,9 @@ void ProtocolManager::requestTerminate(Protocol* protocol)
     ProtocolRequest req;
     req.protocol_info.protocol = protocol;
     req.type = PROTOCOL_REQUEST_TERMINATE;
-    // add it to the request stack
-    pthread_mutex_lock(&m_requests_mutex);
-    // check that the request does not already exist :
-    for (unsigned int i = 0; i < m_requests.size(); i++)
-    {
-        if (m_requests[i].protocol_info.protocol == protocol)
-        {
-            pthread_mutex_unlock(&m_requests_mutex);
-            return;
-        }
-    }
-    m_requests.push_back(req);
-    pthread_mutex_unlock(&m_requests_mutex);
+    req.time = StkTime::getRealTime();
+    // add it to the request queue, duplicates are ignored when processing
+    addRequest(req);
 }
 
 void ProtocolManager::startProtocol(ProtocolInfo protocol)
@@ -273,11 +276,23 @@ void ProtocolManager::startProtocol(ProtocolInfo protocol)
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
     Log::info("ProtocolManager", "A %s protocol with id=%u has been started. There are %ld protocols running.", typeid(*protocol.protocol).name(), protocol.id, m_protocols.size()+1);
     m_protocols.push_back(protocol);
+    rebuildRoutingTable();
     // setup the protocol and notify it that it's started
     protocol.protocol->setListener(this);
     protocol.protocol->setup();
     pthread_mutex_unlock(&m_protocols_mutex);
     pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
+    // now that it is in m_protocols, it is not pending anymore
+    pthread_mutex_lock(&m_id_mutex);
+    for (unsigned int i = 0; i < m_pending_starts.size(); i++)
+    {
+        if (m_pending_starts[i].id == protocol.id)
+        {
+            m_pending_starts.erase(m_pending_starts.begin()+i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_id_mutex);
 }
 void ProtocolManager::stopProtocol(ProtocolInfo protocol)
 {
@@ -309,68 +324,148 @@ void ProtocolManager::protocolTerminated(ProtocolInfo protocol)
 {
     pthread_mutex_lock(&m_protocols_mutex); // be sure that noone accesses the protocols vector while we erase a protocol
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
-    int offset = 0;
-    std::string protocol_type = typeid(*protocol.protocol).name();
     for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
-        if (m_protocols[i-offset].protocol == protocol.protocol)
+        // there can be several terminate requests for the same protocol,
+        // only the first one finds it
+        if (m_protocols[i].protocol == protocol.protocol)
         {
+            std::string protocol_type = typeid(*protocol.protocol).name();
             delete m_protocols[i].protocol;
-            m_protocols.erase(m_protocols.begin()+(i-offset), m_protocols.begin()+(i-offset)+1);
-            offset++;
+            m_protocols.erase(m_protocols.begin()+i);
+            rebuildRoutingTable();
+            Log::info("ProtocolManager", "A %s protocol has been terminated. There are %ld protocols running.", protocol_type.c_str(), m_protocols.size());
+            break;
         }
     }
-    Log::info("ProtocolManager", "A %s protocol has been terminated. There are %ld protocols running.", protocol_type.c_str(), m_protocols.size());
     pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
     pthread_mutex_unlock(&m_protocols_mutex);
 }
 
 bool ProtocolManager::propagateEvent(EventProcessingInfo* event, bool synchronous)
 {
-    int index = 0;
-    for (unsigned int i = 0; i < m_protocols.size(); i++)
+    std::vector<unsigned int> &ids = event->protocols_ids;
+    for (unsigned int i = 0; i < ids.size(); )
     {
-        if (event->protocols_ids[index] == m_protocols[i].id)
+        Protocol* protocol = getProtocol(ids[i]);
+        bool result = true; // protocol terminated meanwhile, forget it
+        if (protocol)
         {
-            bool result = false;
             if (synchronous)
-                result = m_protocols[i].protocol->notifyEvent(event->event);
-            else
-                result = m_protocols[i].protocol->notifyEventAsynchronous(event->event);
-            if (result)
-                event->protocols_ids.pop_back();
+                result = protocol->notifyEvent(event->event);
             else
-                index++;
+                result = protocol->notifyEventAsynchronous(event->event);
         }
+        if (result)
+            ids.erase(ids.begin()+i);
+        else
+            i++;
     }
-    if (event->protocols_ids.size() == 0 || (StkTime::getTimeSinceEpoch()-event->arrival_time) >= TIME_TO_KEEP_EVENTS)
+    return ids.size() == 0 ||
+           (StkTime::getRealTime()-event->arrival_time) >= TIME_TO_KEEP_EVENTS;
+}
+
+void ProtocolManager::deleteEvent(EventProcessingInfo* event)
+{
+    // the event (and its packet) is owned by the manager, the event is
+    // put back into the pool after its packet is freed
+    Event* evt = event->event;
+    if (evt)
     {
-        // because we made a copy of the event
-        delete event->event->peer; // no more need of that
-        delete event->event;
-        return true;
+        evt->reset();
+        if (!m_event_pool.push(evt))
+            delete evt;
     }
-    return false;
+    releaseEventInfo(event);
+}
+
+Event* ProtocolManager::createEvent(ENetEvent* event)
+{
+    Event* evt;
+    if (!m_event_pool.pop(&evt))
+        evt = new Event();
+    evt->set(event);
+    return evt;
+}
+
+unsigned int ProtocolManager::getNumQueuedEvents() const
+{
+    return (unsigned int)(m_incoming_events.sizeApprox() +
+                          m_synchronous_events_queue.sizeApprox());
+}
+
+/** Returns an unused EventProcessingInfo, from the pool if possible.
+ *  Can be called from any thread.
+ */
+EventProcessingInfo* ProtocolManager::acquireEventInfo()
+{
+    EventProcessingInfo* info;
+    if (!m_event_info_pool.pop(&info))
+        info = new EventProcessingInfo();
+    return info;
+}
+
+/** Puts an EventProcessingInfo back into the pool. The capacity of its
+ *  protocol id vector is kept, so it is not reallocated when reused.
+ */
+void ProtocolManager::releaseEventInfo(EventProcessingInfo* info)
+{
+    info->event = NULL;
+    info->protocols_ids.clear();
+    if (!m_event_info_pool.push(info))
+        delete info;
+}
+
+/** Rebuilds the protocol type -> protocol ids index and the id -> protocol
+ *  map. Must be called with m_protocols_mutex and
+ *  m_asynchronous_protocols_mutex locked, each time m_protocols changes.
+ *  This only happens when protocols start or terminate, which is rare
+ *  compared with the number of events.
+ */
+void ProtocolManager::rebuildRoutingTable()
+{
+    for (unsigned int i = 0; i < 256; i++)
+        m_protocols_by_type[i].clear();
+    m_protocols_by_id.clear();
+    for (unsigned int i = 0; i < m_protocols.size(); i++)
+    {
+        PROTOCOL_TYPE type = m_protocols[i].protocol->getProtocolType();
+        if (type < 256)
+            m_protocols_by_type[type].push_back(m_protocols[i].id);
+        m_protocols_by_id[m_protocols[i].id] = m_protocols[i].protocol;
+    }
+}
+
+void ProtocolManager::updateQueueStats(QueueStats* stats, double wait, size_t depth)
+{
+    stats->count++;
+    stats->total_wait += wait;
+    if (wait > stats->max_wait)
+        stats->max_wait = wait;
+    if (depth > stats->max_depth)
+        stats->max_depth = depth;
 }
 
 void ProtocolManager::update()
 {
+    // get all events the protocol manager thread passed to us
+    EventProcessingInfo* event;
+    while (m_synchronous_events_queue.pop(&event))
+        m_synchronous_events.push_back(event);
+
+    pthread_mutex_lock(&m_protocols_mutex);
     // before updating, notice protocols that they have received events
-    pthread_mutex_lock(&m_events_mutex); // secure threads
-    int size = m_events_to_process.size();
-    int offset = 0;
-    for (int i = 0; i < size; i++)
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < m_synchronous_events.size(); i++)
     {
-        bool result = propagateEvent(&m_events_to_process[i+offset], true);
-        if (result)
-        {
-            m_events_to_process.erase(m_events_to_process.begin()+i+offset,m_events_to_process.begin()+i+offset+1);
-            offset --;
-        }
+        if (propagateEvent(m_synchronous_events[i], true))
+            deleteEvent(m_synchronous_events[i]);
+        else
+            m_synchronous_events[kept++] = m_synchronous_events[i];
     }
-    pthread_mutex_unlock(&m_events_mutex); // release the mutex
+    m_synchronous_events.resize(kept);
+
     // now update all protocols
-    pthread_mutex_lock(&m_protocols_mutex);
     for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
         if (m_protocols[i].state == PROTOCOL_STATE_RUNNING)
@@ -379,58 +474,126 @@ void ProtocolManager::update()
     pthread_mutex_unlock(&m_protocols_mutex);
 }
 
-void ProtocolManager::asynchronousUpdate()
+/** Routes all events received since the last call to the protocols, and
+ *  notifies them asynchronously. Events not completely consumed are passed
+ *  to the main thread for the synchronous notifyEvent.
+ *  Only called from the protocol manager thread, which is the only thread
+ *  modifying m_protocols, so no lock is needed to read it.
+ */
+void ProtocolManager::processIncomingEvents()
 {
-    // before updating, notice protocols that they have received information
-    pthread_mutex_lock(&m_events_mutex); // secure threads
-    int size = m_events_to_process.size();
-    int offset = 0;
-    for (int i = 0; i < size; i++)
+    // First retry events the main thread could not take last time
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < m_synchronous_events_overflow.size(); i++)
     {
-        bool result = propagateEvent(&m_events_to_process[i+offset], false);
-        if (result)
-        {
-            m_events_to_process.erase(m_events_to_process.begin()+i+offset,m_events_to_process.begin()+i+offset+1);
-            offset --;
-        }
+        if (!m_synchronous_events_queue.push(m_synchronous_events_overflow[i]))
+            m_synchronous_events_overflow[kept++] = m_synchronous_events_overflow[i];
     }
-    pthread_mutex_unlock(&m_events_mutex); // release the mutex
+    m_synchronous_events_overflow.resize(kept);
 
-    // now update all protocols that need to be updated in asynchronous mode
-    pthread_mutex_lock(&m_asynchronous_protocols_mutex);
-    for (unsigned int i = 0; i < m_protocols.size(); i++)
+    size_t depth = m_incoming_events.sizeApprox();
+    double now = StkTime::getRealTime();
+    EventProcessingInfo* event;
+    while (m_incoming_events.pop(&event))
     {
-        if (m_protocols[i].state == PROTOCOL_STATE_RUNNING)
-            m_protocols[i].protocol->asynchronousUpdate();
+        updateQueueStats(&m_event_queue_stats, now - event->arrival_time, depth);
+        Event* event2 = event->event;
+        // register protocols that will receive this event
+        PROTOCOL_TYPE searchedProtocol = PROTOCOL_NONE;
+        if (event2->type == EVENT_TYPE_MESSAGE)
+        {
+            if (event2->data().size() > 0)
+            {
+                searchedProtocol = (PROTOCOL_TYPE)(event2->data()[0]);
+                event2->removeFront(1);
+            }
+            else
+            {
+                Log::warn("ProtocolManager", "Not enough data.");
+            }
+        }
+        if (event2->type == EVENT_TYPE_CONNECTED)
+        {
+            searchedProtocol = PROTOCOL_CONNECTION;
+        }
+        Log::verbose("ProtocolManager", "Received event for protocols of type %d", searchedProtocol);
+        // pass data to protocols even when paused
+        if (event2->type == EVENT_TYPE_DISCONNECTED)
+        {
+            for (unsigned int i = 0; i < m_protocols.size() ; i++)
+                event->protocols_ids.push_back(m_protocols[i].id);
+        }
+        else
+        {
+            const std::vector<unsigned int> &ids = m_protocols_by_type[searchedProtocol & 0xff];
+            event->protocols_ids.insert(event->protocols_ids.end(), ids.begin(), ids.end());
+        }
+        if (searchedProtocol == PROTOCOL_NONE) // no protocol was aimed, show the msg to debug
+        {
+            Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event2->data().std_string().c_str());
+        }
+
+        if (event->protocols_ids.size() == 0)
+        {
+            Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
+            deleteEvent(event);
+            continue;
+        }
+        if (propagateEvent(event, false))
+            deleteEvent(event);
+        else if (!m_synchronous_events_queue.push(event))
+            m_synchronous_events_overflow.push_back(event);
     }
-    pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
+}
 
-    // process queued events for protocols
-    // these requests are asynchronous
-    pthread_mutex_lock(&m_requests_mutex);
-    for (unsigned int i = 0; i < m_requests.size(); i++)
+/** Processes all queued requests to start/stop etc... protocols.
+ */
+void ProtocolManager::processRequests()
+{
+    size_t depth = m_requests.sizeApprox();
+    double now = StkTime::getRealTime();
+    ProtocolRequest request;
+    while (m_requests.pop(&request))
     {
-        switch (m_requests[i].type)
+        updateQueueStats(&m_request_queue_stats, now - request.time, depth);
+        switch (request.type)
         {
             case PROTOCOL_REQUEST_START:
-                startProtocol(m_requests[i].protocol_info);
+                startProtocol(request.protocol_info);
                 break;
             case PROTOCOL_REQUEST_STOP:
-                stopProtocol(m_requests[i].protocol_info);
+                stopProtocol(request.protocol_info);
                 break;
             case PROTOCOL_REQUEST_PAUSE:
-                pauseProtocol(m_requests[i].protocol_info);
+                pauseProtocol(request.protocol_info);
                 break;
             case PROTOCOL_REQUEST_UNPAUSE:
-                unpauseProtocol(m_requests[i].protocol_info);
+                unpauseProtocol(request.protocol_info);
                 break;
             case PROTOCOL_REQUEST_TERMINATE:
-                protocolTerminated(m_requests[i].protocol_info);
+                protocolTerminated(request.protocol_info);
                 break;
         }
     }
-    m_requests.clear();
-    pthread_mutex_unlock(&m_requests_mutex);
+}
+
+void ProtocolManager::asynchronousUpdate()
+{
+    // before updating, notice protocols that they have received information
+    processIncomingEvents();
+
+    // now update all protocols that need to be updated in asynchronous mode
+    pthread_mutex_lock(&m_asynchronous_protocols_mutex);
+    for (unsigned int i = 0; i < m_protocols.size(); i++)
+    {
+        if (m_protocols[i].state == PROTOCOL_STATE_RUNNING)
+            m_protocols[i].protocol->asynchronousUpdate();
+    }
+    pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
+
+    // process queued events for protocols
+    // these requests are asynchronous
+    processRequests();
 }
 
 int ProtocolManager::runningProtocolsCount()
@@ -446,12 +609,15 @@ PROTOCOL_STATE ProtocolManager::getProtocolState(uint32_t id)
             return m_protocols[i].state; // return its state
     }
     // the protocol isn't running right now
-    for (unsigned int i = 0; i < m_requests.size(); i++)
+    PROTOCOL_STATE state = PROTOCOL_STATE_TERMINATED; // else, it's already finished
+    pthread_mutex_lock(&m_id_mutex);
+    for (unsigned int i = 0; i < m_pending_starts.size(); i++)
     {
-        if (m_requests[i].protocol_info.id == id) // the protocol is going to be started
-            return PROTOCOL_STATE_RUNNING; // we can say it's running
+        if (m_pending_starts[i].id == id) // the protocol is going to be started
+            state = PROTOCOL_STATE_RUNNING; // we can say it's running
     }
-    return PROTOCOL_STATE_TERMINATED; // else, it's already finished
+    pthread_mutex_unlock(&m_id_mutex);
+    return state;
 }
 
 PROTOCOL_STATE ProtocolManager::getProtocolState(Protocol* protocol)
@@ -461,12 +627,15 @@ PROTOCOL_STATE ProtocolManager::getProtocolState(Protocol* protocol)
         if (m_protocols[i].protocol == protocol) // the protocol is known
             return m_protocols[i].state; // return its state
     }
-    for (unsigned int i = 0; i < m_requests.size(); i++)
+    PROTOCOL_STATE state = PROTOCOL_STATE_TERMINATED; // we don't know this protocol at all, it's finished
+    pthread_mutex_lock(&m_id_mutex);
+    for (unsigned int i = 0; i < m_pending_starts.size(); i++)
     {
-        if (m_requests[i].protocol_info.protocol == protocol) // the protocol is going to be started
-            return PROTOCOL_STATE_RUNNING; // we can say it's running
+        if (m_pending_starts[i].protocol == protocol) // the protocol is going to be started
+            state = PROTOCOL_STATE_RUNNING; // we can say it's running
     }
-    return PROTOCOL_STATE_TERMINATED; // we don't know this protocol at all, it's finished
+    pthread_mutex_unlock(&m_id_mutex);
+    return state;
 }
 
 uint32_t ProtocolManager::getProtocolID(Protocol* protocol)
@@ -481,12 +650,10 @@ uint32_t ProtocolManager::getProtocolID(Protocol* protocol)
 
 Protocol* ProtocolManager::getProtocol(uint32_t id)
 {
-    for (unsigned int i = 0; i < m_protocols.size(); i++)
-    {
-        if (m_protocols[i].id == id)
-            return m_protocols[i].protocol;
-    }
-    return NULL;
+    std::map<uint32_t, Protocol*>::const_iterator it = m_protocols_by_id.find(id);
+    if (it == m_protocols_by_id.end())
+        return NULL;
+    return it->second;
 }
 
 Protocol* ProtocolManager::getProtocol(PROTOCOL_TYPE type)
@@ -26,9 +26,11 @@
 #include "network/event.hpp"
 #include "network/network_string.hpp"
 #include "network/protocol.hpp"
+#include "utils/lock_free_queue.hpp"
 #include "utils/singleton.hpp"
 #include "utils/types.hpp"
 
+#include <map>
 #include <vector>
 
 #define TIME_TO_KEEP_EVENTS 1.0
@@ -78,6 +80,7 @@ typedef struct ProtocolRequest
 {
     PROTOCOL_REQUEST_TYPE type; //!< The type of request
     ProtocolInfo protocol_info; //!< The concerned protocol information
+    double time;                //!< When the request was queued
 } ProtocolRequest;
 
 /*! \struct ProtocolRequest
@@ -90,6 +93,19 @@ typedef struct EventProcessingInfo
     std::vector<unsigned int> protocols_ids;
 } EventProcessingInfo;
 
+/*! \struct QueueStats
+ *  \brief Statistics about one of the queues of the protocol manager, used
+ *  to measure how long events and requests wait before being processed.
+ *  Only the consumer thread of the queue updates them.
+ */
+typedef struct QueueStats
+{
+    uint32_t count;      //!< Number of elements processed
+    uint32_t max_depth;  //!< Maximum number of elements found in the queue
+    double   total_wait; //!< Sum of the time elements spent in the queue
+    double   max_wait;   //!< Maximum time an element spent in the queue
+} QueueStats;
+
 /*!
  * \class ProtocolManager
  * \brief Manages the protocols at runtime.
@@ -113,9 +129,22 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         /*!
          * \brief Function that processes incoming events.
          * This function is called by the network manager each time there is an
-         * incoming packet.
+         * incoming packet. The manager takes ownership of the event. The
+         * event is only queued (without locking), it is routed to the
+         * protocols by the protocol manager thread.
          */
         virtual void            notifyEvent(Event* event);
+        /*!
+         * \brief Returns an event for the given ENet event. Events are
+         * recycled once they are processed, so this does not allocate
+         * memory in the common case. Can be called from any thread.
+         */
+        Event*                  createEvent(ENetEvent* event);
+        /*!
+         * \brief Returns the (approximate) number of events that were
+         * notified, but not yet routed to the protocols.
+         */
+        unsigned int            getNumQueuedEvents() const;
         /*!
          * \brief WILL BE COMMENTED LATER
          */
@@ -234,6 +263,11 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         /*! \brief Tells if we need to stop the update thread. */
         int                     exit();
 
+        /*! \brief Statistics about the incoming events queue. */
+        const QueueStats&       getEventQueueStats() const   { return m_event_queue_stats;   }
+        /*! \brief Statistics about the protocol requests queue. */
+        const QueueStats&       getRequestQueueStats() const { return m_request_queue_stats; }
+
     protected:
         // protected functions
         /*!
@@ -285,6 +319,14 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         virtual void            protocolTerminated(ProtocolInfo protocol);
 
         bool                    propagateEvent(EventProcessingInfo* event, bool synchronous);
+        void                    addRequest(const ProtocolRequest& request);
+        void                    processIncomingEvents();
+        void                    processRequests();
+        void                    deleteEvent(EventProcessingInfo* event);
+        static void             updateQueueStats(QueueStats* stats, double wait, size_t depth);
+        EventProcessingInfo*    acquireEventInfo();
+        void                    releaseEventInfo(EventProcessingInfo* event);
+        void                    rebuildRoutingTable();
 
         // protected members
         /*!
@@ -294,13 +336,50 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
          */
         std::vector<ProtocolInfo>       m_protocols;
         /*!
-         * \brief Contains the network events to pass to protocols.
+         * \brief Ids of the protocols that receive messages, indexed by the
+         * protocol type (which is the first byte of a message). Kept up to
+         * date when protocols start and terminate, so that routing an event
+         * does not depend on the number of running protocols.
+         */
+        std::vector<unsigned int>       m_protocols_by_type[256];
+        /*! \brief Maps a protocol id to the protocol. */
+        std::map<uint32_t, Protocol*>   m_protocols_by_id;
+        /*!
+         * \brief Events received from the network, not yet routed.
+         * Filled by the network threads, emptied by the protocol manager
+         * thread in one batch per update.
+         */
+        LockFreeQueue<EventProcessingInfo*> m_incoming_events;
+        /*!
+         * \brief Unused EventProcessingInfo records. They are recycled to
+         * avoid allocating a record and its protocol id vector per event.
+         */
+        LockFreeQueue<EventProcessingInfo*> m_event_info_pool;
+        /*!
+         * \brief Unused events, which are recycled so that no event is
+         * allocated per packet.
          */
-        std::vector<EventProcessingInfo>             m_events_to_process;
+        LockFreeQueue<Event*> m_event_pool;
+        /*!
+         * \brief Events that still need to be processed by the synchronous
+         * notifyEvent() of some protocols. Filled by the protocol manager
+         * thread, emptied by the main thread.
+         */
+        LockFreeQueue<EventProcessingInfo*> m_synchronous_events_queue;
+        /*! \brief Events the main thread is processing. Only accessed by the
+         *  main thread. */
+        std::vector<EventProcessingInfo*>   m_synchronous_events;
+        /*! \brief Events that did not fit into m_synchronous_events_queue.
+         *  Only accessed by the protocol manager thread. */
+        std::vector<EventProcessingInfo*>   m_synchronous_events_overflow;
         /*!
          * \brief Contains the requests to start/stop etc... protocols.
          */
-        std::vector<ProtocolRequest>    m_requests;
+        LockFreeQueue<ProtocolRequest>      m_requests;
+        /*! \brief Protocols that were requested to start, but are not yet
+         *  started. Used to report them as running. Protected by m_id_mutex.
+         */
+        std::vector<ProtocolInfo>           m_pending_starts;
         /*! \brief The next id to assign to a protocol.
          * This value is incremented by 1 each time a protocol is started.
          * If a protocol has an id lower than this value, it means that it have
@@ -308,16 +387,16 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
          */
         uint32_t                        m_next_protocol_id;
 
+        QueueStats                      m_event_queue_stats;
+        QueueStats                      m_request_queue_stats;
+
         // mutexes:
-        /*! Used to ensure that the event queue is used thread-safely.       */
-        pthread_mutex_t                 m_events_mutex;
         /*! Used to ensure that the protocol vector is used thread-safely.   */
         pthread_mutex_t                 m_protocols_mutex;
         /*! Used to ensure that the protocol vector is used thread-safely.   */
         pthread_mutex_t                 m_asynchronous_protocols_mutex;
-        /*! Used to ensure that the request vector is used thread-safely.    */
-        pthread_mutex_t                 m_requests_mutex;
-        /*! Used to ensure that the protocol id is used in a thread-safe way.*/
+        /*! Used to ensure that the protocol id is used in a thread-safe way.
+         *  Also protects m_pending_starts. */
         pthread_mutex_t                 m_id_mutex;
         /*! Used when need to quit.*/
         pthread_mutex_t                 m_exit_mutex;
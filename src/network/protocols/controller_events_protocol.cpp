@@ -11,12 +11,14 @@
 ControllerEventsProtocol::ControllerEventsProtocol() :
         Protocol(NULL, PROTOCOL_CONTROLLER_EVENTS)
 {
+    pthread_mutex_init(&m_relay_mutex, NULL);
 }
 
 //-----------------------------------------------------------------------------
 
 ControllerEventsProtocol::~ControllerEventsProtocol()
 {
+    pthread_mutex_destroy(&m_relay_mutex);
 }
 
 //-----------------------------------------------------------------------------
@@ -63,67 +65,72 @@ void ControllerEventsProtocol::setup()
 
 bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
 {
-    NetworkString data = event->data();
-    if (data.size() < 17)
+    const NetworkString &data = event->data();
+    if (data.size() < 4 + INPUT_SIZE)
     {
         Log::error("ControllerEventsProtocol", "The data supplied was not complete. Size was %d.", data.size());
         return true;
     }
+    const bool is_server = m_listener->isServer();
+    // A client can only receive messages from the server, which relays the
+    // inputs with the same message to all clients, so only the server
+    // checks the token.
     uint32_t token = data.gui32();
-    NetworkString pure_message = data;
-    pure_message.removeFront(4);
-    if (token != (*event->peer)->getClientServerToken())
+    if (is_server && token != event->peer->getClientServerToken())
     {
         Log::error("ControllerEventsProtocol", "Bad token from peer.");
         return true;
     }
-    NetworkString ns = pure_message;
-
-    ns.removeFront(4);
-    uint8_t client_index = -1;
-    while (ns.size() >= 9)
-    {
-        uint8_t controller_index = ns.gui8();
-        client_index = controller_index;
-        uint8_t serialized_1 = ns.gui8(1);
-        PlayerAction action  = (PlayerAction)(ns.gui8(4));
-        int action_value = ns.gui32(5);
-
-        KartControl* controls   = m_controllers[controller_index].first->getControls();
-        controls->m_brake       = (serialized_1 & 0x40)!=0;
-        controls->m_nitro       = (serialized_1 & 0x20)!=0;
-        controls->m_rescue      = (serialized_1 & 0x10)!=0;
-        controls->m_fire        = (serialized_1 & 0x08)!=0;
-        controls->m_look_back   = (serialized_1 & 0x04)!=0;
-        controls->m_skid        = KartControl::SkidControl(serialized_1 & 0x03);
-
-        m_controllers[controller_index].first->action(action, action_value);
-        ns.removeFront(9);
-        //Log::info("ControllerEventProtocol", "Registered one action.");
-    }
-    if (ns.size() > 0 && ns.size() != 9)
+    if ((data.size() - 4) % INPUT_SIZE != 0)
     {
-        Log::warn("ControllerEventProtocol", "The data seems corrupted. Remains %d", ns.size());
+        Log::warn("ControllerEventProtocol", "The data seems corrupted. Size was %d", data.size());
         return true;
     }
-    if (client_index < 0)
-    {
-        Log::warn("ControllerEventProtocol", "Couldn't have a client id.");
-        return true;
-    }
-    if (m_listener->isServer())
+
+    // The inputs are applied by the main thread in the tick they were
+    // made in (see RewindManager)
+    RewindManager *rewind_manager =
+        NetworkWorld::getInstance()->getRewindManager();
+    for (int offset = 4; offset < data.size(); offset += INPUT_SIZE)
     {
-        // notify everybody of the event :
-        for (unsigned int i = 0; i < m_controllers.size(); i++)
+        uint8_t controller_index = data.gui8(offset + 4);
+        if (controller_index >= m_controllers.size())
         {
-            if (i == client_index) // don't send that message to the sender
-                continue;
-            NetworkString ns2;
-            ns2.ai32(m_controllers[i].second->getClientServerToken());
-            ns2 += pure_message;
-            m_listener->sendMessage(this, m_controllers[i].second, ns2, false);
-            //Log::info("ControllerEventsProtocol", "Sizes are %d and %d", ns2.size(), pure_message.size());
+            Log::warn("ControllerEventProtocol", "Invalid controller %d.",
+                      controller_index);
+            return true;
         }
+        // The server also sends the inputs back to the client they came from
+        if (!is_server && controller_index == m_self_controller_index)
+            continue;
+        uint8_t serialized_1 = data.gui8(offset + 5);
+
+        RewindManager::KartInput input;
+        input.m_tick                = data.gui32(offset);
+        input.m_controls.m_steer    = (int8_t)data.gui8(offset + 7)/127.0f;
+        input.m_controls.m_accel    = data.gui8(offset + 6)/255.0f;
+        input.m_controls.m_brake    = (serialized_1 & 0x40)!=0;
+        input.m_controls.m_nitro    = (serialized_1 & 0x20)!=0;
+        input.m_controls.m_rescue   = (serialized_1 & 0x10)!=0;
+        input.m_controls.m_fire     = (serialized_1 & 0x08)!=0;
+        input.m_controls.m_look_back= (serialized_1 & 0x04)!=0;
+        input.m_controls.m_skid     = KartControl::SkidControl(serialized_1 & 0x03);
+        input.m_action              = (PlayerAction)(data.gui8(offset + 8));
+        input.m_value               = data.gui32(offset + 9);
+        input.m_applied             = false;
+        rewind_manager->addInput(controller_index, input);
+        //Log::info("ControllerEventProtocol", "Registered one action.");
+    }
+
+    if (is_server)
+    {
+        // The inputs are sent to everybody in one message per tick (see
+        // update()), instead of one copy per client.
+        pthread_mutex_lock(&m_relay_mutex);
+        m_relayed_inputs.insert(m_relayed_inputs.end(),
+                                data.getBytes() + 4,
+                                data.getBytes() + data.size());
+        pthread_mutex_unlock(&m_relay_mutex);
     }
     return true;
 }
@@ -132,6 +139,22 @@ bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
 
 void ControllerEventsProtocol::update()
 {
+    if (!m_listener->isServer())
+        return;
+    pthread_mutex_lock(&m_relay_mutex);
+    if (m_relayed_inputs.empty())
+    {
+        pthread_mutex_unlock(&m_relay_mutex);
+        return;
+    }
+    NetworkString ns;
+    ns.reserve(4 + m_relayed_inputs.size());
+    ns.ai32(0); // no token, see notifyEventAsynchronous
+    ns += NetworkString::wrap(&m_relayed_inputs[0], m_relayed_inputs.size());
+    m_relayed_inputs.clear();
+    pthread_mutex_unlock(&m_relay_mutex);
+    // One packet shared by all clients
+    m_listener->sendMessage(this, ns, false);
 }
 
 //-----------------------------------------------------------------------------
@@ -155,11 +178,11 @@ void ControllerEventsProtocol::controllerAction(Controller* controller,
     serialized_1 <<= 2;
     serialized_1 += controls->m_skid;
     uint8_t serialized_2 = (uint8_t)(controls->m_accel*255.0);
-    uint8_t serialized_3 = (uint8_t)(controls->m_steer*127.0);
+    uint8_t serialized_3 = (uint8_t)(int8_t)(controls->m_steer*127.0);
 
     NetworkString ns;
     ns.ai32(m_controllers[m_self_controller_index].second->getClientServerToken());
-    ns.af(World::getWorld()->getTime());
+    ns.ai32(NetworkWorld::getInstance()->getTick());
     ns.ai8(m_self_controller_index);
     ns.ai8(serialized_1).ai8(serialized_2).ai8(serialized_3);
     ns.ai8((uint8_t)(action)).ai32(value);
@@ -6,12 +6,30 @@
 #include "input/input.hpp"
 #include "karts/controller/controller.hpp"
 
+#include <pthread.h>
+
+/** \class ControllerEventsProtocol
+ *  \brief Sends the inputs of the local kart to the server, which relays
+ *  them to all clients.
+ *  A message is a token followed by one or more inputs of INPUT_SIZE bytes
+ *  (tick, kart, controls, action and value). The server collects all inputs
+ *  received during a tick and broadcasts them in one message, without a
+ *  token, so the same packet is shared by all clients.
+ */
 class ControllerEventsProtocol : public Protocol
 {
     protected:
+        /** Size of one serialised input. */
+        static const int INPUT_SIZE = 13;
+
         std::vector<std::pair<Controller*, STKPeer*> > m_controllers;
         uint32_t m_self_controller_index;
 
+        /** Server: inputs received since the last update(), which are sent
+         *  to all clients. Protected by m_relay_mutex. */
+        std::vector<uint8_t> m_relayed_inputs;
+        pthread_mutex_t m_relay_mutex;
+
     public:
         ControllerEventsProtocol();
         virtual ~ControllerEventsProtocol();
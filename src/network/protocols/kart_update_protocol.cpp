@@ -1,9 +1,13 @@
 #include "network/protocols/kart_update_protocol.hpp"
 
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
 #include "modes/world.hpp"
+#include "network/bit_buffer.hpp"
+#include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/network_world.hpp"
+#include "tracks/track.hpp"
 #include "utils/time.hpp"
 
 KartUpdateProtocol::KartUpdateProtocol()
@@ -23,6 +27,15 @@ KartUpdateProtocol::KartUpdateProtocol()
         }
     }
     pthread_mutex_init(&m_positions_updates_mutex, NULL);
+
+    // Server and clients must use the same quantisation box
+    const Vec3 *min, *max;
+    World::getWorld()->getTrack()->getAABB(&min, &max);
+    KartSnapshot::setBounds(*min, *max);
+
+    m_next_sequence          = 0;
+    m_last_received_sequence = KartSnapshot::NO_SEQUENCE;
+    m_last_send_time         = 0;
 }
 
 KartUpdateProtocol::~KartUpdateProtocol()
@@ -31,35 +44,128 @@ KartUpdateProtocol::~KartUpdateProtocol()
 
 bool KartUpdateProtocol::notifyEventAsynchronous(Event* event)
 {
+    if (event->type == EVENT_TYPE_DISCONNECTED)
+    {
+        // The peer object is deleted, so forget its acknowledgement (the
+        // address could be reused for a new peer).
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        m_peer_acks.erase(event->peer);
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+        return true;
+    }
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
     NetworkString ns = event->data();
-    if (ns.size() < 36)
+    if (ns.size() < 4)
     {
         Log::info("KartUpdateProtocol", "Message too short.");
         return true;
     }
-    ns.removeFront(4);
-    while(ns.size() >= 16)
+    if (m_listener->isServer())
     {
-        uint32_t kart_id = ns.getUInt32(0);
-
-        float a,b,c;
-        a = ns.getFloat(4);
-        b = ns.getFloat(8);
-        c = ns.getFloat(12);
-        float d,e,f,g;
-        d = ns.getFloat(16);
-        e = ns.getFloat(20);
-        f = ns.getFloat(24);
-        g = ns.getFloat(28);
-        pthread_mutex_trylock(&m_positions_updates_mutex);
-        m_next_positions.push_back(Vec3(a,b,c));
-        m_next_quaternions.push_back(btQuaternion(d,e,f,g));
-        m_karts_ids.push_back(kart_id);
+        // Client message: acknowledged sequence, kart id, full kart state
+        uint16_t ack     = ns.getUInt16(0);
+        uint8_t  kart_id = ns.getUInt8(2);
+        ns.removeFront(3);
+        KartSnapshot snapshot(KartSnapshot::NO_SEQUENCE, 1);
+        BitReader reader(ns);
+        if (kart_id >= m_karts.size() || !snapshot.decode(&reader, NULL))
+        {
+            Log::warn("KartUpdateProtocol", "Invalid kart state received.");
+            return true;
+        }
+        Vec3 xyz;
+        btQuaternion q;
+        snapshot.getKart(0, &xyz, &q);
+        // With rollback the server is authoritative, the client state is
+        // only used as acknowledgement.
+        const bool use_state = !UserConfigParams::m_network_rollback;
+
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        if (ack != KartSnapshot::NO_SEQUENCE)
+        {
+            STKPeer *peer = event->peer;
+            std::map<STKPeer*, uint16_t>::iterator it = m_peer_acks.find(peer);
+            if (it == m_peer_acks.end() ||
+                it->second == KartSnapshot::NO_SEQUENCE ||
+                KartSnapshot::isNewer(ack, it->second))
+                m_peer_acks[peer] = ack;
+        }
+        if (use_state)
+        {
+            m_next_positions.push_back(xyz);
+            m_next_quaternions.push_back(q);
+            m_karts_ids.push_back(kart_id);
+        }
         pthread_mutex_unlock(&m_positions_updates_mutex);
-        ns.removeFront(32);
+        return true;
     }
+
+    // Server message: sequence, baseline sequence, tick, snapshot
+    if (ns.size() < 8)
+    {
+        Log::info("KartUpdateProtocol", "Message too short.");
+        return true;
+    }
+    uint16_t sequence = ns.getUInt16(0);
+    uint16_t baseline_sequence = ns.getUInt16(2);
+    uint32_t tick = ns.getUInt32(4);
+    ns.removeFront(8);
+
+    const KartSnapshot *baseline = NULL;
+    if (baseline_sequence != KartSnapshot::NO_SEQUENCE)
+    {
+        baseline = m_history.get(baseline_sequence);
+        // We don't have the baseline anymore, wait till the server notices
+        // that our acknowledgement is too old and sends a full snapshot.
+        if (!baseline)
+            return true;
+    }
+    KartSnapshot snapshot(sequence, m_karts.size());
+    BitReader reader(ns);
+    if (!snapshot.decode(&reader, baseline))
+    {
+        Log::warn("KartUpdateProtocol", "Invalid snapshot received.");
+        return true;
+    }
+    m_history.add(snapshot);
+
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    // Ignore snapshots that arrive out of order
+    if (m_last_received_sequence != KartSnapshot::NO_SEQUENCE &&
+        !KartSnapshot::isNewer(sequence, m_last_received_sequence))
+    {
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+        return true;
+    }
+    m_last_received_sequence = sequence;
+    if (UserConfigParams::m_network_rollback)
+    {
+        // The client reconciles its prediction with the server state of
+        // that tick (see RewindManager)
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+        std::vector<btTransform> transforms(m_karts.size());
+        for (unsigned int i = 0; i < m_karts.size(); i++)
+        {
+            Vec3 xyz;
+            btQuaternion q;
+            snapshot.getKart(i, &xyz, &q);
+            transforms[i] = btTransform(q, xyz);
+        }
+        NetworkWorld::getInstance()->getRewindManager()
+                                   ->addServerState(tick, transforms);
+        return true;
+    }
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        Vec3 xyz;
+        btQuaternion q;
+        snapshot.getKart(i, &xyz, &q);
+        m_next_positions.push_back(xyz);
+        m_next_quaternions.push_back(q);
+        m_karts_ids.push_back(i);
+    }
+    pthread_mutex_unlock(&m_positions_updates_mutex);
     return true;
 }
 
@@ -67,64 +173,105 @@ void KartUpdateProtocol::setup()
 {
 }
 
+/** Sends the current state of all karts to each peer, delta encoded against
+ *  the last snapshot the peer acknowledged.
+ */
+void KartUpdateProtocol::sendServerSnapshots()
+{
+    KartSnapshot snapshot(m_next_sequence, m_karts.size());
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        AbstractKart* kart = m_karts[i];
+        snapshot.setKart(i, kart->getXYZ(), kart->getRotation());
+    }
+    m_history.add(snapshot);
+    m_next_sequence++;
+    if (m_next_sequence == KartSnapshot::NO_SEQUENCE)
+        m_next_sequence = 0;
+
+    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        uint16_t ack = KartSnapshot::NO_SEQUENCE;
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        std::map<STKPeer*, uint16_t>::iterator it = m_peer_acks.find(peers[i]);
+        if (it != m_peer_acks.end())
+            ack = it->second;
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+
+        const KartSnapshot *baseline = m_history.get(ack);
+        NetworkString ns;
+        // Worst case size, avoids any reallocation while writing bits
+        ns.reserve(8 + m_karts.size()*16);
+        ns.ai16(snapshot.getSequence());
+        ns.ai16(baseline ? ack : KartSnapshot::NO_SEQUENCE);
+        // The state is the one after the last simulated tick
+        ns.ai32(NetworkWorld::getInstance()->getTick() - 1);
+        BitWriter writer(&ns);
+        snapshot.encode(&writer, baseline);
+        writer.flush();
+        m_listener->sendMessage(this, peers[i], ns, false);
+    }
+}
+
+/** Sends the state of the local kart to the server, and acknowledges the
+ *  last snapshot received.
+ */
+void KartUpdateProtocol::sendClientState()
+{
+    AbstractKart* kart = m_karts[m_self_kart_index];
+    KartSnapshot snapshot(KartSnapshot::NO_SEQUENCE, 1);
+    snapshot.setKart(0, kart->getXYZ(), kart->getRotation());
+
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    uint16_t ack = m_last_received_sequence;
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+
+    NetworkString ns;
+    ns.reserve(3 + 16);
+    ns.ai16(ack).ai8(kart->getWorldKartId());
+    BitWriter writer(&ns);
+    snapshot.encode(&writer, NULL);
+    writer.flush();
+    Log::verbose("KartUpdateProtocol", "Sending %d's state, %d bytes",
+                 kart->getWorldKartId(), ns.size());
+    m_listener->sendMessage(this, ns, false);
+}
+
 void KartUpdateProtocol::update()
 {
     if (!World::getWorld())
         return;
-    static double time = 0;
     double current_time = StkTime::getRealTime();
-    if (current_time > time + 0.1) // 10 updates per second
+    int frequency = UserConfigParams::m_network_state_frequency;
+    if (frequency < 1) frequency = 1;
+    if (current_time > m_last_send_time + 1.0/frequency)
     {
-        time = current_time;
+        m_last_send_time = current_time;
         if (m_listener->isServer())
-        {
-            NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            for (unsigned int i = 0; i < m_karts.size(); i++)
-            {
-                AbstractKart* kart = m_karts[i];
-                Vec3 v = kart->getXYZ();
-                btQuaternion quat = kart->getRotation();
-                ns.ai32( kart->getWorldKartId());
-                ns.af(v[0]).af(v[1]).af(v[2]); // add position
-                ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-                Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
-            }
-            m_listener->sendMessage(this, ns, false);
-        }
+            sendServerSnapshots();
         else
-        {
-            AbstractKart* kart = m_karts[m_self_kart_index];
-            Vec3 v = kart->getXYZ();
-            btQuaternion quat = kart->getRotation();
-            NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            ns.ai32( kart->getWorldKartId());
-            ns.af(v[0]).af(v[1]).af(v[2]); // add position
-            ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-            Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
-            m_listener->sendMessage(this, ns, false);
-        }
+            sendClientState();
     }
     switch(pthread_mutex_trylock(&m_positions_updates_mutex))
     {
         case 0: /* if we got the lock */
+            // Apply in arrival order, so that the newest state wins
             while (!m_next_positions.empty())
             {
-                uint32_t id = m_karts_ids.back();
+                uint32_t id = m_karts_ids.front();
                 if (id != m_self_kart_index || m_listener->isServer()) // server takes all updates
                 {
-                    Vec3 pos = m_next_positions.back();
+                    Vec3 pos = m_next_positions.front();
                     btTransform transform = m_karts[id]->getBody()->getInterpolationWorldTransform();
                     transform.setOrigin(pos);
-                    transform.setRotation(m_next_quaternions.back());
+                    transform.setRotation(m_next_quaternions.front());
                     m_karts[id]->getBody()->setCenterOfMassTransform(transform);
-                    //m_karts[id]->getBody()->setLinearVelocity(Vec3(0,0,0));
                     Log::verbose("KartUpdateProtocol", "Update kart %i pos to %f %f %f", id, pos[0], pos[1], pos[2]);
                 }
-                m_next_positions.pop_back();
-                m_next_quaternions.pop_back();
-                m_karts_ids.pop_back();
+                m_next_positions.pop_front();
+                m_next_quaternions.pop_front();
+                m_karts_ids.pop_front();
             }
             pthread_mutex_unlock(&m_positions_updates_mutex);
             break;
@@ -132,7 +279,3 @@ void KartUpdateProtocol::update()
             break;
     }
 }
-
-
-
-
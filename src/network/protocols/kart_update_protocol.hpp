@@ -2,12 +2,25 @@
 #define KART_UPDATE_PROTOCOL_HPP
 
 #include "network/protocol.hpp"
+#include "network/kart_snapshot.hpp"
 #include "utils/vec3.hpp"
 #include "LinearMath/btQuaternion.h"
 #include <list>
+#include <map>
 
 class AbstractKart;
+class STKPeer;
 
+/** \class KartUpdateProtocol
+ *  \brief Synchronises the position and rotation of all karts.
+ *  The server regularly sends a KartSnapshot to each client, delta encoded
+ *  against the last snapshot this client has acknowledged. Each client
+ *  sends the state of its own kart, together with the sequence number of
+ *  the last snapshot it received (which is its acknowledgement).
+ *  In rollback mode (see RewindManager) the server ignores the client
+ *  states, and the clients reconcile their prediction with the snapshots,
+ *  which contain the tick of the state.
+ */
 class KartUpdateProtocol : public Protocol
 {
     public:
@@ -20,6 +33,9 @@ class KartUpdateProtocol : public Protocol
         virtual void asynchronousUpdate() {};
 
     protected:
+        void sendServerSnapshots();
+        void sendClientState();
+
         std::vector<AbstractKart*> m_karts;
         uint32_t m_self_kart_index;
 
@@ -28,6 +44,21 @@ class KartUpdateProtocol : public Protocol
         std::list<uint32_t> m_karts_ids;
 
         pthread_mutex_t m_positions_updates_mutex;
+
+        /** Server: the snapshots sent recently. Client: the snapshots
+         *  received recently. In both cases they are used as baselines. */
+        KartSnapshotHistory m_history;
+        /** Server: sequence number of the next snapshot to send. */
+        uint16_t m_next_sequence;
+        /** Server: the last snapshot acknowledged by each peer. An entry
+         *  is removed when its peer disconnects. Protected by
+         *  m_positions_updates_mutex. */
+        std::map<STKPeer*, uint16_t> m_peer_acks;
+        /** Client: most recent snapshot received, which is acknowledged to
+         *  the server. Protected by m_positions_updates_mutex. */
+        uint16_t m_last_received_sequence;
+        /** Time at which the last update was sent. */
+        double m_last_send_time;
 };
 
 #endif // KART_UPDATE_PROTOCOL_HPP
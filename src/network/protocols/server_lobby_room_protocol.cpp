@@ -57,6 +57,10 @@ void ServerLobbyRoomProtocol::setup()
     m_public_address.port = 0;
     m_selection_enabled = false;
     m_in_race = false;
+    // When replaying a packet capture there is no network: the server is
+    // neither published nor polled for connection requests.
+    if (UserConfigParams::m_packets_replay_filename.size() > 0)
+        m_state = WORKING;
     Log::info("ServerLobbyRoomProtocol", "Starting the protocol.");
 }
 
@@ -67,7 +71,7 @@ bool ServerLobbyRoomProtocol::notifyEventAsynchronous(Event* event)
     assert(m_setup); // assert that the setup exists
     if (event->type == EVENT_TYPE_MESSAGE)
     {
-        NetworkString data = event->data();
+        const NetworkString &data = event->data();
         assert(data.size()); // message not empty
         uint8_t message_type;
         message_type = data[0];
@@ -128,7 +132,8 @@ void ServerLobbyRoomProtocol::update()
         break;
     case WORKING:
     {
-        checkIncomingConnectionRequests();
+        if (UserConfigParams::m_packets_replay_filename.size() == 0)
+            checkIncomingConnectionRequests();
         if (m_in_race && World::getWorld() && NetworkWorld::getInstance<NetworkWorld>()->isRunning())
             checkRaceFinished();
 
@@ -307,7 +312,7 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
 
 void ServerLobbyRoomProtocol::kartDisconnected(Event* event)
 {
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     if (peer->getPlayerProfile() != NULL) // others knew him
     {
         NetworkString msg;
@@ -336,8 +341,8 @@ void ServerLobbyRoomProtocol::kartDisconnected(Event* event)
  */
 void ServerLobbyRoomProtocol::connectionRequested(Event* event)
 {
-    STKPeer* peer = *(event->peer);
-    NetworkString data = event->data();
+    STKPeer* peer = event->peer;
+    const NetworkString &data = event->data();
     if (data.size() != 5 || data[0] != 4)
     {
         Log::warn("ServerLobbyRoomProtocol", "Receiving badly formated message. Size is %d and first byte %d", data.size(), data[0]);
@@ -415,8 +420,8 @@ void ServerLobbyRoomProtocol::connectionRequested(Event* event)
  */
 void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
 {
-    NetworkString data = event->data();
-    STKPeer* peer = *(event->peer);
+    const NetworkString &data = event->data();
+    STKPeer* peer = event->peer;
     if (!checkDataSizeAndToken(event, 6))
         return;
 
@@ -477,7 +482,7 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
 void ServerLobbyRoomProtocol::playerMajorVote(Event* event)
 {
     NetworkString data = event->data();
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     if (!checkDataSizeAndToken(event, 7))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -508,7 +513,7 @@ void ServerLobbyRoomProtocol::playerMajorVote(Event* event)
 void ServerLobbyRoomProtocol::playerRaceCountVote(Event* event)
 {
     NetworkString data = event->data();
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     if (!checkDataSizeAndToken(event, 7))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -539,7 +544,7 @@ void ServerLobbyRoomProtocol::playerRaceCountVote(Event* event)
 void ServerLobbyRoomProtocol::playerMinorVote(Event* event)
 {
     NetworkString data = event->data();
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     if (!checkDataSizeAndToken(event, 7))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -570,7 +575,7 @@ void ServerLobbyRoomProtocol::playerMinorVote(Event* event)
 void ServerLobbyRoomProtocol::playerTrackVote(Event* event)
 {
     NetworkString data = event->data();
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     if (!checkDataSizeAndToken(event, 8))
         return;
     int N = data[5];
@@ -603,7 +608,7 @@ void ServerLobbyRoomProtocol::playerTrackVote(Event* event)
 void ServerLobbyRoomProtocol::playerReversedVote(Event* event)
 {
     NetworkString data = event->data();
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     if (!checkDataSizeAndToken(event, 9))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -636,7 +641,7 @@ void ServerLobbyRoomProtocol::playerReversedVote(Event* event)
 void ServerLobbyRoomProtocol::playerLapsVote(Event* event)
 {
     NetworkString data = event->data();
-    STKPeer* peer = *(event->peer);
+    STKPeer* peer = event->peer;
     if (!checkDataSizeAndToken(event, 9))
         return;
     if (!isByteCorrect(event, 5, 1))
@@ -36,7 +36,7 @@ StartGameProtocol::~StartGameProtocol()
 
 bool StartGameProtocol::notifyEventAsynchronous(Event* event)
 {
-    NetworkString data = event->data();
+    const NetworkString &data = event->data();
     if (data.size() < 5)
     {
         Log::error("StartGameProtocol", "Too short message.");
@@ -44,7 +44,7 @@ bool StartGameProtocol::notifyEventAsynchronous(Event* event)
     }
     uint32_t token = data.gui32();
     uint8_t ready = data.gui8(4);
-    STKPeer* peer = (*(event->peer));
+    STKPeer* peer = event->peer;
     if (peer->getClientServerToken() != token)
     {
         Log::error("StartGameProtocol", "Bad token received.");
@@ -35,7 +35,7 @@ bool SynchronizationProtocol::notifyEventAsynchronous(Event* event)
 {
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
-    NetworkString data = event->data();
+    const NetworkString &data = event->data();
     if (data.size() < 10)
     {
         Log::warn("SynchronizationProtocol", "Received a message too short.");
@@ -60,7 +60,7 @@ bool SynchronizationProtocol::notifyEventAsynchronous(Event* event)
     uint8_t peer_id;
     for (unsigned int i = 0; i < peers.size(); i++)
     {
-        if (peers[i]->isSamePeer(*event->peer))
+        if (peers[i]->isSamePeer(event->peer))
         {
             peer_id = i;
         }
@@ -0,0 +1,407 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "network/rewind_manager.hpp"
+
+#include "config/user_config.hpp"
+#include "karts/abstract_kart.hpp"
+#include "karts/controller/controller.hpp"
+#include "modes/world.hpp"
+#include "network/network_manager.hpp"
+#include "physics/physics.hpp"
+#include "physics/stk_dynamics_world.hpp"
+#include "physics/user_pointer.hpp"
+#include "utils/log.hpp"
+
+/** A server state is only reconciled with the prediction if a kart is off
+ *  by more than this distance (in m). */
+static const float MAX_PREDICTION_ERROR = 0.05f;
+
+RewindManager::RewindManager()
+{
+    m_has_server_state      = false;
+    m_num_rewinds           = 0;
+    m_num_resimulated_ticks = 0;
+}   // RewindManager
+
+// ----------------------------------------------------------------------------
+RewindManager::~RewindManager()
+{
+}   // ~RewindManager
+
+// ----------------------------------------------------------------------------
+/** Removes all inputs and states, called when an online race starts. */
+void RewindManager::reset()
+{
+    m_states.clear();
+    m_inputs.clear();
+    m_pending_inputs.lock();
+    m_pending_inputs.getData().clear();
+    m_pending_inputs.unlock();
+    m_server_state.lock();
+    m_has_server_state = false;
+    m_server_state.unlock();
+    m_num_rewinds           = 0;
+    m_num_resimulated_ticks = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+void RewindManager::init()
+{
+    int num_ticks = UserConfigParams::m_network_rewind_ticks;
+    if (num_ticks < 1) num_ticks = 1;
+    const unsigned int num_karts = World::getWorld()->getNumKarts();
+    // One more state than ticks, since a rewind starts with the state
+    // before the first re-simulated tick.
+    m_states.resize(num_ticks + 1);
+    for (unsigned int i = 0; i < m_states.size(); i++)
+    {
+        m_states[i].m_valid = false;
+        m_states[i].m_karts.resize(num_karts);
+    }
+    m_inputs.resize(num_karts);
+}   // init
+
+// ----------------------------------------------------------------------------
+/** Queues an input of a kart. Called by the network thread, the input is
+ *  applied (or triggers a rewind) in the next update().
+ */
+void RewindManager::addInput(unsigned int kart_id, const KartInput &input)
+{
+    m_pending_inputs.lock();
+    m_pending_inputs.getData().push_back(std::make_pair(kart_id, input));
+    m_pending_inputs.unlock();
+}   // addInput
+
+// ----------------------------------------------------------------------------
+/** Stores a state of all karts received from the server. Called by the
+ *  network thread of a client; only the newest state is kept.
+ */
+void RewindManager::addServerState(uint32_t tick,
+                                   const std::vector<btTransform> &transforms)
+{
+    m_server_state.lock();
+    m_server_state.getData().m_tick       = tick;
+    m_server_state.getData().m_transforms = transforms;
+    m_has_server_state = true;
+    m_server_state.unlock();
+}   // addServerState
+
+// ----------------------------------------------------------------------------
+/** Returns the stored state after a tick, or NULL if it is not stored
+ *  (anymore). */
+RewindManager::TickState* RewindManager::getState(uint32_t tick)
+{
+    if (m_states.empty())
+        return NULL;
+    TickState &state = m_states[tick % m_states.size()];
+    return state.m_valid && state.m_tick == tick ? &state : NULL;
+}   // getState
+
+// ----------------------------------------------------------------------------
+/** Returns the input of a kart that is active in a tick, i.e. the last one
+ *  with a tick not after the given tick, or NULL if there is none. */
+const RewindManager::KartInput* RewindManager::getInput(unsigned int kart_id,
+                                                        uint32_t tick) const
+{
+    const std::deque<KartInput> &inputs = m_inputs[kart_id];
+    for (unsigned int i = inputs.size(); i > 0; i--)
+    {
+        if (inputs[i-1].m_tick <= tick)
+            return &inputs[i-1];
+    }
+    return NULL;
+}   // getInput
+
+// ----------------------------------------------------------------------------
+/** Called before the world is updated for a tick. Adds the queued inputs
+ *  and server state, rewinds if necessary, and applies the inputs of this
+ *  tick to the karts.
+ *  \param tick The tick that is simulated next.
+ *  \param dt Time step of a tick.
+ */
+void RewindManager::update(uint32_t tick, float dt)
+{
+    if (m_states.empty())
+        init();
+    const bool rollback = UserConfigParams::m_network_rollback;
+    const unsigned int num_karts = m_inputs.size();
+
+    std::vector<std::pair<unsigned int, KartInput> > inputs;
+    m_pending_inputs.lock();
+    inputs.swap(m_pending_inputs.getData());
+    m_pending_inputs.unlock();
+
+    // The first tick that has to be simulated again
+    uint32_t rewind_tick = tick;
+    std::vector<bool> late(num_karts, false);
+    for (unsigned int i = 0; i < inputs.size(); i++)
+    {
+        const unsigned int kart_id = inputs[i].first;
+        KartInput &input = inputs[i].second;
+        if (kart_id >= num_karts)
+        {
+            Log::warn("RewindManager", "Input for invalid kart %d.", kart_id);
+            continue;
+        }
+        if (input.m_tick < tick)
+        {
+            // An input older than all stored states can only be applied now
+            if (!rollback || !getState(input.m_tick - 1))
+                input.m_tick = tick;
+            else
+            {
+                late[kart_id] = true;
+                if (input.m_tick < rewind_tick)
+                    rewind_tick = input.m_tick;
+            }
+        }
+        // Keep the inputs sorted, after inputs with the same tick
+        std::deque<KartInput> &buffer = m_inputs[kart_id];
+        std::deque<KartInput>::iterator it = buffer.end();
+        while (it != buffer.begin() && (it - 1)->m_tick > input.m_tick)
+            it--;
+        buffer.insert(it, input);
+    }
+
+    if (rollback && !NetworkManager::getInstance()->isServer())
+        applyServerState(tick, &rewind_tick);
+
+    if (rewind_tick < tick)
+        rewind(rewind_tick, tick, dt, late);
+
+    World *world = World::getWorld();
+    const uint32_t oldest = tick >= m_states.size() ? tick - m_states.size()
+                                                    : 0;
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        AbstractKart *kart = world->getKart(k);
+        std::deque<KartInput> &buffer = m_inputs[k];
+        for (unsigned int i = 0; i < buffer.size(); i++)
+        {
+            KartInput &input = buffer[i];
+            if (input.m_tick > tick)
+                break;
+            if (input.m_applied)
+                continue;
+            kart->getControls() = input.m_controls;
+            kart->getController()->action(input.m_action, input.m_value);
+            input.m_applied = true;
+        }
+        // Drop the inputs that can not be needed by a rewind anymore, but
+        // keep the one that is active in the oldest stored tick.
+        while (buffer.size() > 1 && buffer[0].m_applied &&
+               buffer[1].m_tick <= oldest)
+            buffer.pop_front();
+    }
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Handles the newest server state on a client. If it is different from the
+ *  state predicted for its tick, the predicted state is replaced so that
+ *  the following ticks are re-simulated. If there is no prediction for the
+ *  tick, all karts except the local ones are moved to the server state.
+ *  \param tick The tick that is simulated next.
+ *  \param rewind_tick The first tick to re-simulate, updated if necessary.
+ */
+void RewindManager::applyServerState(uint32_t tick, uint32_t *rewind_tick)
+{
+    ServerState server_state;
+    m_server_state.lock();
+    bool has_state = m_has_server_state;
+    if (has_state)
+        server_state = m_server_state.getData();
+    m_has_server_state = false;
+    m_server_state.unlock();
+
+    const std::vector<btTransform> &transforms = server_state.m_transforms;
+    if (!has_state || transforms.size() != m_inputs.size())
+        return;
+
+    World *world = World::getWorld();
+    TickState *state = server_state.m_tick < tick
+                     ? getState(server_state.m_tick) : NULL;
+    if (!state)
+    {
+        for (unsigned int k = 0; k < transforms.size(); k++)
+        {
+            AbstractKart *kart = world->getKart(k);
+            if (kart->getController()->isPlayerController() ||
+                kart->getKartAnimation())
+                continue;
+            kart->getBody()->setCenterOfMassTransform(transforms[k]);
+        }
+        return;
+    }
+
+    bool mispredicted = false;
+    for (unsigned int k = 0; k < transforms.size(); k++)
+    {
+        const btTransform &predicted = state->m_karts[k].m_transform;
+        if ((predicted.getOrigin() - transforms[k].getOrigin()).length2() >
+            MAX_PREDICTION_ERROR*MAX_PREDICTION_ERROR)
+        {
+            mispredicted = true;
+            break;
+        }
+    }
+    if (!mispredicted)
+        return;
+
+    // The snapshots do not contain velocities, so the predicted ones are
+    // kept.
+    for (unsigned int k = 0; k < transforms.size(); k++)
+        state->m_karts[k].m_transform = transforms[k];
+    if (server_state.m_tick + 1 < *rewind_tick)
+        *rewind_tick = server_state.m_tick + 1;
+}   // applyServerState
+
+// ----------------------------------------------------------------------------
+/** Sets the controls of a kart for re-simulating a tick. A kart with a late
+ *  input uses the buffered inputs, all other karts the controls they had
+ *  when the tick was simulated.
+ */
+void RewindManager::setControls(unsigned int kart_id, uint32_t tick,
+                                bool late)
+{
+    AbstractKart *kart = World::getWorld()->getKart(kart_id);
+    const KartInput *input = late ? getInput(kart_id, tick) : NULL;
+    if (input)
+    {
+        kart->getControls() = input->m_controls;
+        return;
+    }
+    const TickState *state = getState(tick);
+    if (state)
+        kart->getControls() = state->m_karts[kart_id].m_controls;
+}   // setControls
+
+// ----------------------------------------------------------------------------
+/** Rewinds the karts to the state before first_tick, and re-simulates their
+ *  physics up to (but not including) tick. Karts that are eliminated or
+ *  in an animation (rescue, explosion, ...) are not rewound.
+ */
+void RewindManager::rewind(uint32_t first_tick, uint32_t tick, float dt,
+                           const std::vector<bool> &late)
+{
+    const TickState *start = getState(first_tick - 1);
+    if (!start)
+        return;
+
+    World *world = World::getWorld();
+    const unsigned int num_karts = world->getNumKarts();
+    saveOtherBodies();
+
+    // Restore the state, and the engine forces and steering (which are
+    // applied by the next physics step) from the controls of that tick.
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        AbstractKart *kart = world->getKart(k);
+        if (kart->isEliminated() || kart->getKartAnimation())
+            continue;
+        const KartState &state = start->m_karts[k];
+        btRigidBody *body = kart->getBody();
+        body->setCenterOfMassTransform(state.m_transform);
+        body->setLinearVelocity(state.m_linear_velocity);
+        body->setAngularVelocity(state.m_angular_velocity);
+        setControls(k, first_tick - 1, late[k]);
+        kart->updatePhysics(dt);
+    }
+
+    for (uint32_t t = first_tick; t < tick; t++)
+    {
+        world->getPhysics()->resimulate(dt);
+        for (unsigned int k = 0; k < num_karts; k++)
+        {
+            AbstractKart *kart = world->getKart(k);
+            if (kart->isEliminated() || kart->getKartAnimation())
+                continue;
+            setControls(k, t, late[k]);
+            kart->updatePhysics(dt);
+        }
+        saveState(t);
+    }
+
+    restoreOtherBodies();
+    m_num_rewinds++;
+    m_num_resimulated_ticks += tick - first_tick;
+    Log::verbose("RewindManager", "Re-simulated ticks %d to %d.",
+                 first_tick, tick - 1);
+}   // rewind
+
+// ----------------------------------------------------------------------------
+/** Stores the state of all karts after a tick. */
+void RewindManager::saveState(uint32_t tick)
+{
+    if (m_states.empty())
+        init();
+    TickState &state = m_states[tick % m_states.size()];
+    state.m_tick  = tick;
+    state.m_valid = true;
+    World *world = World::getWorld();
+    for (unsigned int k = 0; k < state.m_karts.size(); k++)
+    {
+        AbstractKart *kart = world->getKart(k);
+        const btRigidBody *body = kart->getBody();
+        KartState &kart_state = state.m_karts[k];
+        kart_state.m_transform        = body->getCenterOfMassTransform();
+        kart_state.m_linear_velocity  = body->getLinearVelocity();
+        kart_state.m_angular_velocity = body->getAngularVelocity();
+        kart_state.m_controls         = kart->getControls();
+    }
+}   // saveState
+
+// ----------------------------------------------------------------------------
+/** Stores the state of all dynamic bodies except the karts, which keep
+ *  their current state while the karts are re-simulated. */
+void RewindManager::saveOtherBodies()
+{
+    m_other_bodies.clear();
+    btCollisionObjectArray &objects =
+        World::getWorld()->getPhysics()->getPhysicsWorld()
+                                       ->getCollisionObjectArray();
+    for (int i = 0; i < objects.size(); i++)
+    {
+        btRigidBody *body = btRigidBody::upcast(objects[i]);
+        if (!body || body->isStaticOrKinematicObject())
+            continue;
+        const UserPointer *up = (const UserPointer*)body->getUserPointer();
+        if (up && up->is(UserPointer::UP_KART))
+            continue;
+        BodyState state;
+        state.m_body             = body;
+        state.m_transform        = body->getCenterOfMassTransform();
+        state.m_linear_velocity  = body->getLinearVelocity();
+        state.m_angular_velocity = body->getAngularVelocity();
+        m_other_bodies.push_back(state);
+    }
+}   // saveOtherBodies
+
+// ----------------------------------------------------------------------------
+void RewindManager::restoreOtherBodies()
+{
+    for (unsigned int i = 0; i < m_other_bodies.size(); i++)
+    {
+        const BodyState &state = m_other_bodies[i];
+        state.m_body->setCenterOfMassTransform(state.m_transform);
+        state.m_body->setLinearVelocity(state.m_linear_velocity);
+        state.m_body->setAngularVelocity(state.m_angular_velocity);
+    }
+    m_other_bodies.clear();
+}   // restoreOtherBodies
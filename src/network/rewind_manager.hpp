@@ -0,0 +1,151 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/*! \file rewind_manager.hpp
+ *  \brief Tick stamped kart inputs, and rewinding of the kart physics.
+ */
+
+#ifndef REWIND_MANAGER_HPP
+#define REWIND_MANAGER_HPP
+
+#include "input/input.hpp"
+#include "karts/controller/kart_control.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/synchronised.hpp"
+#include "utils/types.hpp"
+
+#include "LinearMath/btTransform.h"
+
+#include <deque>
+#include <vector>
+
+class btRigidBody;
+
+/*! \class RewindManager
+ *  \brief Buffers the inputs of the karts in an online race, and rewinds
+ *  the karts when an input arrives late.
+ *  The world of an online race is updated in fixed ticks (see NetworkWorld),
+ *  and each input is stamped with the tick in which it was made. Inputs
+ *  are received by the network thread and only queued there; they are
+ *  applied by the main thread before the world update of their tick.
+ *  After each tick the physical state of all karts (transform, velocities
+ *  and controls) is stored for a bounded number of ticks. In rollback mode
+ *  an input for a past tick makes the karts rewind to the state before
+ *  that tick, and the physics is re-simulated up to the current tick with
+ *  the corrected inputs. A client does the same when a server state
+ *  differs from its prediction: the server state replaces the stored one
+ *  and the following ticks are re-simulated with the local inputs.
+ *  Only the physics of the karts is re-simulated; all other bodies are
+ *  kept at their current state, and gameplay events (items, attachments)
+ *  are not replayed, they stay synchronised by the game events protocol.
+ */
+class RewindManager : public NoCopy
+{
+    public:
+        /*! \struct KartInput
+         *  \brief An input of one kart, stamped with the tick in which it
+         *  takes effect. */
+        struct KartInput
+        {
+            uint32_t     m_tick;
+            KartControl  m_controls;
+            PlayerAction m_action;
+            int          m_value;
+            bool         m_applied;
+        };
+
+                 RewindManager();
+                ~RewindManager();
+        void     reset();
+        void     addInput(unsigned int kart_id, const KartInput &input);
+        void     addServerState(uint32_t tick,
+                                const std::vector<btTransform> &transforms);
+        void     update(uint32_t tick, float dt);
+        void     saveState(uint32_t tick);
+
+        /*! \brief Returns how often the karts were rewound. */
+        unsigned int getNumRewinds() const           { return m_num_rewinds; }
+        /*! \brief Returns the number of ticks re-simulated in total. */
+        unsigned int getNumResimulatedTicks() const
+                                           { return m_num_resimulated_ticks; }
+
+    private:
+        /*! \brief The physical state of one kart after a tick. */
+        struct KartState
+        {
+            btTransform m_transform;
+            btVector3   m_linear_velocity;
+            btVector3   m_angular_velocity;
+            KartControl m_controls;
+        };
+        /*! \brief The state of all karts after a tick. */
+        struct TickState
+        {
+            uint32_t               m_tick;
+            bool                   m_valid;
+            std::vector<KartState> m_karts;
+        };
+        /*! \brief The state of a body that is not re-simulated. */
+        struct BodyState
+        {
+            btRigidBody *m_body;
+            btTransform  m_transform;
+            btVector3    m_linear_velocity;
+            btVector3    m_angular_velocity;
+        };
+        /*! \brief A state of all karts received from the server. */
+        struct ServerState
+        {
+            uint32_t                 m_tick;
+            std::vector<btTransform> m_transforms;
+        };
+
+        void             init();
+        TickState*       getState(uint32_t tick);
+        const KartInput* getInput(unsigned int kart_id, uint32_t tick) const;
+        void             applyServerState(uint32_t tick, uint32_t *rewind_tick);
+        void             rewind(uint32_t first_tick, uint32_t tick, float dt,
+                                const std::vector<bool> &late);
+        void             setControls(unsigned int kart_id, uint32_t tick,
+                                     bool late);
+        void             saveOtherBodies();
+        void             restoreOtherBodies();
+
+        /*! \brief The states of the last ticks, indexed by tick modulo the
+         *  number of stored ticks. */
+        std::vector<TickState> m_states;
+        /*! \brief The inputs of each kart, sorted by tick. */
+        std::vector<std::deque<KartInput> > m_inputs;
+        /*! \brief Inputs received by the network thread, with the id of
+         *  their kart, which are not yet added to m_inputs. */
+        Synchronised<std::vector<std::pair<unsigned int, KartInput> > >
+                               m_pending_inputs;
+        /*! \brief The newest server state received by the network thread
+         *  that was not handled yet. */
+        Synchronised<ServerState> m_server_state;
+        /*! \brief True if m_server_state was not handled yet. Protected by
+         *  the lock of m_server_state. */
+        bool                   m_has_server_state;
+        /*! \brief States of the other bodies during a rewind. */
+        std::vector<BodyState> m_other_bodies;
+        unsigned int           m_num_rewinds;
+        unsigned int           m_num_resimulated_ticks;
+};
+
+#endif // REWIND_MANAGER_HPP
@@ -128,5 +128,7 @@ void ServerNetworkManager::kickAllPlayers()
 
 void ServerNetworkManager::sendPacket(const NetworkString& data, bool reliable)
 {
-    m_localhost->broadcastPacket(data, reliable);
+    // There is no host when replaying a packet capture
+    if (m_localhost)
+        m_localhost->broadcastPacket(data, reliable);
 }
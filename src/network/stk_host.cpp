@@ -20,9 +20,13 @@
 
 #include "config/user_config.hpp"
 #include "network/network_manager.hpp"
+#include "network/packet_capture.hpp"
+#include "network/protocol_manager.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/time.hpp"
 
+#include <deque>
 #include <string.h>
 #ifdef WIN32
 #  include "Ws2tcpip.h"
@@ -34,25 +38,31 @@
 #include <pthread.h>
 #include <signal.h>
 
-FILE* STKHost::m_log_file = NULL;
-pthread_mutex_t STKHost::m_log_mutex;
-
-void STKHost::logPacket(const NetworkString ns, bool incoming)
+/** Adds an event received from ENet to the packet capture. Messages are
+ *  captured with their raw data, including the 0 byte appended by
+ *  STKPeer::createPacket.
+ *  \param event The ENet event.
+ */
+void STKHost::captureEvent(const ENetEvent &event)
 {
-    if (m_log_file == NULL)
-        return;
-    pthread_mutex_lock(&m_log_mutex);
-    if (incoming)
-        fprintf(m_log_file, "[%d\t]  <--  ", (int)(StkTime::getRealTime()));
-    else
-        fprintf(m_log_file, "[%d\t]  -->  ", (int)(StkTime::getRealTime()));
-    for (int i = 0; i < ns.size(); i++)
-    {
-        fprintf(m_log_file, "%d.", ns[i]);
-    }
-    fprintf(m_log_file, "\n");
-    pthread_mutex_unlock(&m_log_mutex);
-}
+    PacketCapture::RecordType type = PacketCapture::RECORD_MESSAGE;
+    if (event.type == ENET_EVENT_TYPE_CONNECT)
+        type = PacketCapture::RECORD_CONNECT;
+    else if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+        type = PacketCapture::RECORD_DISCONNECT;
+    const ENetPacket *packet =
+        event.type == ENET_EVENT_TYPE_RECEIVE ? event.packet : NULL;
+    PacketCapture::capture(PacketCapture::PACKET_INCOMING, type,
+                           ntohl(event.peer->address.host),
+                           event.peer->address.port, event.channelID,
+                           packet && (packet->flags & ENET_PACKET_FLAG_RELIABLE),
+                           packet ? packet->data : NULL,
+                           packet ? (uint32_t)packet->dataLength : 0);
+}   // captureEvent
+
+// ----------------------------------------------------------------------------
+
+pthread_mutex_t STKHost::m_enet_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // ----------------------------------------------------------------------------
 
@@ -61,17 +71,46 @@ void* STKHost::receive_data(void* self)
     ENetEvent event;
     STKHost* myself = (STKHost*)(self);
     ENetHost* host = myself->m_host;
+    profiler.setThreadName("Network listener");
+    // Events held back to simulate latency, with the time to release them
+    std::deque<std::pair<double, Event*> > delayed_events;
+    const double latency = UserConfigParams::m_network_latency*0.001;
     while (!myself->mustStopListening())
     {
-        while (enet_host_service(host, &event, 20) != 0) {
-            Event* evt = new Event(&event);
-            if (evt->type == EVENT_TYPE_MESSAGE)
-                logPacket(evt->data(), true);
-            if (event.type != ENET_EVENT_TYPE_NONE)
+        // The host is only serviced while ENet is locked, but the thread
+        // waits for packets without the lock, so that other threads can
+        // queue packets in the meantime.
+        lockENet();
+        int result = enet_host_service(host, &event, 0);
+        unlockENet();
+        if (result > 0 && event.type != ENET_EVENT_TYPE_NONE)
+        {
+            if (PacketCapture::isRunning())
+                captureEvent(event);
+            Event* evt = ProtocolManager::getInstance()->createEvent(&event);
+            // the event is then owned by the protocol manager
+            if (latency > 0)
+                delayed_events.push_back(
+                    std::make_pair(StkTime::getMonoTime() + latency, evt));
+            else
                 NetworkManager::getInstance()->notifyEvent(evt);
-            delete evt;
+        }
+        else if (result <= 0)
+        {
+            enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
+            enet_socket_wait(host->socket, &condition,
+                             delayed_events.empty() ? 20 : 1);
+        }
+        const double now = StkTime::getMonoTime();
+        while (!delayed_events.empty() && delayed_events.front().first <= now)
+        {
+            NetworkManager::getInstance()->notifyEvent(
+                                              delayed_events.front().second);
+            delayed_events.pop_front();
         }
     }
+    for (unsigned int i = 0; i < delayed_events.size(); i++)
+        NetworkManager::getInstance()->notifyEvent(delayed_events[i].second);
     myself->m_listening = false;
     free(myself->m_listening_thread);
     myself->m_listening_thread = NULL;
@@ -85,12 +124,12 @@ STKHost::STKHost()
 {
     m_host = NULL;
     m_listening_thread = NULL;
-    m_log_file = NULL;
     pthread_mutex_init(&m_exit_mutex, NULL);
-    pthread_mutex_init(&m_log_mutex, NULL);
-    if (UserConfigParams::m_packets_log_filename.toString() != "")
-        m_log_file = fopen(UserConfigParams::m_packets_log_filename.c_str(), "w+");
-    if (!m_log_file)
+    // Don't overwrite the capture that is being replayed
+    if (UserConfigParams::m_packets_replay_filename.size() > 0)
+        Log::info("STKHost", "Network packets are not captured in a replay.");
+    else if (UserConfigParams::m_packets_log_filename.toString() == "" ||
+        !PacketCapture::start(UserConfigParams::m_packets_log_filename))
         Log::warn("STKHost", "Network packets won't be logged: no file.");
 }
 
@@ -99,11 +138,7 @@ STKHost::STKHost()
 STKHost::~STKHost()
 {
     stopListening();
-    if (m_log_file)
-    {
-        fclose(m_log_file);
-        Log::warn("STKHost", "Packet logging file has been closed.");
-    }
+    PacketCapture::stop();
     if (m_host)
     {
         enet_host_destroy(m_host);
@@ -189,7 +224,9 @@ void STKHost::sendRawPacket(uint8_t* data, int length, TransportAddress dst)
     sendto(m_host->socket, (char*)data, length, 0,(sockaddr*)&to, to_len);
     Log::verbose("STKHost", "Raw packet sent to %i.%i.%i.%i:%u", ((dst.ip>>24)&0xff)
     , ((dst.ip>>16)&0xff), ((dst.ip>>8)&0xff), ((dst.ip>>0)&0xff), dst.port);
-    STKHost::logPacket(NetworkString(std::string((char*)(data), length)), false);
+    PacketCapture::capture(PacketCapture::PACKET_OUTGOING,
+                           PacketCapture::RECORD_RAW, dst.ip, dst.port,
+                           0, false, data, length);
 }
 
 // ----------------------------------------------------------------------------
@@ -209,7 +246,9 @@ uint8_t* STKHost::receiveRawPacket()
         len = recv(m_host->socket,(char*)buffer,2048, 0);
         StkTime::sleep(1);
     }
-    STKHost::logPacket(NetworkString(std::string((char*)(buffer), len)), true);
+    PacketCapture::capture(PacketCapture::PACKET_INCOMING,
+                           PacketCapture::RECORD_RAW, 0, 0, 0, false,
+                           buffer, len);
     return buffer;
 }
 
@@ -249,7 +288,9 @@ uint8_t* STKHost::receiveRawPacket(TransportAddress* sender)
         inet_ntop(AF_INET, &(addr.sin_addr), s, 20);
         Log::info("STKHost", "IPv4 Address of the sender was %s", s);
     }
-    STKHost::logPacket(NetworkString(std::string((char*)(buffer), len)), true);
+    PacketCapture::capture(PacketCapture::PACKET_INCOMING,
+                           PacketCapture::RECORD_RAW, sender->ip,
+                           sender->port, 0, false, buffer, len);
     return buffer;
 }
 
@@ -294,7 +335,10 @@ uint8_t* STKHost::receiveRawPacket(TransportAddress sender, int max_tries)
         inet_ntop(AF_INET, &(addr.sin_addr), s, 20);
         Log::info("STKHost", "IPv4 Address of the sender was %s", s);
     }
-    STKHost::logPacket(NetworkString(std::string((char*)(buffer), len)), true);
+    PacketCapture::capture(PacketCapture::PACKET_INCOMING,
+                           PacketCapture::RECORD_RAW,
+                           ntohl((uint32_t)(addr.sin_addr.s_addr)),
+                           ntohs(addr.sin_port), 0, false, buffer, len);
     return buffer;
 }
 
@@ -302,10 +346,13 @@ uint8_t* STKHost::receiveRawPacket(TransportAddress sender, int max_tries)
 
 void STKHost::broadcastPacket(const NetworkString& data, bool reliable)
 {
-    ENetPacket* packet = enet_packet_create(data.getBytes(), data.size() + 1,
-               (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
+    ENetPacket* packet = STKPeer::createPacket(data, reliable);
+    PacketCapture::capture(PacketCapture::PACKET_OUTGOING,
+                           PacketCapture::RECORD_MESSAGE, HOST_BROADCAST, 0,
+                           0, reliable, packet->data, packet->dataLength);
+    lockENet();
     enet_host_broadcast(m_host, 0, packet);
-    STKHost::logPacket(data, false);
+    unlockENet();
 }
 
 // ----------------------------------------------------------------------------
@@ -64,12 +64,18 @@ class STKHost
         /*! \brief Destructor                                               */
         virtual ~STKHost();
         
-        /*! \brief Log packets into a file
-         *  \param ns : The data in the packet
-         *  \param incoming : True if the packet comes from a peer.
-         *  False if it's sent to a peer.
+        /*! \brief Adds a received ENet event to the packet capture.
+         *  \param event : The event received.
          */
-        static void logPacket(const NetworkString ns, bool incoming);
+        static void captureEvent(const ENetEvent &event);
+
+        /*! \brief Locks ENet, which is not thread safe: the listening thread
+         *  services the host while other threads queue packets. All calls
+         *  that change the state of the host or of its peers must hold it.
+         */
+        static void lockENet()   { pthread_mutex_lock(&m_enet_mutex); }
+        /*! \brief Unlocks ENet, see lockENet().                          */
+        static void unlockENet() { pthread_mutex_unlock(&m_enet_mutex); }
 
         /*! \brief Thread function checking if data is received.
          *  This function tries to get data from network low-level functions as
@@ -165,9 +171,9 @@ class STKHost
         pthread_t*  m_listening_thread; //!< Thread listening network events.
         pthread_mutex_t m_exit_mutex;   //!< Mutex to kill properly the thread
         bool        m_listening;
-        static FILE*       m_log_file;         //!< Where to log packets
-        static pthread_mutex_t m_log_mutex;    //!< To write in the log only once at a time
 
+        /*! \brief Serialises all accesses to ENet, see lockENet(). */
+        static pthread_mutex_t m_enet_mutex;
 };
 
 #endif // STK_HOST_HPP
@@ -18,6 +18,7 @@
 
 #include "network/stk_peer.hpp"
 #include "network/network_manager.hpp"
+#include "network/packet_capture.hpp"
 #include "utils/log.hpp"
 
 #include <string.h>
@@ -47,8 +48,10 @@ STKPeer::STKPeer(const STKPeer& peer)
 
 STKPeer::~STKPeer()
 {
-    if (m_peer)
-        m_peer = NULL;
+    // Events find the STKPeer through the user data of the ENet peer
+    if (m_peer && m_peer->data == this)
+        m_peer->data = NULL;
+    m_peer = NULL;
     if (m_player_profile)
         delete m_player_profile;
     m_player_profile = NULL;
@@ -73,7 +76,9 @@ bool STKPeer::connectToHost(STKHost* localhost, TransportAddress host,
        + ((host.ip & 0x000000ff) << 24); // because ENet wants little endian
     address.port = host.port;
 
+    STKHost::lockENet();
     ENetPeer* peer = enet_host_connect(localhost->m_host, &address, 2, 0);
+    STKHost::unlockENet();
     if (peer == NULL)
     {
         Log::error("STKPeer", "Could not try to connect to server.\n");
@@ -90,7 +95,9 @@ bool STKPeer::connectToHost(STKHost* localhost, TransportAddress host,
 
 void STKPeer::disconnect()
 {
+    STKHost::lockENet();
     enet_peer_disconnect(m_peer, 0);
+    STKHost::unlockENet();
 }
 
 //-----------------------------------------------------------------------------
@@ -101,8 +108,7 @@ void STKPeer::sendPacket(NetworkString const& data, bool reliable)
                 data.size(), (m_peer->address.host>>0)&0xff,
                 (m_peer->address.host>>8)&0xff,(m_peer->address.host>>16)&0xff,
                 (m_peer->address.host>>24)&0xff,m_peer->address.port);
-    ENetPacket* packet = enet_packet_create(data.getBytes(), data.size() + 1,
-                (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
+    ENetPacket* packet = createPacket(data, reliable);
     /* to debug the packet output
     printf("STKPeer: ");
     for (unsigned int i = 0; i < data.size(); i++)
@@ -111,7 +117,43 @@ void STKPeer::sendPacket(NetworkString const& data, bool reliable)
     }
     printf("\n");
     */
-    enet_peer_send(m_peer, 0, packet);
+    // ENet only takes ownership of the packet if it could be queued
+    if (!sendPacket(packet))
+        enet_packet_destroy(packet);
+}
+
+//-----------------------------------------------------------------------------
+/** Queues a packet, which can be shared by several peers: ENet counts the
+ *  references and destroys the packet once it was sent to all of them.
+ *  \return False if the packet could not be queued, in which case the
+ *          caller must destroy it if no other peer took it.
+ */
+bool STKPeer::sendPacket(ENetPacket* packet)
+{
+    PacketCapture::capture(PacketCapture::PACKET_OUTGOING,
+                           PacketCapture::RECORD_MESSAGE, getAddress(),
+                           getPort(), 0,
+                           (packet->flags & ENET_PACKET_FLAG_RELIABLE) != 0,
+                           packet->data, packet->dataLength);
+    STKHost::lockENet();
+    bool queued = enet_peer_send(m_peer, 0, packet) >= 0;
+    STKHost::unlockENet();
+    return queued;
+}
+
+//-----------------------------------------------------------------------------
+/** Creates an ENet packet containing the data, followed by a 0 byte which is
+ *  removed again by the receiving Event. The packet is allocated once with
+ *  its final size and the data copied in a single block.
+ */
+ENetPacket* STKPeer::createPacket(const NetworkString& data, bool reliable)
+{
+    ENetPacket* packet = enet_packet_create(NULL, data.size() + 1,
+                (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
+    if (data.size() > 0)
+        memcpy(packet->data, data.getBytes(), data.size());
+    packet->data[data.size()] = 0;
+    return packet;
 }
 
 //-----------------------------------------------------------------------------
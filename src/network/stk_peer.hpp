@@ -41,6 +41,8 @@ class STKPeer
         virtual ~STKPeer();
 
         virtual void sendPacket(const NetworkString& data, bool reliable = true);
+        bool sendPacket(ENetPacket* packet);
+        static ENetPacket* createPacket(const NetworkString& data, bool reliable);
         static bool connectToHost(STKHost* localhost, TransportAddress host, uint32_t channel_count, uint32_t data);
         void disconnect();
 
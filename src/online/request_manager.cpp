@@ -23,6 +23,7 @@
 #include "config/player_manager.hpp"
 #include "config/user_config.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/profiler.hpp"
 
 #include <iostream>
 #include <stdio.h>
@@ -113,6 +114,7 @@ namespace Online
         pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
         // Should be the default, but just in case:
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        profiler.setThreadName("Request manager");
         //pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 
         m_thread_id.setAtomic(new pthread_t());
@@ -214,7 +216,9 @@ namespace Online
             if(me->m_current_request->getType()==Request::RT_QUIT)
                 break;
             me->m_request_queue.unlock();
+            PROFILER_PUSH_CPU_MARKER("Execute request", 0x00, 0x7F, 0x3F);
             me->m_current_request->execute();
+            PROFILER_POP_CPU_MARKER();
             me->addResult(me->m_current_request);
             me->m_request_queue.lock();
         }   // while
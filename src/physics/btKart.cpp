@@ -36,7 +36,7 @@ btRigidBody& btKart::getFixedBody()
 }
 
 // ============================================================================
-btKart::btKart(btRigidBody* chassis, btVehicleRaycaster* raycaster,
+btKart::btKart(btRigidBody* chassis, btKartRaycaster* raycaster,
                Kart *kart)
       : m_vehicleRaycaster(raycaster)
 {
@@ -212,12 +212,12 @@ void btKart::updateWheelTransformsWS(btWheelInfo& wheel,
 }   // updateWheelTransformsWS
 
 // ----------------------------------------------------------------------------
-/**
+/** Casts the suspension rays of all wheels, and the rays for the visual
+ *  wheels (used for skid marks), with one query to the raycaster. The
+ *  results are then used by rayCast(index).
  */
-btScalar btKart::rayCast(unsigned int index)
+void btKart::castWheelRays()
 {
-    btWheelInfo &wheel = m_wheelInfo[index];
-
     // Work around a bullet problem: when using a convex hull the raycast
     // would sometimes hit the chassis (which does not happen when using a
     // box shape). Therefore set the collision mask in the chassis body so
@@ -230,25 +230,82 @@ btScalar btKart::rayCast(unsigned int index)
         m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
     }
 
-    updateWheelTransformsWS( wheel,false);
+    const int num_wheels = getNumWheels();
+    m_ray_from.resize(num_wheels+2);
+    m_ray_to.resize(num_wheels+2);
+    for(int i=0; i<num_wheels; i++)
+    {
+        btWheelInfo &wheel = m_wheelInfo[i];
+        updateWheelTransformsWS( wheel,false);
+        btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
+                        + wheel.m_maxSuspensionTravelCm*0.01f;
+        btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
+        const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
+        wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
+        m_ray_from[i] = source;
+        m_ray_to[i]   = wheel.m_raycastInfo.m_contactPointWS;
+    }
+
+    // The rays for the visual position of the rear wheels, which
+    // take the visual rotation of the kart (skidding) into account.
+    int num_rays = num_wheels;
+#define USE_VISUAL
+#ifdef USE_VISUAL
+    if(num_wheels==4)
+    {
+        btTransform chassisTrans = getChassisWorldTransform();
+        if (getRigidBody()->getMotionState())
+        {
+            getRigidBody()->getMotionState()->getWorldTransform(chassisTrans);
+        }
+        btQuaternion q(m_visual_rotation, 0, 0);
+        btQuaternion rot_new = chassisTrans.getRotation() * q;
+        chassisTrans.setRotation(rot_new);
+        for(int index=2; index<4; index++)
+        {
+            btVector3 pos =
+                m_kart->getKartModel()->getWheelGraphicsPosition(index);
+            pos.setZ(pos.getZ()*0.9f);
+            btVector3 source = chassisTrans( pos );
+            m_ray_from[num_rays] = source;
+            m_ray_to[num_rays]   = source + m_ray_to[index]
+                                 - m_ray_from[index];
+            num_rays++;
+        }
+    }
+#endif
+
+    m_ray_results.resize(num_rays);
+    m_ray_objects.resize(num_rays);
+    btAssert(m_vehicleRaycaster);
+    m_vehicleRaycaster->castRays(num_rays, &m_ray_from[0], &m_ray_to[0],
+                                 &m_ray_results[0], &m_ray_objects[0]);
+
+    if(m_chassisBody->getBroadphaseHandle())
+    {
+        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
+            = old_group;
+    }
+}   // castWheelRays
+
+// ----------------------------------------------------------------------------
+/** Updates the suspension of one wheel using the result of its ray, which
+ *  must have been cast before with castWheelRays().
+ */
+btScalar btKart::rayCast(unsigned int index)
+{
+    btWheelInfo &wheel = m_wheelInfo[index];
 
     btScalar depth = -1;
 
     btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
                     + wheel.m_maxSuspensionTravelCm*0.01f;
 
-    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-    const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
-    wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-    const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
-
     btScalar param = btScalar(0.);
 
-    btVehicleRaycaster::btVehicleRaycasterResult rayResults;
-
-    btAssert(m_vehicleRaycaster);
-
-    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+    const btVehicleRaycaster::btVehicleRaycasterResult &rayResults =
+        m_ray_results[index];
+    void* object = m_ray_objects[index];
 
     wheel.m_raycastInfo.m_groundObject = 0;
 
@@ -317,40 +374,19 @@ btScalar btKart::rayCast(unsigned int index)
         wheel.m_clippedInvContactDotSuspension = btScalar(1.0);
     }
 
-#define USE_VISUAL
 #ifndef USE_VISUAL
     m_visual_contact_point[index] = rayResults.m_hitPointInWorld;
 #else
-    if(index==2 || index==3)
+    if((index==2 || index==3) && m_ray_results.size()>getNumWheels())
     {
-        btTransform chassisTrans = getChassisWorldTransform();
-        if (getRigidBody()->getMotionState())
-        {
-            getRigidBody()->getMotionState()->getWorldTransform(chassisTrans);
-        }
-        btQuaternion q(m_visual_rotation, 0, 0);
-        btQuaternion rot_new = chassisTrans.getRotation() * q;
-        chassisTrans.setRotation(rot_new);
-        btVector3 pos = m_kart->getKartModel()->getWheelGraphicsPosition(index);
-        pos.setZ(pos.getZ()*0.9f);
-        btVector3 source = chassisTrans( pos );
-        btVector3 target = source + rayvector;
-        btVehicleRaycaster::btVehicleRaycasterResult rayResults;
-
-        void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
-        m_visual_contact_point[index] = rayResults.m_hitPointInWorld;
-        m_visual_contact_point[index-2] = source;
-        m_visual_wheels_touch_ground &= (object!=NULL);
+        const int visual = getNumWheels()+index-2;
+        m_visual_contact_point[index] =
+            m_ray_results[visual].m_hitPointInWorld;
+        m_visual_contact_point[index-2] = m_ray_from[visual];
+        m_visual_wheels_touch_ground &= (m_ray_objects[visual]!=NULL);
     }
 #endif
 
-    if(m_chassisBody->getBroadphaseHandle())
-    {
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
-            = old_group;
-    }
-
-
     return depth;
 
 }   // rayCast
@@ -380,6 +416,7 @@ void btKart::updateVehicle( btScalar step )
 
     m_num_wheels_on_ground       = 0;
     m_visual_wheels_touch_ground = true;
+    castWheelRays();
     for (int i=0;i<m_wheelInfo.size();i++)
     {
         btScalar depth;
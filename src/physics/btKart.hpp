@@ -67,7 +67,7 @@ private:
     btScalar calcRollingFriction(btWheelContactPoint& contactPoint);
 
     btScalar            m_damping;
-    btVehicleRaycaster *m_vehicleRaycaster;
+    btKartRaycaster    *m_vehicleRaycaster;
 
     /** True if a zipper is active for that kart. */
     bool                m_zipper_active;
@@ -133,9 +133,20 @@ private:
     /** Contact point of the visual wheel position. */
     btAlignedObjectArray<btVector3> m_visual_contact_point;
 
+    /** Start and end points of all rays cast in one physics step (one
+     *  for each wheel, plus the rays for the visual wheels). */
+    btAlignedObjectArray<btVector3> m_ray_from;
+    btAlignedObjectArray<btVector3> m_ray_to;
+
+    /** The results of the rays, and the object hit by each ray. */
+    btAlignedObjectArray<btVehicleRaycaster::btVehicleRaycasterResult>
+                                    m_ray_results;
+    btAlignedObjectArray<void*>     m_ray_objects;
+
     btAlignedObjectArray<btWheelInfo> m_wheelInfo;
 
     void     defaultInit();
+    void     castWheelRays();
     btScalar rayCast(btWheelInfo& wheel, const btVector3& ray);
 
 public:
@@ -147,7 +158,7 @@ public:
      *         (this is used to get access to the kart properties).
      */
                        btKart(btRigidBody* chassis,
-                              btVehicleRaycaster* raycaster,
+                              btKartRaycaster* raycaster,
                               Kart *kart);
      virtual          ~btKart();
     void               reset();
@@ -19,48 +19,156 @@
 #include "physics/triangle_mesh.hpp"
 #include "tracks/track.hpp"
 
+// ============================================================================
+/** A ray result callback which also stores the index of the triangle hit.
+ */
+class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
+{
+private:
+    int m_triangle_index;
+public:
+    /** Constructor, initialises the triangle index. */
+    ClosestWithNormal(const btVector3 &from,
+                      const btVector3 &to)
+                      : btCollisionWorld::ClosestRayResultCallback(from,to)
+    {
+        m_triangle_index = -1;
+    }   // CloestWithNormal
+    // ------------------------------------------------------------------------
+    /** Stores the index of the triangle hit. */
+    virtual    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
+                                     bool normalInWorldSpace)
+    {
+        // We don't always get a triangle index, sometimes (e.g. ray hits
+        // other kart) we get shapePart=-1, or no localShapeInfo at all
+        if(rayResult.m_localShapeInfo &&
+            rayResult.m_localShapeInfo->m_shapePart>-1)
+            m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
+        return
+            btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
+            normalInWorldSpace);
+    }
+    // ------------------------------------------------------------------------
+    /** Sets the triangle index, used when a hit was found without using
+     *  this callback. */
+    void setTriangleIndex(int index) { m_triangle_index = index; }
+    // ------------------------------------------------------------------------
+    /** Returns the index of the triangle which was hit, or -1 if
+     *  no triangle was hit. */
+    int getTriangleIndex() const { return m_triangle_index; }
+
+};   // CloestWithNormal
+
+// ============================================================================
+/** Collects all collision objects whose bounding box overlaps a given box,
+ *  except one object (the track, which is handled separately).
+ */
+class ObjectCollector : public btBroadphaseAabbCallback
+{
+private:
+    const btCollisionObject *m_ignore;
+public:
+    btAlignedObjectArray<btCollisionObject*> m_objects;
+    // ------------------------------------------------------------------------
+    ObjectCollector(const btCollisionObject *ignore) : m_ignore(ignore) {}
+    // ------------------------------------------------------------------------
+    virtual bool process(const btBroadphaseProxy* proxy)
+    {
+        btCollisionObject *object = (btCollisionObject*)proxy->m_clientObject;
+        if(object!=m_ignore)
+            m_objects.push_back(object);
+        return true;
+    }   // process
+};   // ObjectCollector
+
+// ============================================================================
 void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
                                btVehicleRaycasterResult& result)
 {
-    // ========================================================================
-    class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
+    void *object;
+    castRays(1, &from, &to, &result, &object);
+    return object;
+}   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts several rays at once (e.g. all suspension rays of one kart). The
+ *  rays are tested against the track with one query of the track's
+ *  triangle tree, and only the (few) other objects in the physics world
+ *  whose boxes overlap the rays are tested separately. The results are
+ *  the same as with a separate bullet ray test for each ray.
+ *  \param num_rays Number of rays, at most TriangleMesh::MAX_RAYS.
+ *  \param from, to Start and end points of the rays.
+ *  \param results On return the result of each ray.
+ *  \param objects On return the body hit by each ray, or NULL.
+ */
+void btKartRaycaster::castRays(unsigned int num_rays, const btVector3 *from,
+                               const btVector3 *to,
+                               btVehicleRaycasterResult *results,
+                               void **objects)
+{
+    assert(num_rays<=TriangleMesh::MAX_RAYS);
+    const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
+    TriangleMesh::RayResult track_results[TriangleMesh::MAX_RAYS];
+    const btCollisionObject *track_object =
+        tm.castRays(num_rays, from, to, track_results)
+        ? tm.getCollisionObject() : NULL;
+
+    // Find all other objects that might be hit by any of the rays.
+    btVector3 aabb_min = from[0], aabb_max = from[0];
+    for(unsigned int i=0; i<num_rays; i++)
     {
-    private:
-        int m_triangle_index;
-    public:
-        /** Constructor, initialises the triangle index. */
-        ClosestWithNormal(const btVector3 &from,
-                          const btVector3 &to)
-                          : btCollisionWorld::ClosestRayResultCallback(from,to)
-        {
-            m_triangle_index = -1;
-        }   // CloestWithNormal
-        // --------------------------------------------------------------------
-        /** Stores the index of the triangle hit. */
-        virtual    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
-                                         bool normalInWorldSpace)
+        aabb_min.setMin(from[i]); aabb_min.setMin(to[i]);
+        aabb_max.setMax(from[i]); aabb_max.setMax(to[i]);
+    }
+    ObjectCollector collector(track_object);
+    m_dynamicsWorld->getBroadphase()->aabbTest(aabb_min, aabb_max, collector);
+
+    for(unsigned int i=0; i<num_rays; i++)
+    {
+        ClosestWithNormal rayCallback(from[i], to[i]);
+        // Start with the hit of the track, so only objects that are
+        // closer are reported.
+        if(track_results[i].m_triangle>=0)
         {
-            // We don't always get a triangle index, sometimes (e.g. ray hits
-            // other kart) we get shapePart=-1, or no localShapeInfo at all
-            if(rayResult.m_localShapeInfo &&
-                rayResult.m_localShapeInfo->m_shapePart>-1)
-                m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
-            return
-                btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
-                normalInWorldSpace);
+            rayCallback.m_closestHitFraction = track_results[i].m_fraction;
+            rayCallback.m_collisionObject    =
+                const_cast<btCollisionObject*>(track_object);
+            rayCallback.m_hitNormalWorld     = track_results[i].m_normal;
+            rayCallback.m_hitPointWorld.setInterpolate3(from[i], to[i],
+                                               track_results[i].m_fraction);
+            rayCallback.setTriangleIndex(track_results[i].m_triangle);
         }
-        // --------------------------------------------------------------------
-        /** Returns the index of the triangle which was hit, or -1 if
-         *  no triangle was hit. */
-        int getTriangleIndex() const { return m_triangle_index; }
-
-    };   // CloestWithNormal
-    // ========================================================================
 
-    ClosestWithNormal rayCallback(from,to);
+        btTransform from_trans, to_trans;
+        from_trans.setIdentity();
+        from_trans.setOrigin(from[i]);
+        to_trans.setIdentity();
+        to_trans.setOrigin(to[i]);
+        for(int j=0; j<collector.m_objects.size(); j++)
+        {
+            if(rayCallback.m_closestHitFraction==0.0f)
+                break;
+            btCollisionObject *object = collector.m_objects[j];
+            if(!rayCallback.needsCollision(object->getBroadphaseHandle()))
+                continue;
+            btCollisionWorld::rayTestSingle(from_trans, to_trans, object,
+                                            object->getCollisionShape(),
+                                            object->getWorldTransform(),
+                                            rayCallback);
+        }   // for j < objects
 
-    m_dynamicsWorld->rayTest(from, to, rayCallback);
+        objects[i] = processResult(rayCallback, results[i]);
+    }   // for i < num_rays
+}   // castRays
 
+// ----------------------------------------------------------------------------
+/** Converts the result of a ray test into a vehicle ray cast result.
+ *  \return The body hit, or NULL if nothing (or a body without contact
+ *          response) was hit.
+ */
+void* btKartRaycaster::processResult(const ClosestWithNormal &rayCallback,
+                                     btVehicleRaycasterResult& result)
+{
     if (rayCallback.hasHit())
     {
         btRigidBody* body = btRigidBody::upcast(rayCallback.m_collisionObject);
@@ -92,5 +200,4 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
         }
     }
     return 0;
-}
-
+}   // processResult
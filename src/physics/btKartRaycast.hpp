@@ -15,6 +15,7 @@
 #include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
 #include "BulletDynamics/Vehicle/btVehicleRaycaster.h"
 class btDynamicsWorld;
+class ClosestWithNormal;
 #include "LinearMath/btAlignedObjectArray.h"
 #include "BulletDynamics/Vehicle/btWheelInfo.h"
 #include "BulletDynamics/Dynamics/btActionInterface.h"
@@ -27,6 +28,9 @@ private:
     /** True if the normals should be smoothed. Not all tracks support this,
     *  so this flag is set depending on track when constructing this object. */
     bool                m_smooth_normals;
+
+    void* processResult(const ClosestWithNormal &rayCallback,
+                        btVehicleRaycasterResult& result);
 public:
     btKartRaycaster(btDynamicsWorld* world, bool smooth_normals=false)
         :m_dynamicsWorld(world), m_smooth_normals(smooth_normals)
@@ -35,6 +39,10 @@ public:
 
     virtual void* castRay(const btVector3& from,const btVector3& to,
                           btVehicleRaycasterResult& result);
+    void          castRays(unsigned int num_rays, const btVector3 *from,
+                           const btVector3 *to,
+                           btVehicleRaycasterResult *results,
+                           void **objects);
 
 };
 
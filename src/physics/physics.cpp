@@ -301,6 +301,22 @@ void Physics::update(float dt)
     PROFILER_POP_CPU_MARKER();
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Steps the physics world again after the karts were rewound (see
+ *  RewindManager). Unlike update() the collisions are not handled, so that
+ *  items, explosions and sound effects are not triggered a second time;
+ *  bullet still resolves the contacts of the bodies.
+ *  \param dt Time step size.
+ */
+void Physics::resimulate(float dt)
+{
+    m_physics_loop_active = true;
+    m_all_collisions.clear();
+    m_dynamics_world->stepSimulation(dt, 3);
+    m_all_collisions.clear();
+    m_physics_loop_active = false;
+}   // resimulate
+
 //-----------------------------------------------------------------------------
 /** Handles the special case of two karts colliding with each other, which
  *  means that bombs must be passed on. If both karts have a bomb, they'll
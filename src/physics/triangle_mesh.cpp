@@ -20,12 +20,19 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include "graphics/material.hpp"
 #include "modes/world.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/log.hpp"
 #include "utils/time.hpp"
+#include "utils/vec3.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+
+const unsigned int TriangleMesh::MAX_RAYS;
 
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
@@ -41,6 +48,7 @@ TriangleMesh::TriangleMesh() : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_bvh_buffer       = NULL;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -78,13 +86,197 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
     m_mesh.addTriangle(t1, t2, t3);
 }   // addTriangle
 
+// -----------------------------------------------------------------------------
+/** Adds data to a FNV-1a hash value. */
+static void hashData(uint32_t *hash, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t*)data;
+    for(size_t i=0; i<size; i++)
+    {
+        *hash ^= p[i];
+        *hash *= 16777619u;
+    }
+}   // hashData
+
+// -----------------------------------------------------------------------------
+/** Computes a hash of all triangles and their materials, which is used to
+ *  detect a BVH cache file that does not match this mesh.
+ */
+uint32_t TriangleMesh::computeHash() const
+{
+    uint32_t hash = 2166136261u;
+    uint32_t n    = m_triangleIndex2Material.size();
+    hashData(&hash, &n, sizeof(n));
+    for(unsigned int i=0; i<n; i++)
+    {
+        btVector3 p[3];
+        getTriangle(i, &p[0], &p[1], &p[2]);
+        for(unsigned int j=0; j<3; j++)
+        {
+            float xyz[3] = { p[j].getX(), p[j].getY(), p[j].getZ() };
+            hashData(&hash, xyz, sizeof(xyz));
+        }
+        const Material *m = m_triangleIndex2Material[i];
+        if(m)
+            hashData(&hash, m->getTexFname().c_str(),
+                     m->getTexFname().size()+1);
+        else
+            hashData(&hash, "", 1);
+    }
+    return hash;
+}   // computeHash
+
+// -----------------------------------------------------------------------------
+/** Collects the names of all materials used by this mesh, and the index of
+ *  the material of each triangle in this list (-1 if a triangle has no
+ *  material).
+ *  \param names On return the names of all materials.
+ *  \param indices On return the material index of each triangle.
+ */
+void TriangleMesh::getMaterialIndices(std::vector<std::string> *names,
+                                      std::vector<int32_t> *indices) const
+{
+    std::map<const Material*, int32_t> material_index;
+    indices->resize(m_triangleIndex2Material.size());
+    for(unsigned int i=0; i<m_triangleIndex2Material.size(); i++)
+    {
+        const Material *m = m_triangleIndex2Material[i];
+        if(!m)
+        {
+            (*indices)[i] = -1;
+            continue;
+        }
+        std::map<const Material*, int32_t>::iterator it =
+                                                       material_index.find(m);
+        if(it==material_index.end())
+        {
+            it = material_index.insert(std::make_pair(m,
+                                               (int32_t)names->size())).first;
+            names->push_back(m->getTexFname());
+        }
+        (*indices)[i] = it->second;
+    }
+}   // getMaterialIndices
+
+// -----------------------------------------------------------------------------
+/** Loads the BVH of this mesh from a cache file. The file contains a header,
+ *  the list of material names, the material index of each triangle and the
+ *  serialized quantized BVH. It is only used if the hash of the mesh, the
+ *  endianness and the materials of all triangles match this mesh.
+ *  \param filename Name of the cache file.
+ *  \return The BVH, or NULL if the file does not exist or does not match.
+ */
+btOptimizedBvh* TriangleMesh::loadBvh(const std::string &filename)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if(!fd)
+        return NULL;
+
+    std::vector<std::string> names;
+    std::vector<int32_t> indices;
+    getMaterialIndices(&names, &indices);
+
+    uint32_t header[BVH_HEADER_SIZE];
+    bool ok = fread(header, sizeof(uint32_t), BVH_HEADER_SIZE, fd)
+                                                          == BVH_HEADER_SIZE &&
+              header[0] == BVH_CACHE_MAGIC                                   &&
+              header[1] == BVH_CACHE_VERSION                                 &&
+              header[2] == computeHash()                                     &&
+              header[3] == indices.size()                                    &&
+              header[4] == names.size()                                      &&
+              header[5] > 0;
+
+    // The material of each triangle is already part of the hash, but a
+    // hash collision would result in wrong physics, so check the material
+    // index as well.
+    for(unsigned int i=0; ok && i<names.size(); i++)
+    {
+        uint32_t len;
+        ok = fread(&len, sizeof(len), 1, fd)==1 && len==names[i].size();
+        if(!ok || len==0) continue;
+        std::string name(len, ' ');
+        ok = fread(&name[0], 1, len, fd)==len && name==names[i];
+    }
+    if(ok)
+    {
+        std::vector<int32_t> cached_indices(indices.size());
+        ok = fread(&cached_indices[0], sizeof(int32_t), indices.size(), fd)
+                                                            == indices.size()
+           && cached_indices==indices;
+    }
+
+    btOptimizedBvh *bvh = NULL;
+    if(ok)
+    {
+        m_bvh_buffer = btAlignedAlloc(header[5], 16);
+        if(fread(m_bvh_buffer, 1, header[5], fd)==header[5])
+            bvh = btOptimizedBvh::deSerializeInPlace(m_bvh_buffer, header[5],
+                                                     /*swap endian*/false);
+        if(!bvh)
+        {
+            btAlignedFree(m_bvh_buffer);
+            m_bvh_buffer = NULL;
+        }
+    }
+    fclose(fd);
+    return bvh;
+}   // loadBvh
+
+// -----------------------------------------------------------------------------
+/** Saves the BVH of this mesh in a cache file, see loadBvh for the format.
+ *  \param filename Name of the cache file.
+ *  \param bvh The BVH to save.
+ */
+void TriangleMesh::saveBvh(const std::string &filename,
+                           const btOptimizedBvh *bvh) const
+{
+    unsigned int size = bvh->calculateSerializeBufferSize();
+    void *buffer      = btAlignedAlloc(size, 16);
+    if(!bvh->serializeInPlace(buffer, size, /*swap endian*/false))
+    {
+        btAlignedFree(buffer);
+        return;
+    }
+
+    FILE *fd = fopen(filename.c_str(), "wb");
+    if(!fd)
+    {
+        Log::warn("TriangleMesh", "Can not write BVH cache file '%s'.",
+                  filename.c_str());
+        btAlignedFree(buffer);
+        return;
+    }
+
+    std::vector<std::string> names;
+    std::vector<int32_t> indices;
+    getMaterialIndices(&names, &indices);
+    uint32_t header[BVH_HEADER_SIZE] = { BVH_CACHE_MAGIC, BVH_CACHE_VERSION,
+                                         computeHash(),
+                                         (uint32_t)indices.size(),
+                                         (uint32_t)names.size(), size };
+    fwrite(header, sizeof(uint32_t), BVH_HEADER_SIZE, fd);
+    for(unsigned int i=0; i<names.size(); i++)
+    {
+        uint32_t len = names[i].size();
+        fwrite(&len, sizeof(len), 1, fd);
+        fwrite(names[i].c_str(), 1, len, fd);
+    }
+    fwrite(&indices[0], sizeof(int32_t), indices.size(), fd);
+    fwrite(buffer, 1, size, fd);
+    fclose(fd);
+    btAlignedFree(buffer);
+}   // saveBvh
+
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
  *  has no physical properties.
- *  @param serialized_bhv if non-null, load the serialized bhv from file instead
- *                        of builing it on the fly
+ *  @param bvh_cache_file If non-null, the name of a file in which the BVH
+ *         of this mesh is cached. If the file contains the BVH for this
+ *         mesh, it is loaded instead of building it on the fly. Otherwise
+ *         the BVH is built and saved in this file.
  */
-void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
+void TriangleMesh::createCollisionShape(bool create_collision_object,
+                                        const char* bvh_cache_file)
 {
     if(m_triangleIndex2Material.size()==0)
     {
@@ -97,53 +289,22 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
     // Now convert the triangle mesh into a static rigid body
     btBvhTriangleMeshShape* bhv_triangle_mesh;
 
-    if (serialized_bhv != NULL)
+    btOptimizedBvh *bvh = bvh_cache_file ? loadBvh(bvh_cache_file) : NULL;
+    if (bvh)
     {
-        FILE *f = fopen(serialized_bhv, "rb");
-        fseek(f, 0, SEEK_END);
-        long pos = ftell(f);
-        assert(pos != -1L);
-        fseek(f, 0, SEEK_SET);
-
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
-        fclose(f);
-
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
-        if (bhv == NULL)
-        {
-            Log::warn("TriangleMesh", "Failed to load serialized BHV");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-        }
-        else
-        {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
-                                                           false /* buildBvh */);
-            bhv_triangle_mesh->setOptimizedBvh( bhv );
-        }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
-
+        bhv_triangle_mesh =
+            new btBvhTriangleMeshShape(&m_mesh,
+                                       true  /* useQuantizedAabbCompression */,
+                                       false /* buildBvh */);
+        bhv_triangle_mesh->setOptimizedBvh(bvh);
     }
     else
     {
-        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
+        bhv_triangle_mesh =
+            new btBvhTriangleMeshShape(&m_mesh,
+                                       true /* useQuantizedAabbCompression */);
+        if(bvh_cache_file)
+            saveBvh(bvh_cache_file, bhv_triangle_mesh->getOptimizedBvh());
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -156,6 +317,7 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
         m_collision_object->setWorldTransform(bt);
     }
 
+    buildRayTree();
 
 }   // createCollisionShape
 
@@ -168,15 +330,15 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
  *  removed and all objects together with the track is converted again into
  *  a single rigid body. This avoids using irrlicht (or the graphics engine)
  *  for height of terrain detection).
- *  @param serializedBhv if non-NULL, the bhv is deserialized instead of
- *                       being calculated on the fly
+ *  @param bvh_cache_file If non-NULL, the name of the file in which the BVH
+ *                       is cached, see createCollisionShape.
  */
 void TriangleMesh::createPhysicalBody(btCollisionObject::CollisionFlags flags,
-                                      const char* serializedBhv)
+                                      const char* bvh_cache_file)
 {
     // We need the collision shape, but not the collision object (since
     // this will be created when the dynamics body is anyway).
-    createCollisionShape(/*create_collision_object*/false, serializedBhv);
+    createCollisionShape(/*create_collision_object*/false, bvh_cache_file);
     btTransform startTransform;
     startTransform.setIdentity();
     m_motion_state = new btDefaultMotionState(startTransform);
@@ -215,6 +377,14 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    // A BVH loaded from a cache file lives in this buffer, so it can only
+    // be freed once the collision shape is deleted.
+    if(m_bvh_buffer)
+    {
+        btAlignedFree(m_bvh_buffer);
+        m_bvh_buffer = NULL;
+    }
+    m_ray_tree.clear();
 }   // removeAll
 
 // -----------------------------------------------------------------------------
@@ -285,65 +455,14 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
                            btVector3 *xyz, const Material **material,
                            btVector3 *normal, bool interpolate_normal) const
 {
-    if(!m_collision_shape)
-    {
-        *material=NULL;
-        return false;
-    }
-
-    btTransform trans_from;
-    trans_from.setIdentity();
-    trans_from.setOrigin(from);
-
-    btTransform trans_to;
-    trans_to.setIdentity();
-    trans_to.setOrigin(to);
+    RayResult result;
+    castRays(1, &from, &to, &result);
 
-    btTransform world_trans;
-    world_trans.setIdentity();
-
-    btCollisionWorld::ClosestRayResultCallback result(from, to);
-
-    /** A special ray result class that stores the index of the triangle
-     *  that was hit. */
-    class MaterialRayResult : public btCollisionWorld::ClosestRayResultCallback
-    {
-    public:
-        /** Stores the index of the triangle that was hit. */
-        int m_index;
-        // --------------------------------------------------------------------
-        MaterialRayResult(const btVector3 &p1, const btVector3 &p2,
-                          const TriangleMesh *me)
-                        : btCollisionWorld::ClosestRayResultCallback(p1,p2)
-        {
-            m_index = -1;;
-        }   // MaterialRayResult
-        // --------------------------------------------------------------------
-        virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
-                                         bool normalInWorldSpace)
-        {
-            m_index = rayResult.m_localShapeInfo->m_triangleIndex;
-            return btCollisionWorld::ClosestRayResultCallback
-                    ::addSingleResult(rayResult, normalInWorldSpace);
-        }   // AddSingleResult
-        // --------------------------------------------------------------------
-    };   // myCollision
-
-    MaterialRayResult ray_callback(from, to, this);
-
-    // If this is a rigid body, m_collision_object is NULL, and the
-    // rigid body is the actual collision object.
-    btCollisionWorld::rayTestSingle(trans_from, trans_to,
-                                    m_collision_object ? m_collision_object
-                                                       : m_body,
-                                    m_collision_shape, world_trans,
-                                    ray_callback);
-    // Get the index of the triangle hit
-    int index = ray_callback.m_index;
-    if(ray_callback.hasHit())
+    if(result.m_triangle>=0)
     {
-        *xyz      = ray_callback.m_hitPointWorld;
-        *material = m_triangleIndex2Material[index];
+        // Same as bullet's ClosestRayResultCallback
+        xyz->setInterpolate3(from, to, result.m_fraction);
+        *material = m_triangleIndex2Material[result.m_triangle];
 
         if(normal)
         {
@@ -351,10 +470,9 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
             // the normal of the triangle interpolate the normal at the
             // hit position based on the three normals of the triangle.
             if(interpolate_normal)
-                *normal = getInterpolatedNormal(ray_callback.m_index,
-                                                ray_callback.m_hitPointWorld);
+                *normal = getInterpolatedNormal(result.m_triangle, *xyz);
             else
-                *normal = ray_callback.m_hitNormalWorld;
+                *normal = result.m_normal;
             normal->normalize();
         }
     }
@@ -364,6 +482,178 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
         if(normal)
             normal->setValue(0, 1, 0);
     }
-    return ray_callback.hasHit();
+    return result.m_triangle>=0;
 
 }   // castRay
+
+// -----------------------------------------------------------------------------
+/** Tests if a ray hits the box of a tree node before the closest hit found
+ *  so far.
+ *  \param box The box to test.
+ *  \param from Start of the ray.
+ *  \param inv_dir The inverse of the direction (to-from) of the ray.
+ *  \param max_fraction The fraction of the closest hit so far.
+ */
+static bool rayHitsBox(const AABBTree::Box &box, const btVector3 &from,
+                       const btVector3 &inv_dir, float max_fraction)
+{
+    float t_near = 0, t_far = max_fraction;
+    for(unsigned int i=0; i<3; i++)
+    {
+        float t1 = (box.m_min[i] - from[i]) * inv_dir[i];
+        float t2 = (box.m_max[i] - from[i]) * inv_dir[i];
+        if(t1>t2) std::swap(t1, t2);
+        if(t1>t_near) t_near = t1;
+        if(t2<t_far ) t_far  = t2;
+        if(t_near>t_far) return false;
+    }
+    return true;
+}   // rayHitsBox
+
+// -----------------------------------------------------------------------------
+/** Tests a ray against a single triangle, and updates the result if the
+ *  triangle is hit before the closest hit found so far. This uses the
+ *  same computations (including the tolerance at the edges) as bullet's
+ *  btTriangleRaycastCallback, so results are the same as with a bullet
+ *  raycast: the ray hits both sides of a triangle, and the normal points
+ *  towards the start of the ray.
+ */
+void TriangleMesh::testTriangle(unsigned int index, const btVector3 &from,
+                                const btVector3 &to, RayResult *result) const
+{
+    btVector3 vert0, vert1, vert2;
+    getTriangle(index, &vert0, &vert1, &vert2);
+
+    btVector3 triangle_normal = (vert1-vert0).cross(vert2-vert0);
+    const btScalar dist   = vert0.dot(triangle_normal);
+    const btScalar dist_a = triangle_normal.dot(from) - dist;
+    const btScalar dist_b = triangle_normal.dot(to  ) - dist;
+    // Both points on the same side of the plane
+    if(dist_a * dist_b >= 0.0f)
+        return;
+
+    const btScalar distance = dist_a/(dist_a-dist_b);
+    if(distance >= result->m_fraction)
+        return;
+
+    // Add a tolerance scaled by the triangle size, in case that the ray
+    // hits exactly on the edge of the triangle.
+    const btScalar edge_tolerance = triangle_normal.length2() * -0.0001f;
+    btVector3 point;
+    point.setInterpolate3(from, to, distance);
+    btVector3 v0p = vert0 - point;
+    btVector3 v1p = vert1 - point;
+    if(v0p.cross(v1p).dot(triangle_normal) < edge_tolerance)
+        return;
+    btVector3 v2p = vert2 - point;
+    if(v1p.cross(v2p).dot(triangle_normal) < edge_tolerance)
+        return;
+    if(v2p.cross(v0p).dot(triangle_normal) < edge_tolerance)
+        return;
+
+    triangle_normal.normalize();
+    result->m_fraction = distance;
+    result->m_triangle = index;
+    result->m_normal   = dist_a <= 0.0f ? -triangle_normal : triangle_normal;
+}   // testTriangle
+
+// -----------------------------------------------------------------------------
+/** Casts several rays at once. The tree of triangles is traversed only
+ *  once for all rays, and each node is tested against all rays which can
+ *  still hit something in it. This is a lot cheaper than separate ray
+ *  casts if the rays are close to each other (e.g. all rays of one kart).
+ *  \param num_rays Number of rays, at most MAX_RAYS.
+ *  \param from Start points of the rays.
+ *  \param to End points of the rays.
+ *  \param results On return the closest hit of each ray.
+ *  \return False if this mesh has no triangles.
+ */
+bool TriangleMesh::castRays(unsigned int num_rays, const btVector3 *from,
+                            const btVector3 *to, RayResult *results) const
+{
+    assert(num_rays<=MAX_RAYS);
+    btVector3 inv_dir[MAX_RAYS];
+    for(unsigned int r=0; r<num_rays; r++)
+    {
+        results[r].m_fraction = 1.0f;
+        results[r].m_triangle = -1;
+        results[r].m_normal.setValue(0, 1, 0);
+        btVector3 dir = to[r]-from[r];
+        for(unsigned int i=0; i<3; i++)
+            inv_dir[r][i] = dir[i]==0 ? BT_LARGE_FLOAT : 1.0f/dir[i];
+    }
+    if(m_ray_tree.empty())
+        return false;
+
+    // Each stack entry is a node together with the set of rays that
+    // still need to be tested against this node.
+    struct StackEntry
+    {
+        int          m_node;
+        unsigned int m_rays;
+    };
+    StackEntry stack[64];
+    int top = 0;
+    stack[top].m_node = 0;
+    stack[top].m_rays = num_rays==32 ? 0xffffffff : (1u<<num_rays)-1;
+    top++;
+
+    while(top>0)
+    {
+        top--;
+        const AABBTree::Node &node = m_ray_tree.getNode(stack[top].m_node);
+        unsigned int rays = 0;
+        for(unsigned int r=0; r<num_rays; r++)
+        {
+            if( (stack[top].m_rays & (1u<<r)) &&
+                rayHitsBox(node.m_box, from[r], inv_dir[r],
+                           results[r].m_fraction) )
+                rays |= 1u<<r;
+        }
+        if(!rays) continue;
+
+        if(node.m_count>0)
+        {
+            for(int i=node.m_first; i<node.m_first+node.m_count; i++)
+            {
+                unsigned int index = m_ray_tree.getItem(i);
+                for(unsigned int r=0; r<num_rays; r++)
+                {
+                    if(rays & (1u<<r))
+                        testTriangle(index, from[r], to[r], &results[r]);
+                }
+            }
+        }
+        else
+        {
+            assert(top+2<=64);
+            stack[top  ].m_node = node.m_first;
+            stack[top++].m_rays = rays;
+            stack[top  ].m_node = node.m_first+1;
+            stack[top++].m_rays = rays;
+        }
+    }   // while top>0
+    return true;
+}   // castRays
+
+// -----------------------------------------------------------------------------
+/** Builds the box hierarchy of all triangles used for ray casts.
+ */
+void TriangleMesh::buildRayTree()
+{
+    unsigned int num_triangles = m_triangleIndex2Material.size();
+    std::vector<AABBTree::Box> boxes(num_triangles);
+    std::vector<int> all_triangles(num_triangles);
+    for(unsigned int i=0; i<num_triangles; i++)
+    {
+        btVector3 p1, p2, p3;
+        getTriangle(i, &p1, &p2, &p3);
+        boxes[i].set(p1);
+        boxes[i].extend(p2);
+        boxes[i].extend(p3);
+        // The triangle test accepts points slightly outside of the edges
+        boxes[i].grow(0.01f);
+        all_triangles[i] = i;
+    }
+    m_ray_tree.build(boxes, all_triangles);
+}   // buildRayTree
@@ -19,11 +19,14 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/user_pointer.hpp"
+#include "utils/aabb_tree.hpp"
 #include "utils/aligned_array.hpp"
+#include "utils/types.hpp"
 
 class Material;
 
@@ -33,7 +36,32 @@ class Material;
  */
 class TriangleMesh
 {
+public:
+    /** The result of a ray cast with castRays. */
+    struct RayResult
+    {
+        /** Fraction of the ray at which the closest triangle was hit, or
+         *  1 if no triangle was hit. */
+        float     m_fraction;
+        /** Index of the triangle hit, or -1 if no triangle was hit. */
+        int       m_triangle;
+        /** The (normalised) normal of the triangle hit, pointing towards
+         *  the start of the ray. */
+        btVector3 m_normal;
+    };   // RayResult
+
+    /** Maximum number of rays that castRays can handle in one call. */
+    static const unsigned int MAX_RAYS = 32;
+
 private:
+    /** Identifies a BVH cache file. Since it is written as a native
+     *  integer, a file written with a different endianness is ignored. */
+    static const uint32_t BVH_CACHE_MAGIC   = 0x42564853;
+    /** Must be increased when the format of the cache file changes. */
+    static const uint32_t BVH_CACHE_VERSION = 1;
+    /** Number of 32 bit values in the header of a BVH cache file. */
+    static const unsigned int BVH_HEADER_SIZE = 6;
+
     UserPointer                  m_user_pointer;
     std::vector<const Material*> m_triangleIndex2Material;
     btRigidBody                 *m_body;
@@ -44,6 +72,21 @@ private:
     btCollisionShape            *m_collision_shape;
     /** The three normals for each triangle. */
     AlignedArray<btVector3>      m_normals;
+    /** A box hierarchy of all triangles used for ray casts. Several rays
+     *  can be tested while traversing this tree only once. */
+    AABBTree                     m_ray_tree;
+    /** If the BVH was loaded from a cache file, the memory it is stored
+     *  in, otherwise NULL. */
+    void                        *m_bvh_buffer;
+
+    void buildRayTree();
+    void getMaterialIndices(std::vector<std::string> *names,
+                            std::vector<int32_t> *indices) const;
+    btOptimizedBvh* loadBvh(const std::string &filename);
+    void saveBvh(const std::string &filename,
+                 const btOptimizedBvh *bvh) const;
+    void testTriangle(unsigned int index, const btVector3 &from,
+                      const btVector3 &to, RayResult *result) const;
 public:
          TriangleMesh();
         ~TriangleMesh();
@@ -51,12 +94,14 @@ public:
                      const btVector3 &t3, const btVector3 &n1,
                      const btVector3 &n2, const btVector3 &n3,
                      const Material* m);
-    void createCollisionShape(bool create_collision_object=true, const char* serialized_bhv=NULL);
+    void createCollisionShape(bool create_collision_object=true,
+                              const char* bvh_cache_file=NULL);
     void createPhysicalBody(btCollisionObject::CollisionFlags flags=
                                (btCollisionObject::CollisionFlags)0,
-                            const char* serializedBhv = NULL);
+                            const char* bvh_cache_file = NULL);
     void removeAll();
     void removeCollisionObject();
+    uint32_t computeHash() const;
     btVector3 getInterpolatedNormal(unsigned int index,
                                     const btVector3 &position) const;
     // ------------------------------------------------------------------------
@@ -71,6 +116,15 @@ public:
     bool castRay(const btVector3 &from, const btVector3 &to,
                  btVector3 *xyz, const Material **material,
                  btVector3 *normal=NULL, bool interpolate_normal=false) const;
+    bool castRays(unsigned int num_rays, const btVector3 *from,
+                  const btVector3 *to, RayResult *results) const;
+    // ------------------------------------------------------------------------
+    /** Returns the collision object of this mesh (either the rigid body,
+     *  or the collision object if no rigid body is used), or NULL. */
+    const btCollisionObject *getCollisionObject() const
+    {
+        return m_collision_object ? m_collision_object : m_body;
+    }   // getCollisionObject
     // ------------------------------------------------------------------------
     /** Returns the points of the 'indx' triangle.
      *  \param indx Index of the triangle to get.
@@ -113,8 +113,7 @@ void RaceManager::setDefaultAIKartList(const std::vector<std::string>& ai_list)
     for(unsigned int i=0; i<ai_list.size(); i++)
     {
         const std::string &name=ai_list[i];
-        const KartProperties *kp = kart_properties_manager->getKart(name);
-        if(!kp)
+        if(!kart_properties_manager->hasKart(name))
         {
             Log::warn("RaceManager", "Kart '%s' is unknown and therefore ignored.",
                       name.c_str());
@@ -144,7 +143,7 @@ void RaceManager::setLocalKartInfo(unsigned int player_id,
 {
     assert(kart.size() > 0);
     assert(player_id <m_local_player_karts.size());
-    assert(kart_properties_manager->getKart(kart) != NULL);
+    assert(kart_properties_manager->hasKart(kart));
 
     const PlayerProfile* profile = StateManager::get()->getActivePlayerProfile(player_id);
     m_local_player_karts[player_id] = RemoteKartInfo(player_id, kart,
@@ -20,6 +20,10 @@
 #include "io/file_manager.hpp"
 #include "race/race_manager.hpp"
 
+#include <string.h>
+
+const char *ReplayBase::BINARY_MAGIC = "STKR";
+
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
 {
@@ -35,12 +39,49 @@ FILE* ReplayBase::openReplayFile(bool writeable)
 {
     m_filename = file_manager->getUserConfigFile(
                                        race_manager->getTrackName()+".replay");
-    FILE *fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+    FILE *fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     if(!fd)
     {
         m_filename = race_manager->getTrackName()+".replay";
-        fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+        fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     }
     return fd;
 
 }   // openReplayFilen
+
+// -----------------------------------------------------------------------------
+/** Writes a 32 bit value in little endian order. */
+void ReplayBase::writeUInt32(FILE *fd, uint32_t value)
+{
+    uint8_t b[4] = { (uint8_t)value,         (uint8_t)(value >> 8),
+                     (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+    fwrite(b, 1, 4, fd);
+}   // writeUInt32
+
+// -----------------------------------------------------------------------------
+/** Writes a name as a zero padded field of NAME_SIZE bytes. */
+void ReplayBase::writeName(FILE *fd, const std::string &name)
+{
+    char s[NAME_SIZE];
+    memset(s, 0, NAME_SIZE);
+    strncpy(s, name.c_str(), NAME_SIZE-1);
+    fwrite(s, 1, NAME_SIZE, fd);
+}   // writeName
+
+// -----------------------------------------------------------------------------
+/** Reads a 32 bit little endian value. */
+uint32_t ReplayBase::readUInt32(const uint8_t *p)
+{
+    return  (uint32_t)p[0]        | ((uint32_t)p[1] << 8)
+         | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}   // readUInt32
+
+// -----------------------------------------------------------------------------
+/** Reads a float stored as 32 bit little endian value. */
+float ReplayBase::readFloat(const uint8_t *p)
+{
+    uint32_t i = readUInt32(p);
+    float f;
+    memcpy(&f, &i, sizeof(f));
+    return f;
+}   // readFloat
@@ -21,6 +21,7 @@
 
 #include "LinearMath/btTransform.h"
 #include "utils/no_copy.hpp"
+#include "utils/types.hpp"
 
 #include <stdio.h>
 #include <string>
@@ -61,9 +62,31 @@ protected:
         float       m_time;
     };   // KartReplayEvent
 
+    // ------------------------------------------------------------------------
+    /** Binary replay files (version 2 and later) start with this string,
+     *  followed by a header, an index with one entry per kart, and the data
+     *  of all karts. All numbers are stored little endian:
+     *  - Header: "STKR", uint32 version, uint32 difficulty, uint32 laps,
+     *    char track[NAME_SIZE], uint32 number of karts.
+     *  - Index entry: char kart[NAME_SIZE], uint32 number of transforms,
+     *    uint32 offset and uint32 size of the transform data (encoded with
+     *    a TransformEncoder), uint32 number of events, uint32 offset of the
+     *    events (each a float time and a uint8 type).
+     *  Version 1 files are text files. */
+    static const char         *BINARY_MAGIC;
+    /** Size of the track and kart name fields in a binary file. */
+    static const unsigned int  NAME_SIZE         = 64;
+    static const unsigned int  HEADER_SIZE       = 4*5 + NAME_SIZE;
+    static const unsigned int  INDEX_ENTRY_SIZE  = 4*5 + NAME_SIZE;
+    static const unsigned int  EVENT_SIZE        = 5;
+
     // ------------------------------------------------------------------------
           ReplayBase();
     FILE *openReplayFile(bool writeable);
+    static void     writeUInt32(FILE *fd, uint32_t value);
+    static void     writeName(FILE *fd, const std::string &name);
+    static uint32_t readUInt32(const uint8_t *p);
+    static float    readFloat(const uint8_t *p);
     // ----------------------------------------------------------------------
     /** Returns the filename that was opened. */
     const std::string &getReplayFilename() const { return m_filename;}
@@ -71,7 +94,7 @@ protected:
     /** Returns the version number of the replay file. This is used to check
      *  that a loaded replay file can still be understood by this
      *  executable. */
-    unsigned int getReplayVersion() const { return 1; }
+    unsigned int getReplayVersion() const { return 2; }
 };   // ReplayBase
 
 #endif
@@ -23,9 +23,11 @@
 #include "karts/ghost_kart.hpp"
 #include "modes/world.hpp"
 #include "race/race_manager.hpp"
+#include "replay/transform_codec.hpp"
 #include "tracks/track.hpp"
 
 #include <stdio.h>
+#include <string.h>
 #include <string>
 
 ReplayPlay *ReplayPlay::m_replay_play = NULL;
@@ -42,6 +44,9 @@ ReplayPlay::ReplayPlay()
 /** Frees all stored data. */
 ReplayPlay::~ReplayPlay()
 {
+    // The ghost karts use the data of the mapped file
+    m_ghost_karts.clearAndDeleteAll();
+    m_mapped_file.close();
 }   // ~Replay
 
 //-----------------------------------------------------------------------------
@@ -78,12 +83,14 @@ void ReplayPlay::update(float dt)
 }   // update
 
 //-----------------------------------------------------------------------------
-/** Loads a replay data from  file called 'trackname'.replay.
+/** Loads a replay data from  file called 'trackname'.replay. Binary files
+ *  are memory mapped, version 1 text files are parsed and converted.
  */
 void ReplayPlay::Load()
 {
     m_ghost_karts.clearAndDeleteAll();
-    char s[1024], s1[1024];
+    m_mapped_file.close();
+    m_converted_data.clear();
 
     FILE *fd = openReplayFile(/*writeable*/false);
     if(!fd)
@@ -96,6 +103,116 @@ void ReplayPlay::Load()
 
     Log::info("Replay", "Reading replay file '%s'.", getReplayFilename().c_str());
 
+    char magic[4];
+    if(fread(magic, 1, 4, fd)==4 && memcmp(magic, BINARY_MAGIC, 4)==0)
+    {
+        fclose(fd);
+        if(!loadBinary())
+            m_ghost_karts.clearAndDeleteAll();
+        return;
+    }
+
+    rewind(fd);
+    loadText(fd);
+    fclose(fd);
+}   // Load
+
+//-----------------------------------------------------------------------------
+/** Loads a binary replay file. The file is memory mapped, and the ghost
+ *  karts decode their transforms from the mapped data while the race is
+ *  running, so loading is independent of the length of the replay.
+ *  \return False if the file is invalid.
+ */
+bool ReplayPlay::loadBinary()
+{
+    if(!m_mapped_file.open(getReplayFilename()))
+    {
+        Log::error("Replay", "Could not read '%s'.",
+                   getReplayFilename().c_str());
+        return false;
+    }
+    const uint8_t *data = m_mapped_file.getData();
+    const size_t   size = m_mapped_file.getSize();
+    if(size < HEADER_SIZE)
+    {
+        Log::error("Replay", "Replay file '%s' is truncated.",
+                   getReplayFilename().c_str());
+        return false;
+    }
+
+    unsigned int version = readUInt32(data+4);
+    if (version != getReplayVersion())
+    {
+        Log::warn("Replay", "Replay is version '%d'",version);
+        Log::warn("Replay", "STK version is '%d'",getReplayVersion());
+        Log::warn("Replay", "We try to proceed, but it may fail.");
+    }
+
+    unsigned int difficulty = readUInt32(data+8);
+    if(race_manager->getDifficulty()!=(RaceManager::Difficulty)difficulty)
+        Log::warn("Replay", "Difficulty of replay is '%d', "
+                  "while '%d' is selected.",
+                  difficulty, race_manager->getDifficulty());
+
+    race_manager->setNumLaps(readUInt32(data+12));
+
+    char name[NAME_SIZE];
+    memcpy(name, data+16, NAME_SIZE);
+    name[NAME_SIZE-1] = 0;
+    assert(std::string(name)==race_manager->getTrackName());
+    race_manager->setTrack(name);
+
+    unsigned int num_karts = readUInt32(data+16+NAME_SIZE);
+    if(num_karts > (size-HEADER_SIZE)/INDEX_ENTRY_SIZE)
+    {
+        Log::error("Replay", "Invalid number of karts in '%s'.",
+                   getReplayFilename().c_str());
+        return false;
+    }
+
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        const uint8_t *entry = data + HEADER_SIZE + k*INDEX_ENTRY_SIZE;
+        memcpy(name, entry, NAME_SIZE);
+        name[NAME_SIZE-1] = 0;
+        const uint8_t *p = entry + NAME_SIZE;
+        uint32_t transform_offset = readUInt32(p+4);
+        uint32_t transform_size   = readUInt32(p+8);
+        uint32_t num_events       = readUInt32(p+12);
+        uint32_t event_offset     = readUInt32(p+16);
+        if(transform_offset > size || transform_size > size-transform_offset ||
+           event_offset > size || num_events > (size-event_offset)/EVENT_SIZE)
+        {
+            Log::error("Replay", "Invalid data for kart %d in '%s'.",
+                       k, getReplayFilename().c_str());
+            return false;
+        }
+
+        GhostKart *ghost = new GhostKart(std::string(name));
+        m_ghost_karts.push_back(ghost);
+        ghost->init(RaceManager::KT_GHOST);
+        ghost->setTransformData(data+transform_offset, transform_size);
+
+        for(unsigned int i=0; i<num_events; i++)
+        {
+            const uint8_t *e = data + event_offset + i*EVENT_SIZE;
+            KartReplayEvent kre;
+            kre.m_time = readFloat(e);
+            kre.m_type = (KartReplayEvent::KartReplayEventType)e[4];
+            ghost->addReplayEvent(kre);
+        }
+    }   // for k<num_karts
+    return true;
+}   // loadBinary
+
+//-----------------------------------------------------------------------------
+/** Loads a version 1 (text) replay file.
+ *  \param fd The file to read from.
+ */
+void ReplayPlay::loadText(FILE *fd)
+{
+    char s[1024], s1[1024];
+
     if (fgets(s, 1023, fd) == NULL)
         Log::fatal("Replay", "Could not read '%s'.", getReplayFilename().c_str());
 
@@ -103,10 +220,9 @@ void ReplayPlay::Load()
     if (sscanf(s,"Version: %d", &version) != 1)
         Log::fatal("Replay", "No Version information found in replay file (bogus replay file).");
 
-    if (version != getReplayVersion())
+    if (version != 1)
     {
-        Log::warn("Replay", "Replay is version '%d'",version);
-        Log::warn("Replay", "STK version is '%d'",getReplayVersion());
+        Log::warn("Replay", "Text replay is version '%d'",version);
         Log::warn("Replay", "We try to proceed, but it may fail.");
     }
 
@@ -135,18 +251,28 @@ void ReplayPlay::Load()
 
     race_manager->setNumLaps(num_laps);
 
+    // The transforms of all karts are stored in one buffer, so only
+    // remember the offsets till all karts are read.
+    std::vector<size_t> offsets;
+
     // eof actually doesn't trigger here, since it requires first to try
     // reading behind eof, but still it's clearer this way.
     while(!feof(fd))
     {
         if(fgets(s, 1023, fd)==NULL)  // eof reached
             break;
+        offsets.push_back(m_converted_data.size());
         readKartData(fd, s);
     }   // for k<num_ghost_karts
+    offsets.push_back(m_converted_data.size());
 
-    fprintf(fd, "Replay file end.\n");
-    fclose(fd);
-}   // Load
+    for(unsigned int k=0; k<m_ghost_karts.size(); k++)
+    {
+        size_t size = offsets[k+1]-offsets[k];
+        m_ghost_karts[k].setTransformData(size ? &m_converted_data[offsets[k]]
+                                               : NULL, size);
+    }
+}   // loadText
 
 //-----------------------------------------------------------------------------
 /** Reads all data from a replay file for a specific kart.
@@ -161,6 +287,7 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line)
 
     m_ghost_karts.push_back(new GhostKart(std::string(s)));
     m_ghost_karts[m_ghost_karts.size()-1].init(RaceManager::KT_GHOST);
+    TransformEncoder encoder(&m_converted_data);
 
     fgets(s, 1023, fd);
     unsigned int size;
@@ -184,8 +311,7 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line)
         {
             btQuaternion q(rx, ry, rz, rw);
             btVector3 xyz(x, y, z);
-            m_ghost_karts[m_ghost_karts.size()-1].addTransform(time,
-                                                          btTransform(q, xyz));
+            encoder.add(time, btTransform(q, xyz));
         }
         else
         {
@@ -19,6 +19,7 @@
 #ifndef HEADER_REPLAY__PLAY_HPP
 #define HEADER_REPLAY__PLAY_HPP
 
+#include "io/mapped_file.hpp"
 #include "replay/replay_base.hpp"
 #include "utils/ptr_vector.hpp"
 
@@ -41,9 +42,19 @@ private:
     /** All ghost karts. */
     PtrVector<GhostKart>    m_ghost_karts;
 
+    /** The binary replay file. The ghost karts decode their transforms
+     *  directly from the mapped file. */
+    MappedFile              m_mapped_file;
+
+    /** The transforms of all ghost karts when a version 1 (text) replay
+     *  file was loaded, converted to the binary encoding. */
+    std::vector<uint8_t>    m_converted_data;
+
           ReplayPlay();
          ~ReplayPlay();
     void  readKartData(FILE *fd, char *next_line);
+    void  loadText(FILE *fd);
+    bool  loadBinary();
 public:
     void  init();
     void  update(float dt);
@@ -23,10 +23,12 @@
 #include "karts/ghost_kart.hpp"
 #include "modes/world.hpp"
 #include "race/race_manager.hpp"
+#include "replay/transform_codec.hpp"
 #include "tracks/track.hpp"
 
 #include <algorithm>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 
 ReplayRecorder *ReplayRecorder::m_replay_recorder = NULL;
@@ -138,6 +140,7 @@ void ReplayRecorder::update(float dt)
             }
             continue;
         }
+        m_last_saved_time[i] = time;
         TransformEvent *p = &(m_transform_events[i][m_count_transforms[i]-1]);
         p->m_time      = World::getWorld()->getTime();
         p->m_transform.setOrigin(kart->getXYZ());
@@ -166,38 +169,56 @@ void ReplayRecorder::Save()
 
     World *world   = World::getWorld();
     unsigned int num_karts = world->getNumKarts();
-    fprintf(fd, "Version:  %d\n",   getReplayVersion());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      world->getTrack()->getIdent().c_str());
-    fprintf(fd, "Laps: %d\n",       race_manager->getNumLaps());
 
+    // First encode the transforms of all karts, so that the offsets of
+    // all data are known when writing the index.
+    std::vector< std::vector<uint8_t> > transforms(num_karts);
+    std::vector<unsigned int> num_transforms(num_karts);
     for(unsigned int k=0; k<num_karts; k++)
     {
-        fprintf(fd, "model: %s\n", world->getKart(k)->getIdent().c_str());
-        fprintf(fd, "size:     %d\n", m_count_transforms[k]);
-
-        unsigned int num_transforms =
-            std::min((unsigned int)stk_config->m_max_history,
-                      m_count_transforms[k]                   );
-        for(unsigned int i=0; i<num_transforms; i++)
+        TransformEncoder encoder(&transforms[k]);
+        unsigned int n = std::min((unsigned int)stk_config->m_max_history,
+                                  m_count_transforms[k]                   );
+        for(unsigned int i=0; i<n; i++)
         {
             const TransformEvent *p=&(m_transform_events[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW()
-                );
-        }   // for i
-        fprintf(fd, "events: %d\n", (int)m_kart_replay_event[k].size());
+            encoder.add(p->m_time, p->m_transform);
+        }
+        num_transforms[k] = encoder.getNumTransforms();
+    }
+
+    fwrite(BINARY_MAGIC, 1, 4, fd);
+    writeUInt32(fd, getReplayVersion());
+    writeUInt32(fd, race_manager->getDifficulty());
+    writeUInt32(fd, race_manager->getNumLaps());
+    writeName(fd, world->getTrack()->getIdent());
+    writeUInt32(fd, num_karts);
+
+    uint32_t offset = HEADER_SIZE + num_karts*INDEX_ENTRY_SIZE;
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        writeName(fd, world->getKart(k)->getIdent());
+        writeUInt32(fd, num_transforms[k]);
+        writeUInt32(fd, offset);
+        writeUInt32(fd, transforms[k].size());
+        offset += transforms[k].size();
+        writeUInt32(fd, m_kart_replay_event[k].size());
+        writeUInt32(fd, offset);
+        offset += m_kart_replay_event[k].size()*EVENT_SIZE;
+    }
+
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        if(transforms[k].size()>0)
+            fwrite(&transforms[k][0], 1, transforms[k].size(), fd);
         for(unsigned int i=0; i<m_kart_replay_event[k].size(); i++)
         {
             const KartReplayEvent *p=&(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f %d\n", p->m_time, p->m_type);
+            uint32_t time;
+            memcpy(&time, &p->m_time, sizeof(time));
+            writeUInt32(fd, time);
+            uint8_t type = (uint8_t)p->m_type;
+            fwrite(&type, 1, 1, fd);
         }
     }
     fclose(fd);
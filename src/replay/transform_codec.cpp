@@ -0,0 +1,218 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "replay/transform_codec.hpp"
+
+#include <math.h>
+#include <string.h>
+
+/** Number of time units per second. */
+static const float TIME_SCALE     = 10000.0f;
+/** Number of position units per metre. */
+static const float POSITION_SCALE = 1024.0f;
+/** Maximum value of a quantised quaternion component. */
+static const float ROTATION_MAX   = 32767.0f;
+/** The largest possible value of the three smallest components of a unit
+ *  quaternion is 1/sqrt(2). */
+static const float ROTATION_RANGE = 0.70710678f;
+
+// ----------------------------------------------------------------------------
+static int32_t roundToInt(float f)
+{
+    return (int32_t)floorf(f + 0.5f);
+}   // roundToInt
+
+// ----------------------------------------------------------------------------
+void QuantizedTransform::set(float time, const btTransform &t)
+{
+    m_time = roundToInt(time*TIME_SCALE);
+    const btVector3 &xyz = t.getOrigin();
+    for (unsigned int i = 0; i < 3; i++)
+        m_position[i] = roundToInt(xyz[i]*POSITION_SCALE);
+
+    btQuaternion q = t.getRotation().normalized();
+    float c[4] = { q.x(), q.y(), q.z(), q.w() };
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; i++)
+        if (fabsf(c[i]) > fabsf(c[largest]))
+            largest = i;
+    float sign = c[largest] < 0 ? -1.0f : 1.0f;
+    m_largest  = largest;
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        float f = (c[i]*sign + ROTATION_RANGE) / (2*ROTATION_RANGE);
+        int32_t v = roundToInt(f*ROTATION_MAX);
+        m_rotation[j++] = v < 0 ? 0 : (v > (int32_t)ROTATION_MAX
+                                       ? (int32_t)ROTATION_MAX : v);
+    }
+}   // set
+
+// ----------------------------------------------------------------------------
+void QuantizedTransform::get(float *time, btTransform *t) const
+{
+    *time = m_time / TIME_SCALE;
+    t->setOrigin(btVector3(m_position[0] / POSITION_SCALE,
+                           m_position[1] / POSITION_SCALE,
+                           m_position[2] / POSITION_SCALE));
+    float c[4];
+    float sum = 0;
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == m_largest) continue;
+        c[i] = (m_rotation[j++]/ROTATION_MAX)*2*ROTATION_RANGE
+             - ROTATION_RANGE;
+        sum += c[i]*c[i];
+    }
+    c[m_largest] = sum < 1.0f ? sqrtf(1.0f - sum) : 0.0f;
+    t->setRotation(btQuaternion(c[0], c[1], c[2], c[3]).normalized());
+}   // get
+
+// ============================================================================
+TransformEncoder::TransformEncoder(std::vector<uint8_t> *buffer)
+{
+    m_buffer = buffer;
+    m_count  = 0;
+    memset(&m_previous, 0, sizeof(m_previous));
+}   // TransformEncoder
+
+// ----------------------------------------------------------------------------
+/** Writes a signed value as zigzag encoded variable length integer (7 bits
+ *  per byte, the highest bit indicates that more bytes follow).
+ */
+void TransformEncoder::writeVarInt(int32_t value)
+{
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    while (v >= 0x80)
+    {
+        m_buffer->push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    m_buffer->push_back((uint8_t)v);
+}   // writeVarInt
+
+// ----------------------------------------------------------------------------
+/** Adds a transform. A transform with the same (quantised) time as the
+ *  previous one is ignored, since it can't be used for interpolation.
+ *  \param time Time of the transform.
+ *  \param t The transform.
+ *  \return True if the transform was added.
+ */
+bool TransformEncoder::add(float time, const btTransform &t)
+{
+    QuantizedTransform q;
+    q.set(time, t);
+    if (m_count > 0 && q.m_time <= m_previous.m_time)
+        return false;
+
+    // The first byte contains the index of the dropped quaternion component
+    // and a flag if the rotation is stored as difference.
+    bool rotation_delta = m_count > 0 && q.m_largest == m_previous.m_largest;
+    m_buffer->push_back(q.m_largest | (rotation_delta ? 4 : 0));
+    writeVarInt(q.m_time - m_previous.m_time);
+    for (unsigned int i = 0; i < 3; i++)
+        writeVarInt(q.m_position[i] - m_previous.m_position[i]);
+    for (unsigned int i = 0; i < 3; i++)
+        writeVarInt(rotation_delta ? q.m_rotation[i] - m_previous.m_rotation[i]
+                                   : q.m_rotation[i]);
+    m_previous = q;
+    m_count++;
+    return true;
+}   // add
+
+// ============================================================================
+TransformDecoder::TransformDecoder()
+{
+    setData(NULL, 0);
+}   // TransformDecoder
+
+// ----------------------------------------------------------------------------
+/** Sets the encoded data to read from, and starts reading at the first
+ *  transform. The data is not copied, so it must stay valid.
+ */
+void TransformDecoder::setData(const uint8_t *data, size_t size)
+{
+    m_data = data;
+    m_size = size;
+    rewind();
+}   // setData
+
+// ----------------------------------------------------------------------------
+/** Starts reading at the first transform again. */
+void TransformDecoder::rewind()
+{
+    m_offset = 0;
+    memset(&m_previous, 0, sizeof(m_previous));
+}   // rewind
+
+// ----------------------------------------------------------------------------
+bool TransformDecoder::readVarInt(int32_t *value)
+{
+    uint32_t v = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7)
+    {
+        if (m_offset >= m_size)
+            return false;
+        uint8_t b = m_data[m_offset++];
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            *value = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            return true;
+        }
+    }
+    return false;
+}   // readVarInt
+
+// ----------------------------------------------------------------------------
+/** Decodes the next transform.
+ *  \param time On return the time of the transform.
+ *  \param t On return the transform.
+ *  \return False if there are no more transforms (or the data is corrupt).
+ */
+bool TransformDecoder::next(float *time, btTransform *t)
+{
+    if (m_offset >= m_size)
+        return false;
+
+    uint8_t flags = m_data[m_offset++];
+    if (flags > 7)
+        return false;
+    QuantizedTransform q;
+    q.m_largest = flags & 3;
+    bool rotation_delta = (flags & 4) != 0;
+
+    int32_t d;
+    if (!readVarInt(&d)) return false;
+    q.m_time = m_previous.m_time + d;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        if (!readVarInt(&d)) return false;
+        q.m_position[i] = m_previous.m_position[i] + d;
+    }
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        if (!readVarInt(&d)) return false;
+        q.m_rotation[i] = rotation_delta ? m_previous.m_rotation[i] + d : d;
+    }
+    m_previous = q;
+    q.get(time, t);
+    return true;
+}   // next
@@ -0,0 +1,90 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TRANSFORM_CODEC_HPP
+#define HEADER_TRANSFORM_CODEC_HPP
+
+#include "utils/types.hpp"
+
+#include "LinearMath/btTransform.h"
+
+#include <stddef.h>
+#include <vector>
+
+/** The quantised representation of a timed transform, shared by the
+ *  encoder and the decoder. Times are stored in units of 0.1 ms, positions
+ *  in units of 1/1024 m, and rotations with the 'smallest three' encoding
+ *  (the largest component of the unit quaternion is dropped) with 15 bits
+ *  per component.
+ * \ingroup replay
+ */
+struct QuantizedTransform
+{
+    int32_t  m_time;
+    int32_t  m_position[3];
+    uint8_t  m_largest;
+    int32_t  m_rotation[3];
+
+    void set(float time, const btTransform &t);
+    void get(float *time, btTransform *t) const;
+};   // QuantizedTransform
+
+// ============================================================================
+/** Appends a sequence of transforms to a byte buffer. Each transform is
+ *  quantised and stored as difference to the previous one using variable
+ *  length integers, so a typical transform needs about 12 bytes.
+ * \ingroup replay
+ */
+class TransformEncoder
+{
+private:
+    std::vector<uint8_t> *m_buffer;
+    QuantizedTransform    m_previous;
+    unsigned int          m_count;
+
+    void writeVarInt(int32_t value);
+public:
+                 TransformEncoder(std::vector<uint8_t> *buffer);
+    bool         add(float time, const btTransform &t);
+    // ------------------------------------------------------------------------
+    /** Returns the number of transforms added. */
+    unsigned int getNumTransforms() const { return m_count; }
+};   // TransformEncoder
+
+// ============================================================================
+/** Decodes transforms written by a TransformEncoder one after the other,
+ *  directly from the (e.g. memory mapped) encoded data.
+ * \ingroup replay
+ */
+class TransformDecoder
+{
+private:
+    const uint8_t     *m_data;
+    size_t             m_size;
+    size_t             m_offset;
+    QuantizedTransform m_previous;
+
+    bool readVarInt(int32_t *value);
+public:
+         TransformDecoder();
+    void setData(const uint8_t *data, size_t size);
+    void rewind();
+    bool next(float *time, btTransform *t);
+};   // TransformDecoder
+
+#endif
@@ -69,7 +69,7 @@ void HelpScreen1::eventCallback(Widget* widget, const std::string& name, const i
         StateManager::get()->createActivePlayer(PlayerManager::getCurrentPlayer(),
                                                 device);
 
-        if (kart_properties_manager->getKart(UserConfigParams::m_default_kart) == NULL)
+        if (!kart_properties_manager->hasKart(UserConfigParams::m_default_kart))
         {
             Log::warn("HelpScreen1", "Cannot find kart '%s', will revert to default",
                       UserConfigParams::m_default_kart.c_str());
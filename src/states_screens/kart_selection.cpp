@@ -48,6 +48,7 @@
 #include "utils/random_generator.hpp"
 #include "utils/string_utils.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <IGUIEnvironment.h>
@@ -2064,6 +2065,23 @@ void KartSelectionScreen::renumberKarts()
     w->updateItemDisplay();
 }   // renumberKarts
 
+// ----------------------------------------------------------------------------
+/** Sorts karts (given by their index) so that locked karts are at the end,
+ *  and otherwise by their (translated) name.
+ */
+static bool compareKarts(int a, int b)
+{
+    PlayerProfile *p = PlayerManager::getCurrentPlayer();
+    bool a_is_locked = p->isLocked(kart_properties_manager->getKartInfo(a)
+                                                           .m_ident);
+    bool b_is_locked = p->isLocked(kart_properties_manager->getKartInfo(b)
+                                                           .m_ident);
+    if (a_is_locked == b_is_locked)
+        return kart_properties_manager->getKartName(a)
+             < kart_properties_manager->getKartName(b);
+    return b_is_locked;
+}   // compareKarts
+
 // ----------------------------------------------------------------------------
 
 void KartSelectionScreen::setKartsFromCurrentGroup()
@@ -2089,35 +2107,40 @@ void KartSelectionScreen::setKartsFromCurrentGroup()
     w->clearItems();
 
     int usable_kart_count = 0;
-    PtrVector<const KartProperties, REF> karts;
+    std::vector<int> karts;
 
+    // Only use the kart info here, so that the karts are not loaded
     for(unsigned int i=0; i<kart_properties_manager->getNumberOfKarts(); i++)
     {
-        const KartProperties* prop = kart_properties_manager->getKartById(i);
+        const KartPropertiesManager::KartInfo &info =
+            kart_properties_manager->getKartInfo(i);
         // Ignore karts that are not in the selected group
         if(selected_kart_group != ALL_KART_GROUPS_ID &&
-            !prop->isInGroup(selected_kart_group))
+            std::find(info.m_groups.begin(), info.m_groups.end(),
+                      selected_kart_group) == info.m_groups.end())
             continue;
-        karts.push_back(prop);
+        karts.push_back(i);
     }
-    karts.insertionSort();
+    std::sort(karts.begin(), karts.end(), compareKarts);
 
     for(unsigned int i=0; i<karts.size(); i++)
     {
-        const KartProperties* prop = karts.get(i);
-        if (PlayerManager::getCurrentPlayer()->isLocked(prop->getIdent()))
+        const KartPropertiesManager::KartInfo &info =
+            kart_properties_manager->getKartInfo(karts[i]);
+        if (PlayerManager::getCurrentPlayer()->isLocked(info.m_ident))
         {
             w->addItem(_("Locked : solve active challenges to gain access "
                          "to more!"),
-                       ID_LOCKED + prop->getIdent(),
-                       prop->getAbsoluteIconFile(), LOCKED_BADGE,
+                       ID_LOCKED + info.m_ident,
+                       info.m_icon_file, LOCKED_BADGE,
                        IconButtonWidget::ICON_PATH_TYPE_ABSOLUTE);
         }
         else
         {
-            w->addItem(translations->fribidize(prop->getName()),
-                       prop->getIdent(),
-                       prop->getAbsoluteIconFile(), 0,
+            w->addItem(translations->fribidize(
+                           kart_properties_manager->getKartName(karts[i])),
+                       info.m_ident,
+                       info.m_icon_file, 0,
                        IconButtonWidget::ICON_PATH_TYPE_ABSOLUTE);
             usable_kart_count++;
         }
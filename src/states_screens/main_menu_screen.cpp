@@ -378,7 +378,7 @@ void MainMenuScreen::eventCallback(Widget* widget, const std::string& name,
         StateManager::get()->createActivePlayer(PlayerManager::getCurrentPlayer(),
                                                 device);
 
-        if (kart_properties_manager->getKart(UserConfigParams::m_default_kart) == NULL)
+        if (!kart_properties_manager->hasKart(UserConfigParams::m_default_kart))
         {
             Log::warn("MainMenuScreen", "Cannot find kart '%s', will revert to default",
                       UserConfigParams::m_default_kart.c_str());
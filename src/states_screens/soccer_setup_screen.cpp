@@ -32,6 +32,7 @@
 #include "karts/kart_properties_manager.hpp"
 #include "states_screens/arenas_screen.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/log.hpp"
 
 
 using namespace GUIEngine;
@@ -150,6 +151,17 @@ void SoccerSetupScreen::beforeAddingWidget()
         const std::string&      kart_name   = kart_info.getKartName();
 
         const KartProperties*   props       = kart_properties_manager->getKart(kart_name);
+        if(!props)
+        {
+            // The kart could not be loaded (see getKartById), so show the
+            // first kart that can be loaded instead.
+            for(unsigned int j=0;
+                !props && j<kart_properties_manager->getNumberOfKarts(); j++)
+                props = kart_properties_manager->getKartById(j);
+            if(!props)
+                Log::fatal("SoccerSetupScreen", "Can't load kart '%s' nor "
+                           "any other kart.", kart_name.c_str());
+        }
         const KartModel&        kart_model  = props->getMasterKartModel();
 
         // Add the view
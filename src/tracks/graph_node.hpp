@@ -243,6 +243,11 @@ public:
     const Vec3 getPointTransformedToFlatQuad(Vec3 xyz);
 
     const Quad& getUnrolledQuad(int succ_idx, int i) const { return m_unrolled_quads[succ_idx][i]; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of sets of unrolled quads (one for each fork
+     *  coming up). */
+    unsigned int getNumberOfUnrolledForks() const
+                                           { return m_unrolled_quads.size(); }
 };   // GraphNode
 
 #endif
@@ -0,0 +1,214 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "tracks/height_map.hpp"
+
+#include "physics/triangle_mesh.hpp"
+#include "utils/log.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+
+/** Start and end height of the rays used to find the ground. */
+static const float RAY_START_HEIGHT =     100.0f;
+static const float RAY_END_HEIGHT   = -100000.0f;
+
+// ----------------------------------------------------------------------------
+/** Creates an (empty) height map for the given area.
+ *  \param aabb_min, aabb_max The area covered by the height map.
+ *  \param resolution Number of grid points in x and z direction.
+ */
+HeightMap::HeightMap(const Vec3 &aabb_min, const Vec3 &aabb_max,
+                     unsigned int resolution)
+{
+    m_resolution = resolution;
+    m_min_x      = aabb_min.getX();
+    m_min_z      = aabb_min.getZ();
+    m_step_x     = (aabb_max.getX() - aabb_min.getX()) / resolution;
+    m_step_z     = (aabb_max.getZ() - aabb_min.getZ()) / resolution;
+    m_heights.resize(resolution*resolution, aabb_min.getY());
+}   // HeightMap
+
+// ----------------------------------------------------------------------------
+/** Computes the heights by casting rays down onto the given mesh. The rows
+ *  are split into strips which are computed in parallel.
+ *  \param mesh The mesh of the track.
+ *  \param cache_file If not empty, the name of a file in which the height
+ *         map is cached. The file is only used if it was computed for the
+ *         same mesh and area, otherwise it is (re)written.
+ */
+void HeightMap::build(const TriangleMesh &mesh, const std::string &cache_file)
+{
+    const uint32_t mesh_hash = mesh.computeHash();
+    if(cache_file.size()>0 && load(cache_file, mesh_hash))
+        return;
+
+    ThreadPool pool;
+    // Use more strips than threads, since the time to compute a row
+    // depends a lot on the complexity of the track below it.
+    const unsigned int num_strips =
+        std::min(m_resolution, 4*std::max(pool.getNumThreads(), 1u));
+    std::vector<BuildJob> jobs(num_strips);
+    for(unsigned int i=0; i<num_strips; i++)
+    {
+        jobs[i].m_height_map = this;
+        jobs[i].m_mesh       = &mesh;
+        jobs[i].m_first_row  = i    *m_resolution/num_strips;
+        jobs[i].m_last_row   = (i+1)*m_resolution/num_strips;
+        pool.addJob(&HeightMap::buildRowsJob, &jobs[i]);
+    }
+    pool.waitForAll();
+
+    if(cache_file.size()>0)
+        save(cache_file, mesh_hash);
+}   // build
+
+// ----------------------------------------------------------------------------
+/** The thread pool job function, which computes a strip of rows. */
+void HeightMap::buildRowsJob(void *data)
+{
+    BuildJob *job = (BuildJob*)data;
+    job->m_height_map->buildRows(*job->m_mesh, job->m_first_row,
+                                 job->m_last_row);
+}   // buildRowsJob
+
+// ----------------------------------------------------------------------------
+/** Computes the heights of some rows (i.e. grid points with the same x
+ *  index). The rays of one row are cast together, since they are close to
+ *  each other and will mostly traverse the same nodes of the ray tree.
+ *  \param mesh The mesh to cast the rays against.
+ *  \param first_row First row to compute.
+ *  \param last_row One after the last row to compute.
+ */
+void HeightMap::buildRows(const TriangleMesh &mesh, unsigned int first_row,
+                          unsigned int last_row)
+{
+    btVector3 from[TriangleMesh::MAX_RAYS], to[TriangleMesh::MAX_RAYS];
+    TriangleMesh::RayResult results[TriangleMesh::MAX_RAYS];
+
+    for(unsigned int i=first_row; i<last_row; i++)
+    {
+        const float x = m_min_x + i*m_step_x;
+        for(unsigned int j=0; j<m_resolution; j+=TriangleMesh::MAX_RAYS)
+        {
+            const unsigned int n =
+                std::min(m_resolution-j, TriangleMesh::MAX_RAYS);
+            for(unsigned int r=0; r<n; r++)
+            {
+                const float z = m_min_z + (j+r)*m_step_z;
+                from[r].setValue(x, RAY_START_HEIGHT, z);
+                to[r].setValue(x, RAY_END_HEIGHT, z);
+            }
+            mesh.castRays(n, from, to, results);
+            // If no triangle is hit, the height stays at the lowest point
+            // of the track.
+            for(unsigned int r=0; r<n; r++)
+            {
+                if(results[r].m_triangle<0) continue;
+                m_heights[i*m_resolution+j+r] = RAY_START_HEIGHT +
+                    results[r].m_fraction*(RAY_END_HEIGHT-RAY_START_HEIGHT);
+            }
+        }   // for j<m_resolution
+    }   // for i<last_row
+}   // buildRows
+
+// ----------------------------------------------------------------------------
+/** Returns the height at the given position, bilinearly interpolated
+ *  between the four surrounding grid points. Positions outside of the area
+ *  of the height map use the height at the closest border.
+ *  \param x, z The position.
+ */
+float HeightMap::getHeightAt(float x, float z) const
+{
+    float fx = m_step_x>0 ? (x-m_min_x)/m_step_x : 0;
+    float fz = m_step_z>0 ? (z-m_min_z)/m_step_z : 0;
+    const float max_index = (float)(m_resolution-1);
+    fx = fx<0 ? 0 : (fx>max_index ? max_index : fx);
+    fz = fz<0 ? 0 : (fz>max_index ? max_index : fz);
+
+    const unsigned int i0 = (unsigned int)fx;
+    const unsigned int j0 = (unsigned int)fz;
+    const unsigned int i1 = std::min(i0+1, m_resolution-1);
+    const unsigned int j1 = std::min(j0+1, m_resolution-1);
+    const float tx = fx - i0;
+    const float tz = fz - j0;
+
+    const float h0 = getHeight(i0, j0)*(1-tz) + getHeight(i0, j1)*tz;
+    const float h1 = getHeight(i1, j0)*(1-tz) + getHeight(i1, j1)*tz;
+    return h0*(1-tx) + h1*tx;
+}   // getHeightAt
+
+// ----------------------------------------------------------------------------
+/** Loads the height map from a cache file. The file is only used if it
+ *  was computed for the same mesh, area and resolution.
+ *  \param filename Name of the cache file.
+ *  \param mesh_hash Hash of the track mesh.
+ *  \return True if the height map was loaded.
+ */
+bool HeightMap::load(const std::string &filename, uint32_t mesh_hash)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if(!fd)
+        return false;
+
+    uint32_t header[4];
+    float area[4];
+    bool ok = fread(header, sizeof(uint32_t), 4, fd)==4  &&
+              header[0]==HEIGHT_MAP_MAGIC                &&
+              header[1]==HEIGHT_MAP_VERSION              &&
+              header[2]==mesh_hash                       &&
+              header[3]==m_resolution                    &&
+              fread(area, sizeof(float), 4, fd)==4       &&
+              area[0]==m_min_x  && area[1]==m_min_z      &&
+              area[2]==m_step_x && area[3]==m_step_z;
+    if(ok)
+    {
+        std::vector<float> heights(m_heights.size());
+        ok = fread(&heights[0], sizeof(float), heights.size(), fd)
+                                                            == heights.size();
+        if(ok)
+            m_heights.swap(heights);
+    }
+    fclose(fd);
+    return ok;
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Saves the height map in a cache file, see load() for details.
+ *  \param filename Name of the cache file.
+ *  \param mesh_hash Hash of the track mesh.
+ */
+void HeightMap::save(const std::string &filename, uint32_t mesh_hash) const
+{
+    FILE *fd = fopen(filename.c_str(), "wb");
+    if(!fd)
+    {
+        Log::warn("HeightMap", "Can not write height map cache file '%s'.",
+                  filename.c_str());
+        return;
+    }
+    uint32_t header[4] = { HEIGHT_MAP_MAGIC, HEIGHT_MAP_VERSION, mesh_hash,
+                           m_resolution };
+    float area[4] = { m_min_x, m_min_z, m_step_x, m_step_z };
+    fwrite(header, sizeof(uint32_t), 4, fd);
+    fwrite(area, sizeof(float), 4, fd);
+    fwrite(&m_heights[0], sizeof(float), m_heights.size(), fd);
+    fclose(fd);
+}   // save
@@ -0,0 +1,102 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_HEIGHT_MAP_HPP
+#define HEADER_HEIGHT_MAP_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include <string>
+#include <vector>
+
+class TriangleMesh;
+
+/** The height of the ground of a track on a regular grid in the x/z plane
+ *  covering the bounding box of the track. This is used by the weather
+ *  particles (to avoid rain or snow inside tunnels etc.), and can be used
+ *  by any other code that needs a quick estimate of the terrain height.
+ *  The heights are stored in one array, with all heights of one x value
+ *  stored together (i.e. index = i*resolution+j, where i is the x index
+ *  and j the z index), which is the layout the GPU particle shader uses.
+ *  Building the map casts one ray per grid point, which is done in
+ *  parallel, and the result is cached in a file.
+ * \ingroup tracks
+ */
+class HeightMap : public NoCopy
+{
+private:
+    /** Identifies a height map cache file. Since it is written as a native
+     *  integer, a file written with a different endianness is ignored. */
+    static const uint32_t HEIGHT_MAP_MAGIC   = 0x484d4150;
+    /** Must be increased when the format of the cache file changes. */
+    static const uint32_t HEIGHT_MAP_VERSION = 1;
+
+    /** Number of grid points in x and in z direction. */
+    unsigned int       m_resolution;
+
+    /** Minimum x and z coordinate of the area covered by the map. */
+    float              m_min_x, m_min_z;
+
+    /** Distance between two grid points in x and z direction. */
+    float              m_step_x, m_step_z;
+
+    /** The heights, see the class description for the layout. */
+    std::vector<float> m_heights;
+
+    /** Data for a job that computes some rows of the height map. */
+    struct BuildJob
+    {
+        HeightMap          *m_height_map;
+        const TriangleMesh *m_mesh;
+        unsigned int        m_first_row;
+        unsigned int        m_last_row;
+    };
+
+    static void buildRowsJob(void *data);
+    void        buildRows(const TriangleMesh &mesh, unsigned int first_row,
+                          unsigned int last_row);
+    bool        load(const std::string &filename, uint32_t mesh_hash);
+    void        save(const std::string &filename, uint32_t mesh_hash) const;
+
+public:
+                HeightMap(const Vec3 &aabb_min, const Vec3 &aabb_max,
+                          unsigned int resolution);
+    void        build(const TriangleMesh &mesh,
+                      const std::string &cache_file="");
+    float       getHeightAt(float x, float z) const;
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of grid points in x and in z direction. */
+    unsigned int getResolution() const { return m_resolution; }
+    // ------------------------------------------------------------------------
+    /** Returns the height at a grid point.
+     *  \param i Index in x direction.
+     *  \param j Index in z direction. */
+    float getHeight(unsigned int i, unsigned int j) const
+    {
+        return m_heights[i*m_resolution+j];
+    }   // getHeight
+    // ------------------------------------------------------------------------
+    /** Returns all heights, see the class description for the layout. */
+    const float *getData() const { return &m_heights[0]; }
+};   // HeightMap
+
+#endif
@@ -0,0 +1,431 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "tracks/navigation_cache.hpp"
+
+#include "tracks/graph_node.hpp"
+#include "tracks/quad_graph.hpp"
+#include "utils/log.hpp"
+#include "utils/vec3.hpp"
+
+#include <math.h>
+#include <stdio.h>
+
+/** Identifies a navigation cache file. Since it is written as a native
+ *  integer, a file written on a machine with different endianness is
+ *  rejected (and the cache is computed again). */
+static const uint32_t NAVIGATION_CACHE_MAGIC   = 0x4e4b5453;
+/** Must be increased whenever the file format or the way the data is
+ *  computed changes. */
+static const uint32_t NAVIGATION_CACHE_VERSION = 2;
+/** Distance between the points that are tested for being on track. */
+static const float    SAMPLE_STEP              = 0.5f;
+/** Distance of the first tested point from the start position. */
+static const float    FIRST_SAMPLE             = 2.0f;
+/** If the direction of the track changes by more than this angle, the AI
+ *  must not look further ahead. */
+static const float    MAX_ANGLE_CHANGE         = 1.5f;
+
+// ----------------------------------------------------------------------------
+/** Normalises an angle to be in [-PI, PI], see
+ *  AIBaseController::normalizeAngle. */
+static float normalizeAngle(float angle)
+{
+    while( angle >  2*M_PI ) angle -= 2*M_PI;
+    while( angle < -2*M_PI ) angle += 2*M_PI;
+
+    if( angle > M_PI ) angle -= 2*M_PI;
+    else if( angle < -M_PI ) angle += 2*M_PI;
+
+    return angle;
+}   // normalizeAngle
+
+// ----------------------------------------------------------------------------
+/** Adds data to a FNV-1a hash value. */
+static void hashData(uint32_t *hash, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t*)data;
+    for(size_t i=0; i<size; i++)
+    {
+        *hash ^= p[i];
+        *hash *= 16777619u;
+    }
+}   // hashData
+
+// ----------------------------------------------------------------------------
+/** Adds a float to a hash value. */
+static void hashFloat(uint32_t *hash, float f)
+{
+    hashData(hash, &f, sizeof(f));
+}   // hashFloat
+
+// ----------------------------------------------------------------------------
+/** Adds an integer to a hash value. */
+static void hashInt(uint32_t *hash, uint32_t n)
+{
+    hashData(hash, &n, sizeof(n));
+}   // hashInt
+
+// ============================================================================
+NavigationCache::NavigationCache()
+{
+    m_num_unrolled = 0;
+    m_hash         = 0;
+}   // NavigationCache
+
+// ----------------------------------------------------------------------------
+/** Computes a hash of all graph data the cache depends on, which is used to
+ *  detect a cache file that does not match the current driveline.
+ *  \param qg The quad graph.
+ */
+uint32_t NavigationCache::computeHash(const QuadGraph &qg)
+{
+    uint32_t hash = 2166136261u;
+    hashInt(&hash, NAVIGATION_CACHE_VERSION);
+    hashInt(&hash, NUM_LATERAL_POSITIONS);
+    hashInt(&hash, NUM_LONGITUDINAL_POSITIONS);
+    hashInt(&hash, qg.getNumNodes());
+    hashInt(&hash, qg.getNumberOfUnrolledQuads());
+    hashInt(&hash, qg.isReverse() ? 1 : 0);
+    for(unsigned int n=0; n<qg.getNumNodes(); n++)
+    {
+        const GraphNode &node = qg.getNode(n);
+        const Quad &quad = node.getQuad();
+        for(unsigned int i=0; i<4; i++)
+        {
+            hashFloat(&hash, quad[i].getX());
+            hashFloat(&hash, quad[i].getY());
+            hashFloat(&hash, quad[i].getZ());
+        }
+        hashFloat(&hash, node.getPathWidth());
+        hashInt(&hash, node.getNumberOfSuccessors());
+        for(unsigned int i=0; i<node.getNumberOfSuccessors(); i++)
+            hashInt(&hash, node.getSuccessor(i));
+        hashInt(&hash, node.getNumberOfUnrolledForks());
+    }
+    return hash;
+}   // computeHash
+
+// ----------------------------------------------------------------------------
+/** Loads the cache from the given file, or computes it (and tries to save
+ *  it) if the file does not exist or does not match the graph.
+ *  \param qg The quad graph, which must have its unrolled quads built.
+ *  \param filename Name of the cache file.
+ */
+void NavigationCache::init(const QuadGraph &qg, const std::string &filename)
+{
+    m_hash = computeHash(qg);
+    if(load(qg, filename))
+        return;
+    compute(qg);
+    save(filename);
+}   // init
+
+// ----------------------------------------------------------------------------
+/** Computes the minimum distance to the edge of the track when driving from
+ *  a start point towards the center of an unrolled quad.
+ *  \param qg The quad graph.
+ *  \param start The start point.
+ *  \param node The graph node the unrolled quads belong to.
+ *  \param fork The set of unrolled quads to use.
+ *  \param j Index of the unrolled quad used for the distance test, the
+ *         point driven to is the center of unrolled quad j+1.
+ *  \param width_node The graph node whose width is used.
+ */
+float NavigationCache::computeClearance(const QuadGraph &qg,
+                                        const Vec3 &start,
+                                        unsigned int node, unsigned int fork,
+                                        unsigned int j, int width_node) const
+{
+    GraphNode &graph_node = qg.getNode(node);
+    Vec3 direction = graph_node.getUnrolledQuad(fork, j+1).getCenter()
+                   - start;
+    float len = direction.length();
+    if(len>0.0f)
+        direction *= 1.0f/len;
+
+    float half_width = qg.getNode(width_node).getPathWidth()*0.5f;
+    float clearance  = half_width;
+    // Test at least one point, even if the target is very close
+    for(float s=FIRST_SAMPLE; ; s+=SAMPLE_STEP)
+    {
+        Vec3 track_coord;
+        graph_node.getDistancesUnrolled(start + direction*s, fork, j,
+                                        &track_coord);
+        float c = half_width - track_coord.getX();
+        if(c < clearance)
+            clearance = c;
+        if(s + SAMPLE_STEP >= len)
+            break;
+    }
+    return clearance;
+}   // computeClearance
+
+// ----------------------------------------------------------------------------
+/** Computes the data for all graph nodes.
+ *  \param qg The quad graph.
+ */
+void NavigationCache::compute(const QuadGraph &qg)
+{
+    m_num_unrolled = qg.getNumberOfUnrolledQuads();
+    unsigned int num_nodes = qg.getNumNodes();
+    m_first_entry.resize(num_nodes+1);
+    unsigned int num_entries = 0;
+    for(unsigned int n=0; n<num_nodes; n++)
+    {
+        m_first_entry[n] = num_entries;
+        num_entries += qg.getNode(n).getNumberOfUnrolledForks();
+    }
+    m_first_entry[num_nodes] = num_entries;
+
+    m_paths.resize(num_entries*(m_num_unrolled+2));
+    m_angle_limit.resize(num_entries);
+    m_clearance.resize(num_entries*NUM_LONGITUDINAL_POSITIONS
+                       *NUM_LATERAL_POSITIONS*m_num_unrolled);
+
+    for(unsigned int n=0; n<num_nodes; n++)
+    {
+        GraphNode &node = qg.getNode(n);
+        // Determine the direction of the right vector, so that the lateral
+        // positions match the signed distances of getDistances().
+        Vec3 right = node.getRightUnitVector();
+        Vec3 distances;
+        node.getDistances(node.getCenter()+right, &distances);
+        if(distances.getX()<0)
+            right = -right;
+        float width = node.getPathWidth();
+
+        for(unsigned int f=0; f<node.getNumberOfUnrolledForks(); f++)
+        {
+            unsigned int entry = m_first_entry[n]+f;
+            // The graph nodes the unrolled quads of this fork are built from
+            int *path = &m_paths[entry*(m_num_unrolled+2)];
+            path[0] = n;
+            for(unsigned int i=0; i<=m_num_unrolled; i++)
+            {
+                const GraphNode &p = qg.getNode(path[i]);
+                path[i+1] = p.getSuccessor(f % p.getNumberOfSuccessors());
+            }
+
+            unsigned int angle_limit = m_num_unrolled;
+            for(unsigned int j=0; j<m_num_unrolled; j++)
+            {
+                const GraphNode &p0 = qg.getNode(path[j]);
+                const GraphNode &p1 = qg.getNode(path[j+1]);
+                float angle  = p0.getAngleToSuccessor(
+                                            f % p0.getNumberOfSuccessors());
+                float angle1 = p1.getAngleToSuccessor(
+                                            f % p1.getNumberOfSuccessors());
+                if(fabsf(normalizeAngle(angle1-angle))>MAX_ANGLE_CHANGE)
+                {
+                    angle_limit = j;
+                    break;
+                }
+            }
+            m_angle_limit[entry] = angle_limit;
+
+            for(unsigned int k=0; k<NUM_LONGITUDINAL_POSITIONS; k++)
+            {
+                // Point on the center line at the middle of cell k
+                float along  = (k+0.5f)/NUM_LONGITUDINAL_POSITIONS;
+                Vec3 center  = node.getLowerCenter()
+                             + (node.getUpperCenter()-node.getLowerCenter())
+                               *along;
+                for(unsigned int l=0; l<NUM_LATERAL_POSITIONS; l++)
+                {
+                    float offset = width*((l+0.5f)/NUM_LATERAL_POSITIONS-0.5f);
+                    Vec3 start   = center + right*offset;
+                    float *clearance =
+                        &m_clearance[getClearanceIndex(entry, k, l)];
+                    for(unsigned int j=0; j<m_num_unrolled; j++)
+                    {
+                        clearance[j] = computeClearance(qg, start, n, f, j,
+                                                      (path[j]+j) % num_nodes);
+                    }
+                }   // for l < NUM_LATERAL_POSITIONS
+            }   // for k < NUM_LONGITUDINAL_POSITIONS
+        }   // for f < number of forks
+    }   // for n < num_nodes
+}   // compute
+
+// ----------------------------------------------------------------------------
+/** Loads the cache from a file.
+ *  \param qg The quad graph the cache must match.
+ *  \param filename Name of the cache file.
+ *  \return False if the file does not exist or does not match the graph.
+ */
+bool NavigationCache::load(const QuadGraph &qg, const std::string &filename)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if(!fd)
+        return false;
+
+    uint32_t header[6];
+    bool ok = fread(header, sizeof(uint32_t), 6, fd) == 6           &&
+              header[0] == NAVIGATION_CACHE_MAGIC                   &&
+              header[1] == NAVIGATION_CACHE_VERSION                 &&
+              header[2] == m_hash                                   &&
+              header[3] == qg.getNumNodes()                         &&
+              (int)header[4] == qg.getNumberOfUnrolledQuads();
+    if(ok)
+    {
+        m_num_unrolled = header[4];
+        unsigned int num_entries = header[5];
+        m_first_entry.resize(header[3]+1);
+        m_paths.resize(num_entries*(m_num_unrolled+2));
+        m_angle_limit.resize(num_entries);
+        m_clearance.resize(num_entries*NUM_LONGITUDINAL_POSITIONS
+                           *NUM_LATERAL_POSITIONS*m_num_unrolled);
+        ok = num_entries > 0                                              &&
+             fread(&m_first_entry[0], sizeof(unsigned int),
+                   m_first_entry.size(), fd) == m_first_entry.size()      &&
+             fread(&m_paths[0], sizeof(int),
+                   m_paths.size(), fd) == m_paths.size()                  &&
+             fread(&m_angle_limit[0], sizeof(uint8_t),
+                   m_angle_limit.size(), fd) == m_angle_limit.size()      &&
+             fread(&m_clearance[0], sizeof(float),
+                   m_clearance.size(), fd) == m_clearance.size()          &&
+             m_first_entry.back() == num_entries;
+    }
+    fclose(fd);
+
+    if(!ok)
+    {
+        Log::info("NavigationCache", "Ignoring outdated cache file '%s'.",
+                  filename.c_str());
+        m_first_entry.clear();
+        m_paths.clear();
+        m_angle_limit.clear();
+        m_clearance.clear();
+    }
+    return ok;
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Saves the cache. Failing to save it (e.g. because the track is installed
+ *  in a read-only directory) is not an error, the data is then just computed
+ *  again the next time the track is loaded.
+ *  \param filename Name of the cache file.
+ */
+void NavigationCache::save(const std::string &filename) const
+{
+    if(m_first_entry.empty() || m_first_entry.back()==0)
+        return;
+
+    FILE *fd = fopen(filename.c_str(), "wb");
+    if(!fd)
+    {
+        Log::debug("NavigationCache", "Can not write cache file '%s'.",
+                   filename.c_str());
+        return;
+    }
+    uint32_t header[6] = { NAVIGATION_CACHE_MAGIC, NAVIGATION_CACHE_VERSION,
+                           m_hash, (uint32_t)m_first_entry.size()-1,
+                           m_num_unrolled, m_first_entry.back() };
+    fwrite(header, sizeof(uint32_t), 6, fd);
+    fwrite(&m_first_entry[0], sizeof(unsigned int), m_first_entry.size(), fd);
+    fwrite(&m_paths[0], sizeof(int), m_paths.size(), fd);
+    fwrite(&m_angle_limit[0], sizeof(uint8_t), m_angle_limit.size(), fd);
+    fwrite(&m_clearance[0], sizeof(float), m_clearance.size(), fd);
+    fclose(fd);
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Determines the point the AI should aim at using the cached data. This
+ *  follows the algorithm in SkiddingAI::findNonCrashingPoint, but the
+ *  result can differ slightly: the kart position is snapped to the center
+ *  of its cell in the grid of positions on the node, and the path towards
+ *  each unrolled quad is sampled every SAMPLE_STEP instead of every kart
+ *  length.
+ *  \param node The graph node the kart is on.
+ *  \param fork The set of unrolled quads to use.
+ *  \param xyz Position of the kart.
+ *  \param kart_width Width of the kart.
+ *  \param next_node_index The path the AI is going to drive.
+ *  \param aim_position On exit contains the point the AI should aim at.
+ *  \param last_node On exit contains the graph node the AI is aiming at.
+ *  \return False if there is no cached data for the path the AI is going
+ *          to drive, in which case the result must be computed.
+ */
+bool NavigationCache::findNonCrashingPoint(int node, int fork,
+                                           const Vec3 &xyz, float kart_width,
+                                       const std::vector<int> &next_node_index,
+                                           Vec3 *aim_position,
+                                           int *last_node) const
+{
+    if(node<0 || node+1>=(int)m_first_entry.size() || fork<0)
+        return false;
+    unsigned int entry = m_first_entry[node]+fork;
+    if(entry>=m_first_entry[node+1])
+        return false;
+
+    const int *path = &m_paths[entry*(m_num_unrolled+2)];
+    for(unsigned int i=0; i<=m_num_unrolled; i++)
+    {
+        if(next_node_index[path[i]]!=path[i+1])
+            return false;
+    }
+
+    GraphNode &graph_node = QuadGraph::get()->getNode(node);
+    Vec3 distances;
+    graph_node.getDistances(xyz, &distances);
+    int lateral = (int)floorf( ( distances.getX()/graph_node.getPathWidth()
+                                 + 0.5f) * NUM_LATERAL_POSITIONS);
+    if(lateral<0)
+        lateral = 0;
+    else if(lateral>=(int)NUM_LATERAL_POSITIONS)
+        lateral = NUM_LATERAL_POSITIONS-1;
+    // The Z coordinate is the distance from the start of the track, so
+    // subtract the start of this node to get the position along the node.
+    float length = graph_node.getNodeLength();
+    float along  = length>0.0f
+                 ? (distances.getZ()-graph_node.getDistanceFromStart())/length
+                 : 0.0f;
+    int longitudinal = (int)floorf(along*NUM_LONGITUDINAL_POSITIONS);
+    if(longitudinal<0)
+        longitudinal = 0;
+    else if(longitudinal>=(int)NUM_LONGITUDINAL_POSITIONS)
+        longitudinal = NUM_LONGITUDINAL_POSITIONS-1;
+
+    const float *clearance =
+        &m_clearance[getClearanceIndex(entry, longitudinal, lateral)];
+    unsigned int angle_limit = m_angle_limit[entry];
+    for(unsigned int j=0; j<m_num_unrolled; j++)
+    {
+        if(j==angle_limit)
+        {
+            *aim_position = QuadGraph::get()->getQuadOfNode(path[j+1])
+                                             .getCenter();
+            *last_node    = path[j];
+            return true;
+        }
+        if(clearance[j] < kart_width*0.5f)
+        {
+            *aim_position = graph_node.getUnrolledQuad(fork, j+1).getCenter();
+            *last_node    = path[j];
+            return true;
+        }
+    }
+    *aim_position = graph_node.getUnrolledQuad(fork, m_num_unrolled)
+                              .getCenter();
+    *last_node    = path[m_num_unrolled];
+    return true;
+}   // findNonCrashingPoint
+
+/* EOF */
@@ -0,0 +1,113 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_NAVIGATION_CACHE_HPP
+#define HEADER_NAVIGATION_CACHE_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <string>
+#include <vector>
+
+class QuadGraph;
+class Vec3;
+
+/**
+ * \brief Precomputed data for the AI to find the point to aim at.
+ *  SkiddingAI::findNonCrashingPoint tests for each of the unrolled quads
+ *  ahead of the kart if the kart can drive towards it without getting off
+ *  track. Besides the kart position, the result only depends on the graph,
+ *  so this data is computed once per track and direction for a grid of
+ *  positions on each graph node (a number of lateral positions at a number
+ *  of positions along the node): for each unrolled quad the minimum
+ *  distance to the edge of the track when driving towards it (which is
+ *  then compared with the width of the kart), and the first unrolled quad
+ *  at which the track turns too sharply. The data is saved
+ *  in a file next to the driveline, so it is only computed again if the
+ *  driveline changes.
+ * \ingroup tracks
+ */
+class NavigationCache : public NoCopy
+{
+public:
+    /** Number of lateral positions on each graph node for which the data
+     *  is computed. */
+    static const unsigned int NUM_LATERAL_POSITIONS = 7;
+
+    /** Number of positions along each graph node for which the data is
+     *  computed. */
+    static const unsigned int NUM_LONGITUDINAL_POSITIONS = 4;
+
+private:
+    /** Number of unrolled quads (excluding the quad of the node itself). */
+    unsigned int              m_num_unrolled;
+
+    /** For each graph node the index of its first entry. Each node has one
+     *  entry for each set of unrolled quads (fork). The last element is
+     *  the overall number of entries. */
+    std::vector<unsigned int> m_first_entry;
+
+    /** For each entry the graph nodes the unrolled quads are built from,
+     *  i.e. the path the data is valid for (m_num_unrolled+2 nodes). */
+    std::vector<int>          m_paths;
+
+    /** For each entry the index of the first unrolled quad at which the
+     *  track turns too sharply, or m_num_unrolled. */
+    std::vector<uint8_t>      m_angle_limit;
+
+    /** For each entry, longitudinal and lateral position and unrolled
+     *  quad: the minimum
+     *  distance to the edge of the track when driving towards the center
+     *  of the next unrolled quad. */
+    std::vector<float>        m_clearance;
+
+    /** Hash of the graph data used to compute the cache. */
+    uint32_t                  m_hash;
+
+    static uint32_t computeHash(const QuadGraph &qg);
+    bool            load(const QuadGraph &qg, const std::string &filename);
+    void            save(const std::string &filename) const;
+    void            compute(const QuadGraph &qg);
+    float           computeClearance(const QuadGraph &qg, const Vec3 &start,
+                                     unsigned int node, unsigned int fork,
+                                     unsigned int j, int width_node) const;
+    // ------------------------------------------------------------------------
+    /** Returns the index of the first clearance value of an entry and
+     *  position on the node. */
+    unsigned int getClearanceIndex(unsigned int entry,
+                                   unsigned int longitudinal,
+                                   unsigned int lateral) const
+    {
+        return ( (entry*NUM_LONGITUDINAL_POSITIONS + longitudinal)
+                 *NUM_LATERAL_POSITIONS + lateral )*m_num_unrolled;
+    }   // getClearanceIndex
+
+public:
+         NavigationCache();
+    void init(const QuadGraph &qg, const std::string &filename);
+    bool findNonCrashingPoint(int node, int fork, const Vec3 &xyz,
+                              float kart_width,
+                              const std::vector<int> &next_node_index,
+                              Vec3 *aim_position, int *last_node) const;
+};   // NavigationCache
+
+#endif
+
+/* EOF */
@@ -145,6 +145,35 @@ bool Quad::pointInQuad3D(const Vec3& p) const
     }
     return true;
 }   // pointInQuad3D
+
+// ----------------------------------------------------------------------------
+/** Computes an axis aligned box containing all points for which
+ *  pointInQuad3D returns true.
+ *  \param min On return the minimum corner of the box.
+ *  \param max On return the maximum corner of the box.
+ *  \return False if there is no such box: if the quad is degenerated (e.g.
+ *          two points are identical) a side of the 3d box is not defined,
+ *          and pointInQuad3D accepts points that are arbitrarily far away.
+ */
+bool Quad::getBoundingBox(Vec3 *min, Vec3 *max) const
+{
+    *min = m_box_faces[0][0];
+    *max = m_box_faces[0][0];
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        core::triangle3df triangle(m_box_faces[i][0].toIrrVector(),
+                                   m_box_faces[i][1].toIrrVector(),
+                                   m_box_faces[i][2].toIrrVector());
+        if (triangle.getNormal().getLengthSQ() == 0)
+            return false;
+        for (unsigned int j = 0; j < 4; j++)
+        {
+            min->setMin(m_box_faces[i][j]);
+            max->setMax(m_box_faces[i][j]);
+        }
+    }
+    return true;
+}   // getBoundingBox
     
 
 // ----------------------------------------------------------------------------
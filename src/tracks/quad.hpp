@@ -73,6 +73,7 @@ public:
     void getVertices(video::S3DVertex *v, const video::SColor &color) const;
     bool pointInQuad(const Vec3& p) const;
     bool pointInQuad3D(const Vec3& p) const;
+    bool getBoundingBox(Vec3 *min, Vec3 *max) const;
     void transform(const btTransform &t, Quad *result) const;
     // ------------------------------------------------------------------------
     /** Returns the i-th. point of a quad. */
@@ -37,6 +37,7 @@
 #include "tracks/check_manager.hpp"
 #include "tracks/quad_set.hpp"
 #include "tracks/track.hpp"
+#include "utils/string_utils.hpp"
 
 const int QuadGraph::UNKNOWN_SECTOR  = -1;
 QuadGraph *QuadGraph::m_quad_graph = NULL;
@@ -60,6 +61,7 @@ QuadGraph::QuadGraph(const std::string &quad_file_name,
     m_quad_filename        = quad_file_name;
     m_quad_graph           = this;
     load(graph_file_name);
+    buildSectorIndex();
 }   // QuadGraph
 
 // -----------------------------------------------------------------------------
@@ -283,6 +285,8 @@ void QuadGraph::computeChecklineRequirements(GraphNode* node,
  *  Only graph nodes with more than one successor have this data structure
  *  (since on other graph nodes only one path can be used anyway, this
  *  saves some memory).
+ *  It also loads (or computes) the navigation cache used by the AI, which
+ *  is stored next to the quad file.
  */
 void QuadGraph::setupPaths()
 {
@@ -290,6 +294,10 @@ void QuadGraph::setupPaths()
     {
         m_all_nodes[i]->setupPathsToNode();
     }
+    std::string cache_file = StringUtils::removeExtension(m_quad_filename)
+                           + (m_reverse ? "-reverse" : "")
+                           + ".navcache";
+    m_navigation_cache.init(*this, cache_file);
 }   // setupPaths
 
 // -----------------------------------------------------------------------------
@@ -929,6 +937,348 @@ void QuadGraph::spatialToTrackUnrolled(Vec3 *dst, const Vec3& xyz,
  */
 void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
                                 std::vector<int> *all_sectors) const
+{
+    // The AI only tests a limited list of sectors (see the explanation in
+    // findRoadSectorLinear), for which the spatial index doesn't help.
+    if(all_sectors || m_all_nodes.empty())
+    {
+        findRoadSectorLinear(xyz, sector, all_sectors);
+        return;
+    }
+
+#ifdef DEBUG
+    int linear_sector = *sector;
+    if(UserConfigParams::m_sector_debug)
+        findRoadSectorLinear(xyz, &linear_sector, NULL);
+#endif
+
+    const int start = *sector;
+    // Most likely the kart will still be on the sector it was before,
+    // so this simple case is tested first.
+    if(start!=UNKNOWN_SECTOR && getQuadOfNode(start).pointInQuad3D(xyz))
+        return;
+
+    // A point can be on several (overlapping) quads. In this case the
+    // linear search returns the quad that was tested last, i.e. the quad
+    // with the highest index after the start sector (wrapping around).
+    // The same quad is selected here, so the result doesn't depend on the
+    // order in which candidates are found.
+    const int num_nodes = m_all_nodes.size();
+    int best       = UNKNOWN_SECTOR;
+    int best_order = -1;
+
+    // Next test the neighbours of the previous sector. If the point is on
+    // a neighbour, all quads the point can be on are neighbours of this
+    // neighbour (since their boxes must overlap).
+    const std::vector<int> *candidates = NULL;
+    if(start!=UNKNOWN_SECTOR)
+    {
+        const std::vector<int> &neighbours = m_quad_neighbours[start];
+        for(unsigned int i=0; i<neighbours.size(); i++)
+        {
+            if(getQuadOfNode(neighbours[i]).pointInQuad3D(xyz))
+            {
+                best       = neighbours[i];
+                best_order = (best-start-1+num_nodes) % num_nodes;
+                candidates = &m_quad_neighbours[best];
+                break;
+            }
+        }
+    }
+
+    // Otherwise (or on the first call) use the box hierarchy.
+    std::vector<int> found;
+    if(!candidates)
+    {
+        m_quad_tree.findContaining(xyz, &found);
+        candidates = &found;
+    }
+
+    for(unsigned int n=0; n<2; n++)
+    {
+        const std::vector<int> &list = n==0 ? *candidates
+                                            : m_unbounded_nodes;
+        for(unsigned int i=0; i<list.size(); i++)
+        {
+            int order = (list[i]-start-1+num_nodes) % num_nodes;
+            if(order>best_order && getQuadOfNode(list[i]).pointInQuad3D(xyz))
+            {
+                best       = list[i];
+                best_order = order;
+            }
+        }   // for i<list.size()
+    }   // for n<2
+
+    *sector = best;
+
+#ifdef DEBUG
+    if(UserConfigParams::m_sector_debug && linear_sector!=best)
+        Log::error("Quad Graph", "findRoadSector: %d instead of %d at "
+                   "%f %f %f (previous %d).", best, linear_sector,
+                   xyz.getX(), xyz.getY(), xyz.getZ(), start);
+#endif
+}   // findRoadSector
+
+//-----------------------------------------------------------------------------
+/** findOutOfRoadSector finds the sector where XYZ is, but as it name
+    implies, it is more accurate for the outside of the track than the
+    inside, and for STK's needs the accuracy on top of the track is
+    unacceptable; but if this was a 2D function, the accuracy for out
+    of road sectors would be perfect.
+
+    To find the sector we look for the closest line segment from the
+    right and left drivelines, and the number of that segment will be
+    the sector.
+
+    The SIDE argument is used to speed up the function only; if we know
+    that XYZ is on the left or right side of the track, we know that
+    the closest driveline must be the one that matches that condition.
+    In reality, the side used in STK is the one from the previous frame,
+    but in order to move from one side to another a point would go
+    through the middle, that is handled by findRoadSector() which doesn't
+    has speed ups based on the side.
+
+    NOTE: This method of finding the sector outside of the road is *not*
+    perfect: if two line segments have a similar altitude (but enough to
+    let a kart get through) and they are very close on a 2D system,
+    if a kart is on the air it could be closer to the top line segment
+    even if it is supposed to be on the sector of the lower line segment.
+    Probably the best solution would be to construct a quad that reaches
+    until the next higher overlapping line segment, and find the closest
+    one to XYZ.
+ */
+int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
+                                   const int curr_sector,
+                                   std::vector<int> *all_sectors) const
+{
+    if(all_sectors || m_all_nodes.empty())
+        return findOutOfRoadSectorLinear(xyz, curr_sector, all_sectors);
+
+    // The linear search starts 10 quads before the current quad, and
+    // picks the first closest quad it finds. This is used to select the
+    // same node if several nodes have the same distance.
+    int start = 0;
+    if(curr_sector != UNKNOWN_SECTOR)
+    {
+        start = curr_sector - 10;
+        if(start<0) start += getNumNodes();
+    }
+
+    // If a kart is falling and in between (or too far below) a driveline
+    // point it might not fulfill the height condition. So we run the test
+    // twice: first with height condition, then again without the height
+    // condition - just to make sure it always comes back with some kind
+    // of quad.
+    const float max_dist_2 = 999999.0f*999999.0f;
+    int min_sector = findClosestNode(xyz, start, /*test_height*/true,
+                                     max_dist_2);
+    if(min_sector==UNKNOWN_SECTOR)
+        min_sector = findClosestNode(xyz, start, /*test_height*/false,
+                                     max_dist_2);
+
+    if(min_sector==UNKNOWN_SECTOR )
+    {
+        Log::info("Quad Grap", "unknown sector found.");
+    }
+
+#ifdef DEBUG
+    if(UserConfigParams::m_sector_debug)
+    {
+        int linear_sector = findOutOfRoadSectorLinear(xyz, curr_sector, NULL);
+        if(linear_sector!=min_sector)
+            Log::error("Quad Graph", "findOutOfRoadSector: %d instead of %d "
+                       "at %f %f %f (current %d).", min_sector, linear_sector,
+                       xyz.getX(), xyz.getY(), xyz.getZ(), curr_sector);
+    }
+#endif
+    return min_sector;
+}   // findOutOfRoadSector
+
+//-----------------------------------------------------------------------------
+/** Finds the graph node whose center line is closest to a point, using the
+ *  box hierarchy of all center lines. If several nodes have the same
+ *  distance, the node that comes first after the start node is returned,
+ *  which is the same node findOutOfRoadSectorLinear would return.
+ *  \param xyz The point.
+ *  \param start The node before the first node in search order.
+ *  \param test_height If true, only nodes whose quad is at most 1 above
+ *         or 5 below the point are considered.
+ *  \param max_dist_2 Nodes with this (or a larger) squared distance are
+ *         ignored.
+ *  \return The index of the closest node, or UNKNOWN_SECTOR.
+ */
+int QuadGraph::findClosestNode(const Vec3 &xyz, int start, bool test_height,
+                               float max_dist_2) const
+{
+    const int num_nodes = m_all_nodes.size();
+    int   best       = UNKNOWN_SECTOR;
+    int   best_order = num_nodes;
+    float best_dist_2 = max_dist_2;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while(top>0)
+    {
+        const AABBTree::Node &node = m_line_tree.getNode(stack[--top]);
+        // Allow for some rounding errors, since the distance to the line
+        // is computed differently from the distance to the box.
+        float box_dist_2 = node.m_box.getDistance2(xyz);
+        if(box_dist_2 > best_dist_2*1.0001f + 0.0001f)
+            continue;
+
+        if(node.m_count==0)
+        {
+            assert(top+2<=64);
+            // Visit the closer child first (i.e. push it last).
+            const AABBTree::Node &c0 = m_line_tree.getNode(node.m_first);
+            const AABBTree::Node &c1 = m_line_tree.getNode(node.m_first+1);
+            bool first_closer = c0.m_box.getDistance2(xyz)
+                             <= c1.m_box.getDistance2(xyz);
+            stack[top++] = first_closer ? node.m_first+1 : node.m_first;
+            stack[top++] = first_closer ? node.m_first   : node.m_first+1;
+            continue;
+        }
+
+        for(int i=node.m_first; i<node.m_first+node.m_count; i++)
+        {
+            int n = m_line_tree.getItem(i);
+            float dist_2 = m_all_nodes[n]->getDistance2FromPoint(xyz);
+            if(dist_2>best_dist_2) continue;
+            int order = (n-start-1+num_nodes) % num_nodes;
+            if(dist_2==best_dist_2 && order>best_order) continue;
+            if(test_height)
+            {
+                // While negative distances are unlikely, we allow some small
+                // negative numbers in case that the kart is partly in the
+                // track.
+                float dist = xyz.getY() - getQuadOfNode(n).getMinHeight();
+                if(dist >= 5.0f || dist <= -1.0f) continue;
+            }
+            best        = n;
+            best_order  = order;
+            best_dist_2 = dist_2;
+        }   // for i
+    }   // while top>0
+
+    return best;
+}   // findClosestNode
+
+//-----------------------------------------------------------------------------
+/** Builds the spatial index used by findRoadSector and findOutOfRoadSector:
+ *  a box hierarchy of all quads, the list of overlapping quads for each
+ *  quad, and a box hierarchy of the center lines of all nodes.
+ */
+void QuadGraph::buildSectorIndex()
+{
+    const unsigned int num_nodes = m_all_nodes.size();
+    m_quad_boxes.resize(num_nodes);
+    m_quad_neighbours.clear();
+    m_quad_neighbours.resize(num_nodes);
+    m_unbounded_nodes.clear();
+
+    std::vector<int> bounded_nodes;
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        Vec3 min, max;
+        if(!getQuadOfNode(i).getBoundingBox(&min, &max))
+        {
+            m_unbounded_nodes.push_back(i);
+            continue;
+        }
+        m_quad_boxes[i].set(min);
+        m_quad_boxes[i].extend(max);
+        // The box faces of a quad which is not flat are not exactly flat
+        // either, so add a small margin to the box.
+        m_quad_boxes[i].grow(0.5f);
+        bounded_nodes.push_back(i);
+    }
+    m_quad_tree.build(m_quad_boxes, bounded_nodes);
+
+    std::vector<int> found;
+    for(unsigned int i=0; i<bounded_nodes.size(); i++)
+    {
+        int n = bounded_nodes[i];
+        found.clear();
+        m_quad_tree.findOverlapping(m_quad_boxes[n], &found);
+        for(unsigned int j=0; j<found.size(); j++)
+        {
+            if(found[j]!=n && m_quad_boxes[n].overlaps(m_quad_boxes[found[j]]))
+                m_quad_neighbours[n].push_back(found[j]);
+        }
+    }   // for i < bounded_nodes.size()
+
+    std::vector<AABBTree::Box> line_boxes(num_nodes);
+    std::vector<int> all_nodes(num_nodes);
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        line_boxes[i].set(m_all_nodes[i]->getLowerCenter());
+        line_boxes[i].extend(m_all_nodes[i]->getUpperCenter());
+        all_nodes[i] = i;
+    }
+    m_line_tree.build(line_boxes, all_nodes);
+
+    if(UserConfigParams::m_sector_debug)
+        checkSectorIndex();
+}   // buildSectorIndex
+
+//-----------------------------------------------------------------------------
+/** Compares the results of findRoadSector and findOutOfRoadSector with the
+ *  linear search for a set of points around each quad, and prints the
+ *  number of differences found.
+ */
+void QuadGraph::checkSectorIndex() const
+{
+    const int num_nodes = m_all_nodes.size();
+    int num_tests = 0, num_errors = 0;
+    const float offsets[][3] = { {0,  0.5f, 0}, {0, 3.0f, 0}, {0, -0.8f, 0},
+                                 {1.5f, 1.0f, 0.7f}, {-2.0f, 0.5f, 1.2f},
+                                 {0, 8.0f, 0}, {15.0f, 0, -10.0f},
+                                 {0, -20.0f, 0} };
+    for(int i=0; i<num_nodes; i++)
+    {
+        const Quad &q = getQuadOfNode(i);
+        for(unsigned int j=0; j<sizeof(offsets)/sizeof(offsets[0]); j++)
+        {
+            // Test points close to the center and close to one corner
+            for(unsigned int k=0; k<2; k++)
+            {
+                Vec3 xyz = q.getCenter();
+                if(k==1)
+                    xyz = Vec3(q[1]*0.9f + q.getCenter()*0.1f);
+                xyz += Vec3(offsets[j][0], offsets[j][1], offsets[j][2]);
+                int prev[3] = {UNKNOWN_SECTOR, i, (i+num_nodes/2) % num_nodes};
+                for(unsigned int l=0; l<3; l++)
+                {
+                    num_tests++;
+                    int s1 = prev[l], s2 = prev[l];
+                    findRoadSector(xyz, &s1);
+                    findRoadSectorLinear(xyz, &s2, NULL);
+                    if(s1!=s2) num_errors++;
+                    if(findOutOfRoadSector(xyz, prev[l]) !=
+                       findOutOfRoadSectorLinear(xyz, prev[l], NULL))
+                        num_errors++;
+                }   // for l<3
+            }   // for k<2
+        }   // for j
+    }   // for i<num_nodes
+
+    Log::info("Quad Graph", "Sector index test: %d differences in %d tests, "
+              "%d unbounded quads.", num_errors, 2*num_tests,
+              (int)m_unbounded_nodes.size());
+}   // checkSectorIndex
+
+//-----------------------------------------------------------------------------
+/** The original implementation of findRoadSector, which tests all graph
+ *  nodes. It is still used if a list of sectors to test is given, and to
+ *  verify the result of the spatial index (see --sector-debug).
+ *  \param xyz Position for which the segment should be determined.
+ *  \param sector Contains the previous sector, and on return the result.
+ *  \param all_sectors If this is not NULL, it is a list of all sectors to
+ *         test.
+ */
+void QuadGraph::findRoadSectorLinear(const Vec3& xyz, int *sector,
+                                     std::vector<int> *all_sectors) const
 {
     // Most likely the kart will still be on the sector it was before,
     // so this simple case is tested first.
@@ -975,39 +1325,16 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
     }   // for i<m_all_nodes.size()
 
     return;
-}   // findRoadSector
+}   // findRoadSectorLinear
 
 //-----------------------------------------------------------------------------
-/** findOutOfRoadSector finds the sector where XYZ is, but as it name
-    implies, it is more accurate for the outside of the track than the
-    inside, and for STK's needs the accuracy on top of the track is
-    unacceptable; but if this was a 2D function, the accuracy for out
-    of road sectors would be perfect.
-
-    To find the sector we look for the closest line segment from the
-    right and left drivelines, and the number of that segment will be
-    the sector.
-
-    The SIDE argument is used to speed up the function only; if we know
-    that XYZ is on the left or right side of the track, we know that
-    the closest driveline must be the one that matches that condition.
-    In reality, the side used in STK is the one from the previous frame,
-    but in order to move from one side to another a point would go
-    through the middle, that is handled by findRoadSector() which doesn't
-    has speed ups based on the side.
-
-    NOTE: This method of finding the sector outside of the road is *not*
-    perfect: if two line segments have a similar altitude (but enough to
-    let a kart get through) and they are very close on a 2D system,
-    if a kart is on the air it could be closer to the top line segment
-    even if it is supposed to be on the sector of the lower line segment.
-    Probably the best solution would be to construct a quad that reaches
-    until the next higher overlapping line segment, and find the closest
-    one to XYZ.
+/** The original implementation of findOutOfRoadSector, which tests all
+ *  graph nodes. It is still used if a list of sectors to test is given, and
+ *  to verify the result of the spatial index (see --sector-debug).
  */
-int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
-                                   const int curr_sector,
-                                   std::vector<int> *all_sectors) const
+int QuadGraph::findOutOfRoadSectorLinear(const Vec3& xyz,
+                                         const int curr_sector,
+                                         std::vector<int> *all_sectors) const
 {
     int count = (all_sectors!=NULL) ? all_sectors->size() : getNumNodes();
     int current_sector = 0;
@@ -1081,7 +1408,7 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
         Log::info("Quad Grap", "unknown sector found.");
     }
     return min_sector;
-}   // findOutOfRoadSector
+}   // findOutOfRoadSectorLinear
 
 //-----------------------------------------------------------------------------
 /** Takes a snapshot of the driveline quads so they can be used as minimap.
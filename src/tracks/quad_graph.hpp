@@ -24,7 +24,9 @@
 #include <set>
 
 #include "tracks/graph_node.hpp"
+#include "tracks/navigation_cache.hpp"
 #include "tracks/quad_set.hpp"
+#include "utils/aabb_tree.hpp"
 #include "utils/aligned_array.hpp"
 #include "utils/no_copy.hpp"
 
@@ -82,6 +84,30 @@ private:
     /** Number of unrolled quads to compute per quad */
     unsigned int             m_unroll_quad_count;
 
+    /** Bounding boxes of the 3d boxes of the quads of all graph nodes
+     *  (i.e. the space in which pointInQuad3D is true). */
+    std::vector<AABBTree::Box> m_quad_boxes;
+
+    /** Hierarchy of m_quad_boxes, used by findRoadSector. */
+    AABBTree                 m_quad_tree;
+
+    /** For each graph node the list of all other graph nodes whose quad
+     *  box overlaps with the box of this node. A kart moving off a quad
+     *  will usually be on one of these nodes, and if a point is on this
+     *  node, it can only be on the nodes in this list as well. */
+    std::vector< std::vector<int> > m_quad_neighbours;
+
+    /** Graph nodes with a degenerated quad, for which no bounding box
+     *  exists. They are tested for each point. */
+    std::vector<int>         m_unbounded_nodes;
+
+    /** Hierarchy of the bounding boxes of the center lines of all graph
+     *  nodes, used by findOutOfRoadSector. */
+    AABBTree                 m_line_tree;
+
+    /** Precomputed data for the AI to find the point to aim at. */
+    NavigationCache          m_navigation_cache;
+
     void setDefaultSuccessors();
     void computeChecklineRequirements(GraphNode* node, int latest_checkline);
     void computeDirectionData();
@@ -90,6 +116,14 @@ private:
 
     void addSuccessor(unsigned int from, unsigned int to);
     void load         (const std::string &filename);
+    void buildSectorIndex();
+    void checkSectorIndex() const;
+    void findRoadSectorLinear(const Vec3& xyz, int *sector,
+                              std::vector<int> *all_sectors) const;
+    int  findOutOfRoadSectorLinear(const Vec3& xyz, const int curr_sector,
+                                   std::vector<int> *all_sectors) const;
+    int  findClosestNode(const Vec3 &xyz, int start, bool test_height,
+                         float max_dist_2) const;
     void computeDistanceFromStart(unsigned int start_node, float distance);
     void createMesh(bool show_invisible=true,
                     bool enable_transparency=false,
@@ -212,6 +246,10 @@ public:
     // ----------------------------------------------------------------------
     /** Returns the number of forward quads that are unrolled for each quad **/
     int          getNumberOfUnrolledQuads() const { return m_unroll_quad_count; }
+    // ----------------------------------------------------------------------
+    /** Returns the precomputed data for the AI. */
+    const NavigationCache &getNavigationCache() const
+                                               { return m_navigation_cache; }
 
 
 };   // QuadGraph
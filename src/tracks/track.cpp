@@ -54,6 +54,7 @@
 #include "race/race_manager.hpp"
 #include "tracks/bezier_curve.hpp"
 #include "tracks/check_manager.hpp"
+#include "tracks/height_map.hpp"
 #include "tracks/model_definition_loader.hpp"
 #include "tracks/track_manager.hpp"
 #include "tracks/quad_graph.hpp"
@@ -106,6 +107,7 @@ Track::Track(const std::string &filename)
     m_screenshot            = "";
     m_version               = 0;
     m_track_mesh            = NULL;
+    m_height_map            = NULL;
     m_gfx_effect_mesh       = NULL;
     m_internal              = false;
     m_enable_auto_rescue    = true;  // Below set to false in arenas
@@ -302,6 +304,9 @@ void Track::cleanup()
     delete m_track_mesh;
     m_track_mesh = NULL;
 
+    delete m_height_map;
+    m_height_map = NULL;
+
     delete m_gfx_effect_mesh;
     m_gfx_effect_mesh = NULL;
 
@@ -703,8 +708,13 @@ void Track::createPhysicsModel(unsigned int main_track_count)
     {
         convertTrackToBullet(m_all_nodes[i]);
     }
-    m_track_mesh->createPhysicalBody();
-    m_gfx_effect_mesh->createCollisionShape();
+    // The BVH of large tracks takes a long time to build, so it is cached
+    // (the cache is only used if the mesh has not changed).
+    std::string cache = file_manager->getCachedDataDir() + m_ident;
+    m_track_mesh->createPhysicalBody((btCollisionObject::CollisionFlags)0,
+                                     (cache+".bvh").c_str());
+    m_gfx_effect_mesh->createCollisionShape(/*create_collision_object*/true,
+                                            (cache+"-gfx.bvh").c_str());
 }   // createPhysicsModel
 
 // -----------------------------------------------------------------------------
@@ -2372,43 +2382,21 @@ bool Track::setTerrainHeight(Vec3 *pos) const
 }   // setTerrainHeight
 
 // ----------------------------------------------------------------------------
-
-std::vector< std::vector<float> > Track::buildHeightMap()
+/** Returns the height map of this track. It is computed (or loaded from the
+ *  cache) the first time it is requested, and then shared by everything
+ *  that needs it (e.g. all weather particle emitters).
+ */
+const HeightMap* Track::getHeightMap()
 {
-    std::vector< std::vector<float> > out(HEIGHT_MAP_RESOLUTION);
-
-    float x = m_aabb_min.getX();
-    const float x_len = m_aabb_max.getX() - m_aabb_min.getX();
-    const float z_len = m_aabb_max.getZ() - m_aabb_min.getZ();
-
-    const float x_step = x_len/HEIGHT_MAP_RESOLUTION;
-    const float z_step = z_len/HEIGHT_MAP_RESOLUTION;
-
-    btVector3 hitpoint;
-    const Material* material;
-    btVector3 normal;
-
-    for (int i=0; i<HEIGHT_MAP_RESOLUTION; i++)
+    if(!m_height_map)
     {
-        out[i].resize(HEIGHT_MAP_RESOLUTION);
-        float z = m_aabb_min.getZ();
-
-        for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
-        {
-            btVector3 pos(x, 100.0f, z);
-            btVector3 to = pos;
-            to.setY(-100000.f);
-
-            m_track_mesh->castRay(pos, to, &hitpoint, &material, &normal);
-            z += z_step;
-
-            out[i][j] = hitpoint.getY();
-        }   // j<HEIGHT_MAP_RESOLUTION
-        x += x_step;
+        m_height_map = new HeightMap(m_aabb_min, m_aabb_max,
+                                     HEIGHT_MAP_RESOLUTION);
+        m_height_map->build(*m_track_mesh,
+                      file_manager->getCachedDataDir()+m_ident+".heightmap");
     }
-
-    return out;
-}
+    return m_height_map;
+}   // getHeightMap
 
 // ----------------------------------------------------------------------------
 /** Returns the rotation of the sun. */
@@ -50,6 +50,7 @@ class ModelDefinitionLoader;
 class AnimationManager;
 class BezierCurve;
 class CheckManager;
+class HeightMap;
 class MovingTexture;
 class MusicInformation;
 class ParticleEmitter;
@@ -226,6 +227,9 @@ private:
     scene::ISceneNode  *m_sun;
     /** Used to collect the triangles for the bullet mesh. */
     TriangleMesh*            m_track_mesh;
+    /** The height map of this track, which is created the first time it
+     *  is needed (e.g. by weather particles), or NULL. */
+    HeightMap*               m_height_map;
     /** Used to collect the triangles which do not have a physical
      *  representation, but are needed for some raycast effects. An
      *  example is a water surface: the karts ignore this (i.e.
@@ -449,7 +453,7 @@ public:
                                         unsigned int mode_id=0);
     bool findGround(AbstractKart *kart);
 
-    std::vector< std::vector<float> > buildHeightMap();
+    const HeightMap*   getHeightMap();
     // ------------------------------------------------------------------------
     /** Returns the texture with the mini map for this track. */
     const video::ITexture*    getOldRttMiniMap() const { return m_old_rtt_mini_map; }
@@ -24,10 +24,14 @@
 #include <sstream>
 #include <iostream>
 
+#include "addons/addon.hpp"
 #include "audio/music_manager.hpp"
 #include "config/stk_config.hpp"
+#include "io/asset_index.hpp"
 #include "io/file_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/constants.hpp"
+#include "utils/string_utils.hpp"
 
 TrackManager* track_manager = 0;
 std::vector<std::string>  TrackManager::m_track_search_path;
@@ -64,16 +68,51 @@ void TrackManager::addTrackSearchDir(const std::string &dir)
  */
 Track* TrackManager::getTrack(const std::string& ident) const
 {
-    for(Tracks::const_iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
+    for(unsigned int i=0; i<m_track_idents.size(); i++)
     {
-        if ((*i)->getIdent() == ident)
-            return *i;
+        if (m_track_idents[i] == ident)
+            return getTrack(i);
     }
 
     return NULL;
 
 }   // getTrack
 
+//-----------------------------------------------------------------------------
+/** Returns the track with a given index number. The track object is created
+ *  the first time a track is requested.
+ *  \param index The index number of the track.
+ *  \return      The track object, or NULL if the track can not be loaded.
+ */
+Track* TrackManager::getTrack(unsigned int index) const
+{
+    if(!m_tracks[index])
+    {
+        try
+        {
+            m_tracks[index] = new Track(m_all_track_dirs[index]+"track.xml");
+        }
+        catch (std::exception& e)
+        {
+            Log::error("TrackManager", "Cannot load track <%s> : %s\n",
+                       m_all_track_dirs[index].c_str(), e.what());
+            return NULL;
+        }
+    }
+    return m_tracks[index];
+}   // getTrack
+
+//-----------------------------------------------------------------------------
+/** Returns true if a track with the given identifier exists. Unlike getTrack
+ *  this does not create the track object.
+ *  \param ident Identifier of the track.
+ */
+bool TrackManager::hasTrack(const std::string& ident) const
+{
+    return std::find(m_track_idents.begin(), m_track_idents.end(), ident)
+           != m_track_idents.end();
+}   // hasTrack
+
 //-----------------------------------------------------------------------------
 /** Removes all cached data from all tracks. This is called when the screen
  *  resolution is changed and all textures need to be bound again.
@@ -81,7 +120,10 @@ Track* TrackManager::getTrack(const std::string& ident) const
 void TrackManager::removeAllCachedData()
 {
     for(Tracks::const_iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
-        (*i)->removeCachedData();
+    {
+        if(*i)
+            (*i)->removeCachedData();
+    }
 }   // removeAllCachedData
 //-----------------------------------------------------------------------------
 /** Sets all tracks that are not in the list a to be unavailable. This is used
@@ -91,13 +133,13 @@ void TrackManager::removeAllCachedData()
  */
 void TrackManager::setUnavailableTracks(const std::vector<std::string> &tracks)
 {
-    for(Tracks::const_iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
+    for(unsigned int i=0; i<m_track_idents.size(); i++)
     {
-        if(!m_track_avail[i-m_tracks.begin()]) continue;
-        const std::string id=(*i)->getIdent();
+        if(!m_track_avail[i]) continue;
+        const std::string &id=m_track_idents[i];
         if (std::find(tracks.begin(), tracks.end(), id)==tracks.end())
         {
-            m_track_avail[i-m_tracks.begin()] = false;
+            m_track_avail[i] = false;
             Log::warn("TrackManager", "Track '%s' not available on all clients, disabled.",
                       id.c_str());
         }   // if id not in tracks
@@ -110,16 +152,14 @@ void TrackManager::setUnavailableTracks(const std::vector<std::string> &tracks)
  */
 std::vector<std::string> TrackManager::getAllTrackIdentifiers()
 {
-    std::vector<std::string> all;
-    for(Tracks::const_iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
-    {
-        all.push_back((*i)->getIdent());
-    }
-    return all;
+    return m_track_idents;
 }   // getAllTrackNames
 
 //-----------------------------------------------------------------------------
-/** Loads all tracks from the track directory (data/track).
+/** Indexes all tracks from the track directories. Only the data needed to
+ *  sort the tracks into groups is read, using an AssetIndex so that only new
+ *  or modified track.xml files are parsed (in parallel). The track objects
+ *  are created when a track is requested, see getTrack().
  */
 void TrackManager::loadTrackList()
 {
@@ -131,15 +171,23 @@ void TrackManager::loadTrackList()
     m_arena_groups.clear();
     m_soccer_arena_groups.clear();
     m_track_avail.clear();
+    m_track_idents.clear();
+    for(Tracks::iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
+        delete *i;
     m_tracks.clear();
 
+    static const char *attributes[] = { "version", "groups", "arena",
+                                        "soccer", "internal", NULL };
+    AssetIndex index("track", "tracks.index", attributes);
+
     for(unsigned int i=0; i<m_track_search_path.size(); i++)
     {
         const std::string &dir = m_track_search_path[i];
 
         // First test if the directory itself contains a track:
         // ----------------------------------------------------
-        if(loadTrack(dir)) continue;  // track found, no more tests
+        if(index.addDirectory(dir, dir+"track.xml"))
+            continue;  // track found, no more tests
 
         // Then see if a subdir of this dir contains tracks
         // ------------------------------------------------
@@ -149,14 +197,59 @@ void TrackManager::loadTrackList()
             subdir != dirs.end(); subdir++)
         {
             if(*subdir=="." || *subdir=="..") continue;
-            loadTrack(dir+*subdir+"/");
+            index.addDirectory(dir+*subdir+"/", dir+*subdir+"/track.xml");
         }   // for dir in dirs
     }   // for i <m_track_search_path.size()
+
+    index.update();
+
+    for(unsigned int i=0; i<index.getNumEntries(); i++)
+    {
+        const AssetIndex::Entry &entry = index.getEntry(i);
+        if(!entry.isValid())
+        {
+            Log::error("TrackManager", "Cannot load track <%s>.",
+                       entry.getDir().c_str());
+            continue;
+        }
+
+        // Same as Track::Track: the identifier is the name of the directory
+        std::string ident = StringUtils::getBasename(
+                            StringUtils::getPath(entry.getConfigFile()));
+        if(Addon::isAddon(entry.getConfigFile()))
+            ident = Addon::createAddonId(ident);
+
+        int version = 0;
+        entry.get("version", &version);
+        if (version<stk_config->m_min_track_version ||
+            version>stk_config->m_max_track_version)
+        {
+            Log::warn("TrackManager", "Track '%s' is not supported "
+                            "by this binary, ignored. (Track is version %i, this "
+                            "executable supports from %i to %i).",
+                      ident.c_str(), version,
+                      stk_config->m_min_track_version,
+                      stk_config->m_max_track_version);
+            continue;
+        }
+
+        std::vector<std::string> groups;
+        bool is_arena = false, is_soccer = false, internal = false;
+        entry.get("groups",   &groups  );
+        entry.get("arena",    &is_arena );
+        entry.get("soccer",   &is_soccer);
+        entry.get("internal", &internal );
+        if(groups.size()==0) groups.push_back(DEFAULT_GROUP_NAME);
+
+        addTrack(entry.getDir(), ident, NULL);
+        updateGroups(groups, is_arena, is_soccer, internal);
+    }   // for i < index.getNumEntries()
 }  // loadTrackList
 
 // ----------------------------------------------------------------------------
 /** Tries to load a track from a single directory. Returns true if a track was
- *  successfully loaded.
+ *  successfully loaded. This is used for tracks that are installed while the
+ *  game is running, e.g. by the addons manager.
  *  \param dirname Name of the directory to load the track from.
  */
 bool TrackManager::loadTrack(const std::string& dirname)
@@ -190,12 +283,26 @@ bool TrackManager::loadTrack(const std::string& dirname)
         delete track;
         return false;
     }
+    addTrack(dirname, track->getIdent(), track);
+    updateGroups(track->getGroups(), track->isArena(), track->isSoccer(),
+                 track->isInternal());
+    return true;
+}   // loadTrack
+
+// ----------------------------------------------------------------------------
+/** Adds a track to the list of all tracks.
+ *  \param dirname Directory of the track.
+ *  \param ident Identifier of the track.
+ *  \param track The track object, or NULL if it is created on demand.
+ */
+void TrackManager::addTrack(const std::string &dirname,
+                            const std::string &ident, Track *track)
+{
     m_all_track_dirs.push_back(dirname);
+    m_track_idents.push_back(ident);
     m_tracks.push_back(track);
     m_track_avail.push_back(true);
-    updateGroups(track);
-    return true;
-}   // loadTrack
+}   // addTrack
 
 // ----------------------------------------------------------------------------
 /** Removes a track.
@@ -266,6 +373,7 @@ void TrackManager::removeTrack(const std::string &ident)
     }   // for i in arenas, tracks
 
     m_tracks.erase(it);
+    m_track_idents.erase(m_track_idents.begin()+index);
     m_all_track_dirs.erase(m_all_track_dirs.begin()+index);
     m_track_avail.erase(m_track_avail.begin()+index);
     delete track;
@@ -273,22 +381,24 @@ void TrackManager::removeTrack(const std::string &ident)
 
 // ----------------------------------------------------------------------------
 /** \brief Updates the groups after a track was read in.
-  * \param track Pointer to the new track, whose groups are now analysed.
+  * \param new_groups The groups of the new track.
+  * \param is_arena True if the new track is an arena.
+  * \param is_soccer True if the new track is a soccer arena.
+  * \param internal True if the new track is internal (and not shown).
   */
-void TrackManager::updateGroups(const Track* track)
+void TrackManager::updateGroups(const std::vector<std::string> &new_groups,
+                                bool is_arena, bool is_soccer, bool internal)
 {
-    if (track->isInternal()) return;
-
-    const std::vector<std::string>& new_groups = track->getGroups();
+    if (internal) return;
 
     Group2Indices &group_2_indices =
-            (track->isArena() ? m_arena_groups :
-             (track->isSoccer() ? m_soccer_arena_groups :
+            (is_arena ? m_arena_groups :
+             (is_soccer ? m_soccer_arena_groups :
                m_track_groups));
 
     std::vector<std::string> &group_names =
-            (track->isArena() ? m_arena_group_names :
-             (track->isSoccer() ? m_soccer_arena_group_names :
+            (is_arena ? m_arena_group_names :
+             (is_soccer ? m_soccer_arena_group_names :
                m_track_group_names));
 
     const unsigned int groups_amount = new_groups.size();
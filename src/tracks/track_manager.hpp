@@ -26,7 +26,9 @@
 class Track;
 
 /**
-  * \brief Simple class to load and manage track data, track names and such
+  * \brief Simple class to load and manage track data, track names and such.
+  *  At startup the tracks are only indexed (see AssetIndex), a Track object
+  *  is created the first time a track is requested.
   * \ingroup tracks
   */
 class TrackManager
@@ -40,8 +42,11 @@ private:
 
     typedef std::vector<Track*>              Tracks;
 
-    /** All track objects. */
-    Tracks                                   m_tracks;
+    /** All track objects, NULL if a track was not requested yet. */
+    mutable Tracks                           m_tracks;
+
+    /** The identifiers of all tracks. */
+    std::vector<std::string>                 m_track_idents;
 
     typedef std::map<std::string, std::vector<int> > Group2Indices;
     /** List of all racing track groups. */
@@ -70,7 +75,10 @@ private:
      */
     std::vector<bool>                        m_track_avail;
 
-    void          updateGroups(const Track* track);
+    void          updateGroups(const std::vector<std::string> &groups,
+                               bool is_arena, bool is_soccer, bool internal);
+    void          addTrack(const std::string &dirname,
+                           const std::string &ident, Track *track);
 
 public:
                 TrackManager();
@@ -86,6 +94,8 @@ public:
     bool  loadTrack(const std::string& dirname);
     void  removeAllCachedData();
     Track* getTrack(const std::string& ident) const;
+    Track* getTrack(unsigned int index) const;
+    bool   hasTrack(const std::string& ident) const;
     // ------------------------------------------------------------------------
     /** Sets a list of track as being unavailable (e.g. in network mode the
      *  track is not on all connected machines.
@@ -114,10 +124,6 @@ public:
     /** Returns the number of tracks. */
     size_t getNumberOfTracks() const { return m_tracks.size(); }
     // ------------------------------------------------------------------------
-    /** Returns the track with a given index number.
-     *  \param index The index number of the track. */
-    Track* getTrack(unsigned int index) const { return m_tracks[index];}
-    // ------------------------------------------------------------------------
     /** Checks if a certain track is available.
      *  \param n Index of the track to check. */
     bool isAvailable(unsigned int n) const {return m_track_avail[n];}
@@ -0,0 +1,243 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/aabb_tree.hpp"
+
+#include "utils/vec3.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+void AABBTree::Box::set(const Vec3 &p)
+{
+    for(int i=0; i<3; i++)
+        m_min[i] = m_max[i] = p[i];
+}   // set
+
+// ----------------------------------------------------------------------------
+void AABBTree::Box::extend(const Vec3 &p)
+{
+    for(int i=0; i<3; i++)
+    {
+        if(p[i] < m_min[i]) m_min[i] = p[i];
+        if(p[i] > m_max[i]) m_max[i] = p[i];
+    }
+}   // extend
+
+// ----------------------------------------------------------------------------
+void AABBTree::Box::extend(const Box &b)
+{
+    for(int i=0; i<3; i++)
+    {
+        if(b.m_min[i] < m_min[i]) m_min[i] = b.m_min[i];
+        if(b.m_max[i] > m_max[i]) m_max[i] = b.m_max[i];
+    }
+}   // extend
+
+// ----------------------------------------------------------------------------
+/** Enlarges the box by f in all directions. */
+void AABBTree::Box::grow(float f)
+{
+    for(int i=0; i<3; i++)
+    {
+        m_min[i] -= f;
+        m_max[i] += f;
+    }
+}   // grow
+
+// ----------------------------------------------------------------------------
+bool AABBTree::Box::contains(const Vec3 &p) const
+{
+    for(int i=0; i<3; i++)
+        if(p[i] < m_min[i] || p[i] > m_max[i]) return false;
+    return true;
+}   // contains
+
+// ----------------------------------------------------------------------------
+bool AABBTree::Box::overlaps(const Box &b) const
+{
+    for(int i=0; i<3; i++)
+        if(b.m_max[i] < m_min[i] || b.m_min[i] > m_max[i]) return false;
+    return true;
+}   // overlaps
+
+// ----------------------------------------------------------------------------
+/** Returns the square of the distance of a point to this box (0 if the
+ *  point is inside of the box).
+ */
+float AABBTree::Box::getDistance2(const Vec3 &p) const
+{
+    float d2 = 0;
+    for(int i=0; i<3; i++)
+    {
+        float d = 0;
+        if(p[i] < m_min[i])      d = m_min[i] - p[i];
+        else if(p[i] > m_max[i]) d = p[i] - m_max[i];
+        d2 += d*d;
+    }
+    return d2;
+}   // getDistance2
+
+// ============================================================================
+/** Sorts items by the center of their boxes along one axis. */
+class BoxCenterLess
+{
+private:
+    const std::vector<AABBTree::Box> &m_boxes;
+    int m_axis;
+public:
+    BoxCenterLess(const std::vector<AABBTree::Box> &boxes, int axis)
+        : m_boxes(boxes), m_axis(axis) {}
+    bool operator()(int a, int b) const
+    {
+        return m_boxes[a].getCenter(m_axis) < m_boxes[b].getCenter(m_axis);
+    }
+};   // BoxCenterLess
+
+// ============================================================================
+/** Builds the tree.
+ *  \param boxes The boxes.
+ *  \param items The indices of the boxes to store in the tree.
+ */
+void AABBTree::build(const std::vector<Box> &boxes,
+                     const std::vector<int> &items)
+{
+    clear();
+    m_items = items;
+    if(m_items.empty())
+        return;
+    m_nodes.reserve(2*m_items.size()/LEAF_SIZE+1);
+    m_nodes.resize(1);
+    buildNode(0, 0, m_items.size(), boxes);
+}   // build
+
+// ----------------------------------------------------------------------------
+/** Removes all items from the tree. */
+void AABBTree::clear()
+{
+    m_nodes.clear();
+    m_items.clear();
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Recursively builds a node by splitting the items at the median of the
+ *  box centers along the longest axis.
+ */
+void AABBTree::buildNode(int node, int first, int count,
+                         const std::vector<Box> &boxes)
+{
+    Box box   = boxes[m_items[first]];
+    Box center_box;
+    for(int i=0; i<3; i++)
+        center_box.m_min[i] = center_box.m_max[i] = box.getCenter(i);
+    for(int i=first+1; i<first+count; i++)
+    {
+        const Box &b = boxes[m_items[i]];
+        box.extend(b);
+        for(int j=0; j<3; j++)
+        {
+            center_box.m_min[j] = std::min(center_box.m_min[j], b.getCenter(j));
+            center_box.m_max[j] = std::max(center_box.m_max[j], b.getCenter(j));
+        }
+    }
+    m_nodes[node].m_box = box;
+
+    if(count<=LEAF_SIZE)
+    {
+        m_nodes[node].m_first = first;
+        m_nodes[node].m_count = count;
+        return;
+    }
+
+    int axis = 0;
+    for(int i=1; i<3; i++)
+    {
+        if(center_box.m_max[i]-center_box.m_min[i] >
+           center_box.m_max[axis]-center_box.m_min[axis])
+            axis = i;
+    }
+    int half = count/2;
+    std::nth_element(m_items.begin()+first, m_items.begin()+first+half,
+                     m_items.begin()+first+count, BoxCenterLess(boxes, axis));
+
+    // Note that m_nodes might be reallocated in the recursive calls.
+    int child = m_nodes.size();
+    m_nodes[node].m_first = child;
+    m_nodes[node].m_count = 0;
+    m_nodes.resize(child+2);
+    buildNode(child,   first,      half,       boxes);
+    buildNode(child+1, first+half, count-half, boxes);
+}   // buildNode
+
+// ----------------------------------------------------------------------------
+/** Appends all items which might contain the point p to result. Note that
+ *  this uses the boxes of the leaves, so the caller still has to test each
+ *  item.
+ */
+void AABBTree::findContaining(const Vec3 &p, std::vector<int> *result) const
+{
+    if(m_nodes.empty()) return;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while(top>0)
+    {
+        const Node &node = m_nodes[stack[--top]];
+        if(!node.m_box.contains(p)) continue;
+        if(node.m_count>0)
+        {
+            for(int i=node.m_first; i<node.m_first+node.m_count; i++)
+                result->push_back(m_items[i]);
+        }
+        else
+        {
+            assert(top+2<=64);
+            stack[top++] = node.m_first;
+            stack[top++] = node.m_first+1;
+        }
+    }   // while top>0
+}   // findContaining
+
+// ----------------------------------------------------------------------------
+/** Appends all items which might overlap the box b to result. Like
+ *  findContaining this uses the boxes of the leaves.
+ */
+void AABBTree::findOverlapping(const Box &b, std::vector<int> *result) const
+{
+    if(m_nodes.empty()) return;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while(top>0)
+    {
+        const Node &node = m_nodes[stack[--top]];
+        if(!node.m_box.overlaps(b)) continue;
+        if(node.m_count>0)
+        {
+            for(int i=node.m_first; i<node.m_first+node.m_count; i++)
+                result->push_back(m_items[i]);
+        }
+        else
+        {
+            assert(top+2<=64);
+            stack[top++] = node.m_first;
+            stack[top++] = node.m_first+1;
+        }
+    }   // while top>0
+}   // findOverlapping
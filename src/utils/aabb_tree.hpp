@@ -0,0 +1,103 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_AABB_TREE_HPP
+#define HEADER_AABB_TREE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <vector>
+
+class Vec3;
+
+/**
+ * \brief A bounding volume hierarchy of axis aligned boxes.
+ *  The tree is built once from a set of boxes (each identified by an
+ *  integer), and can then be used to find all boxes containing a point or
+ *  overlapping another box in logarithmic time. The nodes are accessible
+ *  so that users can implement other queries, e.g. a nearest neighbour
+ *  search with their own distance function.
+ * \ingroup utils
+ */
+class AABBTree : public NoCopy
+{
+public:
+    /** An axis aligned box. */
+    struct Box
+    {
+        float m_min[3];
+        float m_max[3];
+
+        void  set(const Vec3 &p);
+        void  extend(const Vec3 &p);
+        void  extend(const Box &b);
+        void  grow(float f);
+        bool  contains(const Vec3 &p) const;
+        bool  overlaps(const Box &b) const;
+        float getDistance2(const Vec3 &p) const;
+        float getCenter(int axis) const
+        {
+            return 0.5f*(m_min[axis]+m_max[axis]);
+        }   // getCenter
+    };   // Box
+
+    // ------------------------------------------------------------------------
+    /** A node of the tree. */
+    struct Node
+    {
+        /** The box containing all boxes in this subtree. */
+        Box m_box;
+        /** For a leaf the index of the first entry in m_items, otherwise
+         *  the index of the first child (the second child follows it). */
+        int m_first;
+        /** Number of items of a leaf, 0 for an inner node. */
+        int m_count;
+    };   // Node
+
+private:
+    /** Maximum number of items in a leaf. */
+    static const int LEAF_SIZE = 4;
+
+    /** All nodes, node 0 is the root. */
+    std::vector<Node> m_nodes;
+
+    /** The items stored in the leaves. */
+    std::vector<int>  m_items;
+
+    void buildNode(int node, int first, int count,
+                   const std::vector<Box> &boxes);
+
+public:
+    void       build(const std::vector<Box> &boxes,
+                     const std::vector<int> &items);
+    void       clear();
+    void       findContaining(const Vec3 &p, std::vector<int> *result) const;
+    void       findOverlapping(const Box &b, std::vector<int> *result) const;
+    // ------------------------------------------------------------------------
+    /** Returns true if the tree contains no items. */
+    bool       empty() const { return m_nodes.empty(); }
+    // ------------------------------------------------------------------------
+    /** Returns the n-th node. Node 0 is the root. */
+    const Node& getNode(int n) const { return m_nodes[n]; }
+    // ------------------------------------------------------------------------
+    /** Returns the n-th item stored in the leaves. */
+    int        getItem(int n) const { return m_items[n]; }
+};   // AABBTree
+
+#endif
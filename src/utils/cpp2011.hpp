@@ -17,6 +17,14 @@
 #define STDCPP2003
 #endif
 
+// Storage class for plain (POD) variables that have one instance per thread.
+// C++11's thread_local is not supported by all compilers we use.
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 
 template<typename T, typename... Args>
 void pushVector(std::vector<T> &vec, Args ...args)
@@ -83,6 +83,9 @@
 
         void winCrashHandler(PCONTEXT pContext=NULL)
         {
+            // Write the log messages that are still queued
+            Log::flushBuffers();
+
             std::string callstack;
             if(pContext)
                 getCallStackWithContext(callstack, pContext);
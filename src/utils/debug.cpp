@@ -23,6 +23,7 @@
 #include "graphics/irr_driver.hpp"
 #include "items/powerup_manager.hpp"
 #include "items/attachment.hpp"
+#include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "physics/irr_debug_drawer.hpp"
 #include "physics/physics.hpp"
@@ -64,6 +65,7 @@ enum DebugMenuCommand
     DEBUG_GRAPHICS_BULLET_2,
     DEBUG_PROFILER,
     DEBUG_PROFILER_GENERATE_REPORT,
+    DEBUG_PROFILER_WRITE_TRACE,
     DEBUG_FPS,
     DEBUG_SAVE_REPLAY,
     DEBUG_SAVE_HISTORY,
@@ -195,7 +197,10 @@ bool onEvent(const SEvent &event)
 
             mnu->addItem(L"Profiler",DEBUG_PROFILER);
             if (UserConfigParams::m_profiler_enabled)
+            {
                 mnu->addItem(L"Toggle capture profiler report", DEBUG_PROFILER_GENERATE_REPORT);
+                mnu->addItem(L"Save profiler trace", DEBUG_PROFILER_WRITE_TRACE);
+            }
             mnu->addItem(L"Do not limit FPS", DEBUG_THROTTLE_FPS);
             mnu->addItem(L"FPS",DEBUG_FPS);
             mnu->addItem(L"Save replay", DEBUG_SAVE_REPLAY);
@@ -344,6 +349,11 @@ bool onEvent(const SEvent &event)
                 {
                     profiler.setCaptureReport(!profiler.getCaptureReport());
                 }
+                else if (cmdID == DEBUG_PROFILER_WRITE_TRACE)
+                {
+                    profiler.writeChromeTrace(
+                        file_manager->getUserConfigFile("profiling_trace.json"));
+                }
                 else if (cmdID == DEBUG_THROTTLE_FPS)
                 {
                     main_loop->setThrottleFPS(false);
@@ -0,0 +1,242 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LOCK_FREE_QUEUE_HPP
+#define HEADER_LOCK_FREE_QUEUE_HPP
+
+#include "utils/cpp2011.hpp"
+#include "utils/no_copy.hpp"
+
+#include <assert.h>
+#include <stddef.h>
+
+#ifdef STDCPP2011
+#  include <atomic>
+#else
+#  include <pthread.h>
+#endif
+
+#ifdef STDCPP2011
+
+/** A bounded queue that can be used by any number of producer and consumer
+ *  threads without any mutex. push() and pop() never block, they return
+ *  false if the queue is full or empty. It is a ring buffer where each cell
+ *  stores a sequence number that tells producers and consumers whether the
+ *  cell can be written or read (see D. Vyukov's bounded MPMC queue).
+ *  The capacity must be a power of two.
+ */
+template<typename TYPE>
+class LockFreeQueue : public NoCopy
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> m_sequence;
+        TYPE                m_data;
+    };
+
+    /** The ring buffer. */
+    Cell               *m_buffer;
+    /** Capacity - 1, used to compute the index in the ring buffer. */
+    const size_t        m_mask;
+
+    // Keep producer and consumer positions in separate cache lines to
+    // avoid false sharing.
+    char                m_pad0[64];
+    std::atomic<size_t> m_enqueue_pos;
+    char                m_pad1[64];
+    std::atomic<size_t> m_dequeue_pos;
+    char                m_pad2[64];
+
+public:
+    /** Creates a queue.
+     *  \param capacity Maximum number of elements, must be a power of 2.
+     */
+    LockFreeQueue(size_t capacity) : m_mask(capacity-1)
+    {
+        assert(capacity >= 2 && (capacity & (capacity-1)) == 0);
+        m_buffer = new Cell[capacity];
+        for (size_t i = 0; i < capacity; i++)
+            m_buffer[i].m_sequence.store(i, std::memory_order_relaxed);
+        m_enqueue_pos.store(0, std::memory_order_relaxed);
+        m_dequeue_pos.store(0, std::memory_order_relaxed);
+    }   // LockFreeQueue
+
+    // ------------------------------------------------------------------------
+    ~LockFreeQueue()
+    {
+        delete [] m_buffer;
+    }   // ~LockFreeQueue
+
+    // ------------------------------------------------------------------------
+    /** Adds an element at the end of the queue.
+     *  \return False if the queue is full.
+     */
+    bool push(const TYPE &data)
+    {
+        Cell *cell;
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &m_buffer[pos & m_mask];
+            size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+            ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (diff == 0)
+            {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;   // full
+            else
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+        cell->m_data = data;
+        cell->m_sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }   // push
+
+    // ------------------------------------------------------------------------
+    /** Removes the first element of the queue.
+     *  \param data Where the element is stored.
+     *  \return False if the queue is empty.
+     */
+    bool pop(TYPE *data)
+    {
+        Cell *cell;
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &m_buffer[pos & m_mask];
+            size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+            ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;   // empty
+            else
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        }
+        *data = cell->m_data;
+        cell->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }   // pop
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of elements in the queue. This is only a snapshot,
+     *  the value can be outdated by the time it is used. */
+    size_t sizeApprox() const
+    {
+        size_t e = m_enqueue_pos.load(std::memory_order_relaxed);
+        size_t d = m_dequeue_pos.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }   // sizeApprox
+
+    // ------------------------------------------------------------------------
+    size_t getCapacity() const { return m_mask + 1; }
+};   // LockFreeQueue
+
+#else
+
+/** Fallback for compilers without C++11 atomics: a bounded queue with the
+ *  same interface, which is protected by a mutex.
+ */
+template<typename TYPE>
+class LockFreeQueue : public NoCopy
+{
+private:
+    /** The ring buffer. */
+    TYPE                    *m_buffer;
+    /** Capacity - 1, used to compute the index in the ring buffer. */
+    const size_t             m_mask;
+    size_t                   m_enqueue_pos;
+    size_t                   m_dequeue_pos;
+    mutable pthread_mutex_t  m_mutex;
+
+public:
+    /** Creates a queue.
+     *  \param capacity Maximum number of elements, must be a power of 2.
+     */
+    LockFreeQueue(size_t capacity) : m_mask(capacity-1)
+    {
+        assert(capacity >= 2 && (capacity & (capacity-1)) == 0);
+        m_buffer      = new TYPE[capacity];
+        m_enqueue_pos = 0;
+        m_dequeue_pos = 0;
+        pthread_mutex_init(&m_mutex, NULL);
+    }   // LockFreeQueue
+
+    // ------------------------------------------------------------------------
+    ~LockFreeQueue()
+    {
+        pthread_mutex_destroy(&m_mutex);
+        delete [] m_buffer;
+    }   // ~LockFreeQueue
+
+    // ------------------------------------------------------------------------
+    /** Adds an element at the end of the queue.
+     *  \return False if the queue is full.
+     */
+    bool push(const TYPE &data)
+    {
+        pthread_mutex_lock(&m_mutex);
+        bool full = m_enqueue_pos - m_dequeue_pos > m_mask;
+        if (!full)
+            m_buffer[m_enqueue_pos++ & m_mask] = data;
+        pthread_mutex_unlock(&m_mutex);
+        return !full;
+    }   // push
+
+    // ------------------------------------------------------------------------
+    /** Removes the first element of the queue.
+     *  \param data Where the element is stored.
+     *  \return False if the queue is empty.
+     */
+    bool pop(TYPE *data)
+    {
+        pthread_mutex_lock(&m_mutex);
+        bool empty = m_enqueue_pos == m_dequeue_pos;
+        if (!empty)
+            *data = m_buffer[m_dequeue_pos++ & m_mask];
+        pthread_mutex_unlock(&m_mutex);
+        return !empty;
+    }   // pop
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of elements in the queue. This is only a snapshot,
+     *  the value can be outdated by the time it is used. */
+    size_t sizeApprox() const
+    {
+        pthread_mutex_lock(&m_mutex);
+        size_t size = m_enqueue_pos - m_dequeue_pos;
+        pthread_mutex_unlock(&m_mutex);
+        return size;
+    }   // sizeApprox
+
+    // ------------------------------------------------------------------------
+    size_t getCapacity() const { return m_mask + 1; }
+};   // LockFreeQueue
+
+#endif
+
+#endif
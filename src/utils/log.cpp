@@ -19,9 +19,19 @@
 #include "utils/log.hpp"
 
 #include "config/user_config.hpp"
+#include "utils/cpp2011.hpp"
+#include "utils/lock_free_queue.hpp"
+#include "utils/time.hpp"
 
 #include <cstdio>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef STDCPP2011
+#  include <atomic>
+#endif
 
 #ifdef ANDROID
 #  include <android/log.h>
@@ -35,6 +45,89 @@ Log::LogLevel Log::m_min_log_level = Log::LL_VERBOSE;
 bool          Log::m_no_colors     = false;
 FILE*         Log::m_file_stdout   = NULL;
 
+/** A formatted message. If the writer thread is running, it is formatted
+ *  by the calling thread and written by the writer thread. */
+struct LogRecord
+{
+    int          m_level;
+    int          m_thread;
+    double       m_time;
+    char         m_component[32];
+    char         m_message[1024];
+    /** The complete message if it does not fit into m_message, else NULL.
+     *  It is deleted once the message is written (or dropped). */
+    std::string *m_long_message;
+};   // LogRecord
+
+/** Serialises writing messages and emptying the queue, so that messages
+ *  written by the calling thread stay in order with the queued ones. */
+static pthread_mutex_t          g_write_mutex  = PTHREAD_MUTEX_INITIALIZER;
+/** Protects g_num_threads. */
+static pthread_mutex_t          g_thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** Number of threads that printed a message, used for the thread tags. */
+static int                      g_num_threads  = 0;
+/** The tag of the calling thread printed with each message, or -1 if the
+ *  thread has not printed a message yet. */
+static THREAD_LOCAL int         g_thread_tag   = -1;
+
+#ifdef STDCPP2011
+/** Messages waiting to be written by the writer thread. If the queue is
+ *  full, messages are dropped instead of blocking the calling thread. */
+static LockFreeQueue<LogRecord> g_log_queue(512);
+/** True while the writer thread is running. If false, messages are written
+ *  by the calling thread. */
+static std::atomic<bool>        g_writer_running(false);
+/** Number of messages dropped because the queue was full. */
+static std::atomic<int>         g_num_dropped(0);
+static pthread_t                g_writer_thread;
+/** Used by the writer thread to wait for new messages. */
+static pthread_mutex_t          g_wakeup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t           g_wakeup_cond  = PTHREAD_COND_INITIALIZER;
+/** True while the writer thread waits (or is about to wait) on
+ *  g_wakeup_cond, so that only then a new message needs to signal it. */
+static std::atomic<bool>        g_writer_waiting(false);
+#endif
+
+// ----------------------------------------------------------------------------
+/** Returns the time in seconds since the first message was printed. */
+static double getLogTime()
+{
+    static const double start = StkTime::getMonoTime();
+    return StkTime::getMonoTime() - start;
+}   // getLogTime
+
+// ----------------------------------------------------------------------------
+/** Returns the tag of the calling thread, which is a small number assigned
+ *  when the thread prints its first message (0 is usually the main thread).
+ */
+static int getThreadTag()
+{
+    if(g_thread_tag < 0)
+    {
+        pthread_mutex_lock(&g_thread_mutex);
+        g_thread_tag = g_num_threads++;
+        pthread_mutex_unlock(&g_thread_mutex);
+    }
+    return g_thread_tag;
+}   // getThreadTag
+
+#ifdef STDCPP2011
+// ----------------------------------------------------------------------------
+/** Wakes up the writer thread after a message was queued, if it is waiting.
+ */
+static void wakeWriterThread()
+{
+    // Pairs with the fence in Log::writerThread: either the writer thread
+    // sees the new message, or this thread sees that it is waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(!g_writer_waiting.load(std::memory_order_relaxed))
+        return;
+    pthread_mutex_lock(&g_wakeup_mutex);
+    pthread_cond_signal(&g_wakeup_cond);
+    pthread_mutex_unlock(&g_wakeup_mutex);
+}   // wakeWriterThread
+#endif
+
 // ----------------------------------------------------------------------------
 /** Selects background/foreground colors for the message depending on
  *  log level. It is only called if messages are not redirected to a file.
@@ -121,8 +214,11 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually prints the log message. If log messages are not redirected
- *  to a file, it tries to select a terminal colour.
+/** Formats a log message. If the writer thread is running, the message is
+ *  only added to a lock-free queue (or dropped if the queue is full), so the
+ *  calling thread never waits for the console or the log file. Otherwise,
+ *  and for fatal messages, the message is written immediately (after all
+ *  queued messages).
  *  \param level Log level of the message to print.
  *  \param format A printf-like format string.
  *  \param va_list The values to be printed for the format.
@@ -153,61 +249,234 @@ void Log::printMessage(int level, const char *component, const char *format,
     }
     __android_log_vprint(alp, "SuperTuxKart", format, args);
 #else
-    static const char *names[] = {"verbose", "debug  ", "info   ",
-                                  "warn   ", "error  ", "fatal  "};
+    LogRecord record;
+    record.m_level  = level;
+    record.m_thread = getThreadTag();
+    record.m_time   = getLogTime();
+    strncpy(record.m_component, component, sizeof(record.m_component));
+    record.m_component[sizeof(record.m_component)-1] = 0;
+    record.m_long_message = NULL;
 
-    // Using a va_list twice produces undefined results, ie crash.
-    // So make a copy if we're going to use it twice.
-    VALIST copy;
-    if (m_file_stdout)
+    // The arguments are needed a second time for a long message
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int length = vsnprintf(record.m_message, sizeof(record.m_message),
+                           format, args);
+    if(length >= (int)sizeof(record.m_message))
     {
-        va_copy(copy, args);
+        std::vector<char> buffer(length+1);
+        vsnprintf(&buffer[0], buffer.size(), format, args_copy);
+        record.m_long_message = new std::string(&buffer[0], length);
+    }
+    va_end(args_copy);
+
+#ifdef STDCPP2011
+    if(level < LL_FATAL && g_writer_running.load(std::memory_order_acquire))
+    {
+        if(g_log_queue.push(record))
+        {
+            wakeWriterThread();
+        }
+        else
+        {
+            delete record.m_long_message;
+            g_num_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        // If the writer thread was stopped in the meantime, its last call
+        // of writeQueuedMessages() might have missed this message.
+        if(!g_writer_running.load())
+            flushBuffers();
+        return;
     }
-#if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    VALIST copy2;
-    va_copy(copy2, args);
 #endif
 
+    pthread_mutex_lock(&g_write_mutex);
+    // Keep the order of the messages
+    writeQueuedMessages();
+    writeRecord(record);
+    fflush(stdout);
+    if(m_file_stdout)
+        fflush(m_file_stdout);
+    pthread_mutex_unlock(&g_write_mutex);
+#endif
+}   // printMessage
+
+// ----------------------------------------------------------------------------
+/** Writes a message to the console and/or the log file, and deletes the
+ *  long message of the record (if any). If log messages are not redirected
+ *  to a file, it tries to select a terminal colour. Must be called with
+ *  g_write_mutex locked.
+ *  \param record The message to write.
+ */
+void Log::writeRecord(LogRecord &record)
+{
+    static const char *names[] = {"verbose", "debug  ", "info   ",
+                                  "warn   ", "error  ", "fatal  "};
+
+    const int   level     = record.m_level;
+    const char *component = record.m_component;
+    const char *message   = record.m_long_message
+                          ? record.m_long_message->c_str()
+                          : record.m_message;
+
     // If we don't have a console file, write to stdout and hope for the best
     if(!m_file_stdout || level >= LL_WARN ||
         UserConfigParams::m_log_errors_to_console) // log to console & file
     {
-        VALIST out;
-        va_copy(out, args);
-
         setTerminalColor((LogLevel)level);
-        printf("[%s] %s: ", names[level], component);
-        vprintf(format, out);
+        printf("[%s] %9.3f T%-2d %s: %s", names[level], record.m_time,
+               record.m_thread, component, message);
         resetTerminalColor();  // this prints a \n
-
-        va_end(out);
     }
 
 #if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    static char szBuff[2048];
-    vsnprintf(szBuff, sizeof(szBuff), format, copy2);
-
     OutputDebugString("[");
     OutputDebugString(names[level]);
     OutputDebugString("] ");
     OutputDebugString(component);
     OutputDebugString(": ");
-    OutputDebugString(szBuff);
+    OutputDebugString(message);
     OutputDebugString("\r\n");
 #endif
-    
 
     if(m_file_stdout)
+        fprintf(m_file_stdout, "[%s] %9.3f T%-2d %s: %s\n", names[level],
+                record.m_time, record.m_thread, component, message);
+
+    delete record.m_long_message;
+    record.m_long_message = NULL;
+}   // writeRecord
+
+// ----------------------------------------------------------------------------
+/** Writes all messages in the queue, and reports dropped messages. Must be
+ *  called with g_write_mutex locked.
+ *  \return True if any message was written.
+ */
+bool Log::writeQueuedMessages()
+{
+#ifdef STDCPP2011
+    bool written = false;
+    LogRecord record;
+    while(g_log_queue.pop(&record))
     {
-        fprintf (m_file_stdout, "[%s] %s: ", names[level], component);
-        vfprintf(m_file_stdout, format, copy);
-        fprintf (m_file_stdout, "\n");
-        va_end(copy);
+        writeRecord(record);
+        written = true;
     }
 
+    int dropped = g_num_dropped.exchange(0, std::memory_order_relaxed);
+    if(dropped > 0)
+    {
+        LogRecord warning;
+        warning.m_level        = LL_WARN;
+        warning.m_thread       = getThreadTag();
+        warning.m_time         = getLogTime();
+        warning.m_long_message = NULL;
+        strcpy(warning.m_component, "Log");
+        snprintf(warning.m_message, sizeof(warning.m_message),
+                 "%d messages were dropped, the log queue was full.",
+                 dropped);
+        writeRecord(warning);
+        written = true;
+    }
+
+    // Output is buffered while the writer thread is running, so flush it
+    // once per batch of messages.
+    if(written)
+    {
+        fflush(stdout);
+        if(m_file_stdout)
+            fflush(m_file_stdout);
+    }
+    return written;
+#else
+    return false;
 #endif
-}   // printMessage
+}   // writeQueuedMessages-------------------------------------------------------
+/** Writes all queued messages from the calling thread. This is used when
+ *  the writer thread is stopped, and should be called before STK is
+ *  terminated abnormally (e.g. by a crash handler).
+ */
+void Log::flushBuffers()
+{
+#ifndef ANDROID
+    pthread_mutex_lock(&g_write_mutex);
+    writeQueuedMessages();
+    pthread_mutex_unlock(&g_write_mutex);
+#endif
+}   // flushBuffers
 
+// ----------------------------------------------------------------------------
+/** The writer thread: writes queued messages until stopWriterThread() is
+ *  called, and waits for new messages if the queue is empty.
+ */
+void* Log::writerThread(void *data)
+{
+#ifdef STDCPP2011
+    while(g_writer_running.load(std::memory_order_acquire))
+    {
+        pthread_mutex_lock(&g_write_mutex);
+        bool written = writeQueuedMessages();
+        pthread_mutex_unlock(&g_write_mutex);
+        if(written)
+            continue;
+
+        pthread_mutex_lock(&g_wakeup_mutex);
+        g_writer_waiting.store(true, std::memory_order_relaxed);
+        // Pairs with the fence in wakeWriterThread()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(g_writer_running.load() && g_log_queue.sizeApprox() == 0)
+            pthread_cond_wait(&g_wakeup_cond, &g_wakeup_mutex);
+        g_writer_waiting.store(false, std::memory_order_relaxed);
+        pthread_mutex_unlock(&g_wakeup_mutex);
+    }
+#endif
+    return NULL;
+}   // writerThread
+
+// ----------------------------------------------------------------------------
+/** Starts the thread that writes log messages. Until then, messages are
+ *  written by the calling thread. The queue needs C++11 atomics, so without
+ *  them (STDCPP2003) the messages are always written by the calling thread.
+ */
+void Log::startWriterThread()
+{
+#if defined(STDCPP2011) && !defined(ANDROID)
+    if(g_writer_running.load()) return;
+    g_writer_running.store(true, std::memory_order_release);
+    if(pthread_create(&g_writer_thread, NULL, &Log::writerThread, NULL) != 0)
+    {
+        g_writer_running.store(false);
+        warn("Log", "Could not create the log writer thread.");
+        return;
+    }
+    // Don't lose queued messages if exit() is called somewhere
+    static bool registered = false;
+    if(!registered)
+        atexit(&Log::stopWriterThread);
+    registered = true;
+#endif
+}   // startWriterThread
+
+// ----------------------------------------------------------------------------
+/** Stops the writer thread after all queued messages are written. Messages
+ *  printed afterwards are written by the calling thread. It is safe to call
+ *  this function more than once.
+ */
+void Log::stopWriterThread()
+{
+#ifdef STDCPP2011
+    if(!g_writer_running.exchange(false))
+        return;
+    // Signal under the mutex, so the writer thread can not miss it between
+    // testing g_writer_running and waiting.
+    pthread_mutex_lock(&g_wakeup_mutex);
+    pthread_cond_signal(&g_wakeup_cond);
+    pthread_mutex_unlock(&g_wakeup_mutex);
+    pthread_join(g_writer_thread, NULL);
+    // Write messages that were queued while the thread was stopping
+    flushBuffers();
+#endif
+}   // stopWriterThread
 
 // ----------------------------------------------------------------------------
 /** This function opens the files that will contain the output.
@@ -222,17 +491,17 @@ void Log::openOutputFiles(const std::string &logout)
         Log::error("main", "Can not open log file '%s'. Writing to "
                            "stdout instead.", logout.c_str());
     }
-    else
-    {
-        // Disable buffering so that messages are seen asap
-        setvbuf(m_file_stdout, NULL, _IONBF, 0);
-    }
-} // closeOutputFiles
+    // The writer thread flushes the output after each batch of messages,
+    // so buffering can be used.
+    startWriterThread();
+} // openOutputFiles
 
 // ----------------------------------------------------------------------------
 /** Function to close output files */
 void Log::closeOutputFiles()
 {
+    stopWriterThread();
     fclose(m_file_stdout);
+    m_file_stdout = NULL;
 } // closeOutputFiles
 
@@ -36,6 +36,15 @@
 #  define va_copy(dest, src) dest = src
 #endif
 
+/** Messages with a level below this value are removed at compile time, e.g.
+ *  define it as 2 (Log::LL_INFO) to remove all debug and verbose messages.
+ *  Use Log::isEnabled() to also skip computing expensive arguments. */
+#ifndef STK_MIN_LOG_LEVEL
+#  define STK_MIN_LOG_LEVEL 0
+#endif
+
+struct LogRecord;
+
 class Log
 {
 public:
@@ -61,6 +70,10 @@ private:
 
     static void setTerminalColor(LogLevel level);
     static void resetTerminalColor();
+    static void writeRecord(LogRecord &record);
+    static bool writeQueuedMessages();
+    static void startWriterThread();
+    static void* writerThread(void *data);
 
 public:
 
@@ -73,7 +86,8 @@ public:
 #define LOG(NAME, LEVEL)                                             \
     static void NAME(const char *component, const char *format, ...) \
     {                                                                \
-        if(LEVEL < m_min_log_level) return;                          \
+        if(LEVEL < STK_MIN_LOG_LEVEL || LEVEL < m_min_log_level)     \
+            return;                                                  \
         va_list args;                                                \
         va_start(args, format);                                      \
         printMessage(LEVEL, component, format, args);                \
@@ -96,6 +110,10 @@ public:
 
     static void closeOutputFiles();
 
+    static void stopWriterThread();
+
+    static void flushBuffers();
+
     // ------------------------------------------------------------------------
     /** Defines the minimum log level to be displayed. */
     static void setLogLevel(int n)
@@ -115,6 +133,13 @@ public:
      *  replacing the cleartext password in an http request). */
     static LogLevel getLogLevel() { return m_min_log_level;  }
     // ------------------------------------------------------------------------
+    /** Returns true if messages of the given level are printed. This can be
+     *  used to avoid computing the arguments of a message in hot paths. */
+    static bool isEnabled(LogLevel level)
+    {
+        return level >= STK_MIN_LOG_LEVEL && level >= m_min_log_level;
+    }   // isEnabled
+    // ------------------------------------------------------------------------
     /** Disable coloring of log messages. */
     static void disableColor()
     {
@@ -21,6 +21,8 @@
 #include "guiengine/event_handler.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/scalable_font.hpp"
+#include "utils/cpp2011.hpp"
+#include "utils/log.hpp"
 #include "utils/vs.hpp"
 
 #include <assert.h>
@@ -28,6 +30,8 @@
 #include <sstream>
 #include <algorithm>
 #include <fstream>
+#include <stdio.h>
+#include <string.h>
 
 Profiler profiler;
 
@@ -67,24 +71,226 @@ Profiler profiler;
 #endif
 // --- End portable precise timer ---
 
+/** The profiler information of the current thread, or NULL if the thread
+ *  has not used the profiler yet. */
+static THREAD_LOCAL void *g_thread_info = NULL;
+
 //-----------------------------------------------------------------------------
 Profiler::Profiler()
 {
-    m_thread_infos.resize(1);    // TODO: monothread now, should support multithreading
-    m_write_id = 0;
-    m_time_last_sync = getTimeMilliseconds();
+    for (int i = 0; i < MAX_THREADS; i++)
+        m_thread_infos[i] = NULL;
+    m_num_threads = 0;
+    pthread_mutex_init(&m_threads_mutex, NULL);
+    pthread_mutex_init(&m_names_mutex, NULL);
+
+    // Name 0 is used if the name table is full.
+    strcpy(m_names[0].m_name, "Other");
+    m_names[0].m_color = video::SColor(0xFF, 0x80, 0x80, 0x80);
+    m_num_names = 1;
+
+    m_time_start = getTimeMilliseconds();
+    m_time_last_sync = m_time_start;
     m_time_between_sync = 0.0;
     m_freeze_state = UNFROZEN;
     m_capture_report = false;
     m_first_capture_sweep = true;
     m_capture_report_buffer = NULL;
+
+    // The profiler is a global object, so this is the main thread
+    setThreadName("Main");
 }
 
 //-----------------------------------------------------------------------------
 Profiler::~Profiler()
 {
+    for (int i = 0; i < m_num_threads; i++)
+    {
+#ifndef STDCPP2011
+        pthread_mutex_destroy(&m_thread_infos[i]->m_events_mutex);
+#endif
+        delete [] m_thread_infos[i]->m_events;
+        delete m_thread_infos[i];
+    }
+    pthread_mutex_destroy(&m_threads_mutex);
+    pthread_mutex_destroy(&m_names_mutex);
 }
 
+//-----------------------------------------------------------------------------
+/** Returns the information of the calling thread. On the first call from a
+ *  thread its ring buffer is allocated and the thread is registered.
+ *  \return The thread information, or NULL if too many threads are used.
+ */
+Profiler::ThreadInfo* Profiler::getThreadInfo()
+{
+    if (g_thread_info)
+        return (ThreadInfo*)g_thread_info;
+
+    pthread_mutex_lock(&m_threads_mutex);
+    int index = m_num_threads;
+    if (index >= MAX_THREADS)
+    {
+        pthread_mutex_unlock(&m_threads_mutex);
+        return NULL;
+    }
+    ThreadInfo *ti = new ThreadInfo();
+    ti->m_index = index;
+    snprintf(ti->m_name, sizeof(ti->m_name), "Thread %d", index);
+    ti->m_events = new Event[EVENT_BUFFER_SIZE];
+#ifndef STDCPP2011
+    pthread_mutex_init(&ti->m_events_mutex, NULL);
+#endif
+    setNumEvents(ti, 0);
+    for (int i = 0; i < NAME_CACHE_SIZE; i++)
+        ti->m_name_cache[i].m_pointer = NULL;
+    ti->m_read_index = 0;
+    ti->m_open_markers.reserve(16);
+    ti->m_markers_done.reserve(256);
+    m_thread_infos[index] = ti;
+    m_num_threads = index + 1;
+    pthread_mutex_unlock(&m_threads_mutex);
+
+    g_thread_info = ti;
+    return ti;
+}   // getThreadInfo
+
+//-----------------------------------------------------------------------------
+/** Returns the number of threads that used the profiler. */
+int Profiler::getNumThreads()
+{
+    pthread_mutex_lock(&m_threads_mutex);
+    int num_threads = m_num_threads;
+    pthread_mutex_unlock(&m_threads_mutex);
+    return num_threads;
+}   // getNumThreads
+
+//-----------------------------------------------------------------------------
+/** Returns the number of events written by a thread. All events before
+ *  that number are completely written.
+ *  \param ti The information of the thread.
+ */
+uint32_t Profiler::getNumEvents(const ThreadInfo *ti)
+{
+#ifdef STDCPP2011
+    return ti->m_num_events.load(std::memory_order_acquire);
+#else
+    pthread_mutex_lock(&ti->m_events_mutex);
+    uint32_t n = ti->m_num_events;
+    pthread_mutex_unlock(&ti->m_events_mutex);
+    return n;
+#endif
+}   // getNumEvents
+
+//-----------------------------------------------------------------------------
+/** Publishes the events of a thread, only called by the owning thread.
+ *  \param ti The information of the thread.
+ *  \param n The new number of events.
+ */
+void Profiler::setNumEvents(ThreadInfo *ti, uint32_t n)
+{
+#ifdef STDCPP2011
+    ti->m_num_events.store(n, std::memory_order_release);
+#else
+    pthread_mutex_lock(&ti->m_events_mutex);
+    ti->m_num_events = n;
+    pthread_mutex_unlock(&ti->m_events_mutex);
+#endif
+}   // setNumEvents
+
+//-----------------------------------------------------------------------------
+/** Sets the name of the calling thread, which is used in the trace file.
+ *  \param name Name of the thread.
+ */
+void Profiler::setThreadName(const char *name)
+{
+    ThreadInfo *ti = getThreadInfo();
+    if (!ti) return;
+    strncpy(ti->m_name, name, sizeof(ti->m_name)-1);
+    ti->m_name[sizeof(ti->m_name)-1] = 0;
+}   // setThreadName
+
+//-----------------------------------------------------------------------------
+/** Returns the index of a marker name. Names are nearly always string
+ *  literals, so the index is first looked up by the pointer in a small per
+ *  thread cache. Since some names are temporary strings whose address can
+ *  be reused for a different name, a cache hit is only used if the stored
+ *  name matches. Only if this fails the global name table is searched (and
+ *  the name added if necessary) under a lock.
+ *  \param ti The information of the calling thread.
+ *  \param name The name of the marker.
+ *  \param color The color used when drawing this marker (only the color
+ *         used in the first call for a name is used).
+ */
+uint16_t Profiler::internName(ThreadInfo *ti, const char *name,
+                              const video::SColor &color)
+{
+    size_t hash = ((size_t)name >> 2) % NAME_CACHE_SIZE;
+    NameCacheEntry &entry = ti->m_name_cache[hash];
+    if (entry.m_pointer == name &&
+        strncmp(m_names[entry.m_name].m_name, name,
+                sizeof(m_names[entry.m_name].m_name)-1) == 0)
+        return entry.m_name;
+
+    uint16_t index;
+    pthread_mutex_lock(&m_names_mutex);
+    std::map<std::string, uint16_t>::const_iterator it =
+                                                   m_name_index.find(name);
+    if (it != m_name_index.end())
+    {
+        index = it->second;
+    }
+    else
+    {
+        int n = m_num_names;
+        if (n < MAX_NAMES)
+        {
+            strncpy(m_names[n].m_name, name, sizeof(m_names[n].m_name)-1);
+            m_names[n].m_name[sizeof(m_names[n].m_name)-1] = 0;
+            m_names[n].m_color = color;
+            m_name_index[name] = n;
+            m_num_names = n + 1;
+            index = n;
+        }
+        else
+            index = 0;
+    }
+    pthread_mutex_unlock(&m_names_mutex);
+
+    // Only cache real names, so that a full name table is retried
+    if (index > 0)
+    {
+        entry.m_pointer = name;
+        entry.m_name    = index;
+    }
+    return index;
+}   // internName
+
+//-----------------------------------------------------------------------------
+/** Appends an event to the ring buffer of a thread.
+ */
+void Profiler::addEvent(ThreadInfo *ti, uint16_t name, bool begin)
+{
+    uint32_t n = getNumEvents(ti);
+    Event &e = ti->m_events[n % EVENT_BUFFER_SIZE];
+    e.m_time  = getTimeMilliseconds();
+    e.m_name  = name;
+    e.m_begin = begin;
+    setNumEvents(ti, n + 1);
+}   // addEvent
+
+//-----------------------------------------------------------------------------
+/** Returns the number of the oldest event of a thread that can still be
+ *  read. The owning thread keeps on writing while the events are read, so
+ *  a safety margin is kept to the events that might get overwritten.
+ *  \param end Number of events written (read with acquire semantics).
+ */
+uint32_t Profiler::getFirstValidEvent(uint32_t end)
+{
+    const uint32_t available = EVENT_BUFFER_SIZE - EVENT_BUFFER_SIZE/8;
+    return end > available ? end - available : 0;
+}   // getFirstValidEvent
+
+//-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
 void Profiler::setCaptureReport(bool captureReport)
@@ -115,94 +321,93 @@ void Profiler::setCaptureReport(bool captureReport)
 /// Push a new marker that starts now
 void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
 {
-    // Don't do anything when frozen
-    if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
-        return;
-
-    ThreadInfo& ti = getThreadInfo();
-    MarkerStack& markers_stack = ti.markers_stack[m_write_id];
-    double  start = getTimeMilliseconds() - m_time_last_sync;
-    size_t  layer = markers_stack.size();
-
-    // Add to the stack of current markers
-    markers_stack.push(Marker(start, -1.0, name, color, layer));
+    ThreadInfo *ti = getThreadInfo();
+    if (!ti) return;
+    addEvent(ti, internName(ti, name, color), true);
 }
 
 //-----------------------------------------------------------------------------
 /// Stop the last pushed marker
 void Profiler::popCpuMarker()
 {
-    // Don't do anything when frozen
-    if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
-        return;
+    ThreadInfo *ti = getThreadInfo();
+    if (!ti) return;
+    addEvent(ti, 0, false);
+}
 
-    ThreadInfo&    ti = getThreadInfo();
-    assert(ti.markers_stack[m_write_id].size() > 0);
+//-----------------------------------------------------------------------------
+/** Converts the new events of one thread into markers. Markers that are not
+ *  finished yet are closed at the time of the synchronisation (so they are
+ *  shown in this frame) and restarted for the next frame.
+ *  \param ti The thread.
+ *  \param now Time of the synchronisation.
+ *  \param keep If false, the finished markers are not stored (e.g. while
+ *         the display is frozen), only the open markers are updated.
+ */
+void Profiler::collectMarkers(ThreadInfo *ti, double now, bool keep)
+{
+    if (keep)
+        ti->m_markers_done.clear();
 
-    MarkerStack& markers_stack = ti.markers_stack[m_write_id];
-    MarkerList&  markers_done  = ti.markers_done[m_write_id];
+    uint32_t end   = getNumEvents(ti);
+    uint32_t first = getFirstValidEvent(end);
+    if ((int32_t)(first - ti->m_read_index) > 0)
+    {
+        // Events were lost, so the nesting is not known anymore
+        ti->m_open_markers.clear();
+        ti->m_read_index = first;
+    }
 
-    // Update the date of end of the marker
-    Marker&     marker = markers_stack.top();
-    marker.end = getTimeMilliseconds() - m_time_last_sync;
+    for (uint32_t i = ti->m_read_index; i != end; i++)
+    {
+        const Event &e = ti->m_events[i % EVENT_BUFFER_SIZE];
+        if (e.m_begin)
+        {
+            Marker m;
+            m.start = e.m_time - m_time_last_sync;
+            m.end   = -1.0;
+            m.layer = ti->m_open_markers.size();
+            m.name  = e.m_name;
+            ti->m_open_markers.push_back(m);
+        }
+        else if (!ti->m_open_markers.empty())
+        {
+            Marker &m = ti->m_open_markers.back();
+            m.end = e.m_time - m_time_last_sync;
+            if (keep)
+                ti->m_markers_done.push_back(m);
+            ti->m_open_markers.pop_back();
+        }
+    }
+    ti->m_read_index = end;
 
-    // Remove the marker from the stack and add it to the list of markers done
-    markers_done.push_front(marker);
-    markers_stack.pop();
-}
+    for (unsigned int i = 0; i < ti->m_open_markers.size(); i++)
+    {
+        Marker &m = ti->m_open_markers[i];
+        if (keep)
+        {
+            Marker done = m;
+            done.end = now - m_time_last_sync;
+            ti->m_markers_done.push_back(done);
+        }
+        // Times of the next frame are relative to 'now'
+        m.start = 0.0;
+    }
+}   // collectMarkers
 
 //-----------------------------------------------------------------------------
-/// Swap buffering for the markers
+/// Collects the markers of all threads for the frame that just ended
 void Profiler::synchronizeFrame()
 {
-    // Don't do anything when frozen
-    if(m_freeze_state == FROZEN)
-        return;
-
     // Avoid using several times getTimeMilliseconds(), which would yield different results
     double now = getTimeMilliseconds();
 
-    // Swap buffers
-    int old_write_id = m_write_id;
-    m_write_id = !m_write_id;
-
-    // For each thread:
-    ThreadInfoList::iterator it_end = m_thread_infos.end();
-    for(ThreadInfoList::iterator it = m_thread_infos.begin() ; it != it_end ; it++)
-    {
-        // Get the thread information
-        ThreadInfo& ti = *it;
+    int num_threads = getNumThreads();
+    for (int i = 0; i < num_threads; i++)
+        collectMarkers(m_thread_infos[i], now, m_freeze_state != FROZEN);
 
-        MarkerList&  old_markers_done  = ti.markers_done[old_write_id];
-        MarkerStack& old_markers_stack = ti.markers_stack[old_write_id];
-
-        MarkerList&  new_markers_done  = ti.markers_done[m_write_id];
-        MarkerStack& new_markers_stack = ti.markers_stack[m_write_id];
-
-        // Clear the containers for the new frame
-        new_markers_done.clear();
-        while(!new_markers_stack.empty())
-            new_markers_stack.pop();
-
-        // Finish the markers in the stack of the previous frame
-        // and start them for the next frame.
-
-        // For each marker in the old stack:
-        while(!old_markers_stack.empty())
-        {
-            // - finish the marker for the previous frame and add it to the old "done" list
-            Marker& m = old_markers_stack.top();
-            m.end = now - m_time_last_sync;
-            old_markers_done.push_front(m);
-
-            // - start a new one for the new frame
-            Marker new_marker(0.0, -1.0, m.name.c_str(), m.color);
-            new_markers_stack.push(new_marker);
-
-            // - next iteration
-            old_markers_stack.pop();
-        }
-    }
+    if (m_freeze_state == FROZEN)
+        return;
 
     // Remember the date of last synchronization
     m_time_between_sync = now - m_time_last_sync;
@@ -215,6 +420,64 @@ void Profiler::synchronizeFrame()
         m_freeze_state = UNFROZEN;
 }
 
+//-----------------------------------------------------------------------------
+/** Writes all events still stored in the ring buffers of all threads in the
+ *  Chrome trace event format. The file can be opened with Chrome's
+ *  about:tracing page.
+ *  \param filename Name of the file to write.
+ *  \return False if the file could not be written.
+ */
+bool Profiler::writeChromeTrace(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "w");
+    if (!file)
+    {
+        Log::error("Profiler", "Can't open '%s' to write the trace.",
+                   filename.c_str());
+        return false;
+    }
+
+    double now = getTimeMilliseconds();
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first_event = true;
+    int num_threads = getNumThreads();
+    for (int t = 0; t < num_threads; t++)
+    {
+        const ThreadInfo *ti = m_thread_infos[t];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first_event ? "" : ",\n", t, ti->m_name);
+        first_event = false;
+
+        uint32_t end   = getNumEvents(ti);
+        uint32_t first = getFirstValidEvent(end);
+        // End events of markers started before the first event are skipped,
+        // markers not finished yet are ended 'now'.
+        int depth = 0;
+        for (uint32_t i = first; i != end; i++)
+        {
+            const Event &e = ti->m_events[i % EVENT_BUFFER_SIZE];
+            if (!e.m_begin && depth == 0)
+                continue;
+            depth += e.m_begin ? 1 : -1;
+            if (e.m_begin)
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"B\",\"pid\":1,"
+                        "\"tid\":%d,\"ts\":%.3f}", m_names[e.m_name].m_name,
+                        t, (e.m_time - m_time_start)*1000.0);
+            else
+                fprintf(file, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,"
+                        "\"ts\":%.3f}", t, (e.m_time - m_time_start)*1000.0);
+        }
+        for (; depth > 0; depth--)
+            fprintf(file, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%.3f}", t, (now - m_time_start)*1000.0);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+    Log::info("Profiler", "Trace written to '%s'.", filename.c_str());
+    return true;
+}   // writeChromeTrace
+
 //-----------------------------------------------------------------------------
 /// Draw the markers
 void Profiler::draw()
@@ -227,8 +490,6 @@ void Profiler::draw()
     // Force to show the pointer
     irr_driver->showPointer();
 
-    int read_id = (m_freeze_state == FROZEN ? !m_write_id : m_write_id);
-
     // Compute some values for drawing (unit: pixels, but we keep floats for reducing errors accumulation)
     core::dimension2d<u32>    screen_size    = driver->getScreenSize();
     const double profiler_width = (1.0 - 2.0*MARGIN_X) * screen_size.Width;
@@ -236,19 +497,18 @@ void Profiler::draw()
     const double y_offset    = (MARGIN_Y + LINE_HEIGHT)*screen_size.Height;
     const double line_height = LINE_HEIGHT*screen_size.Height;
 
-    size_t nb_thread_infos = m_thread_infos.size();
+    size_t nb_thread_infos = getNumThreads();
 
 
     double start = -1.0f;
     double end = -1.0f;
     for (size_t i = 0; i < nb_thread_infos; i++)
     {
-        MarkerList& markers = m_thread_infos[i].markers_done[read_id];
+        const std::vector<Marker> &markers = m_thread_infos[i]->m_markers_done;
 
-        MarkerList::const_iterator it_end = markers.end();
-        for (MarkerList::const_iterator it = markers.begin(); it != it_end; it++)
+        for (unsigned int j = 0; j < markers.size(); j++)
         {
-            const Marker& m = *it;
+            const Marker& m = markers[j];
 
             if (start < 0.0) start = m.start;
             else start = std::min(start, m.start);
@@ -268,7 +528,7 @@ void Profiler::draw()
     for (size_t i = 0; i < nb_thread_infos; i++)
     {
         // Draw all markers
-        MarkerList& markers = m_thread_infos[i].markers_done[read_id];
+        const std::vector<Marker> &markers = m_thread_infos[i]->m_markers_done;
 
         if (markers.empty())
             continue;
@@ -280,16 +540,15 @@ void Profiler::draw()
             else
                 m_capture_report_buffer->getStdStream() << i << ";";
         }
-        MarkerList::const_iterator it_end = markers.end();
-        for (MarkerList::const_iterator it = markers.begin(); it != it_end; it++)
+        for (unsigned int j = 0; j < markers.size(); j++)
         {
-            const Marker&    m = *it;
+            const Marker&    m = markers[j];
             assert(m.end >= 0.0);
 
             if (m_capture_report)
             {
                 if (m_first_capture_sweep)
-                    m_capture_report_buffer->getStdStream() << "\"" << m.name << "\";";
+                    m_capture_report_buffer->getStdStream() << "\"" << m_names[m.name].m_name << "\";";
                 else
                     m_capture_report_buffer->getStdStream() << (int)round((m.end - m.start) * 1000) << ";";
             }
@@ -302,7 +561,7 @@ void Profiler::draw()
             pos.UpperLeftCorner.Y  += m.layer*2;
             pos.LowerRightCorner.Y -= m.layer*2;
 
-            GL32_draw2DRectangle(m.color, pos);
+            GL32_draw2DRectangle(m_names[m.name].m_color, pos);
 
             // If the mouse cursor is over the marker, get its information
             if(pos.isPointInside(mouse_pos))
@@ -379,7 +638,7 @@ void Profiler::draw()
             Marker& m = hovered_markers.top();
             std::ostringstream oss;
             oss.precision(4);
-            oss << m.name << " [" << (m.end - m.start) << " ms / ";
+            oss << m_names[m.name].m_name << " [" << (m.end - m.start) << " ms / ";
             oss.precision(3);
             oss << (m.end - m.start)*100.0 / duration << "%]" << std::endl;
             text += oss.str().c_str();
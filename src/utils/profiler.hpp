@@ -18,15 +18,22 @@
 #ifndef PROFILER_HPP
 #define PROFILER_HPP
 
+#include "utils/cpp2011.hpp"
+#include "utils/types.hpp"
+
 #include <irrlicht.h>
-#include <list>
+#include <map>
+#include <pthread.h>
 #include <vector>
-#include <stack>
 #include <string>
 #include <streambuf>
 #include <ostream>
 #include <iostream>
 
+#ifdef STDCPP2011
+#  include <atomic>
+#endif
+
 
 class Profiler;
 extern Profiler profiler;
@@ -94,44 +101,109 @@ public:
 
 /**
   * \brief class that allows run-time graphical profiling through the use of markers
+  * Markers can be pushed and popped from any thread. Each thread records
+  * its markers as begin/end events into its own ring buffer, which only
+  * that thread writes to, so no locking is needed. Marker names are
+  * interned: each name is stored once in a name table and the events only
+  * store its index. After the first use of a name in a thread no memory is
+  * allocated when pushing or popping markers.
+  * Once per frame (synchronizeFrame()) the main thread converts the events
+  * of the last frame of all threads into markers for drawing. The events
+  * still in the ring buffers can be written as a trace file that can be
+  * loaded in Chrome's about:tracing (see writeChromeTrace()).
   * \ingroup utils
   */
 class Profiler
 {
 private:
+    /** Maximum number of threads that can use the profiler. */
+    static const int MAX_THREADS       = 32;
+    /** Maximum number of different marker names. */
+    static const int MAX_NAMES         = 1024;
+    /** Number of events stored per thread, must be a power of 2. */
+    static const int EVENT_BUFFER_SIZE = 1<<16;
+    /** Size of the per thread cache mapping name pointers to name ids. */
+    static const int NAME_CACHE_SIZE   = 256;
+
+    /** A begin or end event of a marker. */
+    struct Event
+    {
+        double   m_time;    // in milliseconds
+        uint16_t m_name;    // index in m_names
+        bool     m_begin;   // true for begin, false for end
+    };
+
+    /** A finished marker, used for drawing. */
     struct Marker
     {
-        double  start;  // Times of start and end, in milliseconds,
-        double  end;    // relatively to the time of last synchronization
-        size_t  layer;
-
-        std::string     name;
-        video::SColor   color;
-
-        Marker(double start, double end, const char* name="N/A", const video::SColor& color=video::SColor(), size_t layer=0)
-            : start(start), end(end), layer(layer), name(name), color(color)
-        {
-        }
-
-        Marker(const Marker& ref)
-            : start(ref.start), end(ref.end), layer(ref.layer), name(ref.name), color(ref.color)
-        {
-        }
+        double   start;  // Times of start and end, in milliseconds,
+        double   end;    // relatively to the time of last synchronization
+        size_t   layer;
+        uint16_t name;
     };
 
-    typedef    std::list<Marker>   MarkerList;
-    typedef    std::stack<Marker>  MarkerStack;
+    /** An entry of the name table. */
+    struct NameInfo
+    {
+        char          m_name[64];
+        video::SColor m_color;
+    };
 
-    struct ThreadInfo
+    /** Maps the pointer of a name to its index, per thread. */
+    struct NameCacheEntry
     {
-        MarkerList   markers_done[2];
-        MarkerStack  markers_stack[2];
+        const char *m_pointer;
+        uint16_t    m_name;
     };
 
-    typedef    std::vector<ThreadInfo>  ThreadInfoList;
+    struct ThreadInfo
+    {
+        /** Index of this thread in m_thread_infos. */
+        int                    m_index;
+        /** Name shown in the trace. */
+        char                   m_name[32];
+        /** The ring buffer of events, only written by the owning thread. */
+        Event                 *m_events;
+        /** Total number of events written. The event with number n is
+         *  stored at n % EVENT_BUFFER_SIZE. Only accessed through
+         *  getNumEvents() and setNumEvents(). */
+#ifdef STDCPP2011
+        std::atomic<uint32_t>  m_num_events;
+#else
+        uint32_t               m_num_events;
+        /** Protects m_num_events if there are no C++11 atomics. */
+        mutable pthread_mutex_t m_events_mutex;
+#endif
+        /** Cache of interned names, only used by the owning thread. */
+        NameCacheEntry         m_name_cache[NAME_CACHE_SIZE];
+
+        // The following members are only used by the main thread in
+        // synchronizeFrame() and draw().
+        /** Number of the next event to be converted into a marker. */
+        uint32_t               m_read_index;
+        /** Markers that have been started, but not finished. */
+        std::vector<Marker>    m_open_markers;
+        /** Finished markers of the last frame. */
+        std::vector<Marker>    m_markers_done;
+    };
 
-    ThreadInfoList  m_thread_infos;
-    int             m_write_id;
+    /** Information about all threads that used the profiler. */
+    ThreadInfo         *m_thread_infos[MAX_THREADS];
+    /** Number of entries in m_thread_infos, protected by m_threads_mutex. */
+    int                 m_num_threads;
+
+    /** The interned marker names. Entries below m_num_names are never
+     *  changed, so they can be read without locking. */
+    NameInfo            m_names[MAX_NAMES];
+    /** Number of interned names, protected by m_names_mutex. */
+    int                 m_num_names;
+    /** Maps names to their index, protected by m_names_mutex. */
+    std::map<std::string, uint16_t> m_name_index;
+    pthread_mutex_t     m_names_mutex;
+    /** Protects registering new threads. */
+    pthread_mutex_t     m_threads_mutex;
+
+    double          m_time_start;
     double          m_time_last_sync;
     double          m_time_between_sync;
 
@@ -150,6 +222,16 @@ private:
     bool m_first_capture_sweep;
     StringBuffer* m_capture_report_buffer;
 
+    ThreadInfo* getThreadInfo();
+    int         getNumThreads();
+    uint16_t    internName(ThreadInfo *ti, const char *name,
+                           const video::SColor &color);
+    void        addEvent(ThreadInfo *ti, uint16_t name, bool begin);
+    static uint32_t getFirstValidEvent(uint32_t end);
+    static uint32_t getNumEvents(const ThreadInfo *ti);
+    static void     setNumEvents(ThreadInfo *ti, uint32_t n);
+    void        collectMarkers(ThreadInfo *ti, double now, bool keep);
+
 public:
     Profiler();
     virtual ~Profiler();
@@ -157,6 +239,8 @@ public:
     void    pushCpuMarker(const char* name="N/A", const video::SColor& color=video::SColor());
     void    popCpuMarker();
     void    synchronizeFrame();
+    void    setThreadName(const char *name);
+    bool    writeChromeTrace(const std::string &filename);
 
     void    draw();
 
@@ -168,8 +252,6 @@ public:
     bool isFrozen() const { return m_freeze_state == FROZEN; }
 
 protected:
-    // TODO: detect on which thread this is called to support multithreading
-    ThreadInfo& getThreadInfo() { return m_thread_infos[0]; }
     void        drawBackground();
 
 
@@ -0,0 +1,164 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/thread_pool.hpp"
+
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+
+#ifdef WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+/** Creates the pool and starts the worker threads.
+ *  \param num_threads Number of worker threads. If it is 0, one thread per
+ *         core is created.
+ */
+ThreadPool::ThreadPool(int num_threads)
+{
+    m_num_running = 0;
+    m_abort       = false;
+    pthread_cond_init(&m_job_available, NULL);
+    pthread_cond_init(&m_all_done, NULL);
+
+    if (num_threads <= 0)
+        num_threads = getNumCores();
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, &ThreadPool::mainLoop, this) != 0)
+        {
+            Log::error("ThreadPool", "Could not create thread %d.", i);
+            continue;
+        }
+        m_threads.push_back(thread);
+    }
+}   // ThreadPool
+
+// ----------------------------------------------------------------------------
+/** Waits for all jobs to be finished and then stops all worker threads.
+ */
+ThreadPool::~ThreadPool()
+{
+    waitForAll();
+
+    m_jobs.lock();
+    m_abort = true;
+    pthread_cond_broadcast(&m_job_available);
+    m_jobs.unlock();
+
+    for (unsigned int i = 0; i < m_threads.size(); i++)
+        pthread_join(m_threads[i], NULL);
+
+    pthread_cond_destroy(&m_job_available);
+    pthread_cond_destroy(&m_all_done);
+}   // ~ThreadPool
+
+// ----------------------------------------------------------------------------
+/** Adds a job. It is executed as soon as a worker thread is available. If
+ *  the pool has no threads (e.g. thread creation failed), the job is
+ *  executed immediately in the calling thread.
+ *  \param function The function to execute.
+ *  \param data Pointer that is passed to the function.
+ */
+void ThreadPool::addJob(JobFunction function, void *data)
+{
+    if (m_threads.empty())
+    {
+        function(data);
+        return;
+    }
+
+    Job job;
+    job.m_function = function;
+    job.m_data     = data;
+
+    m_jobs.lock();
+    m_jobs.getData().push_back(job);
+    pthread_cond_signal(&m_job_available);
+    m_jobs.unlock();
+}   // addJob
+
+// ----------------------------------------------------------------------------
+/** Blocks until all jobs added so far are finished. Must not be called from
+ *  a job.
+ */
+void ThreadPool::waitForAll()
+{
+    m_jobs.lock();
+    while (!m_jobs.getData().empty() || m_num_running > 0)
+        pthread_cond_wait(&m_all_done, m_jobs.getMutex());
+    m_jobs.unlock();
+}   // waitForAll
+
+// ----------------------------------------------------------------------------
+/** The main loop of each worker thread: waits for jobs and executes them.
+ *  \param obj Pointer to the thread pool.
+ */
+void *ThreadPool::mainLoop(void *obj)
+{
+    ThreadPool *me = (ThreadPool*)obj;
+    profiler.setThreadName("Worker");
+
+    me->m_jobs.lock();
+    while (true)
+    {
+        std::deque<Job> &jobs = me->m_jobs.getData();
+        while (jobs.empty() && !me->m_abort)
+            pthread_cond_wait(&me->m_job_available, me->m_jobs.getMutex());
+        if (me->m_abort)
+            break;
+
+        Job job = jobs.front();
+        jobs.pop_front();
+        me->m_num_running++;
+        me->m_jobs.unlock();
+
+        PROFILER_PUSH_CPU_MARKER("Job", 0x3F, 0x7F, 0x00);
+        job.m_function(job.m_data);
+        PROFILER_POP_CPU_MARKER();
+
+        me->m_jobs.lock();
+        me->m_num_running--;
+        if (me->m_num_running == 0 && me->m_jobs.getData().empty())
+            pthread_cond_broadcast(&me->m_all_done);
+    }
+    me->m_jobs.unlock();
+    return NULL;
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Returns the number of cores (or at least 1 if it can not be determined).
+ */
+int ThreadPool::getNumCores()
+{
+#ifdef WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int n = (int)info.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n > 0 ? n : 1;
+}   // getNumCores
+
+/* EOF */
@@ -0,0 +1,84 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_THREAD_POOL_HPP
+#define HEADER_THREAD_POOL_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/synchronised.hpp"
+
+#include <deque>
+#include <pthread.h>
+#include <vector>
+
+/** A fixed set of worker threads that execute jobs. A job is a function
+ *  and a pointer passed to it. Jobs are executed in the order they are
+ *  added, but jobs can run concurrently, so they must not depend on each
+ *  other. waitForAll() blocks until all jobs added so far are finished,
+ *  which makes it easy to split one step of work (e.g. updating several
+ *  races) over all cores and then continue when everything is done.
+ */
+class ThreadPool : public NoCopy
+{
+public:
+    /** The type of functions that can be executed as job. */
+    typedef void (*JobFunction)(void *data);
+
+private:
+    struct Job
+    {
+        JobFunction m_function;
+        void       *m_data;
+    };
+
+    /** The worker threads. */
+    std::vector<pthread_t>   m_threads;
+
+    /** The queue of jobs not yet started. The mutex of this variable also
+     *  protects m_num_running and m_abort. */
+    Synchronised<std::deque<Job> > m_jobs;
+
+    /** Signalled when a job is added or the pool is shut down. */
+    pthread_cond_t           m_job_available;
+
+    /** Signalled when the last running job is finished. */
+    pthread_cond_t           m_all_done;
+
+    /** Number of jobs currently being executed. */
+    int                      m_num_running;
+
+    /** Set to shut the worker threads down. */
+    bool                     m_abort;
+
+    static void *mainLoop(void *obj);
+
+public:
+                 ThreadPool(int num_threads=0);
+                ~ThreadPool();
+    void         addJob(JobFunction function, void *data);
+    void         waitForAll();
+    static int   getNumCores();
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of worker threads. */
+    unsigned int getNumThreads() const { return m_threads.size(); }
+};   // ThreadPool
+
+#endif
+
+/* EOF */
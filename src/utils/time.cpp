@@ -31,6 +31,53 @@ double StkTime::getRealTime(long startAt)
     return irr_driver->getRealTime()/1000.0;
 }   // getTimeSinceEpoch
 
+// ----------------------------------------------------------------------------
+/** Returns the time in seconds of a monotonic clock. Only differences between
+ *  two values are meaningful.
+ */
+double StkTime::getMonoTime()
+{
+#ifdef WIN32
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#elif defined(__APPLE__)
+    // Older OSX versions do not have clock_gettime
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*1.0e-6;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1.0e-9;
+#endif
+}   // getMonoTime
+
+// ----------------------------------------------------------------------------
+/** Sleeps until the monotonic clock reaches the given time. The OS sleep is
+ *  only accurate to about a millisecond, so the thread sleeps until shortly
+ *  before the deadline and then yields until the deadline is reached.
+ *  \param mono_time The time (as returned by getMonoTime()) to wake up at.
+ */
+void StkTime::sleepUntil(double mono_time)
+{
+    double remaining = mono_time - getMonoTime();
+    if (remaining > 0.002)
+        sleep((int)((remaining - 0.001) * 1000.0));
+
+    while (getMonoTime() < mono_time)
+    {
+#ifdef WIN32
+        Sleep(0);
+#else
+        usleep(0);
+#endif
+    }
+}   // sleepUntil
+
 // ----------------------------------------------------------------------------
 /** Returns the current date.
  *  \param day Day (1 - 31).
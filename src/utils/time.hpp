@@ -88,6 +88,19 @@ public:
      */
     static double getRealTime(long startAt=0);
 
+    // ------------------------------------------------------------------------
+    /** Returns the time in seconds of a monotonic clock, which is not
+     *  affected by changes of the system time and does not need an irrlicht
+     *  device. Only differences between two values are meaningful.
+     */
+    static double getMonoTime();
+
+    // ------------------------------------------------------------------------
+    /** Sleeps until the monotonic clock (see getMonoTime()) reaches the
+     *  given time. Returns immediately if that time has already passed.
+     */
+    static void sleepUntil(double mono_time);
+
     // ------------------------------------------------------------------------
     /**
      * \brief Compare two different times.